@@ -49,7 +49,38 @@ endif()
 
 if(${CMAKE_C_COMPILER_ID} STREQUAL "MSVC")
 elseif(${CMAKE_C_COMPILER_ID} STREQUAL "GNU")
-    set(wave_compile_options_release -fomit-frame-pointer -march=native -mtune=native -fvisibility=hidden)
+    set(wave_compile_options_release -fomit-frame-pointer -fvisibility=hidden)
 elseif(${CMAKE_C_COMPILER_ID} MATCHES "^.*Clang$")
     set(wave_compile_options_release -fomit-frame-pointer -fvisibility=hidden)
 endif()
+
+# The sample kernels are built once per instruction set of the target architecture, each with its own flags, and the
+# best one that the CPU supports is picked at run time, so the library itself only needs the baseline instruction set.
+set(wave_kernel_targets "")
+if(CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64|x86|X86|i[3-6]86)$")
+  if(${CMAKE_C_COMPILER_ID} STREQUAL "MSVC")
+    set(wave_kernel_flags_sse2 "")
+    set(wave_kernel_flags_avx2 /arch:AVX2)
+    set(wave_kernel_flags_avx512 /arch:AVX512)
+    list(APPEND wave_kernel_targets sse2 avx2 avx512)
+  else()
+    include(CheckCCompilerFlag)
+    set(wave_kernel_flags_sse2 -msse2)
+    set(wave_kernel_flags_avx2 -mavx2)
+    set(wave_kernel_flags_avx512 -mavx512f)
+    foreach(target sse2 avx2 avx512)
+      check_c_compiler_flag(${wave_kernel_flags_${target}} wave_has_kernel_flag_${target})
+      if(wave_has_kernel_flag_${target})
+        list(APPEND wave_kernel_targets ${target})
+      endif()
+    endforeach()
+    # GCC 12 warns about the undefined vectors inside its own AVX-512 intrinsics
+    if(${CMAKE_C_COMPILER_ID} STREQUAL "GNU")
+      list(APPEND wave_kernel_flags_avx512 -Wno-maybe-uninitialized)
+    endif()
+  endif()
+elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "^(aarch64|arm64|ARM64)$")
+  # NEON is part of the baseline of 64-bit ARM
+  set(wave_kernel_flags_neon "")
+  list(APPEND wave_kernel_targets neon)
+endif()
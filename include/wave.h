@@ -84,6 +84,11 @@ enum {
 #define WAVE_FORMAT_PCM          ((WaveU16)0x0001)
 #endif
 
+/* Microsoft ADPCM, read and written as 16-bit PCM frames */
+#if !((defined(_WIN32) || defined(_WIN64)) && defined(WAVE_FORMAT_ADPCM))
+#define WAVE_FORMAT_ADPCM        ((WaveU16)0x0002)
+#endif
+
 #if !((defined(_WIN32) || defined(_WIN64)) && defined(WAVE_FORMAT_IEEE_FLOAT))
 #define WAVE_FORMAT_IEEE_FLOAT   ((WaveU16)0x0003)
 #endif
@@ -96,16 +101,36 @@ enum {
 #define WAVE_FORMAT_MULAW        ((WaveU16)0x0007)
 #endif
 
+/* IMA ADPCM, read and written as 16-bit PCM frames */
+#if !((defined(_WIN32) || defined(_WIN64)) && defined(WAVE_FORMAT_IMA_ADPCM))
+#define WAVE_FORMAT_IMA_ADPCM    ((WaveU16)0x0011)
+#endif
+
 #if !((defined(_WIN32) || defined(_WIN64)) && defined(WAVE_FORMAT_EXTENSIBLE))
 #define WAVE_FORMAT_EXTENSIBLE   ((WaveU16)0xfffe)
 #endif
 
+/* speaker positions of the channel mask of WAVE_FORMAT_EXTENSIBLE, channels are stored in ascending bit order */
+#define WAVE_SPEAKER_FRONT_LEFT             0x1
+#define WAVE_SPEAKER_FRONT_RIGHT            0x2
+#define WAVE_SPEAKER_FRONT_CENTER           0x4
+#define WAVE_SPEAKER_LOW_FREQUENCY          0x8
+#define WAVE_SPEAKER_BACK_LEFT              0x10
+#define WAVE_SPEAKER_BACK_RIGHT             0x20
+#define WAVE_SPEAKER_FRONT_LEFT_OF_CENTER   0x40
+#define WAVE_SPEAKER_FRONT_RIGHT_OF_CENTER  0x80
+#define WAVE_SPEAKER_BACK_CENTER            0x100
+#define WAVE_SPEAKER_SIDE_LEFT              0x200
+#define WAVE_SPEAKER_SIDE_RIGHT             0x400
+#define WAVE_SPEAKER_TOP_CENTER             0x800
+
 typedef enum {
     WAVE_OK,         /** no error */
     WAVE_ERR_OS,     /** error when {wave} called a stdio function */
     WAVE_ERR_FORMAT, /** not a wave file or unsupported wave format */
     WAVE_ERR_MODE,   /** incorrect mode when opening the wave file or calling mode-specific API */
     WAVE_ERR_PARAM,  /** incorrect parameter passed to the API function */
+    WAVE_ERR_CHECKSUM, /** samples that do not match their block checksum, see {WAVE_OPEN_CHECKSUM} */
 } WaveErrCode;
 
 typedef struct {
@@ -138,6 +163,39 @@ WAVE_API void wave_err_clear(void);
 #define WAVE_OPEN_WRITE      2
 #define WAVE_OPEN_APPEND     4
 
+/** Only write the RIFF/fact/data sizes on {wave_flush} and {wave_close} instead of after every {wave_write}. After a
+ *  crash the sizes in the header lag behind the data, which {WAVE_OPEN_REPAIR} or {wave_repair} can recover. */
+#define WAVE_OPEN_DEFER_SIZES   8
+
+/** Trust the file length over the data size in the header when they disagree. The data size is truncated to whole
+ *  frames. If the file is opened with {WAVE_OPEN_APPEND}, the recovered sizes are written back to the header and a file
+ *  that cannot be parsed is never overwritten. */
+#define WAVE_OPEN_REPAIR        16
+
+/** Open an existing file to change its header and tags without rewriting the samples. The frames can be read, but not
+ *  written. {wave_set_sample_rate}, {wave_set_valid_bits_per_sample}, {wave_set_channel_mask}, {wave_set_sub_format} and
+ *  switching between a plain format and {WAVE_FORMAT_EXTENSIBLE} with {wave_set_format} are allowed, as well as
+ *  {wave_set_info}. The changes are written by {wave_flush} and {wave_close}: the chunks in front of the samples are
+ *  rewritten in place with the space left over kept as a JUNK chunk. Tags always go in front of the samples, so that
+ *  {WAVE_OPEN_APPEND} can add frames later. Only chunks that outgrow the space in front of the samples move them, once, by
+ *  inserting a range into the file on file systems that support it and by copying otherwise, and leave extra room for
+ *  later edits. */
+#define WAVE_OPEN_EDIT          32
+
+/** Keep a CRC32C of every block of about 64 KiB of the data chunk in a "crcc" chunk after the samples. With
+ *  {WAVE_OPEN_WRITE} or {WAVE_OPEN_APPEND}, the checksums are computed as the frames are written and the chunk is written
+ *  by {wave_flush} and {wave_close}. With {WAVE_OPEN_READ} alone, every block that {wave_read} touches is checked once,
+ *  and a read that touches a corrupt block fails with {WAVE_ERR_CHECKSUM}. Appending to a file that has checksums keeps
+ *  them up to date even without this flag. See also {wave_verify}. */
+#define WAVE_OPEN_CHECKSUM      64
+
+/** Read a file that another process or handle is still recording, together with {WAVE_OPEN_READ}. The length of the data
+ *  chunk follows the length of the file: whole frames appended after the last chunk are picked up by {wave_read} and
+ *  {wave_wait}, even when the writer has not updated the sizes in the header yet, e.g. with {WAVE_OPEN_DEFER_SIZES}.
+ *  ADPCM data shows up a whole block at a time, and the padding of the last block only drops out once the writer has
+ *  written the sizes. The file cannot be cached with {wave_set_cache}. */
+#define WAVE_OPEN_FOLLOW        128
+
 typedef struct _WaveFile WaveFile;
 
 /** Open a wav file
@@ -156,7 +214,9 @@ WAVE_API WaveFile* wave_reopen(WaveFile* self, WAVE_CONST char* filename, WaveU3
  *  @param count        The number of frames (block size)
  *  @param self         The pointer to the {WaveFile} structure
  *  @return             The number of frames read. If returned value is less than {count}, either EOF reached or an error occured
- *  @remarks            This API does not support extensible format. For extensible format, use {wave_read_raw} instead.
+ *  @remarks            Frames are returned as stored. Extensible files with a PCM, IEEE float, A-law or mu-law sub format
+ *                      work like the plain format. ADPCM frames are decoded to 16-bit PCM. Runs of whole blocks are decoded straight into {buffer},
+ *                      in parallel when there are many of them, and seeking only decodes the block that holds the frame.
  */
 WAVE_API size_t wave_read(WaveFile* self, void *buffer, size_t count);
 
@@ -166,10 +226,86 @@ WAVE_API size_t wave_read(WaveFile* self, void *buffer, size_t count);
  *  @param count    The number of frames (block size)
  *  @param self     The pointer to the {WaveFile} structure
  *  @return         The number of frames written. If returned value is less than {count}, either EOF reached or an error occured.
- *  @remarks        This API does not support extensible format. For extensible format, use {wave_read_raw} instead.
+ *  @remarks        Frames are written as they are. Extensible files work like the plain format of their sub format.
+ *                  ADPCM files take 16-bit PCM frames, which are encoded a block at a time. The last block is padded and
+ *                  written by {wave_close}, and ADPCM data can only be written sequentially to a new file.
  */
 WAVE_API size_t wave_write(WaveFile* self, WAVE_CONST void *buffer, size_t count);
 
+/** Read a block of frames and convert the samples to float
+ *
+ *  @param self     The {WaveFile} object
+ *  @param buffer   A buffer for {count} interleaved frames of float samples in [-1.0, 1.0)
+ *  @param count    The number of frames
+ *  @return         The number of frames read. If returned value is less than {count}, either EOF reached or an error occured
+ *  @remarks        Works for 8/16/24/32-bit PCM, 32/64-bit IEEE float, A-law, mu-law and ADPCM, plain or extensible.
+ *                  The padding bits of PCM samples with fewer valid bits than the container, e.g. 24 in 32, are ignored.
+ */
+WAVE_API size_t wave_read_float(WaveFile* self, float *buffer, size_t count);
+
+/** Convert a block of float frames to the sample format of the file and write them
+ *
+ *  @param self     The {WaveFile} object
+ *  @param buffer   {count} interleaved frames of float samples, clipped to the range of integer formats
+ *  @param count    The number of frames
+ *  @return         The number of frames written
+ *  @remarks        PCM samples are rounded to the valid bits of the file, leaving the padding bits zero.
+ */
+WAVE_API size_t wave_write_float(WaveFile* self, WAVE_CONST float *buffer, size_t count);
+
+/** One buffer of a scatter/gather transfer, e.g. one of the two parts of a ring buffer on either side of its end */
+typedef struct {
+    void*   buffer;
+    size_t  count;      /** the number of frames */
+} WaveIoVec;
+
+/** Read frames into several buffers in turn, as if {wave_read} was called for each of them
+ *
+ *  @param self         The {WaveFile} object
+ *  @param segments     The buffers, filled in order
+ *  @param num_segments The number of buffers
+ *  @return             The number of frames read in total. If returned value is less than the sum of the counts, either
+ *                      EOF reached or an error occured.
+ *  @remarks            The mode, the length and the position are looked up once, and the frames of all buffers are read
+ *                      with one {preadv} call where it is available. ADPCM files and files with a cache read the buffers
+ *                      one by one.
+ */
+WAVE_API size_t wave_readv(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments);
+
+/** Write the frames of several buffers in turn, as if {wave_write} was called for each of them
+ *
+ *  @return             The number of frames written in total
+ *  @remarks            Without a write buffer, the frames of all buffers are written with one {pwritev} call where it is
+ *                      available and the sizes in the header are updated once. With one, the frames are copied into it.
+ */
+WAVE_API size_t wave_writev(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments);
+
+/** {wave_read_float} for several buffers of float frames in turn, converted one buffer at a time */
+WAVE_API size_t wave_readv_float(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments);
+
+/** {wave_write_float} for several buffers of float frames in turn, converted one buffer at a time */
+WAVE_API size_t wave_writev_float(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments);
+
+/** Wait for frames to be appended to a file opened with {WAVE_OPEN_FOLLOW}
+ *
+ *  @param self         The {WaveFile} object
+ *  @param min_frames   The number of frames after the current position to wait for, at least 1
+ *  @param timeout_ms   The longest time to wait in milliseconds, 0 only looks and a negative value waits without limit
+ *  @return             The number of frames after the current position, which is less than {min_frames} on timeout
+ *  @remarks            Sleeps until the file is written to on Linux, and looks at the file every 10 ms elsewhere. The
+ *                      frames are then read with {wave_read}. {wave_err} can be used to get the error code if there is an
+ *                      error.
+ */
+WAVE_API size_t wave_wait(WaveFile* self, size_t min_frames, long timeout_ms);
+
+/** Get the instruction set of the sample conversion and metering kernels
+ *
+ *  @return         One of "scalar", "sse2", "avx2", "avx512" and "neon"
+ *  @remarks        The best target that the CPU and the OS support is picked once per process. Setting the environment
+ *                  variable {WAVE_KERNELS} to one of the names above caps the choice, e.g. to compare targets on one machine.
+ */
+WAVE_API WAVE_CONST char* wave_get_kernels_target(void);
+
 /** Tell the current position in the wav file.
  *
  *  @param self     The pointer to the WaveFile structure.
@@ -187,16 +323,63 @@ WAVE_API void wave_rewind(WaveFile* self);
  */
 WAVE_API int wave_eof(WAVE_CONST WaveFile* self);
 
+/** Write all buffered frames and the current sizes to the file, then flush the stdio stream */
 WAVE_API int wave_flush(WaveFile* self);
 
+/** Set the size of the write buffer owned by the {WaveFile}
+ *
+ *  @param self     The {WaveFile} object
+ *  @param size     The size in bytes, rounded down to whole frames. 0 disables the buffer, which is the default.
+ *  @remarks        Frames passed to {wave_write} are collected in the buffer and written in one call when it is full,
+ *                  and the sizes in the header are patched only then. The buffer is written out by {wave_flush},
+ *                  {wave_close}, {wave_read} and by {wave_seek} to any other position than the current one. While
+ *                  the buffer is set, the stdio stream of the file is unbuffered.
+ */
+WAVE_API void wave_set_buffer_size(WaveFile* self, size_t size);
+
+/** Reserve disk space for frames that are going to be written
+ *
+ *  @param self         The {WaveFile} object
+ *  @param num_frames   The number of frames to reserve after the current end of the data
+ *  @remarks            The file length is not changed, so a file that is being recovered never contains the reserved
+ *                      space as data. This is a no-op on platforms or file systems without support.
+ */
+WAVE_API void wave_preallocate(WaveFile* self, size_t num_frames);
+
+/** Fix the header of a wav file whose sizes are inconsistent with the file length, e.g. after a crash
+ *
+ *  @param filename     The name of the wav file
+ *  @return             0 on success, otherwise the error code, and {wave_err} can be used to get the error message
+ *  @remarks            A trailing partial frame is truncated from the file.
+ */
+WAVE_API int wave_repair(WAVE_CONST char* filename);
+
 /** Set the format code
  *
  *  @param self     The {WaveFile} object
  *  @param format   The format code, which should be one of `WAVE_FORMAT_*`
- *  @remarks        All data will be cleared after the call. {wave_err} can be used to get the error code if there is an error.
+ *  @remarks        All data will be cleared after the call. A file opened with {WAVE_OPEN_EDIT} keeps its samples and can only switch between a plain format and {WAVE_FORMAT_EXTENSIBLE} with that sub format. {wave_err} can be used to get the error code if there is an error.
  */
 WAVE_API void wave_set_format(WaveFile* self, WaveU16 format);
 
+/** Set a LIST/INFO tag of a file opened with {WAVE_OPEN_EDIT}
+ *
+ *  @param self     The {WaveFile} object
+ *  @param id       The four-character ID of the tag, e.g. "INAM" for the title, "IART" for the artist or "ICMT" for a comment
+ *  @param value    The text of the tag, or NULL or "" to remove it
+ *  @remarks        {wave_err} can be used to get the error code if there is an error.
+ */
+WAVE_API void wave_set_info(WaveFile* self, WAVE_CONST char* id, WAVE_CONST char* value);
+
+/** Get a LIST/INFO tag
+ *
+ *  @param self     The {WaveFile} object
+ *  @param id       The four-character ID of the tag
+ *  @return         The text of the tag, or NULL if the file does not have it. It stays valid until the tag is set again or
+ *                  the file is closed.
+ */
+WAVE_API WAVE_CONST char* wave_get_info(WaveFile* self, WAVE_CONST char* id);
+
 /** Set the number of channels
  *
  *  @param self             The {WaveFile} object
@@ -209,7 +392,7 @@ WAVE_API void wave_set_num_channels(WaveFile* self, WaveU16 num_channels);
  *
  *  @param self             The {WaveFile} object
  *  @param sample_rate      The sample rate
- *  @remarks                All data will be cleared after the call. {wave_err} can be used to get the error code if there is an error.
+ *  @remarks                All data will be cleared after the call, except on a file opened with {WAVE_OPEN_EDIT}, which keeps its samples. {wave_err} can be used to get the error code if there is an error.
  */
 WAVE_API void wave_set_sample_rate(WaveFile* self, WaveU32 sample_rate);
 
@@ -217,7 +400,7 @@ WAVE_API void wave_set_sample_rate(WaveFile* self, WaveU32 sample_rate);
  *
  *  @param self     The {WaveFile} object
  *  @param bits     The value of valid bits to set
- *  @remarks        If {bits} is 0 or larger than 8*{sample_size}, an error will occur. All data will be cleared after the call. {wave_err} can be used to get the error code if there is an error.
+ *  @remarks        If {bits} is 0 or larger than 8*{sample_size}, an error will occur. All data will be cleared after the call, except on a file opened with {WAVE_OPEN_EDIT}, which keeps its samples. {wave_err} can be used to get the error code if there is an error.
  */
 WAVE_API void wave_set_valid_bits_per_sample(WaveFile* self, WaveU16 bits);
 
@@ -229,6 +412,22 @@ WAVE_API void wave_set_valid_bits_per_sample(WaveFile* self, WaveU16 bits);
  */
 WAVE_API void wave_set_sample_size(WaveFile* self, size_t sample_size);
 
+/** Set the channel mask of a {WAVE_FORMAT_EXTENSIBLE} file
+ *
+ *  @param self             The {WaveFile} object
+ *  @param channel_mask     The speaker positions of the channels, a combination of `WAVE_SPEAKER_*`, or 0 if unassigned
+ *  @remarks                {wave_err} can be used to get the error code if there is an error.
+ */
+WAVE_API void wave_set_channel_mask(WaveFile* self, WaveU32 channel_mask);
+
+/** Set the format code of the samples of a {WAVE_FORMAT_EXTENSIBLE} file
+ *
+ *  @param self             The {WaveFile} object
+ *  @param sub_format       One of {WAVE_FORMAT_PCM}, {WAVE_FORMAT_IEEE_FLOAT}, {WAVE_FORMAT_ALAW} and {WAVE_FORMAT_MULAW}
+ *  @remarks                The sub format takes the encoding of the samples when {wave_set_format} switches a file to {WAVE_FORMAT_EXTENSIBLE}. {wave_err} can be used to get the error code if there is an error.
+ */
+WAVE_API void wave_set_sub_format(WaveFile* self, WaveU16 sub_format);
+
 WAVE_API WaveU16 wave_get_format(WAVE_CONST WaveFile* self);
 WAVE_API WaveU16 wave_get_num_channels(WAVE_CONST WaveFile* self);
 WAVE_API WaveU32 wave_get_sample_rate(WAVE_CONST WaveFile* self);
@@ -238,6 +437,411 @@ WAVE_API size_t wave_get_length(WAVE_CONST WaveFile* self);
 WAVE_API WaveU32 wave_get_channel_mask(WAVE_CONST WaveFile* self);
 WAVE_API WaveU16 wave_get_sub_format(WAVE_CONST WaveFile* self);
 
+/** Append a range of frames of one wav file to another without passing the samples through user space
+ *
+ *  @param src          The source {WaveFile}
+ *  @param first_frame  The index of the first frame to copy
+ *  @param count        The number of frames to copy
+ *  @param dst          The destination {WaveFile}, opened for writing
+ *  @return             The number of frames copied, which is less than {count} if {src} ends earlier or an error occured
+ *  @remarks            An empty {dst} takes the format of {src}, otherwise the formats must match. On Linux the data is
+ *                      moved with {copy_file_range}, which shares extents on file systems that support reflinks. ADPCM
+ *                      files fail with {WAVE_ERR_FORMAT} before anything is written, as do they in {wave_split} and
+ *                      {wave_concat}.
+ */
+WAVE_API size_t wave_copy_range(WaveFile* src, size_t first_frame, size_t count, WaveFile* dst);
+
+/** Split a wav file into {num_splits} + 1 new files
+ *
+ *  @param src          The source {WaveFile}
+ *  @param split_frames The frames at which a new file starts, in ascending order
+ *  @param num_splits   The number of elements in {split_frames}
+ *  @param filenames    {num_splits} + 1 names of the files to create
+ *  @return             The number of files written
+ */
+WAVE_API size_t wave_split(WaveFile* src, WAVE_CONST size_t* split_frames, size_t num_splits, WAVE_CONST char* WAVE_CONST* filenames);
+
+/** Append all frames of {n} wav files with the same format to {dst}
+ *
+ *  @return             The total number of frames copied
+ */
+WAVE_API size_t wave_concat(WaveFile* WAVE_CONST* srcs, size_t n, WaveFile* dst);
+
+typedef enum {
+    WAVE_LAYOUT_INTERLEAVED,    /** frame by frame */
+    WAVE_LAYOUT_PLANAR,         /** channel by channel, each plane as long as the number of frames requested */
+} WaveLayout;
+
+/** A set of wav files with the same sample format, sample rate and length that are read in lock-step, e.g. stems
+ *
+ * The channels of all files are numbered in the order of the files. Each read fetches the block of every file with a
+ * positional read and places it in the output buffer, spread over a pool of worker threads.
+ */
+typedef struct _WaveGroup WaveGroup;
+
+/** Open a group of wav files for reading
+ *
+ *  @param filenames    The names of the files
+ *  @param num_files    The number of files
+ *  @return             NULL if the memory allocation failed. Other errors, including mismatching files and ADPCM files,
+ *                      can be obtained using {wave_err}.
+ *  @remarks            The files must have the same encoding, sample size and valid bits, sample rate and length. Plain
+ *                      and {WAVE_FORMAT_EXTENSIBLE} files with the same samples can be grouped.
+ */
+WAVE_API WaveGroup* wave_group_open(WAVE_CONST char* WAVE_CONST* filenames, size_t num_files);
+WAVE_API void       wave_group_close(WaveGroup* self);
+
+/** Set the number of threads used by reads, including the calling thread. The default is one per file, up to the
+ *  number of CPUs. */
+WAVE_API void       wave_group_set_num_threads(WaveGroup* self, size_t num_threads);
+
+/** Read a block of frames of all files
+ *
+ *  @param self         The {WaveGroup} object
+ *  @param buffer       Room for {count} frames of {wave_group_get_num_channels} samples in the sample format of the files
+ *  @param count        The number of frames
+ *  @param layout       The layout of {buffer}
+ *  @return             The number of frames read. If returned value is less than {count}, either EOF reached or an error occured.
+ */
+WAVE_API size_t     wave_group_read(WaveGroup* self, void *buffer, size_t count, WaveLayout layout);
+
+WAVE_API int        wave_group_seek(WaveGroup* self, long int offset, int origin);
+WAVE_API long int   wave_group_tell(WAVE_CONST WaveGroup* self);
+
+WAVE_API size_t     wave_group_get_num_files(WAVE_CONST WaveGroup* self);
+WAVE_API WaveFile*  wave_group_get_file(WAVE_CONST WaveGroup* self, size_t index);
+WAVE_API WaveU16    wave_group_get_num_channels(WAVE_CONST WaveGroup* self);
+WAVE_API size_t     wave_group_get_sample_size(WAVE_CONST WaveGroup* self);
+WAVE_API size_t     wave_group_get_length(WAVE_CONST WaveGroup* self);
+
+/** A writer that splits one interleaved multichannel stream into one mono file per channel
+ *
+ * Frames are deinterleaved into a staging buffer per channel, which is written to its file in one call when it is full.
+ * The sizes in the headers are written together by {wave_fanout_flush} and {wave_fanout_close}.
+ */
+typedef struct _WaveFanOut WaveFanOut;
+
+/** Create one mono wav file per channel
+ *
+ *  @param filenames    {num_channels} names of the files to create
+ *  @param num_channels The number of channels of the stream
+ *  @param format       The format code of the files
+ *  @param sample_rate  The sample rate of the files
+ *  @param sample_size  The number of bytes per sample, 0 means the default for {format}
+ *  @return             NULL if the memory allocation failed. Other errors can be obtained using {wave_err}.
+ */
+WAVE_API WaveFanOut* wave_fanout_open(WAVE_CONST char* WAVE_CONST* filenames, WaveU16 num_channels, WaveU16 format, WaveU32 sample_rate, size_t sample_size);
+WAVE_API void        wave_fanout_close(WaveFanOut* self);
+
+/** Set the size in bytes of the staging buffer of each channel. The default is 256 KiB. */
+WAVE_API void        wave_fanout_set_buffer_size(WaveFanOut* self, size_t size);
+
+/** Write a block of interleaved frames
+ *
+ *  @return             The number of frames written. If returned value is less than {count}, an error occured.
+ *  @remarks            A failed write of the staged frames can leave them in some files and not in others. The files
+ *                      are then closed as they are by {wave_fanout_close}, and later writes fail with {WAVE_ERR_MODE}.
+ */
+WAVE_API size_t      wave_fanout_write(WaveFanOut* self, WAVE_CONST void *buffer, size_t count);
+
+/** Write all staged frames and the sizes of all files */
+WAVE_API int         wave_fanout_flush(WaveFanOut* self);
+
+WAVE_API WaveFile*   wave_fanout_get_file(WAVE_CONST WaveFanOut* self, size_t channel);
+
+/** Rolling segmented writer
+ *
+ * Splits one continuous stream of frames into a sequence of wave files. The next segment is created and its header
+ * written by a background thread while the current one is being filled, and completed segments are closed on the same
+ * thread, so switching files at a boundary never waits for {fopen}/{fclose}.
+ */
+typedef struct _WaveSegmentWriter WaveSegmentWriter;
+
+/** Called once per completed segment, from the background thread of the writer.
+ *
+ *  @param context      The {context} from {WaveSegmentOptions}
+ *  @param filename     The name of the completed file
+ *  @param num_frames   The number of frames in the file
+ */
+typedef void (*WaveSegmentCallback)(void *context, WAVE_CONST char *filename, size_t num_frames);
+
+typedef struct {
+    WaveU16             format;         /** format code of every segment, 0 means {WAVE_FORMAT_PCM} */
+    WaveU16             num_channels;   /** 0 means the default of {wave_open} */
+    WaveU32             sample_rate;    /** 0 means the default of {wave_open} */
+    size_t              sample_size;    /** 0 means the default for {format} */
+    size_t              max_frames;     /** split after this many frames, 0 for no limit */
+    size_t              max_bytes;      /** split before the data chunk exceeds this many bytes, 0 for no limit */
+    WaveSegmentCallback on_segment;     /** may be NULL */
+    void*               context;
+} WaveSegmentOptions;
+
+/** Open a segmented writer
+ *
+ *  @param pattern      A printf format with one unsigned conversion (e.g. "rec-%05u.wav") that receives the segment index
+ *  @param options      The segmentation options
+ *  @return             NULL if the memory allocation failed. Other errors can be obtained using {wave_err}.
+ */
+WAVE_API WaveSegmentWriter* wave_segment_open(WAVE_CONST char *pattern, WAVE_CONST WaveSegmentOptions *options);
+
+/** Close the current segment and wait until all completed segments have been handed to the callback. A segment that
+ *  failed to close, here or on the background thread, is left out of the callbacks and its error can be obtained using
+ *  {wave_err}. */
+WAVE_API void wave_segment_close(WaveSegmentWriter *self);
+
+/** Write a block of frames, switching files exactly at the frame where a limit is reached
+ *
+ *  @return             The number of frames written. If returned value is less than {count}, an error occured.
+ */
+WAVE_API size_t wave_segment_write(WaveSegmentWriter *self, WAVE_CONST void *buffer, size_t count);
+
+/** Finish the current segment at the current frame. Does nothing if the current segment is empty. */
+WAVE_API void wave_segment_split(WaveSegmentWriter *self);
+
+/** Get the index of the segment currently being written */
+WAVE_API WaveU32 wave_segment_get_index(WAVE_CONST WaveSegmentWriter *self);
+
+/** A size-bounded LRU cache of file blocks and parsed headers that can be shared by any number of read-only {WaveFile}
+ *  objects on any number of threads
+ *
+ * Blocks are keyed by the identity of the file (device, inode, size and modification time) and the index of the aligned
+ * block, so handles of the same file share blocks and a file that changed is never served stale data. The cache is split
+ * into independently locked shards.
+ */
+typedef struct _WaveCache WaveCache;
+
+typedef struct {
+    WaveU64 hits;           /** block lookups served from the cache */
+    WaveU64 misses;         /** block lookups that read the file */
+    WaveU64 header_hits;    /** {wave_open_cached} calls that did not parse the header */
+    WaveU64 header_misses;
+    WaveU64 evictions;
+    size_t  size;           /** bytes currently held */
+} WaveCacheStats;
+
+/** Create a block cache
+ *
+ *  @param capacity     The maximum number of bytes held by the cache
+ *  @param block_size   The size of a block in bytes, 0 means 64 KiB
+ *  @return             NULL if the memory allocation failed
+ */
+WAVE_API WaveCache* wave_cache_create(size_t capacity, size_t block_size);
+
+/** Destroy a block cache. No {WaveFile} may be attached to it any more. */
+WAVE_API void       wave_cache_destroy(WaveCache* self);
+
+WAVE_API void       wave_cache_get_stats(WAVE_CONST WaveCache* self, WaveCacheStats* stats);
+
+/** Open a wav file for reading through a block cache
+ *
+ *  @param filename     The name of the wav file
+ *  @param cache        The cache, which also provides the parsed header if the file has been opened before
+ *  @return             Same as {wave_open}
+ */
+WAVE_API WaveFile*  wave_open_cached(WAVE_CONST char* filename, WaveCache* cache);
+
+/** Serve the reads of a {WaveFile} opened with {WAVE_OPEN_READ} only from a block cache
+ *
+ *  @param self         The {WaveFile} object
+ *  @param cache        The cache, or NULL to detach the current one
+ *  @remarks            {wave_read} and the functions built on it copy from cached blocks, and only missing blocks are
+ *                      read from the file with a positional read. {wave_seek} and {wave_tell} no longer touch the stream.
+ */
+WAVE_API void       wave_set_cache(WaveFile* self, WaveCache* cache);
+
+/** A range of frames of a wav file requested by {wave_read_windows} */
+typedef struct {
+    WAVE_CONST char*    filename;
+    size_t              first_frame;
+    size_t              num_frames;
+} WaveWindow;
+
+typedef struct {
+    size_t      num_channels;   /** channels of every window, 0 means those of the first file. Files must match. */
+    size_t      window_frames;  /** frames per output slot, 0 means the longest window. Longer windows are cut. */
+    size_t      merge_gap;      /** windows of a file that are at most this many frames apart are fetched in one read */
+    size_t      num_threads;    /** 0 means one per CPU */
+    WaveBool    pad_past_end;   /** zero-fill windows that run past the end of their file instead of failing them */
+    WaveCache*  cache;          /** optional block cache shared with other readers */
+    size_t*     frames_read;    /** optional, receives the number of frames read for every window */
+} WaveWindowOptions;
+
+/** Read a batch of windows from any number of files as float samples
+ *
+ *  @param requests     The windows, in any order, with any number of windows per file
+ *  @param n            The number of windows
+ *  @param out          Room for {n} slots of {window_frames} interleaved frames. Slot i receives window i, followed by
+ *                      zeros up to the end of the slot.
+ *  @param options      The options, NULL for the defaults
+ *  @return             The number of windows read. Slots of failed windows are zero, and {wave_err} holds the first error.
+ *  @remarks            The windows are grouped by file and sorted by offset, and every file is opened once. Overlapping
+ *                      and nearby windows are fetched with a single positional read. Files are spread over a pool of
+ *                      threads.
+ */
+WAVE_API size_t wave_read_windows(WAVE_CONST WaveWindow* requests, size_t n, float* out, WAVE_CONST WaveWindowOptions* options);
+
+/** Splits a stream of frames into overlapping analysis frames, e.g. for an STFT or for log-mel and MFCC features
+ *
+ * The samples are kept as float planes in a ring of about two analysis frames plus one hop per channel, so the memory
+ * does not depend on the length of the stream. Without a window function, the analysis frames are views into the ring
+ * and no sample is copied after it is decoded.
+ */
+typedef struct _WaveFramer WaveFramer;
+
+typedef enum {
+    WAVE_FRAMER_RECTANGULAR,    /** no window function */
+    WAVE_FRAMER_HANN,           /** periodic Hann window, 0.5 - 0.5 cos(2 pi i / N) */
+    WAVE_FRAMER_HAMMING,        /** periodic Hamming window, 0.54 - 0.46 cos(2 pi i / N) */
+} WaveFramerWindow;
+
+typedef struct {
+    size_t              frame_size;     /** N, the number of samples of every analysis frame */
+    size_t              hop_size;       /** H, the distance between the starts of two analysis frames, 0 means N */
+    WaveFramerWindow    window;         /** multiplied into every analysis frame */
+    WaveBool            downmix;        /** average the channels into a single plane */
+    WaveBool            pad_end;        /** zero-pad the frame that runs past the end of the stream instead of dropping it */
+} WaveFramerOptions;
+
+/** Frame the samples of a wav file, read with {wave_read_float} as they are needed
+ *
+ *  @param file         The {WaveFile} object, opened for reading. It is not closed with the framer.
+ *  @param options      The framing options
+ *  @return             NULL if the memory allocation failed. Other errors can be obtained using {wave_err}.
+ *  @remarks            A file opened with {WAVE_OPEN_FOLLOW} is framed as it grows: {wave_framer_next} returns
+ *                      {WAVE_FALSE} when there is no whole frame yet, and can be called again after {wave_wait}. Such a
+ *                      stream never ends, so {pad_end} does not apply.
+ */
+WAVE_API WaveFramer* wave_framer_open(WaveFile* file, WAVE_CONST WaveFramerOptions* options);
+
+/** Frame float samples that are passed to {wave_framer_push} instead of a file
+ *
+ *  @param num_channels The number of channels of the pushed frames
+ *  @param options      The framing options
+ *  @return             NULL if the memory allocation failed. Other errors can be obtained using {wave_err}.
+ */
+WAVE_API WaveFramer* wave_framer_create(size_t num_channels, WAVE_CONST WaveFramerOptions* options);
+
+WAVE_API void        wave_framer_close(WaveFramer* self);
+
+/** Add interleaved float frames to a framer from {wave_framer_create}
+ *
+ *  @param frames       The frames, or NULL to mark the end of the stream
+ *  @param count        The number of frames
+ *  @return             The number of frames taken, which is less than {count} when the ring is full. The analysis
+ *                      frames are then taken with {wave_framer_next} before the rest is pushed.
+ */
+WAVE_API size_t      wave_framer_push(WaveFramer* self, WAVE_CONST float* frames, size_t count);
+
+/** Get the next analysis frame
+ *
+ *  @param planes       Receives a pointer to the {frame_size} samples of every channel, or of the single downmixed one
+ *  @return             {WAVE_FALSE} at the end of the stream, when more frames must be pushed or the followed file has
+ *                      not grown enough yet, and on errors, which can be obtained using {wave_err}
+ *  @remarks            The samples are valid until the next call to a function of the framer and must not be modified.
+ */
+WAVE_API WaveBool    wave_framer_next(WaveFramer* self, WAVE_CONST float** planes);
+
+/** Get the number of channels of the analysis frames, 1 with {downmix} */
+WAVE_API size_t      wave_framer_get_num_channels(WAVE_CONST WaveFramer* self);
+
+/** Get the index of the first sample frame of the last analysis frame in the stream */
+WAVE_API WaveU64     wave_framer_tell(WAVE_CONST WaveFramer* self);
+
+/** A range of frames that contains signal, see {wave_scan_activity} */
+typedef struct {
+    size_t  first_frame;
+    size_t  num_frames;
+} WaveRegion;
+
+/** Find the parts of a wav file that are not silent
+ *
+ *  @param self         The {WaveFile} object, opened for reading
+ *  @param threshold    The RMS level over all channels, relative to full scale, below which 10 ms of audio is silent
+ *  @param min_duration The shortest silence in seconds that separates two regions. Shorter ones are part of a region.
+ *  @param regions_out  Receives the regions in ascending order, to be freed with {wave_free_regions}
+ *  @param num_threads  The number of threads, 0 means one per CPU
+ *  @return             The number of regions
+ *  @remarks            The data chunk is read with positional reads in large blocks that are scanned in parallel, so
+ *                      the position of {self} does not change. The regions are plain frame ranges that can be stored
+ *                      and passed to {wave_read_regions} later.
+ */
+WAVE_API size_t wave_scan_activity(WaveFile* self, float threshold, double min_duration, WaveRegion** regions_out, size_t num_threads);
+
+WAVE_API void   wave_free_regions(WaveRegion* regions);
+
+/** Read the frames of a list of regions back to back
+ *
+ *  @param self         The {WaveFile} object
+ *  @param regions      The regions to read
+ *  @param num_regions  The number of regions
+ *  @param buffer       Room for the frames of all regions
+ *  @return             The number of frames read. If returned value is less than the total, an error occured.
+ */
+WAVE_API size_t wave_read_regions(WaveFile* self, WAVE_CONST WaveRegion* regions, size_t num_regions, void *buffer);
+
+/** Check the samples of a wav file against the block checksums written with {WAVE_OPEN_CHECKSUM}
+ *
+ *  @param filename     The name of the wav file
+ *  @param num_threads  The number of threads, 0 means one per CPU
+ *  @param corrupt_out  Receives the frame ranges of the blocks that do not match in ascending order, to be freed with
+ *                      {wave_free_regions}. Adjacent corrupt blocks are merged into one range.
+ *  @return             The number of corrupt ranges, 0 if the file is intact or an error occured, which can be obtained
+ *                      using {wave_err}, e.g. {WAVE_ERR_FORMAT} for a file without checksums.
+ *  @remarks            The blocks are read with positional reads in large batches that are checked in parallel. Frames
+ *                      missing from a truncated file and frames written after the checksums are reported as corrupt.
+ */
+WAVE_API size_t wave_verify(WAVE_CONST char* filename, size_t num_threads, WaveRegion** corrupt_out);
+
+#define WAVE_METER_PEAK         1   /** largest sample magnitude */
+#define WAVE_METER_TRUE_PEAK    2   /** largest magnitude of the signal oversampled by 4 as in ITU-R BS.1770 */
+#define WAVE_METER_RMS          4
+#define WAVE_METER_DC           8   /** mean of the samples */
+#define WAVE_METER_CLIPS        16  /** samples at the limit of the sample format */
+#define WAVE_METER_LOUDNESS     32  /** EBU R128 integrated, short-term and momentary loudness */
+#define WAVE_METER_ALL          63
+
+/** Peak, RMS and DC are relative to full scale, i.e. 1.0 for a full-scale sample */
+typedef struct {
+    double  peak;
+    double  true_peak;
+    double  rms;
+    double  dc;
+    WaveU64 clips;
+} WaveChannelStats;
+
+/** Loudness in LUFS, -HUGE_VAL until enough frames have been seen: 400 ms for the momentary loudness and 3 s for the
+ *  short-term loudness */
+typedef struct {
+    double  integrated;     /** gated loudness of everything seen so far */
+    double  short_term;     /** loudness of the last 3 s */
+    double  momentary;      /** loudness of the last 400 ms */
+} WaveLoudness;
+
+/** Analyze every frame that is read or written through a {WaveFile}
+ *
+ *  @param self     The {WaveFile} object
+ *  @param flags    `WAVE_METER_*` flags of the measurements, 0 detaches the meter
+ *  @remarks        The frames passing through {wave_read}, {wave_write} and the functions built on them are measured in
+ *                  the same pass, so no second read of the file is needed. Attaching a meter resets all measurements.
+ *                  Formats that {wave_read_float} cannot convert are not supported.
+ */
+WAVE_API void wave_attach_meter(WaveFile* self, WaveU32 flags);
+
+/** Get the measurements of one channel
+ *
+ *  @param self     The {WaveFile} object with a meter attached
+ *  @param channel  The index of the channel
+ *  @param stats    Receives the measurements, zero if they were not requested
+ */
+WAVE_API void wave_get_channel_stats(WAVE_CONST WaveFile* self, size_t channel, WaveChannelStats* stats);
+
+/** Get the loudness of all channels, weighted as in ITU-R BS.1770 by the channel mask, or as mono, stereo or 5.1 without one
+ *
+ *  @param self     The {WaveFile} object with a meter attached with {WAVE_METER_LOUDNESS}
+ *  @param loudness Receives the loudness
+ */
+WAVE_API void wave_get_loudness(WAVE_CONST WaveFile* self, WaveLoudness* loudness);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1239 @@
+/** C++17 wrapper of libwave
+ *
+ * Header-only. {wave::File} owns a {WaveFile*}, {wave::Reader} and {wave::Writer} convert between the sample encoding
+ * of the file and the sample type {T} of the caller. The conversion kernel is instantiated at compile time for {T}, the
+ * layout and every encoding, and the one matching the file is selected once when the reader or writer is created.
+ *
+ * With C++20, {wave::AsyncReader} reads blocks ahead on the threads of a shared {wave::IoContext} and hands them to
+ * coroutines, see {AsyncReader::next_block} and {AsyncReader::blocks}.
+ *
+ * Supported sample types are {std::int16_t}, {std::int32_t}, {float} and {double}. Integers are full scale, floating
+ * point samples are in [-1, 1).
+ */
+
+#ifndef __WAVE_HPP__
+#define __WAVE_HPP__
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#define WAVE_HPP_HAS_SPAN 1
+#endif
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <thread>
+#define WAVE_HPP_HAS_COROUTINE 1
+#endif
+
+#include "wave.h"
+
+namespace wave {
+
+struct Error {
+    WaveErrCode code = WAVE_OK;
+    std::string message;
+};
+
+/** Take the pending error of the calling thread out of {wave_err} */
+inline Error take_error()
+{
+    Error error{wave_err()->code, wave_err()->message};
+    wave_err_clear();
+    return error;
+}
+
+/** An expected-style result holding either a value or an {Error} */
+template <typename T>
+class Result {
+public:
+    Result(T value) : ok_(true) { new (&storage_.value) T(std::move(value)); }
+    Result(Error error) : ok_(false) { new (&storage_.error) Error(std::move(error)); }
+
+    Result(Result&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : ok_(other.ok_)
+    {
+        if (ok_) {
+            new (&storage_.value) T(std::move(other.storage_.value));
+        } else {
+            new (&storage_.error) Error(std::move(other.storage_.error));
+        }
+    }
+
+    Result& operator=(Result&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &other) {
+            destroy();
+            ok_ = other.ok_;
+            if (ok_) {
+                new (&storage_.value) T(std::move(other.storage_.value));
+            } else {
+                new (&storage_.error) Error(std::move(other.storage_.error));
+            }
+        }
+        return *this;
+    }
+
+    ~Result() { destroy(); }
+
+    bool has_value() const noexcept { return ok_; }
+    explicit operator bool() const noexcept { return ok_; }
+
+    T& value() & { return storage_.value; }
+    const T& value() const& { return storage_.value; }
+    T&& value() && { return std::move(storage_.value); }
+    const Error& error() const { return storage_.error; }
+
+    T& operator*() & { return storage_.value; }
+    const T& operator*() const& { return storage_.value; }
+    T&& operator*() && { return std::move(storage_.value); }
+    T* operator->() { return &storage_.value; }
+    const T* operator->() const { return &storage_.value; }
+
+private:
+    void destroy()
+    {
+        if (ok_) {
+            storage_.value.~T();
+        } else {
+            storage_.error.~Error();
+        }
+    }
+
+    union Storage {
+        Storage() {}
+        ~Storage() {}
+        T     value;
+        Error error;
+    } storage_;
+    bool ok_;
+};
+
+template <>
+class Result<void> {
+public:
+    Result() = default;
+    Result(Error error) : ok_(false), error_(std::move(error)) {}
+
+    bool has_value() const noexcept { return ok_; }
+    explicit operator bool() const noexcept { return ok_; }
+    void value() const {}
+    const Error& error() const { return error_; }
+
+private:
+    bool  ok_ = true;
+    Error error_;
+};
+
+enum class Layout {
+    Interleaved,    /** frame by frame: L R L R ... */
+    Planar,         /** channel by channel: L L ... R R ..., each plane as long as the requested number of frames */
+};
+
+/** The format of a new file, 0 means the default of {wave_open} */
+struct Spec {
+    WaveU16     format = WAVE_FORMAT_PCM;
+    WaveU16     num_channels = 0;
+    WaveU32     sample_rate = 0;
+    std::size_t sample_size = 0;
+};
+
+/** Move-only owner of a {WaveFile*} */
+class File {
+public:
+    File() noexcept = default;
+    explicit File(WaveFile* fp) noexcept : fp_(fp) {}
+    File(File&& other) noexcept : fp_(std::exchange(other.fp_, nullptr)) {}
+    File& operator=(File&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            fp_ = std::exchange(other.fp_, nullptr);
+        }
+        return *this;
+    }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() { close(); }
+
+    static Result<File> open(const char* filename, WaveU32 mode)
+    {
+        File file(wave_open(filename, mode));
+        if (!file.fp_) {
+            return Error{WAVE_ERR_OS, "Failed to allocate memory for a WaveFile"};
+        }
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return file;
+    }
+
+    static Result<File> create(const char* filename, const Spec& spec, WaveU32 mode = WAVE_OPEN_WRITE)
+    {
+        auto file = open(filename, mode);
+        if (!file) {
+            return file;
+        }
+        WaveFile* fp = file->get();
+        if (spec.format != 0) {
+            wave_set_format(fp, spec.format);
+        }
+        if (wave_err()->code == WAVE_OK && spec.num_channels != 0) {
+            wave_set_num_channels(fp, spec.num_channels);
+        }
+        if (wave_err()->code == WAVE_OK && spec.sample_rate != 0) {
+            wave_set_sample_rate(fp, spec.sample_rate);
+        }
+        if (wave_err()->code == WAVE_OK && spec.sample_size != 0) {
+            wave_set_sample_size(fp, spec.sample_size);
+        }
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return file;
+    }
+
+    void close() noexcept
+    {
+        if (fp_) {
+            wave_close(fp_);
+            fp_ = nullptr;
+        }
+    }
+
+    WaveFile* get() const noexcept { return fp_; }
+    WaveFile* release() noexcept { return std::exchange(fp_, nullptr); }
+    explicit operator bool() const noexcept { return fp_ != nullptr; }
+
+    WaveU16 format() const { return wave_get_format(fp_); }
+    WaveU16 sub_format() const { return wave_get_sub_format(fp_); }
+    WaveU16 num_channels() const { return wave_get_num_channels(fp_); }
+    WaveU32 sample_rate() const { return wave_get_sample_rate(fp_); }
+    WaveU16 valid_bits_per_sample() const { return wave_get_valid_bits_per_sample(fp_); }
+    std::size_t sample_size() const { return wave_get_sample_size(fp_); }
+    std::size_t length() const { return wave_get_length(fp_); }
+    WaveU32 channel_mask() const { return wave_get_channel_mask(fp_); }
+
+    Result<std::size_t> tell() const
+    {
+        long pos = wave_tell(fp_);
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return static_cast<std::size_t>(pos);
+    }
+
+    Result<void> seek(long offset, int origin = SEEK_SET)
+    {
+        wave_seek(fp_, offset, origin);
+        return check();
+    }
+
+    Result<void> flush()
+    {
+        wave_flush(fp_);
+        return check();
+    }
+
+    Result<std::size_t> read_raw(void* buffer, std::size_t frames)
+    {
+        std::size_t n = wave_read(fp_, buffer, frames);
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return n;
+    }
+
+    Result<std::size_t> write_raw(const void* buffer, std::size_t frames)
+    {
+        std::size_t n = wave_write(fp_, buffer, frames);
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return n;
+    }
+
+private:
+    static Result<void> check()
+    {
+        if (wave_err()->code != WAVE_OK) {
+            return take_error();
+        }
+        return {};
+    }
+
+    WaveFile* fp_ = nullptr;
+};
+
+namespace detail {
+
+enum class Encoding { U8, S16, S24, S32, F32, F64, ALaw, MuLaw, Unsupported };
+
+inline Encoding encoding_of(const File& file)
+{
+    WaveU16     format = file.format();
+    std::size_t size = file.sample_size();
+
+    if (format == WAVE_FORMAT_EXTENSIBLE) {
+        format = file.sub_format();
+    }
+
+    switch (format) {
+        case WAVE_FORMAT_PCM:
+            switch (size) {
+                case 1: return Encoding::U8;
+                case 2: return Encoding::S16;
+                case 3: return Encoding::S24;
+                case 4: return Encoding::S32;
+                default: return Encoding::Unsupported;
+            }
+        case WAVE_FORMAT_IEEE_FLOAT:
+            return size == 4 ? Encoding::F32 : size == 8 ? Encoding::F64 : Encoding::Unsupported;
+        case WAVE_FORMAT_ALAW:
+            return size == 1 ? Encoding::ALaw : Encoding::Unsupported;
+        case WAVE_FORMAT_MULAW:
+            return size == 1 ? Encoding::MuLaw : Encoding::Unsupported;
+        default:
+            return Encoding::Unsupported;
+    }
+}
+
+inline std::int16_t alaw_to_s16(std::uint8_t a)
+{
+    a ^= 0x55;
+    int exponent = (a >> 4) & 7;
+    int mantissa = a & 0x0f;
+    int magnitude = exponent == 0 ? (mantissa << 4) + 8 : ((mantissa << 4) + 0x108) << (exponent - 1);
+    return static_cast<std::int16_t>((a & 0x80) ? magnitude : -magnitude);
+}
+
+inline std::uint8_t s16_to_alaw(std::int16_t sample)
+{
+    int pcm = sample >> 3;
+    int mask = 0xd5;
+    if (pcm < 0) {
+        pcm = -pcm - 1;
+        mask = 0x55;
+    }
+    int segment = 0;
+    while (segment < 8 && pcm > (0x20 << segment) - 1) {
+        ++segment;
+    }
+    if (segment >= 8) {
+        return static_cast<std::uint8_t>(0x7f ^ mask);
+    }
+    int mantissa = segment < 2 ? (pcm >> 1) & 0x0f : (pcm >> segment) & 0x0f;
+    return static_cast<std::uint8_t>(((segment << 4) | mantissa) ^ mask);
+}
+
+inline std::int16_t mulaw_to_s16(std::uint8_t u)
+{
+    u = static_cast<std::uint8_t>(~u);
+    int exponent = (u >> 4) & 7;
+    int magnitude = ((((u & 0x0f) << 3) + 0x84) << exponent) - 0x84;
+    return static_cast<std::int16_t>((u & 0x80) ? -magnitude : magnitude);
+}
+
+inline std::uint8_t s16_to_mulaw(std::int16_t sample)
+{
+    int          pcm = sample;
+    std::uint8_t sign = 0;
+    if (pcm < 0) {
+        pcm = -pcm;
+        sign = 0x80;
+    }
+    pcm = (pcm > 32635 ? 32635 : pcm) + 0x84;
+    int exponent = 7;
+    for (int mask = 0x4000; (pcm & mask) == 0 && exponent > 0; mask >>= 1) {
+        --exponent;
+    }
+    int mantissa = (pcm >> (exponent + 3)) & 0x0f;
+    return static_cast<std::uint8_t>(~(sign | (exponent << 4) | mantissa));
+}
+
+/* Every encoding loads to and stores from either a left-justified int32 or a double */
+template <Encoding E>
+struct Codec;
+
+template <>
+struct Codec<Encoding::U8> {
+    static constexpr std::size_t size = 1;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(p[0] ^ 0x80) << 24); }
+    static void store(unsigned char* p, std::int32_t v) { p[0] = static_cast<unsigned char>((static_cast<std::uint32_t>(v) >> 24) ^ 0x80); }
+};
+
+template <>
+struct Codec<Encoding::S16> {
+    static constexpr std::size_t size = 2;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p)
+    {
+        std::int16_t v;
+        std::memcpy(&v, p, 2);
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(v) << 16);
+    }
+    static void store(unsigned char* p, std::int32_t v)
+    {
+        std::int16_t s = static_cast<std::int16_t>(v >> 16);
+        std::memcpy(p, &s, 2);
+    }
+};
+
+template <>
+struct Codec<Encoding::S24> {
+    static constexpr std::size_t size = 3;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p)
+    {
+        return static_cast<std::int32_t>((std::uint32_t(p[0]) << 8) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 24));
+    }
+    static void store(unsigned char* p, std::int32_t v)
+    {
+        std::uint32_t u = static_cast<std::uint32_t>(v);
+        p[0] = static_cast<unsigned char>(u >> 8);
+        p[1] = static_cast<unsigned char>(u >> 16);
+        p[2] = static_cast<unsigned char>(u >> 24);
+    }
+};
+
+template <>
+struct Codec<Encoding::S32> {
+    static constexpr std::size_t size = 4;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p)
+    {
+        std::int32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+    static void store(unsigned char* p, std::int32_t v) { std::memcpy(p, &v, 4); }
+};
+
+template <>
+struct Codec<Encoding::F32> {
+    static constexpr std::size_t size = 4;
+    static constexpr bool is_float = true;
+    static double load(const unsigned char* p)
+    {
+        float v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+    static void store(unsigned char* p, double v)
+    {
+        float f = static_cast<float>(v);
+        std::memcpy(p, &f, 4);
+    }
+};
+
+template <>
+struct Codec<Encoding::F64> {
+    static constexpr std::size_t size = 8;
+    static constexpr bool is_float = true;
+    static double load(const unsigned char* p)
+    {
+        double v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+    static void store(unsigned char* p, double v) { std::memcpy(p, &v, 8); }
+};
+
+template <>
+struct Codec<Encoding::ALaw> {
+    static constexpr std::size_t size = 1;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(alaw_to_s16(p[0])) << 16); }
+    static void store(unsigned char* p, std::int32_t v) { p[0] = s16_to_alaw(static_cast<std::int16_t>(v >> 16)); }
+};
+
+template <>
+struct Codec<Encoding::MuLaw> {
+    static constexpr std::size_t size = 1;
+    static constexpr bool is_float = false;
+    static std::int32_t load(const unsigned char* p) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(mulaw_to_s16(p[0])) << 16); }
+    static void store(unsigned char* p, std::int32_t v) { p[0] = s16_to_mulaw(static_cast<std::int16_t>(v >> 16)); }
+};
+
+template <typename T>
+constexpr bool is_sample_type_v = std::is_same_v<T, std::int16_t> || std::is_same_v<T, std::int32_t> ||
+                                  std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template <typename T>
+constexpr double full_scale_v = std::is_floating_point_v<T> ? 1.0 : static_cast<double>(std::uint64_t(1) << (8 * sizeof(T) - 1));
+
+template <typename T>
+T from_double(double x)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(x);
+    } else {
+        double v = std::nearbyint(x * full_scale_v<T>);
+        if (v >= full_scale_v<T>) {
+            return static_cast<T>(full_scale_v<T> - 1);
+        }
+        if (v < -full_scale_v<T>) {
+            return static_cast<T>(-full_scale_v<T>);
+        }
+        return static_cast<T>(v);
+    }
+}
+
+template <typename T, Encoding E>
+T decode_one(const unsigned char* p)
+{
+    if constexpr (Codec<E>::is_float) {
+        return from_double<T>(Codec<E>::load(p));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(Codec<E>::load(p)) * static_cast<T>(1.0 / 2147483648.0);
+    } else {
+        return static_cast<T>(Codec<E>::load(p) >> (32 - 8 * sizeof(T)));
+    }
+}
+
+template <typename T, Encoding E>
+void encode_one(unsigned char* p, T v)
+{
+    if constexpr (Codec<E>::is_float) {
+        Codec<E>::store(p, static_cast<double>(v) / full_scale_v<T>);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        Codec<E>::store(p, from_double<std::int32_t>(static_cast<double>(v)));
+    } else {
+        Codec<E>::store(p, static_cast<std::int32_t>(static_cast<std::uint32_t>(v) << (32 - 8 * sizeof(T))));
+    }
+}
+
+/* {src_stride} is in bytes, {dst_stride} in samples. Interleaved access uses the contiguous kernels. */
+template <typename T>
+using DecodeFn = void (*)(const unsigned char* src, std::size_t src_stride, T* dst, std::size_t dst_stride, std::size_t n);
+template <typename T>
+using EncodeFn = void (*)(const T* src, std::size_t src_stride, unsigned char* dst, std::size_t dst_stride, std::size_t n);
+
+template <typename T, Encoding E, Layout L>
+void decode_block(const unsigned char* src, std::size_t src_stride, T* dst, std::size_t dst_stride, std::size_t n)
+{
+    if constexpr (L == Layout::Interleaved) {
+        (void)src_stride;
+        (void)dst_stride;
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[i] = decode_one<T, E>(src + i * Codec<E>::size);
+        }
+    } else {
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[i * dst_stride] = decode_one<T, E>(src + i * src_stride);
+        }
+    }
+}
+
+template <typename T, Encoding E, Layout L>
+void encode_block(const T* src, std::size_t src_stride, unsigned char* dst, std::size_t dst_stride, std::size_t n)
+{
+    if constexpr (L == Layout::Interleaved) {
+        (void)src_stride;
+        (void)dst_stride;
+        for (std::size_t i = 0; i < n; ++i) {
+            encode_one<T, E>(dst + i * Codec<E>::size, src[i]);
+        }
+    } else {
+        for (std::size_t i = 0; i < n; ++i) {
+            encode_one<T, E>(dst + i * dst_stride, src[i * src_stride]);
+        }
+    }
+}
+
+template <typename T, Layout L>
+DecodeFn<T> select_decoder(Encoding encoding)
+{
+    switch (encoding) {
+        case Encoding::U8: return &decode_block<T, Encoding::U8, L>;
+        case Encoding::S16: return &decode_block<T, Encoding::S16, L>;
+        case Encoding::S24: return &decode_block<T, Encoding::S24, L>;
+        case Encoding::S32: return &decode_block<T, Encoding::S32, L>;
+        case Encoding::F32: return &decode_block<T, Encoding::F32, L>;
+        case Encoding::F64: return &decode_block<T, Encoding::F64, L>;
+        case Encoding::ALaw: return &decode_block<T, Encoding::ALaw, L>;
+        case Encoding::MuLaw: return &decode_block<T, Encoding::MuLaw, L>;
+        default: return nullptr;
+    }
+}
+
+template <typename T, Layout L>
+EncodeFn<T> select_encoder(Encoding encoding)
+{
+    switch (encoding) {
+        case Encoding::U8: return &encode_block<T, Encoding::U8, L>;
+        case Encoding::S16: return &encode_block<T, Encoding::S16, L>;
+        case Encoding::S24: return &encode_block<T, Encoding::S24, L>;
+        case Encoding::S32: return &encode_block<T, Encoding::S32, L>;
+        case Encoding::F32: return &encode_block<T, Encoding::F32, L>;
+        case Encoding::F64: return &encode_block<T, Encoding::F64, L>;
+        case Encoding::ALaw: return &encode_block<T, Encoding::ALaw, L>;
+        case Encoding::MuLaw: return &encode_block<T, Encoding::MuLaw, L>;
+        default: return nullptr;
+    }
+}
+
+/* Bound the scratch buffer of readers and writers, independent of the block size asked for */
+constexpr std::size_t max_chunk_frames = 4096;
+
+} // namespace detail
+
+/** A block of frames handed out by {Reader::blocks}, valid until the iterator is advanced */
+template <typename T>
+struct Block {
+    const T*    data = nullptr;
+    std::size_t frames = 0;
+    std::size_t channels = 0;
+
+    std::size_t size() const noexcept { return frames * channels; }
+#ifdef WAVE_HPP_HAS_SPAN
+    std::span<const T> samples() const noexcept { return {data, size()}; }
+#endif
+};
+
+template <typename T, Layout L = Layout::Interleaved>
+class Reader {
+    static_assert(detail::is_sample_type_v<T>, "unsupported sample type");
+
+public:
+    static Result<Reader> open(const char* filename)
+    {
+        auto file = File::open(filename, WAVE_OPEN_READ);
+        if (!file) {
+            return file.error();
+        }
+        return create(std::move(*file));
+    }
+
+    static Result<Reader> create(File file)
+    {
+        auto decode = detail::select_decoder<T, L>(detail::encoding_of(file));
+        if (!decode) {
+            return Error{WAVE_ERR_FORMAT, "Unsupported sample encoding"};
+        }
+        return Reader(std::move(file), decode);
+    }
+
+    File& file() noexcept { return file_; }
+    const File& file() const noexcept { return file_; }
+    std::size_t num_channels() const noexcept { return channels_; }
+
+    /** Read up to {frames} frames into {out}, which holds {frames} * {num_channels()} samples
+     *
+     *  @return     The number of frames read, less than {frames} at the end of the file
+     */
+    Result<std::size_t> read(T* out, std::size_t frames)
+    {
+        std::size_t done = 0;
+        while (done < frames) {
+            std::size_t chunk = frames - done < detail::max_chunk_frames ? frames - done : detail::max_chunk_frames;
+            raw_.resize(chunk * block_align_);
+
+            auto n = file_.read_raw(raw_.data(), chunk);
+            if (!n) {
+                return n.error();
+            }
+
+            if constexpr (L == Layout::Interleaved) {
+                decode_(raw_.data(), 0, out + done * channels_, 0, *n * channels_);
+            } else {
+                for (std::size_t c = 0; c < channels_; ++c) {
+                    decode_(raw_.data() + c * sample_size_, block_align_, out + c * frames + done, 1, *n);
+                }
+            }
+
+            done += *n;
+            if (*n < chunk) {
+                break;
+            }
+        }
+        return done;
+    }
+
+#ifdef WAVE_HPP_HAS_SPAN
+    Result<std::size_t> read(std::span<T> out) { return read(out.data(), out.size() / channels_); }
+#endif
+
+    class BlockRange {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Block<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Block<T>*;
+            using reference = const Block<T>&;
+
+            iterator() = default;
+            reference operator*() const { return range_->block_; }
+            pointer operator->() const { return &range_->block_; }
+            iterator& operator++()
+            {
+                if (!range_->next()) {
+                    range_ = nullptr;
+                }
+                return *this;
+            }
+            bool operator==(const iterator& other) const { return range_ == other.range_; }
+            bool operator!=(const iterator& other) const { return range_ != other.range_; }
+
+        private:
+            friend class BlockRange;
+            explicit iterator(BlockRange* range) : range_(range) {}
+            BlockRange* range_ = nullptr;
+        };
+
+        iterator begin() { return next() ? iterator(this) : iterator(); }
+        iterator end() { return iterator(); }
+
+        /** The error that ended the iteration, if any */
+        const Error& error() const noexcept { return error_; }
+
+    private:
+        friend class Reader;
+
+        BlockRange(Reader& reader, std::size_t frames)
+            : reader_(reader), frames_(frames), buffer_(frames * reader.num_channels()) {}
+
+        bool next()
+        {
+            auto n = reader_.read(buffer_.data(), frames_);
+            if (!n) {
+                error_ = n.error();
+                return false;
+            }
+            block_ = Block<T>{buffer_.data(), *n, reader_.num_channels()};
+            return *n > 0;
+        }
+
+        Reader&        reader_;
+        std::size_t    frames_;
+        std::vector<T> buffer_;
+        Block<T>       block_;
+        Error          error_;
+    };
+
+    /** Iterate over the rest of the file in blocks of {frames} frames. The block buffer is allocated once. */
+    BlockRange blocks(std::size_t frames) { return BlockRange(*this, frames); }
+
+private:
+    Reader(File file, detail::DecodeFn<T> decode)
+        : file_(std::move(file))
+        , decode_(decode)
+        , channels_(file_.num_channels())
+        , sample_size_(file_.sample_size())
+        , block_align_(channels_ * sample_size_) {}
+
+    File                       file_;
+    detail::DecodeFn<T>        decode_;
+    std::size_t                channels_;
+    std::size_t                sample_size_;
+    std::size_t                block_align_;
+    std::vector<unsigned char> raw_;
+};
+
+template <typename T, Layout L = Layout::Interleaved>
+class Writer {
+    static_assert(detail::is_sample_type_v<T>, "unsupported sample type");
+
+public:
+    static Result<Writer> create(const char* filename, const Spec& spec)
+    {
+        auto file = File::create(filename, spec);
+        if (!file) {
+            return file.error();
+        }
+        return create(std::move(*file));
+    }
+
+    static Result<Writer> create(File file)
+    {
+        auto encode = detail::select_encoder<T, L>(detail::encoding_of(file));
+        if (!encode) {
+            return Error{WAVE_ERR_FORMAT, "Unsupported sample encoding"};
+        }
+        return Writer(std::move(file), encode);
+    }
+
+    File& file() noexcept { return file_; }
+    const File& file() const noexcept { return file_; }
+    std::size_t num_channels() const noexcept { return channels_; }
+
+    /** Write {frames} frames from {in}, which holds {frames} * {num_channels()} samples */
+    Result<std::size_t> write(const T* in, std::size_t frames)
+    {
+        std::size_t done = 0;
+        while (done < frames) {
+            std::size_t chunk = frames - done < detail::max_chunk_frames ? frames - done : detail::max_chunk_frames;
+            raw_.resize(chunk * block_align_);
+
+            if constexpr (L == Layout::Interleaved) {
+                encode_(in + done * channels_, 0, raw_.data(), 0, chunk * channels_);
+            } else {
+                for (std::size_t c = 0; c < channels_; ++c) {
+                    encode_(in + c * frames + done, 1, raw_.data() + c * sample_size_, block_align_, chunk);
+                }
+            }
+
+            auto n = file_.write_raw(raw_.data(), chunk);
+            if (!n) {
+                return n.error();
+            }
+            done += *n;
+            if (*n < chunk) {
+                break;
+            }
+        }
+        return done;
+    }
+
+#ifdef WAVE_HPP_HAS_SPAN
+    Result<std::size_t> write(std::span<const T> in) { return write(in.data(), in.size() / channels_); }
+#endif
+
+private:
+    Writer(File file, detail::EncodeFn<T> encode)
+        : file_(std::move(file))
+        , encode_(encode)
+        , channels_(file_.num_channels())
+        , sample_size_(file_.sample_size())
+        , block_align_(channels_ * sample_size_) {}
+
+    File                       file_;
+    detail::EncodeFn<T>        encode_;
+    std::size_t                channels_;
+    std::size_t                sample_size_;
+    std::size_t                block_align_;
+    std::vector<unsigned char> raw_;
+};
+
+#ifdef WAVE_HPP_HAS_COROUTINE
+
+namespace detail {
+
+/* A unit of work of an {IoContext}, embedded in its owner so that posting it does not allocate */
+struct IoTask {
+    IoTask* next = nullptr;
+    void (*run)(IoTask* task) = nullptr;
+};
+
+} // namespace detail
+
+/** A few threads that do the file I/O of any number of {AsyncReader}s
+ *
+ *  Must outlive the readers that use it. Coroutines waiting for a block are resumed on one of these threads.
+ */
+class IoContext {
+public:
+    explicit IoContext(std::size_t num_threads = 2)
+    {
+        threads_.reserve(num_threads > 0 ? num_threads : 1);
+        for (std::size_t i = 0; i < (num_threads > 0 ? num_threads : 1); ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    IoContext(const IoContext&) = delete;
+    IoContext& operator=(const IoContext&) = delete;
+
+    ~IoContext()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    std::size_t num_threads() const noexcept { return threads_.size(); }
+
+    void post(detail::IoTask* task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task->next = nullptr;
+            if (tail_) {
+                tail_->next = task;
+            } else {
+                head_ = task;
+            }
+            tail_ = task;
+        }
+        cond_.notify_one();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cond_.wait(lock, [this] { return stop_ || head_ != nullptr; });
+            if (head_ == nullptr) {
+                return;
+            }
+            detail::IoTask* task = head_;
+            head_ = task->next;
+            if (head_ == nullptr) {
+                tail_ = nullptr;
+            }
+            lock.unlock();
+            task->run(task);
+            lock.lock();
+        }
+    }
+
+    std::mutex               mutex_;
+    std::condition_variable  cond_;
+    detail::IoTask*          head_ = nullptr;
+    detail::IoTask*          tail_ = nullptr;
+    bool                     stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+/** A coroutine that produces values with {co_yield} and may {co_await} in between
+ *
+ *  The consumer gets a pointer to every value with {co_await next()}, valid until it asks for the next one, and nullptr
+ *  when the coroutine has returned.
+ */
+template <typename V>
+class AsyncGenerator {
+public:
+    struct promise_type {
+        const V*                value = nullptr;
+        std::coroutine_handle<> consumer;
+
+        /* hand control back to the consumer, which is waiting in {next} */
+        struct Yield {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept { return self.promise().consumer; }
+            void await_resume() const noexcept {}
+        };
+
+        AsyncGenerator get_return_object() { return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        Yield final_suspend() noexcept
+        {
+            value = nullptr;
+            return {};
+        }
+        Yield yield_value(const V& v) noexcept
+        {
+            value = &v;
+            return {};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    AsyncGenerator(AsyncGenerator&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+    AsyncGenerator& operator=(AsyncGenerator&& other) noexcept
+    {
+        if (this != &other) {
+            if (coro_) {
+                coro_.destroy();
+            }
+            coro_ = std::exchange(other.coro_, nullptr);
+        }
+        return *this;
+    }
+    AsyncGenerator(const AsyncGenerator&) = delete;
+    AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+    ~AsyncGenerator()
+    {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+    /** Resume the coroutine up to its next {co_yield}, the result of {co_await} is the yielded value or nullptr */
+    auto next() noexcept
+    {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> coro;
+
+            bool await_ready() const noexcept { return !coro || coro.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept
+            {
+                coro.promise().consumer = consumer;
+                return coro;
+            }
+            const V* await_resume() const noexcept { return coro && !coro.done() ? coro.promise().value : nullptr; }
+        };
+        return Awaiter{coro_};
+    }
+
+private:
+    explicit AsyncGenerator(std::coroutine_handle<promise_type> coro) noexcept : coro_(coro) {}
+
+    std::coroutine_handle<promise_type> coro_;
+};
+
+/** Reads interleaved blocks of frames ahead on an {IoContext} for a coroutine
+ *
+ *  A ring of {depth} buffers of {block_frames} frames each is allocated when the reader is created. The I/O threads fill
+ *  free buffers in file order while the consumer works on the ones already filled, and a buffer is recycled when the
+ *  consumer has taken all of its frames and asks for more. One coroutine at a time may wait on a reader.
+ */
+template <typename T>
+class AsyncReader {
+public:
+    static Result<AsyncReader> open(IoContext& io, const char* filename, std::size_t block_frames, std::size_t depth = 4)
+    {
+        auto reader = Reader<T>::open(filename);
+        if (!reader) {
+            return reader.error();
+        }
+        return create(io, std::move(*reader), block_frames, depth);
+    }
+
+    static Result<AsyncReader> create(IoContext& io, Reader<T> reader, std::size_t block_frames, std::size_t depth = 4)
+    {
+        if (block_frames == 0 || depth == 0) {
+            return Error{WAVE_ERR_PARAM, "The block size and the read-ahead depth must not be 0"};
+        }
+        AsyncReader async(std::make_shared<State>(io, std::move(reader), block_frames, depth));
+        {
+            std::lock_guard<std::mutex> lock(async.state_->mutex);
+            async.state_->schedule();
+        }
+        return async;
+    }
+
+    AsyncReader(AsyncReader&&) noexcept = default;
+    AsyncReader& operator=(AsyncReader&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            state_ = std::move(other.state_);
+        }
+        return *this;
+    }
+    ~AsyncReader() { close(); }
+
+    std::size_t num_channels() const noexcept { return state_->channels; }
+    std::size_t block_frames() const noexcept { return state_->block_frames; }
+
+    /** Wait for the next frames of the file
+     *
+     *  @return     With {co_await}, a block of between 1 and {frames} frames, at most {block_frames()}, which is valid
+     *              until the next call. The block is empty at the end of the file.
+     */
+    auto next_block(std::size_t frames)
+    {
+        struct Awaiter {
+            State*      state;
+            std::size_t frames;
+
+            bool await_ready()
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                return state->can_take();
+            }
+            bool await_suspend(std::coroutine_handle<> waiter)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->can_take()) {
+                    return false;
+                }
+                state->waiter = waiter;
+                return true;
+            }
+            Result<Block<T>> await_resume()
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                return state->take(frames);
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->release();
+        }
+        return Awaiter{state_.get(), frames > 0 ? frames : state_->block_frames};
+    }
+
+    /** The rest of the file in blocks of up to {frames} frames. The iteration stops at the end of the file or at an
+     *  error, which {error} then returns. */
+    AsyncGenerator<Block<T>> blocks(std::size_t frames)
+    {
+        for (;;) {
+            auto block = co_await next_block(frames);
+            if (!block) {
+                co_return;
+            }
+            if (block->frames == 0) {
+                co_return;
+            }
+            co_yield *block;
+        }
+    }
+
+    /** The error that ended the reading, if any */
+    Error error() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->error;
+    }
+
+private:
+    struct Slot {
+        std::vector<T> samples;
+        std::size_t    frames = 0;
+    };
+
+    /* Shared with the I/O threads. The slots in use start at {front}: the one the consumer holds, the {filled} ones
+     * after it, and the one being read. A posted read holds a reference in {pending}, so a reader that is dropped while a
+     * read is queued, even on the I/O thread that will run it, is freed by that read instead of waiting for it. */
+    struct State : detail::IoTask, std::enable_shared_from_this<State> {
+        State(IoContext& io_, Reader<T> reader_, std::size_t block_frames_, std::size_t depth)
+            : io(io_)
+            , reader(std::move(reader_))
+            , block_frames(block_frames_)
+            , channels(reader.num_channels())
+            , slots(depth)
+        {
+            for (auto& slot : slots) {
+                slot.samples.resize(block_frames * channels);
+            }
+            run = &State::read_one;
+        }
+
+        bool can_take() const { return (held && offset < slots[front].frames) || filled > 0 || (done && !reading); }
+
+        /* give back the slot of the previous block once all of its frames are taken */
+        void release()
+        {
+            if (held && offset >= slots[front].frames) {
+                held = false;
+                offset = 0;
+                front = (front + 1) % slots.size();
+                schedule();
+            }
+        }
+
+        Result<Block<T>> take(std::size_t frames)
+        {
+            if (!held || offset >= slots[front].frames) {
+                release();
+                if (filled == 0) {
+                    if (error.code != WAVE_OK) {
+                        return error;
+                    }
+                    return Block<T>{};
+                }
+                --filled;
+                held = true;
+            }
+            const Slot& slot = slots[front];
+            std::size_t n = slot.frames - offset < frames ? slot.frames - offset : frames;
+            Block<T>    block{slot.samples.data() + offset * channels, n, channels};
+            offset += n;
+            return block;
+        }
+
+        void schedule()
+        {
+            if (!reading && !done && (held ? 1 : 0) + filled < slots.size()) {
+                reading = true;
+                pending = this->shared_from_this();
+                io.post(this);
+            }
+        }
+
+        static void read_one(detail::IoTask* task)
+        {
+            State*                  self = static_cast<State*>(task);
+            std::shared_ptr<State>  hold;
+            std::coroutine_handle<> resume;
+            std::size_t             index;
+
+            {
+                std::lock_guard<std::mutex> lock(self->mutex);
+                hold = std::move(self->pending);
+                if (self->done) {
+                    self->reading = false;
+                    return;
+                }
+                index = (self->front + (self->held ? 1 : 0) + self->filled) % self->slots.size();
+            }
+
+            /* only this task touches the reader, and at most one is posted at a time */
+            auto n = self->reader.read(self->slots[index].samples.data(), self->block_frames);
+
+            std::unique_lock<std::mutex> lock(self->mutex);
+            self->reading = false;
+            if (!n) {
+                self->error = n.error();
+                self->done = true;
+            } else {
+                self->slots[index].frames = *n;
+                if (*n > 0) {
+                    ++self->filled;
+                }
+                if (*n < self->block_frames) {
+                    self->done = true;
+                }
+            }
+            self->schedule();
+            resume = std::exchange(self->waiter, nullptr);
+
+            /* the consumer may drop the reader once it runs, then {hold} frees the state on the way out */
+            lock.unlock();
+            if (resume) {
+                resume.resume();
+            }
+        }
+
+        IoContext&              io;
+        Reader<T>               reader;
+        std::size_t             block_frames;
+        std::size_t             channels;
+        std::vector<Slot>       slots;
+        mutable std::mutex      mutex;
+        std::shared_ptr<State>  pending;
+        std::size_t             front = 0;
+        std::size_t             filled = 0;
+        std::size_t             offset = 0;
+        bool                    held = false;
+        bool                    reading = false;
+        bool                    done = false;
+        std::coroutine_handle<> waiter;
+        Error                   error;
+    };
+
+    explicit AsyncReader(std::shared_ptr<State> state) noexcept : state_(std::move(state)) {}
+
+    /* stop reading ahead, the state goes away with the last read that is still posted */
+    void close() noexcept
+    {
+        if (state_) {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->done = true;
+        }
+        state_.reset();
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+#endif /* WAVE_HPP_HAS_COROUTINE */
+
+} // namespace wave
+
+#endif /* __WAVE_HPP__ */
@@ -1,46 +1,13 @@
-#include <assert.h>
-#include <errno.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "wave.h"
-
-#define WAVE_ENDIAN_ORDER_LITTLE    0x41424344UL
-#define WAVE_ENDIAN_ORDER_BIG       0x44434241UL
-#define WAVE_ENDIAN_ORDER_PDP       0x42414443UL
-#define WAVE_ENDIAN_ORDER           'ABCD'
-
-#if WAVE_ENDIAN_ORDER == WAVE_ENDIAN_ORDER_LITTLE
-#define WAVE_ENDIAN_LITTLE 1
-#define WAVE_ENDIAN_BIG 0
-#elif WAVE_ENDIAN_ORDER == WAVE_ENDIAN_ORDER_BIG
-#define WAVE_ENDIAN_LITTLE 0
-#define WAVE_ENDIAN_BIG 1
-#else
-#error "unsupported endianess"
-#endif
-
-#if WAVE_ENDIAN_LITTLE
-#define WAVE_RIFF_CHUNK_ID       ((WaveU32)'FFIR')
-#define WAVE_FORMAT_CHUNK_ID     ((WaveU32)' tmf')
-#define WAVE_FACT_CHUNK_ID       ((WaveU32)'tcaf')
-#define WAVE_DATA_CHUNK_ID       ((WaveU32)'atad')
-#define WAVE_WAVE_ID             ((WaveU32)'EVAW')
-#endif
-
-#if WAVE_ENDIAN_BIG
-#define WAVE_RIFF_CHUNK_ID       ((WaveU32)'RIFF')
-#define WAVE_FORMAT_CHUNK_ID     ((WaveU32)'fmt ')
-#define WAVE_FACT_CHUNK_ID       ((WaveU32)'fact')
-#define WAVE_DATA_CHUNK_ID       ((WaveU32)'data')
-#define WAVE_WAVE_ID             ((WaveU32)'WAVE')
-#endif
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_checksum.h"
+#include "wave_follow.h"
+#include "wave_edit.h"
+#include "wave_kernels.h"
+#include "wave_meter.h"
 
 WAVE_THREAD_LOCAL WaveErr g_err = {WAVE_OK, (char*)"", 1};
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-
 static void* wave_default_malloc(void *context, size_t size)
 {
     (void)context;
@@ -161,98 +128,112 @@ void wave_err_clear(void)
     }
 }
 
-WAVE_INLINE void wave_err_set(WaveErrCode code, WAVE_CONST char *format, ...)
-{
-    assert(g_err.code == WAVE_OK);
-    va_list args;
-    va_start(args, format);
-    g_err.code = code;
-    wave_vasprintf(&g_err.message, format, args);
-    g_err._is_literal = 0;
-    va_end(args);
-}
+static WAVE_CONST WaveU8 default_sub_format[16] = {
+    0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+};
 
-WAVE_INLINE void wave_err_set_literal(WaveErrCode code, WAVE_CONST char *message)
+static WaveBool wave_has_chunk_at(WaveFile* self, WaveU64 offset, WaveU64 file_size)
 {
-    assert(g_err.code == WAVE_OK);
-    g_err.code = code;
-    g_err.message = (char *)message;
-    g_err._is_literal = 1;
-}
+    WaveChunkHeader header;
+    WaveU8 *id = (WaveU8*)&header.id;
+    int i;
 
-#pragma pack(push, 1)
+    if (offset + sizeof(WaveChunkHeader) > file_size) {
+        return WAVE_FALSE;
+    }
+    if (fseek(self->fp, (long)offset, SEEK_SET) != 0 || fread(&header, sizeof(WaveChunkHeader), 1, self->fp) != 1) {
+        return WAVE_FALSE;
+    }
+    for (i = 0; i < 4; ++i) {
+        if (id[i] < 0x20 || id[i] > 0x7e) {
+            return WAVE_FALSE;
+        }
+    }
+    return offset + sizeof(WaveChunkHeader) + header.size <= file_size;
+}
 
-typedef struct {
-    WaveU32 id;
-    WaveU32 size;
-} WaveChunkHeader;
+static WaveU64 wave_get_file_size(WaveFile* self)
+{
+    long size;
 
-typedef struct {
-    WaveChunkHeader header;
+    if (fseek(self->fp, 0, SEEK_END) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return 0;
+    }
+    size = ftell(self->fp);
+    if (size < 0) {
+        wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
+        return 0;
+    }
+    return (WaveU64)size;
+}
 
-    WaveU64 offset;
+/* Reconstruct the RIFF, fact and data sizes from the file length, for headers that lag behind the data after a crash.
+ * A data size that is smaller than the file is trusted only if a valid chunk follows it. */
+static void wave_recover_sizes(WaveFile* self)
+{
+    WaveU16 block_align = self->format_chunk.body.block_align;
+    WaveU64 file_size, avail, size, max_size;
 
-    struct {
-        WaveU16 format_tag;
-        WaveU16 num_channels;
-        WaveU32 sample_rate;
-        WaveU32 avg_bytes_per_sec;
-        WaveU16 block_align;
-        WaveU16 bits_per_sample;
+    if (block_align == 0) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Missing format chunk");
+        return;
+    }
 
-        WaveU16 ext_size;
-        WaveU16 valid_bits_per_sample;
-        WaveU32 channel_mask;
+    file_size = wave_get_file_size(self);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
 
-        WaveU8 sub_format[16];
-    } body;
-} WaveFormatChunk;
+    avail = file_size > self->data_chunk.offset ? file_size - self->data_chunk.offset : 0;
+    size = self->data_chunk.header.size;
+    if (size > avail || (size < avail && !wave_has_chunk_at(self, self->data_chunk.offset + size + (size & 1), file_size))) {
+        size = avail;
+    }
 
-typedef struct {
-    WaveChunkHeader header;
+    max_size = 0xffffffffUL - self->data_chunk.offset;
+    size = MIN(size, max_size);
+    size -= size % block_align;
 
-    WaveU64 offset;
+    if (size != self->data_chunk.header.size) {
+        self->data_chunk.header.size = (WaveU32)size;
+        self->riff_chunk.size = (WaveU32)(self->data_chunk.offset + size - sizeof(WaveChunkHeader));
+        if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+            self->fact_chunk.body.sample_length = (WaveU32)(size / block_align);
+        }
+    }
 
-    struct {
-        WaveU32 sample_length;
-    } body;
-} WaveFactChunk;
+    if (fseek(self->fp, (long)self->data_chunk.offset, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+}
 
-typedef struct {
-    WaveChunkHeader header;
-    WaveU64 offset;
-} WaveDataChunk;
-
-typedef struct {
-    WaveU32 id;
-    WaveU32 size;
-    WaveU32 wave_id;
-    WaveU64 offset;
-} WaveMasterChunk;
-
-#pragma pack(pop)
-
-#define WAVE_CHUNK_MASTER    ((WaveU32)1)
-#define WAVE_CHUNK_FORMAT    ((WaveU32)2)
-#define WAVE_CHUNK_FACT      ((WaveU32)4)
-#define WAVE_CHUNK_DATA      ((WaveU32)8)
-
-struct _WaveFile {
-    FILE*               fp;
-    char*               filename;
-    WaveU32              mode;
-    WaveBool             is_a_new_file;
-
-    WaveMasterChunk      riff_chunk;
-    WaveFormatChunk      format_chunk;
-    WaveFactChunk        fact_chunk;
-    WaveDataChunk        data_chunk;
-};
+/* Extensible files are read through the kernels of the plain format named by the sub format */
+static void wave_check_extensible(WaveFile* self)
+{
+    WaveU16 sub_format = wave_get_sample_format(self);
+    size_t  container = 8 * (size_t)wave_get_sample_size(self);
 
-static WAVE_CONST WaveU8 default_sub_format[16] = {
-    0x01, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
-};
+    if (self->format_chunk.header.size < (WaveU32)((WaveUIntPtr)&self->format_chunk.body.ext_tail - (WaveUIntPtr)&self->format_chunk.body) ||
+        self->format_chunk.body.ext_size < 22)
+    {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Truncated extensible format chunk");
+        return;
+    }
+    if (memcmp(self->format_chunk.body.sub_format + 2, default_sub_format + 2, 14) != 0 ||
+        (sub_format != WAVE_FORMAT_PCM && sub_format != WAVE_FORMAT_IEEE_FLOAT &&
+         sub_format != WAVE_FORMAT_ALAW && sub_format != WAVE_FORMAT_MULAW))
+    {
+        wave_err_set(WAVE_ERR_FORMAT, "Unsupported sub format: %#06x", sub_format);
+        return;
+    }
+    if (self->format_chunk.body.valid_bits_per_sample > container) {
+        wave_err_set(WAVE_ERR_FORMAT, "Invalid ValidBitsPerSample: %u", self->format_chunk.body.valid_bits_per_sample);
+        return;
+    }
+}
 
 void wave_parse_header(WaveFile* self)
 {
@@ -302,11 +283,25 @@ void wave_parse_header(WaveFile* self)
                 if (self->format_chunk.body.format_tag != WAVE_FORMAT_PCM &&
                     self->format_chunk.body.format_tag != WAVE_FORMAT_IEEE_FLOAT &&
                     self->format_chunk.body.format_tag != WAVE_FORMAT_ALAW &&
-                    self->format_chunk.body.format_tag != WAVE_FORMAT_MULAW)
+                    self->format_chunk.body.format_tag != WAVE_FORMAT_MULAW &&
+                    self->format_chunk.body.format_tag != WAVE_FORMAT_EXTENSIBLE &&
+                    !WAVE_IS_ADPCM(self->format_chunk.body.format_tag))
                 {
                     wave_err_set(WAVE_ERR_FORMAT, "Unsupported format tag: %#010x", self->format_chunk.body.format_tag);
                     return;
                 }
+                if (self->format_chunk.body.format_tag == WAVE_FORMAT_EXTENSIBLE) {
+                    wave_check_extensible(self);
+                    if (g_err.code != WAVE_OK) {
+                        return;
+                    }
+                }
+                if (header.size > sizeof(self->format_chunk.body) &&
+                    fseek(self->fp, (long)(self->format_chunk.offset + header.size), SEEK_SET) != 0)
+                {
+                    wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+                    return;
+                }
                 break;
             case WAVE_FACT_CHUNK_ID:
                 self->fact_chunk.header = header;
@@ -328,10 +323,25 @@ void wave_parse_header(WaveFile* self)
                 break;
         }
     }
+
+    if (self->mode & WAVE_OPEN_REPAIR) {
+        wave_recover_sizes(self);
+    }
 }
 
 void wave_write_header(WaveFile* self)
 {
+    /* existing files are only rewritten once, by {wave_flush} or {wave_close} */
+    if (self->mode & WAVE_OPEN_EDIT) {
+        self->header_dirty = WAVE_TRUE;
+        return;
+    }
+
+    wave_drain_buffer(self);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
     self->riff_chunk.size =
         sizeof(self->riff_chunk.wave_id) +
         (self->format_chunk.header.id == WAVE_FORMAT_CHUNK_ID ? (sizeof(WaveChunkHeader) + self->format_chunk.header.size) : 0) +
@@ -389,23 +399,77 @@ void wave_write_header(WaveFile* self)
     }
 }
 
+void wave_update_sizes(WaveFile *self)
+{
+    long int save_pos = ftell(self->fp);
+    if (fseek(self->fp, (long)(sizeof(WaveChunkHeader) - 4), SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fwrite(&self->riff_chunk.size, 4, 1, self->fp) != 1) {
+        wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+        if (fseek(self->fp, (long)self->fact_chunk.offset, SEEK_SET) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+            return;
+        }
+        if (fwrite(&self->fact_chunk.body.sample_length, 4, 1, self->fp) != 1) {
+            wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
+            return;
+        }
+    }
+    if (fseek(self->fp, (long)(self->data_chunk.offset - 4), SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fwrite(&self->data_chunk.header.size, 4, 1, self->fp) != 1) {
+        wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fseek(self->fp, save_pos, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+}
+
+/* appending to a file with checksums keeps them, since the frames would overwrite them otherwise */
+static void wave_attach_checksum(WaveFile* self)
+{
+    if ((self->mode & (WAVE_OPEN_CHECKSUM | WAVE_OPEN_APPEND)) && !(self->mode & WAVE_OPEN_EDIT) && g_err.code == WAVE_OK) {
+        wave_checksum_open(self);
+    }
+}
+
 void wave_init(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode)
 {
     memset(self, 0, sizeof(WaveFile));
+    wave_kernels_init();
 
-    if (mode & WAVE_OPEN_READ) {
-        if ((mode & WAVE_OPEN_WRITE) || (mode & WAVE_OPEN_APPEND)) {
+    if ((mode & WAVE_OPEN_WRITE)) {
+        self->fp = fopen(filename, "wb+");
+    } else if (mode & WAVE_OPEN_APPEND) {
+        self->fp = fopen(filename, "rb+");
+        if (self->fp == NULL && errno == ENOENT && !(mode & WAVE_OPEN_REPAIR)) {
             self->fp = fopen(filename, "wb+");
-        } else {
-            self->fp = fopen(filename, "rb");
         }
+    } else if (mode & WAVE_OPEN_EDIT) {
+        self->fp = fopen(filename, "rb+");
+    } else if (mode & WAVE_OPEN_READ) {
+        self->fp = fopen(filename, "rb");
     } else {
-        if ((mode & WAVE_OPEN_WRITE) || (mode & WAVE_OPEN_APPEND)) {
-            self->fp = fopen(filename, "wb+");
-        } else {
-            wave_err_set_literal(WAVE_ERR_PARAM, "Invalid mode");
-            return;
+        wave_err_set_literal(WAVE_ERR_PARAM, "Invalid mode");
+        return;
+    }
+
+    if ((mode & WAVE_OPEN_FOLLOW) && (mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND | WAVE_OPEN_EDIT))) {
+        if (self->fp != NULL) {
+            fclose(self->fp);
+            self->fp = NULL;
         }
+        wave_err_set_literal(WAVE_ERR_PARAM, "WAVE_OPEN_FOLLOW only goes with WAVE_OPEN_READ");
+        return;
     }
 
     if (self->fp == NULL) {
@@ -418,6 +482,10 @@ void wave_init(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode)
 
     if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
         wave_parse_header(self);
+        if ((self->mode & WAVE_OPEN_FOLLOW) && g_err.code == WAVE_OK) {
+            wave_follow_open(self);
+        }
+        wave_attach_checksum(self);
         return;
     }
 
@@ -425,11 +493,26 @@ void wave_init(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode)
         wave_parse_header(self);
         if (g_err.code == WAVE_OK) {
             // If the header parsing was successful, return immediately.
+            if (self->mode & WAVE_OPEN_REPAIR) {
+                wave_update_sizes(self);
+            }
+            wave_attach_checksum(self);
+            return;
+        } else if (self->mode & WAVE_OPEN_REPAIR) {
+            // Never overwrite a file that was opened for recovery.
             return;
         } else {
             // Header parsing failed. Regard it as a new file.
             wave_err_clear();
-            rewind(self->fp);
+            self->fp = freopen(filename, "wb+", self->fp);
+            if (self->fp == NULL) {
+                wave_err_set(WAVE_ERR_OS, "Error when opening %s [errno %d: %s]", filename, errno, strerror(errno));
+                return;
+            }
+            memset(&self->riff_chunk, 0, sizeof(self->riff_chunk));
+            memset(&self->format_chunk, 0, sizeof(self->format_chunk));
+            memset(&self->fact_chunk, 0, sizeof(self->fact_chunk));
+            memset(&self->data_chunk, 0, sizeof(self->data_chunk));
             self->is_a_new_file = WAVE_TRUE;
         }
     }
@@ -457,18 +540,39 @@ void wave_init(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode)
     self->data_chunk.offset = self->format_chunk.offset + self->format_chunk.header.size + sizeof(WaveChunkHeader);
 
     wave_write_header(self);
+    wave_attach_checksum(self);
 }
 
 void wave_finalize(WaveFile* self)
 {
     int ret;
 
-    wave_free(self->filename);
-
     if (self->fp == NULL) {
+        wave_free(self->filename);
         return;
     }
 
+    wave_adpcm_finish(self);
+    wave_adpcm_destroy(self->adpcm);
+    wave_drain_buffer(self);
+    if (wave_edit_is_dirty(self) && g_err.code == WAVE_OK) {
+        wave_edit_commit(self);
+    }
+    if (self->sizes_dirty) {
+        wave_update_sizes(self);
+    }
+    /* after the sizes, so that the RIFF size includes the checksum chunk */
+    if (self->checksum != NULL && g_err.code == WAVE_OK) {
+        wave_checksum_commit(self);
+    }
+    wave_checksum_destroy(self->checksum);
+    wave_follow_destroy(self->follow);
+    wave_edit_destroy(self->edit);
+    wave_free(self->buffer);
+    wave_free(self->scratch);
+    wave_free(self->filename);
+    wave_meter_destroy(self->meter);
+
     ret = fclose(self->fp);
     if (ret != 0) {
         fprintf(stderr, "[WARN] [libwav] fclose failed with code %d [errno %d: %s]", ret, errno, strerror(errno));
@@ -501,21 +605,82 @@ WaveFile* wave_reopen(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode)
     return self;
 }
 
+/* Check the blocks under the {count} frames from frame {first} that {wave_read} returned in {buffer} */
+static void wave_verify_frames(WaveFile* self, size_t first, size_t count, WAVE_CONST void *buffer)
+{
+    WaveU64 block_align = self->format_chunk.body.block_align;
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        size_t samples_per_block = wave_adpcm_samples_per_block(self);
+        wave_checksum_verify(self, first / samples_per_block * block_align,
+                             ((first + count - 1) / samples_per_block + 1) * block_align, NULL);
+    } else {
+        wave_checksum_verify(self, first * block_align, (first + count) * block_align, buffer);
+    }
+}
+
 size_t wave_read(WaveFile* self, void *buffer, size_t count)
 {
     size_t read_count;
     WaveU16 n_channels = wave_get_num_channels(self);
     size_t sample_size = wave_get_sample_size(self);
     size_t len_remain;
+    size_t first = 0;
+    WaveBool verify = self->checksum != NULL && !(self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND));
 
     if (!(self->mode & WAVE_OPEN_READ)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not readable");
         return 0;
     }
 
-    if (self->format_chunk.body.format_tag == WAVE_FORMAT_EXTENSIBLE) {
-        wave_err_set_literal(WAVE_ERR_FORMAT, "Extensible format is not supported");
-        return 0;
+    /* the frames appended since the last look, or since the previous read ran into the end */
+    if (self->follow != NULL) {
+        wave_follow_refresh(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (verify) {
+        first = (size_t)wave_tell(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        read_count = wave_adpcm_read(self, buffer, count);
+        if (verify && read_count > 0) {
+            wave_verify_frames(self, first, read_count, buffer);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+        }
+        if (self->meter != NULL && read_count > 0) {
+            wave_meter_update(self, buffer, read_count);
+        }
+        return read_count;
+    }
+
+    if (self->cache != NULL) {
+        read_count = wave_cache_read(self, buffer, count);
+        if (verify && read_count > 0) {
+            wave_verify_frames(self, first, read_count, buffer);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+        }
+        if (self->meter != NULL && read_count > 0) {
+            wave_meter_update(self, buffer, read_count);
+        }
+        return read_count;
+    }
+
+    if (self->buffer_used > 0) {
+        wave_drain_buffer(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
     }
 
     len_remain = wave_get_length(self) - (size_t)wave_tell(self);
@@ -528,104 +693,636 @@ size_t wave_read(WaveFile* self, void *buffer, size_t count)
         return 0;
     }
 
+    if (self->follow != NULL) {
+        /* the end of file seen by an earlier read may have moved since */
+        clearerr(self->fp);
+    }
     read_count = fread(buffer, sample_size, n_channels * count, self->fp);
     if (ferror(self->fp)) {
         wave_err_set(WAVE_ERR_OS, "Error when reading %s [errno %d: %s]", self->filename, errno, strerror(errno));
         return 0;
     }
 
+    if (verify && read_count >= n_channels) {
+        wave_verify_frames(self, first, read_count / n_channels, buffer);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (self->meter != NULL && read_count >= n_channels) {
+        wave_meter_update(self, buffer, read_count / n_channels);
+    }
+
     return read_count / n_channels;
 }
 
-WAVE_INLINE void wave_update_sizes(WaveFile *self)
+#if !defined(_WIN32) && !defined(_WIN64)
+
+/* segments passed to one {preadv} or {pwritev} */
+#define WAVE_IOV_BATCH 64
+
+/* Read or write all of {iov} at file offset {offset}, returns the number of bytes transferred */
+static size_t wave_transfer_iov(WaveFile* self, struct iovec* iov, int n, WaveU64 offset, WaveBool write)
 {
-    long int save_pos = ftell(self->fp);
-    if (fseek(self->fp, (long)(sizeof(WaveChunkHeader) - 4), SEEK_SET) != 0) {
-        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
-        return;
-    }
-    if (fwrite(&self->riff_chunk.size, 4, 1, self->fp) != 1) {
-        wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
-        return;
-    }
-    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
-        if (fseek(self->fp, (long)self->fact_chunk.offset, SEEK_SET) != 0) {
-            wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
-            return;
+    size_t done = 0;
+
+    while (n > 0) {
+        ssize_t ret = write ? pwritev(fileno(self->fp), iov, n, (off_t)offset) : preadv(fileno(self->fp), iov, n, (off_t)offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
         }
-        if (fwrite(&self->fact_chunk.body.sample_length, 4, 1, self->fp) != 1) {
-            wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
-            return;
+        if (ret < 0) {
+            wave_err_set(WAVE_ERR_OS, "Error when %s %s [errno %d: %s]", write ? "writing to" : "reading", self->filename, errno, strerror(errno));
+            break;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += (size_t)ret;
+        offset += (WaveU64)ret;
+        /* skip what was transferred, the call may stop anywhere */
+        while (n > 0 && (size_t)ret >= iov->iov_len) {
+            ret -= (ssize_t)iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if (n > 0) {
+            iov->iov_base = (char*)iov->iov_base + ret;
+            iov->iov_len -= (size_t)ret;
         }
     }
-    if (fseek(self->fp, (long)(self->data_chunk.offset - 4), SEEK_SET) != 0) {
-        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
-        return;
-    }
-    if (fwrite(&self->data_chunk.header.size, 4, 1, self->fp) != 1) {
-        wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
-        return;
-    }
-    if (fseek(self->fp, save_pos, SEEK_SET) != 0) {
-        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
-        return;
+
+    return done;
+}
+
+/* Transfer up to {count} frames between the segments and the data chunk from frame {first} on, one system call per
+ * {WAVE_IOV_BATCH} segments. Returns the number of frames transferred. */
+static size_t wave_transfer_segments(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments, size_t first, size_t count, WaveBool write)
+{
+    struct iovec iov[WAVE_IOV_BATCH];
+    size_t       block_align = self->format_chunk.body.block_align;
+    size_t       done = 0;
+    size_t       i = 0;
+
+    while (i < num_segments && done < count) {
+        size_t planned = 0;
+        size_t bytes;
+        int    n = 0;
+
+        for (; i < num_segments && n < WAVE_IOV_BATCH && done + planned < count; ++i) {
+            size_t frames = MIN(segments[i].count, count - done - planned);
+            iov[n].iov_base = segments[i].buffer;
+            iov[n].iov_len = frames * block_align;
+            planned += frames;
+            ++n;
+        }
+        bytes = wave_transfer_iov(self, iov, n, self->data_chunk.offset + (WaveU64)(first + done) * block_align, write);
+        done += bytes / block_align;
+        if (bytes < planned * block_align) {
+            break;
+        }
     }
+
+    return done;
 }
 
-size_t wave_write(WaveFile* self, WAVE_CONST void *buffer, size_t count)
+#endif
+
+/* Run the meter and the checksums over the frames that {wave_readv} or {wave_writev} transferred from frame {first} on */
+static void wave_segments_done(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments, size_t first, size_t count, WaveBool write)
 {
-    size_t write_count;
-    WaveU16 n_channels = wave_get_num_channels(self);
-    size_t sample_size = wave_get_sample_size(self);
+    size_t block_align = self->format_chunk.body.block_align;
+    size_t i;
 
-    if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
-        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
-        return 0;
+    for (i = 0; i < num_segments && count > 0 && g_err.code == WAVE_OK; ++i) {
+        size_t n = MIN(segments[i].count, count);
+        if (n == 0) {
+            continue;
+        }
+        if (write && self->checksum != NULL) {
+            wave_checksum_update(self, (WaveU64)first * block_align, segments[i].buffer, n * block_align);
+        } else if (!write && self->checksum != NULL && !(self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND))) {
+            wave_verify_frames(self, first, n, segments[i].buffer);
+        }
+        if (self->meter != NULL && g_err.code == WAVE_OK) {
+            wave_meter_update(self, segments[i].buffer, n);
+        }
+        first += n;
+        count -= n;
     }
+}
 
-    if (self->format_chunk.body.format_tag == WAVE_FORMAT_EXTENSIBLE) {
-        wave_err_set_literal(WAVE_ERR_FORMAT, "Extensible format is not supported");
-        return 0;
-    }
+size_t wave_readv(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments)
+{
+    size_t done = 0;
+    size_t i;
 
-    if (count == 0) {
+    if (!(self->mode & WAVE_OPEN_READ)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not readable");
         return 0;
     }
 
-    wave_tell(self);
-    if (g_err.code != WAVE_OK) {
-        return 0;
+    if (self->follow != NULL) {
+        wave_follow_refresh(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
     }
 
-    if (!(self->mode & WAVE_OPEN_READ) && !(self->mode & WAVE_OPEN_WRITE)) {
-        wave_seek(self, 0, SEEK_END);
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (!WAVE_IS_ADPCM(self->format_chunk.body.format_tag) && self->cache == NULL) {
+        size_t total = 0;
+        size_t length = wave_get_length(self);
+        size_t first;
+
+        if (self->buffer_used > 0) {
+            wave_drain_buffer(self);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+        }
+        if ((self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND | WAVE_OPEN_EDIT)) && fflush(self->fp) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+            return 0;
+        }
+        first = (size_t)wave_tell(self);
         if (g_err.code != WAVE_OK) {
             return 0;
         }
-    }
 
-    write_count = fwrite(buffer, sample_size, n_channels * count, self->fp);
-    if (ferror(self->fp)) {
-        wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
-        return 0;
+        for (i = 0; i < num_segments; ++i) {
+            total += segments[i].count;
+        }
+        done = wave_transfer_segments(self, segments, num_segments, first, MIN(total, first < length ? length - first : 0), WAVE_FALSE);
+        /* the stream did not move, and its read buffer no longer matches the position */
+        if (fseek(self->fp, (long)(self->data_chunk.offset + (WaveU64)(first + done) * self->format_chunk.body.block_align), SEEK_SET) != 0) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+            }
+            return 0;
+        }
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+        wave_segments_done(self, segments, num_segments, first, done, WAVE_FALSE);
+        return g_err.code == WAVE_OK ? done : 0;
     }
+#endif
 
-    self->riff_chunk.size += write_count * sample_size;
-    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
-        self->fact_chunk.body.sample_length += write_count / n_channels;
+    /* the block codec and the cache keep their own position, so their segments are read one by one */
+    for (i = 0; i < num_segments; ++i) {
+        size_t n = wave_read(self, segments[i].buffer, segments[i].count);
+        done += n;
+        if (n < segments[i].count || g_err.code != WAVE_OK) {
+            break;
+        }
     }
-    self->data_chunk.header.size += write_count * sample_size;
 
-    wave_update_sizes(self);
-    if (g_err.code != WAVE_OK)
+    return done;
+}
+
+void wave_drain_buffer(WaveFile* self)
+{
+    if (self->buffer_used == 0) {
+        return;
+    }
+
+    if (fwrite(self->buffer, self->buffer_used, 1, self->fp) != 1) {
+        wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        return;
+    }
+    self->buffer_used = 0;
+
+    /* the header on disk follows the data on disk, not the data in the buffer */
+    if (self->sizes_dirty && !(self->mode & WAVE_OPEN_DEFER_SIZES)) {
+        wave_update_sizes(self);
+        if (g_err.code == WAVE_OK) {
+            self->sizes_dirty = WAVE_FALSE;
+        }
+    }
+}
+
+static size_t wave_write_buffered(WaveFile* self, WAVE_CONST void *buffer, size_t count)
+{
+    size_t size = count * self->format_chunk.body.block_align;
+
+    if (self->buffer_used + size > self->buffer_size) {
+        wave_drain_buffer(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    self->riff_chunk.size += (WaveU32)size;
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID && !WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        self->fact_chunk.body.sample_length += (WaveU32)count;
+    }
+    self->data_chunk.header.size += (WaveU32)size;
+    self->sizes_dirty = WAVE_TRUE;
+
+    if (size >= self->buffer_size) {
+        /* too large to be worth a copy, this is already a coalesced write */
+        if (fwrite(buffer, size, 1, self->fp) != 1) {
+            wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
+            return 0;
+        }
+        if (!(self->mode & WAVE_OPEN_DEFER_SIZES)) {
+            wave_update_sizes(self);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+            self->sizes_dirty = WAVE_FALSE;
+        }
+    } else {
+        if (self->buffer_used == 0) {
+            long pos = ftell(self->fp);
+            if (pos == -1L) {
+                wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
+                return 0;
+            }
+            self->buffer_offset = (WaveU64)pos;
+        }
+        memcpy(self->buffer + self->buffer_used, buffer, size);
+        self->buffer_used += size;
+    }
+
+    return count;
+}
+
+/* The offset in the data chunk at which the next write lands */
+static WaveU64 wave_write_offset(WaveFile* self)
+{
+    long pos;
+
+    if (self->buffer_used > 0) {
+        return self->buffer_offset + self->buffer_used - self->data_chunk.offset;
+    }
+    pos = ftell(self->fp);
+    if (pos == -1L) {
+        wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
         return 0;
+    }
+    return (WaveU64)pos - self->data_chunk.offset;
+}
+
+size_t wave_write_raw(WaveFile* self, WAVE_CONST void *buffer, size_t count)
+{
+    size_t write_count;
+    WaveU16 n_channels = wave_get_num_channels(self);
+    size_t sample_size = self->format_chunk.body.block_align / n_channels;
+    WaveU64 offset = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (self->buffer == NULL) {
+        wave_tell(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (!(self->mode & WAVE_OPEN_READ) && !(self->mode & WAVE_OPEN_WRITE)) {
+        wave_seek(self, 0, SEEK_END);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (self->checksum != NULL) {
+        offset = wave_write_offset(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    if (self->buffer != NULL) {
+        write_count = wave_write_buffered(self, buffer, count);
+        if (self->checksum != NULL && write_count > 0) {
+            wave_checksum_update(self, offset, buffer, write_count * self->format_chunk.body.block_align);
+        }
+        return g_err.code == WAVE_OK ? write_count : 0;
+    }
+
+    write_count = fwrite(buffer, sample_size, n_channels * count, self->fp);
+    if (ferror(self->fp)) {
+        wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        return 0;
+    }
+
+    if (self->checksum != NULL && write_count > 0) {
+        wave_checksum_update(self, offset, buffer, write_count * sample_size);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    self->riff_chunk.size += write_count * sample_size;
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID && !WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        self->fact_chunk.body.sample_length += write_count / n_channels;
+    }
+    self->data_chunk.header.size += write_count * sample_size;
+
+    if (self->mode & WAVE_OPEN_DEFER_SIZES) {
+        self->sizes_dirty = WAVE_TRUE;
+    } else {
+        wave_update_sizes(self);
+        if (g_err.code != WAVE_OK)
+            return 0;
+    }
 
     return write_count / n_channels;
 }
 
+size_t wave_write(WaveFile* self, WAVE_CONST void *buffer, size_t count)
+{
+    size_t write_count;
+
+    if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+        return 0;
+    }
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        write_count = wave_adpcm_write(self, buffer, count);
+    } else {
+        write_count = wave_write_raw(self, buffer, count);
+    }
+
+    if (self->meter != NULL && write_count > 0) {
+        wave_meter_update(self, buffer, write_count);
+    }
+
+    return write_count;
+}
+
+size_t wave_writev(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments)
+{
+    size_t done = 0;
+    size_t i;
+
+    if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+        return 0;
+    }
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    /* frames that go through the write buffer are already coalesced */
+    if (!WAVE_IS_ADPCM(self->format_chunk.body.format_tag) && self->buffer == NULL) {
+        size_t  block_align = self->format_chunk.body.block_align;
+        size_t  total = 0;
+        size_t  size;
+        long    pos;
+
+        if (!(self->mode & WAVE_OPEN_READ) && !(self->mode & WAVE_OPEN_WRITE)) {
+            wave_seek(self, 0, SEEK_END);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+        }
+        if (fflush(self->fp) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+            return 0;
+        }
+        pos = ftell(self->fp);
+        if (pos == -1L) {
+            wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
+            return 0;
+        }
+
+        for (i = 0; i < num_segments; ++i) {
+            total += segments[i].count;
+        }
+        done = wave_transfer_segments(self, segments, num_segments, (size_t)(((WaveU64)pos - self->data_chunk.offset) / block_align), total, WAVE_TRUE);
+        size = done * block_align;
+        if (fseek(self->fp, pos + (long)size, SEEK_SET) != 0) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+            }
+            return 0;
+        }
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+
+        self->riff_chunk.size += (WaveU32)size;
+        if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+            self->fact_chunk.body.sample_length += (WaveU32)done;
+        }
+        self->data_chunk.header.size += (WaveU32)size;
+        if (self->mode & WAVE_OPEN_DEFER_SIZES) {
+            self->sizes_dirty = WAVE_TRUE;
+        } else {
+            wave_update_sizes(self);
+            if (g_err.code != WAVE_OK) {
+                return 0;
+            }
+        }
+
+        wave_segments_done(self, segments, num_segments, (size_t)(((WaveU64)pos - self->data_chunk.offset) / block_align), done, WAVE_TRUE);
+        return g_err.code == WAVE_OK ? done : 0;
+    }
+#endif
+
+    for (i = 0; i < num_segments; ++i) {
+        size_t n = wave_write(self, segments[i].buffer, segments[i].count);
+        done += n;
+        if (n < segments[i].count || g_err.code != WAVE_OK) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+/* Grow the conversion scratch buffer of {self} and return how many frames fit in one pass */
+static size_t wave_reserve_scratch(WaveFile* self, size_t count)
+{
+    size_t block_align = wave_get_num_channels(self) * wave_get_sample_size(self);
+    size_t frames = MIN(count, MAX(WAVE_SCRATCH_SIZE / block_align, 1));
+
+    if (self->scratch_size < frames * block_align) {
+        WaveU8 *scratch = wave_realloc(self->scratch, frames * block_align);
+        if (scratch == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the conversion buffer");
+            return 0;
+        }
+        self->scratch = scratch;
+        self->scratch_size = frames * block_align;
+    }
+
+    return frames;
+}
+
+size_t wave_read_float(WaveFile* self, float *buffer, size_t count)
+{
+    WaveEncoding encoding = wave_get_frame_encoding(self);
+    size_t       num_channels = wave_get_num_channels(self);
+    unsigned     padding_bits = wave_get_padding_bits(self);
+    size_t       done = 0;
+
+    if (encoding == WAVE_ENCODING_F32) {
+        return wave_read(self, buffer, count);
+    }
+    if (encoding == WAVE_ENCODING_UNSUPPORTED) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Sample format cannot be converted to float");
+        return 0;
+    }
+
+    while (done < count) {
+        size_t n = wave_reserve_scratch(self, count - done);
+        size_t read_count;
+
+        if (n == 0) {
+            break;
+        }
+        read_count = wave_read(self, self->scratch, n);
+        if (padding_bits > 0) {
+            wave_clear_padding_bits(self->scratch, wave_get_sample_size(self), read_count * num_channels, padding_bits);
+        }
+        wave_decode_f32(buffer + done * num_channels, self->scratch, encoding, read_count * num_channels);
+        done += read_count;
+        if (read_count < n) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+size_t wave_write_float(WaveFile* self, WAVE_CONST float *buffer, size_t count)
+{
+    WaveEncoding encoding = wave_get_frame_encoding(self);
+    size_t       num_channels = wave_get_num_channels(self);
+    unsigned     padding_bits = wave_get_padding_bits(self);
+    size_t       done = 0;
+
+    if (encoding == WAVE_ENCODING_F32) {
+        return wave_write(self, buffer, count);
+    }
+    if (encoding == WAVE_ENCODING_UNSUPPORTED) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Sample format cannot be converted from float");
+        return 0;
+    }
+
+    while (done < count) {
+        size_t n = wave_reserve_scratch(self, count - done);
+        size_t write_count;
+
+        if (n == 0) {
+            break;
+        }
+        wave_encode_f32(self->scratch, buffer + done * num_channels, encoding, n * num_channels);
+        if (padding_bits > 0) {
+            wave_round_padding_bits(self->scratch, wave_get_sample_size(self), n * num_channels, padding_bits);
+        }
+        write_count = wave_write(self, self->scratch, n);
+        done += write_count;
+        if (write_count < n) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+size_t wave_readv_float(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments)
+{
+    size_t done = 0;
+    size_t i;
+
+    for (i = 0; i < num_segments; ++i) {
+        size_t n = wave_read_float(self, segments[i].buffer, segments[i].count);
+        done += n;
+        if (n < segments[i].count || g_err.code != WAVE_OK) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+size_t wave_writev_float(WaveFile* self, WAVE_CONST WaveIoVec* segments, size_t num_segments)
+{
+    size_t done = 0;
+    size_t i;
+
+    for (i = 0; i < num_segments; ++i) {
+        size_t n = wave_write_float(self, segments[i].buffer, segments[i].count);
+        done += n;
+        if (n < segments[i].count || g_err.code != WAVE_OK) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+size_t wave_read_at(WaveFile* self, void *buffer, size_t size, WaveU64 offset)
+{
+    size_t done = 0;
+
+    if (self->buffer_used > 0) {
+        wave_drain_buffer(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+    if ((self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND | WAVE_OPEN_EDIT)) && fflush(self->fp) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+        return 0;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    {
+        long save_pos = ftell(self->fp);
+        if (fseek(self->fp, (long)offset, SEEK_SET) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+            return 0;
+        }
+        done = fread(buffer, 1, size, self->fp);
+        if (ferror(self->fp)) {
+            wave_err_set(WAVE_ERR_OS, "Error when reading %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        }
+        fseek(self->fp, save_pos, SEEK_SET);
+    }
+#else
+    while (done < size) {
+        ssize_t n = pread(fileno(self->fp), (char*)buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            wave_err_set(WAVE_ERR_OS, "Error when reading %s [errno %d: %s]", self->filename, errno, strerror(errno));
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+#endif
+
+    return done;
+}
+
 long int wave_tell(WAVE_CONST WaveFile* self)
 {
-    long pos = ftell(self->fp);
+    long pos;
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return wave_adpcm_tell(self);
+    }
+    if (self->buffer_used > 0) {
+        return (long)((self->buffer_offset + self->buffer_used - self->data_chunk.offset) / (self->format_chunk.body.block_align));
+    }
+    if (self->cache != NULL) {
+        return (long)((self->cache_pos - self->data_chunk.offset) / (self->format_chunk.body.block_align));
+    }
+
+    pos = ftell(self->fp);
 
     if (pos == -1L) {
         wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
@@ -648,6 +1345,10 @@ int wave_seek(WaveFile* self, long int offset, int origin)
         offset += (long)length;
     }
 
+    if (offset >= 0 && WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return wave_adpcm_seek(self, offset);
+    }
+
     /* POSIX allows seeking beyond end of file */
     if (offset >= 0) {
         offset *= self->format_chunk.body.block_align;
@@ -656,6 +1357,22 @@ int wave_seek(WaveFile* self, long int offset, int origin)
         return (int)g_err.code;
     }
 
+    if (self->cache != NULL) {
+        self->cache_pos = self->data_chunk.offset + (WaveU64)offset;
+        return 0;
+    }
+
+    if (self->buffer_used > 0) {
+        /* only a real seek invalidates the write buffer */
+        if (self->data_chunk.offset + (WaveU64)offset == self->buffer_offset + self->buffer_used) {
+            return 0;
+        }
+        wave_drain_buffer(self);
+        if (g_err.code != WAVE_OK) {
+            return (int)g_err.code;
+        }
+    }
+
     ret = fseek(self->fp, (long)self->data_chunk.offset + offset, SEEK_SET);
 
     if (ret != 0) {
@@ -673,12 +1390,50 @@ void wave_rewind(WaveFile* self)
 
 int wave_eof(WAVE_CONST WaveFile* self)
 {
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return (size_t)wave_adpcm_tell(self) >= wave_adpcm_get_length(self);
+    }
+    if (self->buffer_used > 0) {
+        return self->buffer_offset + self->buffer_used == self->data_chunk.offset + self->data_chunk.header.size;
+    }
+    if (self->cache != NULL) {
+        return self->cache_pos >= self->data_chunk.offset + self->data_chunk.header.size;
+    }
     return feof(self->fp) || ftell(self->fp) == (long)(self->data_chunk.offset + self->data_chunk.header.size);
 }
 
 int wave_flush(WaveFile* self)
 {
-    int ret = fflush(self->fp);
+    int ret;
+
+    wave_drain_buffer(self);
+    if (g_err.code != WAVE_OK) {
+        return (int)g_err.code;
+    }
+
+    if (self->sizes_dirty) {
+        wave_update_sizes(self);
+        if (g_err.code != WAVE_OK) {
+            return (int)g_err.code;
+        }
+        self->sizes_dirty = WAVE_FALSE;
+    }
+
+    if (wave_edit_is_dirty(self)) {
+        wave_edit_commit(self);
+        if (g_err.code != WAVE_OK) {
+            return (int)g_err.code;
+        }
+    }
+
+    if (self->checksum != NULL) {
+        wave_checksum_commit(self);
+        if (g_err.code != WAVE_OK) {
+            return (int)g_err.code;
+        }
+    }
+
+    ret = fflush(self->fp);
 
     if (ret != 0) {
         wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
@@ -687,23 +1442,167 @@ int wave_flush(WaveFile* self)
     return ret;
 }
 
+void wave_set_buffer_size(WaveFile* self, size_t size)
+{
+    if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+        return;
+    }
+
+    wave_drain_buffer(self);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
+    /* with a buffer of its own, the frames would otherwise be copied once more into the stdio buffer and written in
+     * pieces of its size. The stream is flushed first, which lets setvbuf() switch it after the header is written. */
+    if (fflush(self->fp) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (setvbuf(self->fp, NULL, size == 0 ? _IOFBF : _IONBF, BUFSIZ) != 0) {
+        wave_err_set_literal(WAVE_ERR_OS, "setvbuf() failed");
+        return;
+    }
+
+    if (size == 0) {
+        wave_free(self->buffer);
+        self->buffer = NULL;
+        self->buffer_size = 0;
+        return;
+    }
+
+    size -= size % self->format_chunk.body.block_align;
+    if (size == 0) {
+        size = self->format_chunk.body.block_align;
+    }
+
+    self->buffer = wave_realloc(self->buffer, size);
+    if (self->buffer == NULL) {
+        self->buffer_size = 0;
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the write buffer");
+        return;
+    }
+    self->buffer_size = size;
+}
+
+void wave_preallocate(WaveFile* self, size_t num_frames)
+{
+    if (!(self->mode & WAVE_OPEN_WRITE) && !(self->mode & WAVE_OPEN_APPEND)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+        return;
+    }
+
+#if defined(__linux__)
+    {
+        off_t offset = (off_t)(self->data_chunk.offset + self->data_chunk.header.size);
+        off_t len = (off_t)(num_frames * self->format_chunk.body.block_align);
+
+        /* keep the file length at the end of the real data so that recovery can rely on it */
+        if (len > 0 && fallocate(fileno(self->fp), FALLOC_FL_KEEP_SIZE, offset, len) != 0 && errno != EOPNOTSUPP) {
+            wave_err_set(WAVE_ERR_OS, "fallocate() failed [errno %d: %s]", errno, strerror(errno));
+        }
+    }
+#else
+    (void)num_frames;
+#endif
+}
+
+int wave_repair(WAVE_CONST char* filename)
+{
+    WaveFile *self;
+    WaveU64   data_end, file_size;
+
+    self = wave_open(filename, WAVE_OPEN_APPEND | WAVE_OPEN_REPAIR);
+    if (self == NULL) {
+        return (int)WAVE_ERR_OS;
+    }
+
+    if (g_err.code == WAVE_OK) {
+        data_end = self->data_chunk.offset + self->data_chunk.header.size;
+        file_size = wave_get_file_size(self);
+        /* drop a trailing partial frame, but never a chunk that follows the data */
+        if (g_err.code == WAVE_OK && file_size > data_end && !wave_has_chunk_at(self, data_end + (self->data_chunk.header.size & 1), file_size)) {
+            if (fflush(self->fp) != 0) {
+                wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+            } else if (wave_truncate(fileno(self->fp), data_end) != 0) {
+                wave_err_set(WAVE_ERR_OS, "Error when truncating %s [errno %d: %s]", filename, errno, strerror(errno));
+            }
+        }
+    }
+
+    wave_close(self);
+
+    return (int)g_err.code;
+}
+
+/* Whether the header of {self} can change freely, because there are no samples that depend on it */
+static WaveBool wave_header_is_free(WAVE_CONST WaveFile* self)
+{
+    return (self->mode & WAVE_OPEN_WRITE) || ((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0);
+}
+
+/* Place the fact and data chunks after a format chunk whose size changed. Only valid while there is no data. */
+static void wave_layout_chunks(WaveFile* self)
+{
+    WaveU64 offset = self->format_chunk.offset + self->format_chunk.header.size;
+
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+        self->fact_chunk.offset = offset + sizeof(WaveChunkHeader);
+        offset = self->fact_chunk.offset + self->fact_chunk.header.size;
+    }
+    self->data_chunk.offset = offset + sizeof(WaveChunkHeader);
+}
+
 void wave_set_format(WaveFile* self, WaveU16 format)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
+    WaveU16 old_format = self->format_chunk.body.format_tag;
+
+    if (!wave_header_is_free(self) && !(self->mode & WAVE_OPEN_EDIT)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
         return;
     }
 
-    if (format == self->format_chunk.body.format_tag)
+    if (format == old_format)
+        return;
+
+    /* an existing file can only switch between a plain format and the extensible form of it */
+    if (!wave_header_is_free(self) &&
+        !(format == WAVE_FORMAT_EXTENSIBLE && old_format == wave_get_sample_format(self) && !WAVE_IS_ADPCM(old_format)) &&
+        !(old_format == WAVE_FORMAT_EXTENSIBLE && format == wave_get_sample_format(self)))
+    {
+        wave_err_set_literal(WAVE_ERR_MODE, "The layout of the samples of an existing file cannot change");
         return;
+    }
 
     self->format_chunk.body.format_tag = format;
-    if (format != WAVE_FORMAT_PCM && format != WAVE_FORMAT_EXTENSIBLE) {
+    if (WAVE_IS_ADPCM(old_format)) {
+        /* back to 16-bit samples, without the codec extension and the fact chunk */
+        self->format_chunk.body.block_align = (WaveU16)(2 * self->format_chunk.body.num_channels);
+        self->format_chunk.body.bits_per_sample = 16;
+        self->format_chunk.body.avg_bytes_per_sec = self->format_chunk.body.block_align * self->format_chunk.body.sample_rate;
+        self->format_chunk.body.valid_bits_per_sample = 0;
+        self->format_chunk.body.channel_mask = 0;
+        memcpy(self->format_chunk.body.sub_format, default_sub_format, 16);
+        memset(self->format_chunk.body.ext_tail, 0, sizeof(self->format_chunk.body.ext_tail));
+        memset(&self->fact_chunk, 0, sizeof(self->fact_chunk));
+    }
+
+    if (format != WAVE_FORMAT_EXTENSIBLE) {
         self->format_chunk.body.ext_size = 0;
         self->format_chunk.header.size = (WaveU32)((WaveUIntPtr)&self->format_chunk.body.ext_size - (WaveUIntPtr)&self->format_chunk.body);
-    } else if (format == WAVE_FORMAT_EXTENSIBLE) {
+    } else {
         self->format_chunk.body.ext_size = 22;
-        self->format_chunk.header.size = sizeof(WaveFormatChunk) - sizeof(WaveChunkHeader);
+        self->format_chunk.header.size = (WaveU32)((WaveUIntPtr)&self->format_chunk.body.ext_tail - (WaveUIntPtr)&self->format_chunk.body);
+        /* the samples keep their encoding, now named by the sub format */
+        if (!WAVE_IS_ADPCM(old_format)) {
+            memcpy(self->format_chunk.body.sub_format, default_sub_format, 16);
+            self->format_chunk.body.sub_format[0] = (WaveU8)(old_format & 0xff);
+            self->format_chunk.body.sub_format[1] = (WaveU8)(old_format >> 8);
+        }
+        if (self->format_chunk.body.valid_bits_per_sample == 0) {
+            self->format_chunk.body.valid_bits_per_sample = (WaveU16)(8 * wave_get_sample_size(self));
+        }
     }
 
     if (format == WAVE_FORMAT_ALAW || format == WAVE_FORMAT_MULAW) {
@@ -716,15 +1615,23 @@ void wave_set_format(WaveFile* self, WaveU16 format)
         if (sample_size != 4 && sample_size != 8) {
             wave_set_sample_size(self, 4);
         }
+    } else if (WAVE_IS_ADPCM(format)) {
+        wave_adpcm_setup_format(self);
+        if (g_err.code != WAVE_OK) {
+            return;
+        }
     }
 
+    if (self->data_chunk.header.size == 0) {
+        wave_layout_chunks(self);
+    }
     wave_write_header(self);
 }
 
 void wave_set_num_channels(WaveFile* self, WaveU16 num_channels)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
-        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+    if (!wave_header_is_free(self)) {
+        wave_err_set_literal(WAVE_ERR_MODE, (self->mode & WAVE_OPEN_EDIT) ? "The layout of the samples of an existing file cannot change" : "This WaveFile is not writable");
         return;
     }
 
@@ -740,13 +1647,19 @@ void wave_set_num_channels(WaveFile* self, WaveU16 num_channels)
     self->format_chunk.body.num_channels = num_channels;
     self->format_chunk.body.block_align = self->format_chunk.body.block_align / old_num_channels * num_channels;
     self->format_chunk.body.avg_bytes_per_sec = self->format_chunk.body.block_align * self->format_chunk.body.sample_rate;
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_adpcm_setup_format(self);
+        if (g_err.code != WAVE_OK) {
+            return;
+        }
+    }
 
     wave_write_header(self);
 }
 
 void wave_set_sample_rate(WaveFile* self, WaveU32 sample_rate)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
+    if (!wave_header_is_free(self) && !(self->mode & WAVE_OPEN_EDIT)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
         return;
     }
@@ -756,17 +1669,29 @@ void wave_set_sample_rate(WaveFile* self, WaveU32 sample_rate)
 
     self->format_chunk.body.sample_rate = sample_rate;
     self->format_chunk.body.avg_bytes_per_sec = self->format_chunk.body.block_align * self->format_chunk.body.sample_rate;
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag) && (self->mode & WAVE_OPEN_EDIT)) {
+        /* the blocks are already encoded, only the byte rate follows the new rate */
+        self->format_chunk.body.avg_bytes_per_sec = (WaveU32)((WaveU64)sample_rate * self->format_chunk.body.block_align /
+                                                              wave_adpcm_samples_per_block(self));
+    } else if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_adpcm_setup_format(self);
+    }
 
     wave_write_header(self);
 }
 
 void wave_set_valid_bits_per_sample(WaveFile* self, WaveU16 bits)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
+    if (!wave_header_is_free(self) && !(self->mode & WAVE_OPEN_EDIT)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
         return;
     }
 
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag) && bits != 4) {
+        wave_err_set(WAVE_ERR_PARAM, "Invalid ValidBitsPerSample: %u", bits);
+        return;
+    }
+
     if (bits < 1 || bits > 8 * self->format_chunk.body.block_align / self->format_chunk.body.num_channels) {
         wave_err_set(WAVE_ERR_PARAM, "Invalid ValidBitsPerSample: %u", bits);
         return;
@@ -789,8 +1714,8 @@ void wave_set_valid_bits_per_sample(WaveFile* self, WaveU16 bits)
 
 void wave_set_sample_size(WaveFile* self, size_t sample_size)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
-        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+    if (!wave_header_is_free(self)) {
+        wave_err_set_literal(WAVE_ERR_MODE, (self->mode & WAVE_OPEN_EDIT) ? "The layout of the samples of an existing file cannot change" : "This WaveFile is not writable");
         return;
     }
 
@@ -799,6 +1724,11 @@ void wave_set_sample_size(WaveFile* self, size_t sample_size)
         return;
     }
 
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "The sample size of ADPCM is fixed");
+        return;
+    }
+
     self->format_chunk.body.block_align = (WaveU16)(sample_size * self->format_chunk.body.num_channels);
     self->format_chunk.body.avg_bytes_per_sec = self->format_chunk.body.block_align * self->format_chunk.body.sample_rate;
     self->format_chunk.body.bits_per_sample = (WaveU16)(sample_size * 8);
@@ -811,7 +1741,7 @@ void wave_set_sample_size(WaveFile* self, size_t sample_size)
 
 void wave_set_channel_mask(WaveFile* self, WaveU32 channel_mask)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
+    if (!wave_header_is_free(self) && !(self->mode & WAVE_OPEN_EDIT)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
         return;
     }
@@ -828,7 +1758,7 @@ void wave_set_channel_mask(WaveFile* self, WaveU32 channel_mask)
 
 void wave_set_sub_format(WaveFile* self, WaveU16 sub_format)
 {
-    if (!(self->mode & WAVE_OPEN_WRITE) && !((self->mode & WAVE_OPEN_APPEND) && self->is_a_new_file && self->data_chunk.header.size == 0)) {
+    if (!wave_header_is_free(self) && !(self->mode & WAVE_OPEN_EDIT)) {
         wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
         return;
     }
@@ -838,9 +1768,37 @@ void wave_set_sub_format(WaveFile* self, WaveU16 sub_format)
         return;
     }
 
+    if (sub_format != WAVE_FORMAT_PCM && sub_format != WAVE_FORMAT_IEEE_FLOAT &&
+        sub_format != WAVE_FORMAT_ALAW && sub_format != WAVE_FORMAT_MULAW)
+    {
+        wave_err_set(WAVE_ERR_PARAM, "Unsupported sub format: %#06x", sub_format);
+        return;
+    }
+
+    if (!wave_header_is_free(self)) {
+        size_t sample_size = wave_get_sample_size(self);
+        if (((sub_format == WAVE_FORMAT_ALAW || sub_format == WAVE_FORMAT_MULAW) && sample_size != 1) ||
+            (sub_format == WAVE_FORMAT_IEEE_FLOAT && sample_size != 4 && sample_size != 8))
+        {
+            wave_err_set_literal(WAVE_ERR_MODE, "The layout of the samples of an existing file cannot change");
+            return;
+        }
+    }
+
     self->format_chunk.body.sub_format[0] = (WaveU8)(sub_format & 0xff);
     self->format_chunk.body.sub_format[1] = (WaveU8)(sub_format >> 8);
 
+    if (sub_format == WAVE_FORMAT_ALAW || sub_format == WAVE_FORMAT_MULAW) {
+        if (wave_get_sample_size(self) != 1) {
+            wave_set_sample_size(self, 1);
+        }
+    } else if (sub_format == WAVE_FORMAT_IEEE_FLOAT) {
+        size_t sample_size = wave_get_sample_size(self);
+        if (sample_size != 4 && sample_size != 8) {
+            wave_set_sample_size(self, 4);
+        }
+    }
+
     wave_write_header(self);
 }
 
@@ -870,11 +1828,17 @@ WaveU16 wave_get_valid_bits_per_sample(WAVE_CONST WaveFile* self)
 
 size_t wave_get_sample_size(WAVE_CONST WaveFile* self)
 {
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return sizeof(WaveI16);
+    }
     return self->format_chunk.body.block_align / self->format_chunk.body.num_channels;
 }
 
 size_t wave_get_length(WAVE_CONST WaveFile* self)
 {
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return wave_adpcm_get_length(self);
+    }
     return self->data_chunk.header.size / (self->format_chunk.body.block_align);
 }
 
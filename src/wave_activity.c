@@ -0,0 +1,184 @@
+#include "wave_internal.h"
+#include "wave_kernels.h"
+#include "wave_pool.h"
+
+/* bytes of the data chunk scanned by one task */
+#define WAVE_ACTIVITY_TASK_SIZE     ((size_t)1 << 20)
+/* windows per second, i.e. the resolution of the activity map */
+#define WAVE_ACTIVITY_WINDOW_RATE   100
+
+typedef struct {
+    WaveFile*       file;
+    WaveEncoding    encoding;
+    unsigned        padding_bits;
+    size_t          num_channels;
+    size_t          length;
+    size_t          window_frames;
+    size_t          windows_per_task;
+    size_t          num_windows;
+    double          threshold_sq;
+    WaveU8*         active;         /* one flag per window */
+} WaveActivityScan;
+
+static void wave_activity_scan_task(void *context, size_t index)
+{
+    WaveActivityScan *scan = context;
+    WaveFile         *file = scan->file;
+    size_t            block_align = file->format_chunk.body.block_align;
+    size_t            first_window = index * scan->windows_per_task;
+    size_t            end_window = MIN(first_window + scan->windows_per_task, scan->num_windows);
+    size_t            first = first_window * scan->window_frames;
+    size_t            count = MIN(end_window * scan->window_frames, scan->length) - first;
+    WaveU8           *raw = wave_malloc(count * block_align);
+    float            *samples = wave_malloc(sizeof(float) * count * scan->num_channels);
+    size_t            w;
+
+    if (raw == NULL || samples == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the scan buffers");
+    } else if (wave_read_at(file, raw, count * block_align, file->data_chunk.offset + (WaveU64)first * block_align) != count * block_align) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", file->filename);
+        }
+    } else {
+        if (scan->padding_bits > 0) {
+            wave_clear_padding_bits(raw, block_align / scan->num_channels, count * scan->num_channels, scan->padding_bits);
+        }
+        wave_decode_f32(samples, raw, scan->encoding, count * scan->num_channels);
+        for (w = first_window; w < end_window; ++w) {
+            size_t offset = (w - first_window) * scan->window_frames;
+            size_t n = MIN(scan->window_frames, count - offset) * scan->num_channels;
+            double energy = wave_sum_squares_f32(samples + offset * scan->num_channels, n);
+            scan->active[w] = energy >= scan->threshold_sq * (double)n;
+        }
+    }
+
+    wave_free(samples);
+    wave_free(raw);
+}
+
+size_t wave_scan_activity(WaveFile* self, float threshold, double min_duration, WaveRegion** regions_out, size_t num_threads)
+{
+    WaveActivityScan  scan;
+    WavePool         *pool;
+    WaveRegion       *regions = NULL;
+    size_t            num_regions = 0;
+    size_t            capacity = 0;
+    size_t            block_align = self->format_chunk.body.block_align;
+    size_t            sample_rate = self->format_chunk.body.sample_rate;
+    size_t            num_tasks, min_gap, w;
+
+    *regions_out = NULL;
+
+    if (!(self->mode & WAVE_OPEN_READ)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not readable");
+        return 0;
+    }
+
+    memset(&scan, 0, sizeof(scan));
+    scan.file = self;
+    scan.encoding = wave_get_encoding(self);
+    if (scan.encoding == WAVE_ENCODING_UNSUPPORTED) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Sample format cannot be scanned");
+        return 0;
+    }
+
+    scan.padding_bits = wave_get_padding_bits(self);
+    scan.num_channels = wave_get_num_channels(self);
+    scan.length = wave_get_length(self);
+    if (g_err.code != WAVE_OK || scan.length == 0) {
+        return 0;
+    }
+    scan.window_frames = MAX(sample_rate / WAVE_ACTIVITY_WINDOW_RATE, 1);
+    scan.windows_per_task = MAX(WAVE_ACTIVITY_TASK_SIZE / (scan.window_frames * block_align), 1);
+    scan.num_windows = (scan.length + scan.window_frames - 1) / scan.window_frames;
+    scan.threshold_sq = (double)threshold * threshold;
+    scan.active = wave_malloc(scan.num_windows);
+    if (scan.active == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the activity map");
+        return 0;
+    }
+
+    /* the tasks read the file with positional reads, which do not see frames still in the write buffer */
+    wave_drain_buffer(self);
+    if (g_err.code != WAVE_OK) {
+        wave_free(scan.active);
+        return 0;
+    }
+
+    num_tasks = (scan.num_windows + scan.windows_per_task - 1) / scan.windows_per_task;
+    pool = wave_pool_create(MIN(num_tasks, num_threads != 0 ? num_threads : wave_cpu_count()));
+    wave_pool_run(pool, num_tasks, wave_activity_scan_task, &scan);
+    wave_pool_destroy(pool);
+    if (g_err.code != WAVE_OK) {
+        wave_free(scan.active);
+        return 0;
+    }
+
+    /* bridge silences shorter than {min_duration}, so only stretches of dead air worth a seek are skipped */
+    min_gap = min_duration > 0.0 ? (size_t)(min_duration * (double)sample_rate) : 0;
+    min_gap = MAX(min_gap, 1);
+    for (w = 0; w < scan.num_windows; ++w) {
+        size_t first, end;
+
+        if (!scan.active[w]) {
+            continue;
+        }
+        first = w * scan.window_frames;
+        end = MIN(first + scan.window_frames, scan.length);
+
+        if (num_regions > 0 && first - (regions[num_regions - 1].first_frame + regions[num_regions - 1].num_frames) < min_gap) {
+            regions[num_regions - 1].num_frames = end - regions[num_regions - 1].first_frame;
+            continue;
+        }
+
+        if (num_regions == capacity) {
+            WaveRegion *p = wave_realloc(regions, sizeof(WaveRegion) * (capacity > 0 ? capacity * 2 : 16));
+            if (p == NULL) {
+                wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the regions");
+                wave_free(regions);
+                wave_free(scan.active);
+                return 0;
+            }
+            regions = p;
+            capacity = capacity > 0 ? capacity * 2 : 16;
+        }
+        regions[num_regions].first_frame = first;
+        regions[num_regions].num_frames = end - first;
+        ++num_regions;
+    }
+
+    wave_free(scan.active);
+    *regions_out = regions;
+
+    return num_regions;
+}
+
+void wave_free_regions(WaveRegion* regions)
+{
+    wave_free(regions);
+}
+
+size_t wave_read_regions(WaveFile* self, WAVE_CONST WaveRegion* regions, size_t num_regions, void *buffer)
+{
+    WaveU8 *dst = buffer;
+    size_t  block_align = self->format_chunk.body.block_align;
+    size_t  done = 0;
+    size_t  i;
+
+    for (i = 0; i < num_regions; ++i) {
+        size_t n;
+
+        wave_seek(self, (long)regions[i].first_frame, SEEK_SET);
+        if (g_err.code != WAVE_OK) {
+            break;
+        }
+        n = wave_read(self, dst, regions[i].num_frames);
+        dst += n * block_align;
+        done += n;
+        if (g_err.code != WAVE_OK || n < regions[i].num_frames) {
+            break;
+        }
+    }
+
+    return done;
+}
@@ -0,0 +1,721 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_pool.h"
+
+/* the block header of every channel is decoded in place, so the channels are bounded */
+#define WAVE_ADPCM_MAX_CHANNELS     8
+/* bytes of whole blocks fetched with one positional read */
+#define WAVE_ADPCM_BATCH_SIZE       ((size_t)1 << 20)
+/* batches of at least this many blocks are decoded on the pool, in tasks of {WAVE_ADPCM_TASK_BLOCKS} blocks */
+#define WAVE_ADPCM_PARALLEL_BLOCKS  64
+#define WAVE_ADPCM_TASK_BLOCKS      16
+/* the predictor in the block header is a byte, so later coefficients can never be used */
+#define WAVE_ADPCM_MAX_COEFS        256
+
+static WAVE_CONST int wave_ima_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107,
+    118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894,
+    6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static WAVE_CONST int wave_ima_index_adjust[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/* the 7 predictors that every Microsoft ADPCM file must start its coefficient table with */
+static WAVE_CONST int wave_ms_coef1[7] = {256, 512, 0, 192, 240, 460, 392};
+static WAVE_CONST int wave_ms_coef2[7] = {0, -256, 0, 64, 0, -208, -232};
+
+static WAVE_CONST int wave_ms_adapt[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230
+};
+
+struct _WaveAdpcm {
+    WaveU16     format_tag;
+    WaveU16     num_channels;
+    WaveU16     block_align;
+    size_t      samples_per_block;
+
+    WaveU8*     raw;            /* encoded blocks, {batch} blocks when reading, one when writing */
+    size_t      batch;
+    WaveI16*    block;          /* one decoded block, or the frames waiting for a block when writing */
+    size_t      block_index;    /* the block in {block}, or SIZE_MAX */
+    size_t      block_frames;
+    WavePool*   pool;
+
+    size_t      pos;
+    size_t      pending;        /* frames in {block} not yet encoded */
+    size_t      written;        /* frames in encoded blocks */
+    int         ima_index[WAVE_ADPCM_MAX_CHANNELS];
+    int         ms_coefs[WAVE_ADPCM_MAX_COEFS][2];  /* the coefficient table of the format chunk */
+    size_t      num_coefs;
+};
+
+typedef struct {
+    WaveAdpcm*          adpcm;
+    WAVE_CONST WaveU8*  src;
+    WaveI16*            dst;
+    size_t              num_blocks;
+} WaveAdpcmBatch;
+
+static WaveI16 wave_clamp_s16(int x)
+{
+    return (WaveI16)(x < -32768 ? -32768 : x > 32767 ? 32767 : x);
+}
+
+static WaveI16 wave_read_s16(WAVE_CONST WaveU8* p)
+{
+    return (WaveI16)(WaveU16)(p[0] | (p[1] << 8));
+}
+
+static void wave_write_s16(WaveU8* p, int x)
+{
+    p[0] = (WaveU8)(x & 0xff);
+    p[1] = (WaveU8)((x >> 8) & 0xff);
+}
+
+/* The number of frames that {size} bytes of a block hold */
+static size_t wave_adpcm_max_frames(WaveU16 format_tag, size_t num_channels, size_t size)
+{
+    if (format_tag == WAVE_FORMAT_IMA_ADPCM) {
+        return size < 4 * num_channels ? 0 : 1 + (size - 4 * num_channels) / (4 * num_channels) * 8;
+    }
+    return size < 7 * num_channels ? 0 : 2 + (size - 7 * num_channels) * 2 / num_channels;
+}
+
+size_t wave_adpcm_samples_per_block(WAVE_CONST WaveFile* self)
+{
+    WaveU16 format_tag = self->format_chunk.body.format_tag;
+    size_t  num_channels = self->format_chunk.body.num_channels;
+    size_t  max_frames = wave_adpcm_max_frames(format_tag, num_channels, self->format_chunk.body.block_align);
+
+    /* the extension starts with wSamplesPerBlock, which shares its place with wValidBitsPerSample */
+    if (self->format_chunk.body.ext_size >= 2 && self->format_chunk.body.valid_bits_per_sample != 0) {
+        return MIN(self->format_chunk.body.valid_bits_per_sample, max_frames);
+    }
+    return max_frames;
+}
+
+static int wave_ima_decode_sample(int nibble, int* pred, int* index)
+{
+    int step = wave_ima_steps[*index];
+    int diff = step >> 3;
+
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+    *pred = wave_clamp_s16(nibble & 8 ? *pred - diff : *pred + diff);
+    *index = MIN(MAX(*index + wave_ima_index_adjust[nibble], 0), 88);
+
+    return *pred;
+}
+
+static int wave_ima_encode_sample(int sample, int* pred, int* index)
+{
+    int step = wave_ima_steps[*index];
+    int diff = sample - *pred;
+    int nibble = 0;
+
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 1;
+    }
+
+    /* track the decoder, not the input, so that errors do not accumulate */
+    wave_ima_decode_sample(nibble, pred, index);
+
+    return nibble;
+}
+
+/* Decode up to {frames} frames of the IMA block {src} of {size} bytes, returns the number of frames decoded.
+ * After the 4-byte header of each channel, the channels take turns with 4 bytes holding 8 samples, low nibble first. */
+static size_t wave_ima_decode_block(WaveI16* dst, WAVE_CONST WaveU8* src, size_t size, size_t num_channels, size_t frames)
+{
+    WAVE_CONST WaveU8 *data = src + 4 * num_channels;
+    size_t             c, g, k;
+
+    frames = MIN(frames, wave_adpcm_max_frames(WAVE_FORMAT_IMA_ADPCM, num_channels, size));
+
+    for (c = 0; c < num_channels && frames > 0; ++c) {
+        int pred = wave_read_s16(src + 4 * c);
+        int index = MIN(src[4 * c + 2], 88);
+
+        dst[c] = (WaveI16)pred;
+        for (g = 0; 1 + g * 8 < frames; ++g) {
+            WAVE_CONST WaveU8 *p = data + (g * num_channels + c) * 4;
+            for (k = 0; k < 8 && 1 + g * 8 + k < frames; ++k) {
+                int nibble = (p[k >> 1] >> ((k & 1) * 4)) & 0xf;
+                dst[(1 + g * 8 + k) * num_channels + c] = (WaveI16)wave_ima_decode_sample(nibble, &pred, &index);
+            }
+        }
+    }
+
+    return frames;
+}
+
+static void wave_ima_encode_block(WaveU8* dst, WAVE_CONST WaveI16* src, size_t num_channels, size_t frames, int* indices)
+{
+    WaveU8 *data = dst + 4 * num_channels;
+    size_t  c, g, k;
+
+    for (c = 0; c < num_channels; ++c) {
+        int pred = src[c];
+
+        wave_write_s16(dst + 4 * c, pred);
+        dst[4 * c + 2] = (WaveU8)indices[c];
+        dst[4 * c + 3] = 0;
+        for (g = 0; 1 + g * 8 < frames; ++g) {
+            WaveU8 *p = data + (g * num_channels + c) * 4;
+            for (k = 0; k < 8; ++k) {
+                int nibble = wave_ima_encode_sample(src[(1 + g * 8 + k) * num_channels + c], &pred, &indices[c]);
+                p[k >> 1] |= (WaveU8)(nibble << ((k & 1) * 4));
+            }
+        }
+    }
+}
+
+/* Decode up to {frames} frames of the Microsoft ADPCM block {src} of {size} bytes, returns the number of frames decoded.
+ * The header holds the predictor, delta, second and first sample of each channel, followed by one nibble per sample
+ * with the channels interleaved, high nibble first. The predictors index {coefs} and have been checked against it. */
+static size_t wave_ms_decode_block(WaveI16* dst, WAVE_CONST WaveU8* src, size_t size, size_t num_channels, size_t frames,
+                                   WAVE_CONST int (*coefs)[2])
+{
+    WAVE_CONST WaveU8 *data = src + 7 * num_channels;
+    int                coef1[WAVE_ADPCM_MAX_CHANNELS], coef2[WAVE_ADPCM_MAX_CHANNELS];
+    int                delta[WAVE_ADPCM_MAX_CHANNELS], s1[WAVE_ADPCM_MAX_CHANNELS], s2[WAVE_ADPCM_MAX_CHANNELS];
+    size_t             c, n;
+
+    frames = MIN(frames, wave_adpcm_max_frames(WAVE_FORMAT_ADPCM, num_channels, size));
+    if (frames == 0) {
+        return 0;
+    }
+
+    for (c = 0; c < num_channels; ++c) {
+        coef1[c] = coefs[src[c]][0];
+        coef2[c] = coefs[src[c]][1];
+        delta[c] = wave_read_s16(src + num_channels + 2 * c);
+        s1[c] = wave_read_s16(src + 3 * num_channels + 2 * c);
+        s2[c] = wave_read_s16(src + 5 * num_channels + 2 * c);
+        dst[c] = (WaveI16)s2[c];
+        if (frames > 1) {
+            dst[num_channels + c] = (WaveI16)s1[c];
+        }
+    }
+
+    for (n = 0; n < (frames - MIN(frames, 2)) * num_channels; ++n) {
+        int nibble = (n & 1) ? data[n >> 1] & 0xf : data[n >> 1] >> 4;
+        int pred;
+
+        c = n % num_channels;
+        pred = (s1[c] * coef1[c] + s2[c] * coef2[c]) >> 8;
+        pred = wave_clamp_s16(pred + (nibble >= 8 ? nibble - 16 : nibble) * delta[c]);
+        s2[c] = s1[c];
+        s1[c] = pred;
+        delta[c] = MAX((wave_ms_adapt[nibble] * delta[c]) >> 8, 16);
+        dst[2 * num_channels + n] = (WaveI16)pred;
+    }
+
+    return frames;
+}
+
+/* Encode channel {c} of {frames} frames with {predictor}, returns the squared error. {dst} may be NULL for a trial. */
+static double wave_ms_encode_channel(WaveU8* dst, WAVE_CONST WaveI16* src, size_t num_channels, size_t c, size_t frames,
+                                     int predictor, int delta)
+{
+    int    s2 = src[c];
+    int    s1 = src[num_channels + c];
+    double error = 0.0;
+    size_t i;
+
+    for (i = 2; i < frames; ++i) {
+        int sample = src[i * num_channels + c];
+        int pred = (s1 * wave_ms_coef1[predictor] + s2 * wave_ms_coef2[predictor]) >> 8;
+        int diff = sample - pred;
+        int nibble = diff >= 0 ? (diff + delta / 2) / delta : -((-diff + delta / 2) / delta);
+        int out;
+
+        nibble = MIN(MAX(nibble, -8), 7);
+        out = wave_clamp_s16(pred + nibble * delta);
+        error += (double)(sample - out) * (sample - out);
+        s2 = s1;
+        s1 = out;
+        delta = MAX((wave_ms_adapt[nibble & 0xf] * delta) >> 8, 16);
+
+        if (dst != NULL) {
+            size_t n = (i - 2) * num_channels + c;
+            dst[n >> 1] |= (WaveU8)((n & 1) ? (nibble & 0xf) : (nibble & 0xf) << 4);
+        }
+    }
+
+    return error;
+}
+
+static void wave_ms_encode_block(WaveU8* dst, WAVE_CONST WaveI16* src, size_t num_channels, size_t frames)
+{
+    WaveU8 *data = dst + 7 * num_channels;
+    size_t  c;
+    int     p;
+
+    for (c = 0; c < num_channels; ++c) {
+        double best_error = 0.0;
+        int    best = 0, best_delta = 16;
+
+        /* every predictor is tried, starting from a delta of a quarter of its first prediction errors */
+        for (p = 0; p < 7; ++p) {
+            int    delta = 0;
+            double error;
+            size_t i;
+
+            for (i = 2; i < MIN(frames, 5); ++i) {
+                int x1 = src[(i - 1) * num_channels + c], x2 = src[(i - 2) * num_channels + c];
+                int e = src[i * num_channels + c] - ((x1 * wave_ms_coef1[p] + x2 * wave_ms_coef2[p]) >> 8);
+                delta += e < 0 ? -e : e;
+            }
+            delta = MIN(MAX(delta / 12, 16), 32767);
+
+            error = wave_ms_encode_channel(NULL, src, num_channels, c, frames, p, delta);
+            if (p == 0 || error < best_error) {
+                best_error = error;
+                best = p;
+                best_delta = delta;
+            }
+        }
+
+        dst[c] = (WaveU8)best;
+        wave_write_s16(dst + num_channels + 2 * c, best_delta);
+        wave_write_s16(dst + 3 * num_channels + 2 * c, src[num_channels + c]);
+        wave_write_s16(dst + 5 * num_channels + 2 * c, src[c]);
+        wave_ms_encode_channel(data, src, num_channels, c, frames, best, best_delta);
+    }
+}
+
+static size_t wave_adpcm_decode_block(WAVE_CONST WaveAdpcm* adpcm, WaveI16* dst, WAVE_CONST WaveU8* src, size_t size, size_t frames)
+{
+    if (adpcm->format_tag == WAVE_FORMAT_IMA_ADPCM) {
+        return wave_ima_decode_block(dst, src, size, adpcm->num_channels, frames);
+    }
+    return wave_ms_decode_block(dst, src, size, adpcm->num_channels, frames, (WAVE_CONST int (*)[2])adpcm->ms_coefs);
+}
+
+/* Check that the predictors of the Microsoft ADPCM blocks in the {size} bytes at {src}, the first of which is block
+ * {first}, are in the coefficient table */
+static void wave_ms_check_blocks(WAVE_CONST WaveFile* self, WAVE_CONST WaveAdpcm* adpcm, WAVE_CONST WaveU8* src,
+                                 size_t size, size_t first)
+{
+    size_t b, c;
+
+    if (adpcm->format_tag != WAVE_FORMAT_ADPCM) {
+        return;
+    }
+    for (b = 0; b * adpcm->block_align + adpcm->num_channels <= size; ++b) {
+        for (c = 0; c < adpcm->num_channels; ++c) {
+            if (src[b * adpcm->block_align + c] >= adpcm->num_coefs) {
+                wave_err_set(WAVE_ERR_FORMAT, "Invalid ADPCM predictor %u in block %zu of %s",
+                             (unsigned)src[b * adpcm->block_align + c], first + b, self->filename);
+                return;
+            }
+        }
+    }
+}
+
+/* Load the coefficient table that follows wSamplesPerBlock and wNumCoef in the format chunk. The first 7 pairs are
+ * kept in the extensible fields, the others are read from the file. */
+static void wave_ms_load_coefs(WaveFile* self, WaveAdpcm* adpcm)
+{
+    WAVE_CONST WaveU8 *ext = (WAVE_CONST WaveU8*)&self->format_chunk.body.valid_bits_per_sample;
+    size_t             num_coefs = (WaveU16)wave_read_s16(ext + 2);
+    size_t             in_body = MIN(num_coefs, 7);
+    WaveU8             rest[4 * (WAVE_ADPCM_MAX_COEFS - 7)];
+    size_t             i;
+
+    if (num_coefs == 0 || self->format_chunk.body.ext_size < 4 + 4 * num_coefs ||
+        self->format_chunk.header.size < 18 + 4 + 4 * num_coefs)
+    {
+        wave_err_set(WAVE_ERR_FORMAT, "Invalid ADPCM coefficient table of %zu entries", num_coefs);
+        return;
+    }
+    num_coefs = MIN(num_coefs, WAVE_ADPCM_MAX_COEFS);
+
+    for (i = 0; i < in_body; ++i) {
+        adpcm->ms_coefs[i][0] = wave_read_s16(ext + 4 + 4 * i);
+        adpcm->ms_coefs[i][1] = wave_read_s16(ext + 6 + 4 * i);
+    }
+    if (num_coefs > in_body) {
+        size_t size = 4 * (num_coefs - in_body);
+        if (wave_read_at(self, rest, size, self->format_chunk.offset + 18 + 4 + 4 * in_body) != size) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+            }
+            return;
+        }
+        for (i = in_body; i < num_coefs; ++i) {
+            adpcm->ms_coefs[i][0] = wave_read_s16(rest + 4 * (i - in_body));
+            adpcm->ms_coefs[i][1] = wave_read_s16(rest + 4 * (i - in_body) + 2);
+        }
+    }
+    adpcm->num_coefs = num_coefs;
+}
+
+void wave_adpcm_destroy(WaveAdpcm* adpcm)
+{
+    if (adpcm == NULL) {
+        return;
+    }
+    wave_pool_destroy(adpcm->pool);
+    wave_free(adpcm->block);
+    wave_free(adpcm->raw);
+    wave_free(adpcm);
+}
+
+/* The codec state of {self}, created on first use and re-created if the format changed before any frame */
+static WaveAdpcm* wave_adpcm_get(WaveFile* self)
+{
+    WaveAdpcm *adpcm = self->adpcm;
+    WaveU16    format_tag = self->format_chunk.body.format_tag;
+    size_t     num_channels = self->format_chunk.body.num_channels;
+    size_t     block_align = self->format_chunk.body.block_align;
+    size_t     samples_per_block = wave_adpcm_samples_per_block(self);
+
+    if (adpcm != NULL && adpcm->format_tag == format_tag && adpcm->num_channels == num_channels &&
+        adpcm->block_align == block_align && adpcm->samples_per_block == samples_per_block)
+    {
+        return adpcm;
+    }
+    wave_adpcm_destroy(adpcm);
+    self->adpcm = NULL;
+
+    if (num_channels < 1 || num_channels > WAVE_ADPCM_MAX_CHANNELS) {
+        wave_err_set(WAVE_ERR_FORMAT, "Unsupported number of ADPCM channels: %zu", num_channels);
+        return NULL;
+    }
+    if (samples_per_block < 2 || (format_tag == WAVE_FORMAT_IMA_ADPCM && block_align % (4 * num_channels) != 0)) {
+        wave_err_set(WAVE_ERR_FORMAT, "Invalid ADPCM block size: %zu", block_align);
+        return NULL;
+    }
+
+    adpcm = wave_malloc(sizeof(WaveAdpcm));
+    if (adpcm == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the ADPCM codec");
+        return NULL;
+    }
+    memset(adpcm, 0, sizeof(WaveAdpcm));
+    adpcm->format_tag = format_tag;
+    adpcm->num_channels = (WaveU16)num_channels;
+    adpcm->block_align = (WaveU16)block_align;
+    adpcm->samples_per_block = samples_per_block;
+    adpcm->batch = MAX(WAVE_ADPCM_BATCH_SIZE / block_align, 1);
+    adpcm->block_index = (size_t)-1;
+
+    adpcm->raw = wave_malloc(adpcm->batch * block_align);
+    adpcm->block = wave_malloc(sizeof(WaveI16) * samples_per_block * num_channels);
+    if (adpcm->raw == NULL || adpcm->block == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the ADPCM codec");
+        wave_adpcm_destroy(adpcm);
+        return NULL;
+    }
+    if (format_tag == WAVE_FORMAT_ADPCM) {
+        wave_ms_load_coefs(self, adpcm);
+        if (g_err.code != WAVE_OK) {
+            wave_adpcm_destroy(adpcm);
+            return NULL;
+        }
+    }
+
+    self->adpcm = adpcm;
+    return adpcm;
+}
+
+void wave_adpcm_setup_format(WaveFile* self)
+{
+    WaveU16 format_tag = self->format_chunk.body.format_tag;
+    size_t  num_channels = self->format_chunk.body.num_channels;
+    WaveU32 sample_rate = self->format_chunk.body.sample_rate;
+    size_t  block_align, samples_per_block, i;
+
+    if (num_channels > WAVE_ADPCM_MAX_CHANNELS) {
+        wave_err_set(WAVE_ERR_FORMAT, "Unsupported number of ADPCM channels: %zu", num_channels);
+        return;
+    }
+
+    /* the customary block sizes of the Windows codecs */
+    block_align = 256 * num_channels * (sample_rate <= 11025 ? 1 : sample_rate <= 22050 ? 2 : 4);
+    samples_per_block = wave_adpcm_max_frames(format_tag, num_channels, block_align);
+
+    self->format_chunk.body.block_align = (WaveU16)block_align;
+    self->format_chunk.body.bits_per_sample = 4;
+    self->format_chunk.body.avg_bytes_per_sec = (WaveU32)((WaveU64)sample_rate * block_align / samples_per_block);
+    self->format_chunk.body.valid_bits_per_sample = (WaveU16)samples_per_block;
+
+    if (format_tag == WAVE_FORMAT_IMA_ADPCM) {
+        self->format_chunk.body.ext_size = 2;
+    } else {
+        /* wSamplesPerBlock, wNumCoef and the coefficient pairs, which continue past the extensible fields */
+        WaveU8 ext[32];
+
+        wave_write_s16(ext, (int)samples_per_block);
+        wave_write_s16(ext + 2, 7);
+        for (i = 0; i < 7; ++i) {
+            wave_write_s16(ext + 4 + 4 * i, wave_ms_coef1[i]);
+            wave_write_s16(ext + 6 + 4 * i, wave_ms_coef2[i]);
+        }
+        self->format_chunk.body.ext_size = 32;
+        memcpy(&self->format_chunk.body.valid_bits_per_sample, ext, sizeof(ext));
+    }
+    self->format_chunk.header.size = (WaveU32)((WaveUIntPtr)&self->format_chunk.body.valid_bits_per_sample -
+                                               (WaveUIntPtr)&self->format_chunk.body) + self->format_chunk.body.ext_size;
+
+    self->fact_chunk.header.id = WAVE_FACT_CHUNK_ID;
+    self->fact_chunk.header.size = sizeof(self->fact_chunk.body);
+    self->fact_chunk.body.sample_length = 0;
+}
+
+size_t wave_adpcm_get_length(WAVE_CONST WaveFile* self)
+{
+    WaveU16 format_tag = self->format_chunk.body.format_tag;
+    size_t  num_channels = self->format_chunk.body.num_channels;
+    size_t  block_align = self->format_chunk.body.block_align;
+    size_t  samples_per_block = wave_adpcm_samples_per_block(self);
+    size_t  size = self->data_chunk.header.size;
+    size_t  length;
+
+    if (num_channels == 0 || block_align == 0) {
+        return 0;
+    }
+
+    length = size / block_align * samples_per_block;
+    length += MIN(wave_adpcm_max_frames(format_tag, num_channels, size % block_align), samples_per_block);
+
+    /* the last block is padded, only the fact chunk knows where the frames end */
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+        length = MIN(length, self->fact_chunk.body.sample_length);
+    }
+
+    return length;
+}
+
+long wave_adpcm_tell(WAVE_CONST WaveFile* self)
+{
+    return self->adpcm != NULL ? (long)self->adpcm->pos : 0;
+}
+
+int wave_adpcm_seek(WaveFile* self, long frame)
+{
+    WaveAdpcm *adpcm = wave_adpcm_get(self);
+
+    if (adpcm == NULL) {
+        return (int)g_err.code;
+    }
+    if (adpcm->written > 0 || adpcm->pending > 0) {
+        wave_err_set_literal(WAVE_ERR_MODE, "ADPCM frames can only be written sequentially");
+        return (int)g_err.code;
+    }
+
+    /* no I/O here, the block that holds the frame is decoded by the next read */
+    adpcm->pos = (size_t)frame;
+    return 0;
+}
+
+static void wave_adpcm_decode_task(void *context, size_t index)
+{
+    WaveAdpcmBatch *batch = context;
+    WaveAdpcm      *adpcm = batch->adpcm;
+    size_t          first = index * WAVE_ADPCM_TASK_BLOCKS;
+    size_t          end = MIN(first + WAVE_ADPCM_TASK_BLOCKS, batch->num_blocks);
+    size_t          b;
+
+    for (b = first; b < end; ++b) {
+        wave_adpcm_decode_block(adpcm, batch->dst + b * adpcm->samples_per_block * adpcm->num_channels,
+                                batch->src + b * adpcm->block_align, adpcm->block_align, adpcm->samples_per_block);
+    }
+}
+
+/* Decode {num_blocks} whole blocks starting at block {first} straight into {dst}. Blocks are independent, so large
+ * batches are spread over a pool of threads. */
+static void wave_adpcm_decode_blocks(WaveFile* self, WaveAdpcm* adpcm, size_t first, size_t num_blocks, WaveI16* dst)
+{
+    WaveAdpcmBatch batch;
+    size_t         size = num_blocks * adpcm->block_align;
+
+    if (wave_read_at(self, adpcm->raw, size, self->data_chunk.offset + (WaveU64)first * adpcm->block_align) != size) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+        }
+        return;
+    }
+    wave_ms_check_blocks(self, adpcm, adpcm->raw, size, first);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
+    batch.adpcm = adpcm;
+    batch.src = adpcm->raw;
+    batch.dst = dst;
+    batch.num_blocks = num_blocks;
+
+    if (num_blocks >= WAVE_ADPCM_PARALLEL_BLOCKS && adpcm->pool == NULL) {
+        adpcm->pool = wave_pool_create(wave_cpu_count());
+    }
+    wave_pool_run(num_blocks >= WAVE_ADPCM_PARALLEL_BLOCKS ? adpcm->pool : NULL,
+                  (num_blocks + WAVE_ADPCM_TASK_BLOCKS - 1) / WAVE_ADPCM_TASK_BLOCKS, wave_adpcm_decode_task, &batch);
+}
+
+/* Decode block {index} into the block buffer */
+static void wave_adpcm_load_block(WaveFile* self, WaveAdpcm* adpcm, size_t index, size_t length)
+{
+    WaveU64 offset = (WaveU64)index * adpcm->block_align;
+    size_t  size = (size_t)MIN((WaveU64)adpcm->block_align, self->data_chunk.header.size - offset);
+    size_t  frames = MIN(adpcm->samples_per_block, length - index * adpcm->samples_per_block);
+
+    adpcm->block_index = (size_t)-1;
+    if (wave_read_at(self, adpcm->raw, size, self->data_chunk.offset + offset) != size) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+        }
+        return;
+    }
+    wave_ms_check_blocks(self, adpcm, adpcm->raw, size, index);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
+    adpcm->block_frames = wave_adpcm_decode_block(adpcm, adpcm->block, adpcm->raw, size, frames);
+    adpcm->block_index = index;
+}
+
+size_t wave_adpcm_read(WaveFile* self, WaveI16* buffer, size_t count)
+{
+    WaveAdpcm *adpcm = wave_adpcm_get(self);
+    size_t     length = wave_adpcm_get_length(self);
+    size_t     done = 0;
+
+    if (adpcm == NULL) {
+        return 0;
+    }
+    if (adpcm->written > 0 || adpcm->pending > 0) {
+        wave_err_set_literal(WAVE_ERR_MODE, "ADPCM frames cannot be read while writing");
+        return 0;
+    }
+
+    count = MIN(count, adpcm->pos < length ? length - adpcm->pos : 0);
+
+    while (done < count) {
+        size_t spb = adpcm->samples_per_block;
+        size_t index = adpcm->pos / spb;
+        size_t offset = adpcm->pos % spb;
+        size_t n;
+
+        if (offset == 0 && count - done >= spb) {
+            n = MIN((count - done) / spb, adpcm->batch);
+            wave_adpcm_decode_blocks(self, adpcm, index, n, buffer + done * adpcm->num_channels);
+            n *= spb;
+        } else {
+            if (adpcm->block_index != index) {
+                wave_adpcm_load_block(self, adpcm, index, length);
+            }
+            n = g_err.code == WAVE_OK ? MIN(count - done, adpcm->block_frames - MIN(offset, adpcm->block_frames)) : 0;
+            memcpy(buffer + done * adpcm->num_channels, adpcm->block + offset * adpcm->num_channels,
+                   sizeof(WaveI16) * n * adpcm->num_channels);
+        }
+        if (g_err.code != WAVE_OK || n == 0) {
+            break;
+        }
+
+        done += n;
+        adpcm->pos += n;
+    }
+
+    return done;
+}
+
+/* Encode the frames waiting in the block buffer, padded with copies of the last frame, and write the block */
+static void wave_adpcm_flush_block(WaveFile* self, WaveAdpcm* adpcm)
+{
+    size_t num_channels = adpcm->num_channels;
+    size_t i;
+
+    for (i = adpcm->pending; i < adpcm->samples_per_block; ++i) {
+        memcpy(adpcm->block + i * num_channels, adpcm->block + (adpcm->pending - 1) * num_channels, sizeof(WaveI16) * num_channels);
+    }
+
+    memset(adpcm->raw, 0, adpcm->block_align);
+    if (adpcm->format_tag == WAVE_FORMAT_IMA_ADPCM) {
+        wave_ima_encode_block(adpcm->raw, adpcm->block, num_channels, adpcm->samples_per_block, adpcm->ima_index);
+    } else {
+        wave_ms_encode_block(adpcm->raw, adpcm->block, num_channels, adpcm->samples_per_block);
+    }
+
+    /* the fact chunk is written together with the other sizes */
+    self->fact_chunk.body.sample_length = (WaveU32)(adpcm->written + adpcm->pending);
+    if (wave_write_raw(self, adpcm->raw, 1) != 1) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_OS, "Short write to %s", self->filename);
+        }
+        return;
+    }
+
+    adpcm->written += adpcm->pending;
+    adpcm->pending = 0;
+}
+
+size_t wave_adpcm_write(WaveFile* self, WAVE_CONST WaveI16* buffer, size_t count)
+{
+    WaveAdpcm *adpcm = wave_adpcm_get(self);
+    size_t     done = 0;
+
+    if (adpcm == NULL) {
+        return 0;
+    }
+    if (adpcm->written == 0 && adpcm->pending == 0 && self->data_chunk.header.size != 0) {
+        wave_err_set_literal(WAVE_ERR_MODE, "Cannot append to ADPCM data");
+        return 0;
+    }
+
+    while (done < count) {
+        size_t n = MIN(count - done, adpcm->samples_per_block - adpcm->pending);
+
+        memcpy(adpcm->block + adpcm->pending * adpcm->num_channels, buffer + done * adpcm->num_channels,
+               sizeof(WaveI16) * n * adpcm->num_channels);
+        adpcm->pending += n;
+        adpcm->pos += n;
+        done += n;
+
+        if (adpcm->pending == adpcm->samples_per_block) {
+            wave_adpcm_flush_block(self, adpcm);
+            if (g_err.code != WAVE_OK) {
+                return done - MIN(done, adpcm->pending);
+            }
+        }
+    }
+
+    return done;
+}
+
+void wave_adpcm_finish(WaveFile* self)
+{
+    WaveAdpcm *adpcm = self->adpcm;
+
+    if (adpcm != NULL && adpcm->pending > 0 && g_err.code == WAVE_OK) {
+        wave_adpcm_flush_block(self, adpcm);
+    }
+}
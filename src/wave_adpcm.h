@@ -0,0 +1,30 @@
+#ifndef __WAVE_ADPCM_H__
+#define __WAVE_ADPCM_H__
+
+#include "wave.h"
+
+#define WAVE_IS_ADPCM(format_tag) ((format_tag) == WAVE_FORMAT_IMA_ADPCM || (format_tag) == WAVE_FORMAT_ADPCM)
+
+/* Block codec state attached to a WaveFile on the first read or write of IMA or Microsoft ADPCM frames. Frames are
+ * 16-bit PCM on the API side; the data chunk holds whole blocks of {block_align} bytes. */
+typedef struct _WaveAdpcm WaveAdpcm;
+
+void    wave_adpcm_destroy(WaveAdpcm* adpcm);
+
+/** Fill in the format chunk and add the fact chunk for the ADPCM format of {self}, based on its channels and rate */
+void    wave_adpcm_setup_format(WaveFile* self);
+
+/** The number of frames in every block of {self}, as given by the format chunk */
+size_t  wave_adpcm_samples_per_block(WAVE_CONST WaveFile* self);
+
+size_t  wave_adpcm_get_length(WAVE_CONST WaveFile* self);
+long    wave_adpcm_tell(WAVE_CONST WaveFile* self);
+int     wave_adpcm_seek(WaveFile* self, long frame);
+
+size_t  wave_adpcm_read(WaveFile* self, WaveI16* buffer, size_t count);
+size_t  wave_adpcm_write(WaveFile* self, WAVE_CONST WaveI16* buffer, size_t count);
+
+/** Encode the frames of the last partial block, padded to a whole block. Called when the file is closed. */
+void    wave_adpcm_finish(WaveFile* self);
+
+#endif /* __WAVE_ADPCM_H__ */
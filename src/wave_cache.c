@@ -0,0 +1,545 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_thread.h"
+
+#include <sys/stat.h>
+
+#define WAVE_CACHE_MAX_SHARDS       64
+#define WAVE_CACHE_BLOCKS_PER_SHARD 4
+#define WAVE_CACHE_MIN_BUCKETS      16
+#define WAVE_CACHE_DEFAULT_BLOCK    ((size_t)64 << 10)
+
+/* the block index under which the parsed header of a file is stored */
+#define WAVE_CACHE_HEADER_BLOCK     (~(WaveU64)0)
+
+typedef struct _WaveCacheEntry {
+    struct _WaveCacheEntry* hash_next;
+    struct _WaveCacheEntry* lru_prev;
+    struct _WaveCacheEntry* lru_next;
+    WaveFileId              id;
+    WaveU64                 block;
+    WaveU64                 hash;
+    size_t                  size;
+    WaveU8                  data[];
+} WaveCacheEntry;
+
+typedef struct {
+    WaveMasterChunk riff_chunk;
+    WaveFormatChunk format_chunk;
+    WaveFactChunk   fact_chunk;
+    WaveDataChunk   data_chunk;
+} WaveCacheHeader;
+
+typedef struct {
+    WaveMutex           mutex;
+    WaveCacheEntry**    buckets;
+    size_t              num_buckets;
+    size_t              num_entries;
+    WaveCacheEntry*     lru_head;   /* most recently used */
+    WaveCacheEntry*     lru_tail;
+    size_t              size;
+    size_t              capacity;
+    WaveCacheStats      stats;
+} WaveCacheShard;
+
+struct _WaveCache {
+    size_t          block_size;
+    size_t          num_shards;
+    WaveCacheShard  shards[WAVE_CACHE_MAX_SHARDS];
+};
+
+static WaveU64 wave_cache_mix(WaveU64 h, WaveU64 v)
+{
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+static WaveU64 wave_cache_hash(WAVE_CONST WaveFileId* id, WaveU64 block)
+{
+    WaveU64 h = wave_cache_mix(0, id->device);
+    h = wave_cache_mix(h, id->inode);
+    h = wave_cache_mix(h, id->size);
+    h = wave_cache_mix(h, id->mtime);
+    return wave_cache_mix(h, block);
+}
+
+static WaveCacheShard* wave_cache_shard(WaveCache* self, WaveU64 hash)
+{
+    return &self->shards[hash & (self->num_shards - 1)];
+}
+
+static WaveCacheEntry* wave_cache_find(WaveCacheShard* shard, WAVE_CONST WaveFileId* id, WaveU64 block, WaveU64 hash)
+{
+    WaveCacheEntry *entry = shard->buckets[(hash >> 6) & (shard->num_buckets - 1)];
+
+    for (; entry != NULL; entry = entry->hash_next) {
+        if (entry->hash == hash && entry->block == block && memcmp(&entry->id, id, sizeof(WaveFileId)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void wave_cache_lru_unlink(WaveCacheShard* shard, WaveCacheEntry* entry)
+{
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+}
+
+static void wave_cache_lru_push(WaveCacheShard* shard, WaveCacheEntry* entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head != NULL) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+static void wave_cache_touch(WaveCacheShard* shard, WaveCacheEntry* entry)
+{
+    if (shard->lru_head != entry) {
+        wave_cache_lru_unlink(shard, entry);
+        wave_cache_lru_push(shard, entry);
+    }
+}
+
+static size_t wave_cache_cost(WAVE_CONST WaveCacheEntry* entry)
+{
+    return sizeof(WaveCacheEntry) + entry->size;
+}
+
+static void wave_cache_evict(WaveCacheShard* shard, WaveCacheEntry* entry)
+{
+    WaveCacheEntry **link = &shard->buckets[(entry->hash >> 6) & (shard->num_buckets - 1)];
+
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    wave_cache_lru_unlink(shard, entry);
+    shard->size -= wave_cache_cost(entry);
+    --shard->num_entries;
+    ++shard->stats.evictions;
+    wave_free(entry);
+}
+
+static void wave_cache_grow(WaveCacheShard* shard)
+{
+    size_t           num_buckets = shard->num_buckets * 2;
+    WaveCacheEntry **buckets = wave_malloc(sizeof(WaveCacheEntry*) * num_buckets);
+    size_t           i;
+
+    /* a longer chain is not worth failing the insertion for */
+    if (buckets == NULL) {
+        return;
+    }
+    memset(buckets, 0, sizeof(WaveCacheEntry*) * num_buckets);
+
+    for (i = 0; i < shard->num_buckets; ++i) {
+        WaveCacheEntry *entry = shard->buckets[i];
+        while (entry != NULL) {
+            WaveCacheEntry *next = entry->hash_next;
+            WaveCacheEntry **bucket = &buckets[(entry->hash >> 6) & (num_buckets - 1)];
+            entry->hash_next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    wave_free(shard->buckets);
+    shard->buckets = buckets;
+    shard->num_buckets = num_buckets;
+}
+
+/* Insert {entry}, or drop it in favour of an equal entry inserted by another thread in the meantime. Either way, the
+ * returned entry stays in the cache until the shard is unlocked. */
+static WaveCacheEntry* wave_cache_insert(WaveCacheShard* shard, WaveCacheEntry* entry)
+{
+    WaveCacheEntry **bucket;
+    WaveCacheEntry  *existing = wave_cache_find(shard, &entry->id, entry->block, entry->hash);
+
+    if (existing != NULL) {
+        wave_free(entry);
+        wave_cache_touch(shard, existing);
+        return existing;
+    }
+
+    if (shard->num_entries >= shard->num_buckets) {
+        wave_cache_grow(shard);
+    }
+
+    bucket = &shard->buckets[(entry->hash >> 6) & (shard->num_buckets - 1)];
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    wave_cache_lru_push(shard, entry);
+    shard->size += wave_cache_cost(entry);
+    ++shard->num_entries;
+
+    while (shard->size > shard->capacity && shard->lru_tail != entry) {
+        wave_cache_evict(shard, shard->lru_tail);
+    }
+
+    return entry;
+}
+
+static WaveCacheEntry* wave_cache_new_entry(WAVE_CONST WaveFileId* id, WaveU64 block, WaveU64 hash, size_t size)
+{
+    WaveCacheEntry *entry = wave_malloc(sizeof(WaveCacheEntry) + size);
+
+    if (entry == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate a cache block");
+        return NULL;
+    }
+    entry->id = *id;
+    entry->block = block;
+    entry->hash = hash;
+    entry->size = size;
+    return entry;
+}
+
+static void wave_get_file_id(WaveFile* self, WaveFileId* id)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    struct _stat64  st;
+    WAVE_CONST char *p;
+
+    if (_fstat64(fileno(self->fp), &st) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fstat() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    /* there are no inode numbers, so the name stands in for one */
+    id->device = (WaveU64)st.st_dev;
+    id->inode = 0xcbf29ce484222325ULL;
+    for (p = self->filename; *p != '\0'; ++p) {
+        id->inode = (id->inode ^ (WaveU8)*p) * 0x100000001b3ULL;
+    }
+    id->size = (WaveU64)st.st_size;
+    id->mtime = (WaveU64)st.st_mtime;
+#else
+    struct stat st;
+
+    if (fstat(fileno(self->fp), &st) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fstat() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    id->device = (WaveU64)st.st_dev;
+    id->inode = (WaveU64)st.st_ino;
+    id->size = (WaveU64)st.st_size;
+#if defined(__linux__)
+    id->mtime = (WaveU64)st.st_mtim.tv_sec * 1000000000ULL + (WaveU64)st.st_mtim.tv_nsec;
+#else
+    id->mtime = (WaveU64)st.st_mtime;
+#endif
+#endif
+}
+
+static WaveBool wave_cache_get_header(WaveCache* self, WaveFile* file)
+{
+    WaveU64          hash = wave_cache_hash(&file->cache_id, WAVE_CACHE_HEADER_BLOCK);
+    WaveCacheShard  *shard = wave_cache_shard(self, hash);
+    WaveCacheEntry  *entry;
+    WaveCacheHeader  header;
+
+    wave_mutex_lock(&shard->mutex);
+    entry = wave_cache_find(shard, &file->cache_id, WAVE_CACHE_HEADER_BLOCK, hash);
+    if (entry != NULL) {
+        memcpy(&header, entry->data, sizeof(WaveCacheHeader));
+        wave_cache_touch(shard, entry);
+        ++shard->stats.header_hits;
+    } else {
+        ++shard->stats.header_misses;
+    }
+    wave_mutex_unlock(&shard->mutex);
+
+    if (entry == NULL) {
+        return WAVE_FALSE;
+    }
+
+    file->riff_chunk = header.riff_chunk;
+    file->format_chunk = header.format_chunk;
+    file->fact_chunk = header.fact_chunk;
+    file->data_chunk = header.data_chunk;
+    return WAVE_TRUE;
+}
+
+static void wave_cache_put_header(WaveCache* self, WaveFile* file)
+{
+    WaveU64          hash = wave_cache_hash(&file->cache_id, WAVE_CACHE_HEADER_BLOCK);
+    WaveCacheShard  *shard = wave_cache_shard(self, hash);
+    WaveCacheEntry  *entry = wave_malloc(sizeof(WaveCacheEntry) + sizeof(WaveCacheHeader));
+    WaveCacheHeader  header;
+
+    /* a header that is not cached is parsed again next time, which is not an error */
+    if (entry == NULL) {
+        return;
+    }
+    entry->id = file->cache_id;
+    entry->block = WAVE_CACHE_HEADER_BLOCK;
+    entry->hash = hash;
+    entry->size = sizeof(WaveCacheHeader);
+
+    header.riff_chunk = file->riff_chunk;
+    header.format_chunk = file->format_chunk;
+    header.fact_chunk = file->fact_chunk;
+    header.data_chunk = file->data_chunk;
+    memcpy(entry->data, &header, sizeof(WaveCacheHeader));
+
+    wave_mutex_lock(&shard->mutex);
+    wave_cache_insert(shard, entry);
+    wave_mutex_unlock(&shard->mutex);
+}
+
+/* Copy {size} bytes at {offset} of block {block} of {file}, reading the block on a miss */
+static void wave_cache_copy(WaveCache* self, WaveFile* file, WaveU64 block, size_t offset, WaveU8* dst, size_t size)
+{
+    WaveU64          hash = wave_cache_hash(&file->cache_id, block);
+    WaveCacheShard  *shard = wave_cache_shard(self, hash);
+    WaveCacheEntry  *entry;
+    size_t           read_size;
+
+    wave_mutex_lock(&shard->mutex);
+    entry = wave_cache_find(shard, &file->cache_id, block, hash);
+    if (entry != NULL && entry->size >= offset + size) {
+        memcpy(dst, entry->data + offset, size);
+        wave_cache_touch(shard, entry);
+        ++shard->stats.hits;
+        wave_mutex_unlock(&shard->mutex);
+        return;
+    }
+    ++shard->stats.misses;
+    wave_mutex_unlock(&shard->mutex);
+
+    /* read without the lock, racing threads that miss the same block each read it and the first one is kept */
+    entry = wave_cache_new_entry(&file->cache_id, block, hash, self->block_size);
+    if (entry == NULL) {
+        return;
+    }
+    read_size = wave_read_at(file, entry->data, self->block_size, block * self->block_size);
+    if (g_err.code != WAVE_OK || read_size < offset + size) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", file->filename);
+        }
+        wave_free(entry);
+        return;
+    }
+    entry->size = read_size;
+
+    wave_mutex_lock(&shard->mutex);
+    entry = wave_cache_insert(shard, entry);
+    memcpy(dst, entry->data + offset, size);
+    wave_mutex_unlock(&shard->mutex);
+}
+
+WaveCache* wave_cache_create(size_t capacity, size_t block_size)
+{
+    WaveCache *self = wave_malloc(sizeof(WaveCache));
+    size_t     i;
+
+    if (self == NULL) {
+        return NULL;
+    }
+    memset(self, 0, sizeof(WaveCache));
+    self->block_size = block_size != 0 ? block_size : WAVE_CACHE_DEFAULT_BLOCK;
+
+    /* fewer shards for small caches, so that every shard can still hold a few blocks */
+    self->num_shards = 1;
+    while (self->num_shards < WAVE_CACHE_MAX_SHARDS &&
+           capacity / (self->num_shards * 2) >= WAVE_CACHE_BLOCKS_PER_SHARD * self->block_size)
+    {
+        self->num_shards *= 2;
+    }
+
+    for (i = 0; i < self->num_shards; ++i) {
+        WaveCacheShard *shard = &self->shards[i];
+
+        shard->buckets = wave_malloc(sizeof(WaveCacheEntry*) * WAVE_CACHE_MIN_BUCKETS);
+        if (shard->buckets == NULL) {
+            while (i-- > 0) {
+                wave_mutex_destroy(&self->shards[i].mutex);
+                wave_free(self->shards[i].buckets);
+            }
+            wave_free(self);
+            return NULL;
+        }
+        memset(shard->buckets, 0, sizeof(WaveCacheEntry*) * WAVE_CACHE_MIN_BUCKETS);
+        shard->num_buckets = WAVE_CACHE_MIN_BUCKETS;
+        shard->capacity = capacity / self->num_shards;
+        wave_mutex_init(&shard->mutex);
+    }
+
+    return self;
+}
+
+void wave_cache_destroy(WaveCache* self)
+{
+    size_t i;
+
+    for (i = 0; i < self->num_shards; ++i) {
+        WaveCacheShard *shard = &self->shards[i];
+        WaveCacheEntry *entry = shard->lru_head;
+
+        while (entry != NULL) {
+            WaveCacheEntry *next = entry->lru_next;
+            wave_free(entry);
+            entry = next;
+        }
+        wave_free(shard->buckets);
+        wave_mutex_destroy(&shard->mutex);
+    }
+
+    wave_free(self);
+}
+
+void wave_cache_get_stats(WAVE_CONST WaveCache* self, WaveCacheStats* stats)
+{
+    size_t i;
+
+    memset(stats, 0, sizeof(WaveCacheStats));
+    for (i = 0; i < self->num_shards; ++i) {
+        WaveCacheShard *shard = (WaveCacheShard*)&self->shards[i];
+
+        wave_mutex_lock(&shard->mutex);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->header_hits += shard->stats.header_hits;
+        stats->header_misses += shard->stats.header_misses;
+        stats->evictions += shard->stats.evictions;
+        stats->size += shard->size;
+        wave_mutex_unlock(&shard->mutex);
+    }
+}
+
+WaveFile* wave_open_cached(WAVE_CONST char* filename, WaveCache* cache)
+{
+    WaveFile *self = wave_malloc(sizeof(WaveFile));
+
+    if (self == NULL) {
+        return NULL;
+    }
+    memset(self, 0, sizeof(WaveFile));
+
+    self->fp = fopen(filename, "rb");
+    if (self->fp == NULL) {
+        wave_err_set(WAVE_ERR_OS, "Error when opening %s [errno %d: %s]", filename, errno, strerror(errno));
+        return self;
+    }
+    self->filename = wave_strdup(filename);
+    self->mode = WAVE_OPEN_READ;
+
+    wave_get_file_id(self, &self->cache_id);
+    if (g_err.code != WAVE_OK) {
+        return self;
+    }
+
+    if (!wave_cache_get_header(cache, self)) {
+        wave_parse_header(self);
+        if (g_err.code != WAVE_OK) {
+            return self;
+        }
+        wave_cache_put_header(cache, self);
+    }
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "ADPCM files cannot be cached");
+        return self;
+    }
+
+    self->cache = cache;
+    self->cache_pos = self->data_chunk.offset;
+
+    return self;
+}
+
+void wave_set_cache(WaveFile* self, WaveCache* cache)
+{
+    long pos;
+
+    if ((self->mode & WAVE_OPEN_WRITE) || (self->mode & WAVE_OPEN_APPEND)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "Only read-only WaveFiles can be cached");
+        return;
+    }
+
+    if (cache != NULL && (self->mode & WAVE_OPEN_FOLLOW)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "Files that are still being written cannot be cached");
+        return;
+    }
+
+    if (cache != NULL && WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "ADPCM files cannot be cached");
+        return;
+    }
+
+    if (cache == NULL) {
+        /* hand the position back to the stream */
+        if (self->cache != NULL && fseek(self->fp, (long)self->cache_pos, SEEK_SET) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+            return;
+        }
+        self->cache = NULL;
+        return;
+    }
+
+    if (self->cache == NULL) {
+        pos = ftell(self->fp);
+        if (pos == -1L) {
+            wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
+            return;
+        }
+        wave_get_file_id(self, &self->cache_id);
+        if (g_err.code != WAVE_OK) {
+            return;
+        }
+        self->cache_pos = (WaveU64)pos;
+    }
+
+    wave_cache_put_header(cache, self);
+    self->cache = cache;
+}
+
+size_t wave_cache_read(WaveFile* self, void *buffer, size_t count)
+{
+    WaveCache *cache = self->cache;
+    size_t     block_align = self->format_chunk.body.block_align;
+    WaveU64    data_end = self->data_chunk.offset + self->data_chunk.header.size;
+    WaveU64    pos = self->cache_pos;
+    size_t     size, copied = 0;
+
+    if (pos >= data_end) {
+        return 0;
+    }
+    count = (size_t)MIN((WaveU64)count, (data_end - pos) / block_align);
+    size = count * block_align;
+
+    while (copied < size) {
+        WaveU64 offset = pos + copied;
+        size_t  in_block = (size_t)(offset % cache->block_size);
+        size_t  n = MIN(size - copied, cache->block_size - in_block);
+
+        wave_cache_copy(cache, self, offset / cache->block_size, in_block, (WaveU8*)buffer + copied, n);
+        if (g_err.code != WAVE_OK) {
+            break;
+        }
+        copied += n;
+    }
+
+    copied -= copied % block_align;
+    self->cache_pos += copied;
+
+    return copied / block_align;
+}
@@ -0,0 +1,503 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_checksum.h"
+#include "wave_kernels.h"
+#include "wave_pool.h"
+
+/* bytes of the data chunk per checksum, rounded down to whole frames or ADPCM blocks */
+#define WAVE_CHECKSUM_BLOCK_SIZE    ((size_t)64 << 10)
+/* bytes of the data chunk read and checked by one task of {wave_verify} */
+#define WAVE_CHECKSUM_TASK_SIZE     ((size_t)4 << 20)
+
+#pragma pack(push, 1)
+
+/* the start of the body of the "crcc" chunk, followed by one CRC32C per block */
+typedef struct {
+    WaveU32 block_size;
+    WaveU64 data_size;
+} WaveChecksumHeader;
+
+#pragma pack(pop)
+
+struct _WaveChecksum {
+    WaveU32     block_size;     /* 0 until the frame size of a new file is known */
+    WaveU64     data_size;      /* bytes of the data chunk covered by the chunk that was loaded */
+    WaveU32*    crcs;
+    size_t      num_crcs;
+    size_t      capacity;
+
+    /* readers: whether every block has been checked, and one block read back from the file */
+    WaveU8*     verified;
+    WaveU8*     block;
+
+    /* writers: the bytes from the start of the data chunk that {crcs} cover, and whether a write did not continue there */
+    WaveU64     frontier;
+    WaveBool    resync;
+};
+
+static WaveChecksum* wave_checksum_create(void)
+{
+    WaveChecksum* checksum = wave_malloc(sizeof(WaveChecksum));
+
+    if (checksum == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the checksums");
+        return NULL;
+    }
+    memset(checksum, 0, sizeof(WaveChecksum));
+    return checksum;
+}
+
+void wave_checksum_destroy(WaveChecksum* checksum)
+{
+    if (checksum == NULL) {
+        return;
+    }
+    wave_free(checksum->crcs);
+    wave_free(checksum->verified);
+    wave_free(checksum->block);
+    wave_free(checksum);
+}
+
+static WaveBool wave_checksum_reserve(WaveChecksum* checksum, size_t num_crcs)
+{
+    WaveU32* crcs;
+    size_t   capacity;
+
+    if (num_crcs <= checksum->capacity) {
+        return WAVE_TRUE;
+    }
+    capacity = MAX(num_crcs, checksum->capacity > 0 ? checksum->capacity * 2 : 64);
+    crcs = wave_realloc(checksum->crcs, sizeof(WaveU32) * capacity);
+    if (crcs == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the checksums");
+        return WAVE_FALSE;
+    }
+    checksum->crcs = crcs;
+    checksum->capacity = capacity;
+    return WAVE_TRUE;
+}
+
+static WaveU8* wave_checksum_block(WaveChecksum* checksum)
+{
+    if (checksum->block == NULL) {
+        checksum->block = wave_malloc(checksum->block_size);
+        if (checksum->block == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the checksum buffer");
+        }
+    }
+    return checksum->block;
+}
+
+/* The frame that starts at byte {offset} of the data chunk, or the length for the end of it */
+static size_t wave_checksum_frame(WAVE_CONST WaveFile* self, WaveU64 offset)
+{
+    size_t block_align = self->format_chunk.body.block_align;
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        return MIN((size_t)(offset / block_align) * wave_adpcm_samples_per_block(self), wave_adpcm_get_length(self));
+    }
+    return (size_t)(offset / block_align);
+}
+
+/* Where the "crcc" chunk of a file that ends with its data chunk goes */
+static WaveU64 wave_checksum_chunk_offset(WAVE_CONST WaveFile* self)
+{
+    WaveU64 data_size = self->data_chunk.header.size;
+    return self->data_chunk.offset + data_size + (data_size & 1);
+}
+
+/* Find the "crcc" chunk among the chunks after the data chunk. Returns NULL if there is none. */
+static WaveChecksum* wave_checksum_load(WaveFile* self)
+{
+    WaveChecksum*       checksum;
+    WaveChecksumHeader  body;
+    WaveChunkHeader     header;
+    WaveU64             offset = wave_checksum_chunk_offset(self);
+    WaveU64             num_crcs;
+
+    for (;;) {
+        if (wave_read_at(self, &header, sizeof(header), offset) != sizeof(header)) {
+            return NULL;
+        }
+        if (header.id == WAVE_CRC_CHUNK_ID) {
+            break;
+        }
+        offset += sizeof(header) + header.size + (header.size & 1);
+    }
+
+    if (header.size < sizeof(body) || wave_read_at(self, &body, sizeof(body), offset + sizeof(header)) != sizeof(body) ||
+        body.block_size == 0 || body.block_size % self->format_chunk.body.block_align != 0)
+    {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Invalid checksum chunk in %s", self->filename);
+        }
+        return NULL;
+    }
+    num_crcs = (body.data_size + body.block_size - 1) / body.block_size;
+    if (num_crcs != (header.size - sizeof(body)) / 4) {
+        wave_err_set(WAVE_ERR_FORMAT, "Invalid checksum chunk in %s", self->filename);
+        return NULL;
+    }
+
+    checksum = wave_checksum_create();
+    if (checksum == NULL) {
+        return NULL;
+    }
+    checksum->block_size = body.block_size;
+    checksum->data_size = body.data_size;
+    checksum->num_crcs = (size_t)num_crcs;
+    if (!wave_checksum_reserve(checksum, checksum->num_crcs) ||
+        wave_read_at(self, checksum->crcs, sizeof(WaveU32) * checksum->num_crcs, offset + sizeof(header) + sizeof(body)) !=
+            sizeof(WaveU32) * checksum->num_crcs)
+    {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Invalid checksum chunk in %s", self->filename);
+        }
+        wave_checksum_destroy(checksum);
+        return NULL;
+    }
+
+    return checksum;
+}
+
+void wave_checksum_open(WaveFile* self)
+{
+    WaveU64 data_size = self->data_chunk.header.size;
+
+    if (self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND)) {
+        if (!(self->mode & WAVE_OPEN_WRITE) && !self->is_a_new_file) {
+            self->checksum = wave_checksum_load(self);
+            if (g_err.code != WAVE_OK) {
+                return;
+            }
+        }
+        if (self->checksum == NULL) {
+            if (!(self->mode & WAVE_OPEN_CHECKSUM)) {
+                return;
+            }
+            self->checksum = wave_checksum_create();
+            if (self->checksum == NULL) {
+                return;
+            }
+        }
+        /* the chunk is written again after the frames that are appended, which overwrite it */
+        self->riff_chunk.size = (WaveU32)(self->data_chunk.offset + data_size - 8);
+        self->checksum->frontier = MIN(self->checksum->data_size, data_size);
+        self->checksum->resync = self->checksum->frontier != data_size;
+        return;
+    }
+
+    self->checksum = wave_checksum_load(self);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+    if (self->checksum == NULL) {
+        wave_err_set(WAVE_ERR_FORMAT, "No block checksums in %s", self->filename);
+        return;
+    }
+    if (self->checksum->data_size != data_size) {
+        wave_err_set(WAVE_ERR_CHECKSUM, "The checksums of %s cover %llu of %llu bytes", self->filename,
+                     (unsigned long long)self->checksum->data_size, (unsigned long long)data_size);
+        return;
+    }
+    self->checksum->verified = wave_malloc(MAX(self->checksum->num_crcs, 1));
+    if (self->checksum->verified == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the checksums");
+        return;
+    }
+    memset(self->checksum->verified, 0, MAX(self->checksum->num_crcs, 1));
+}
+
+/* The block size of a new file, decided by the first write so that the format can be set after {wave_open} */
+static void wave_checksum_start(WaveFile* self)
+{
+    size_t block_align = self->format_chunk.body.block_align;
+
+    if (self->checksum->block_size == 0) {
+        self->checksum->block_size = (WaveU32)(MAX(WAVE_CHECKSUM_BLOCK_SIZE / block_align, 1) * block_align);
+    }
+}
+
+void wave_checksum_update(WaveFile* self, WaveU64 offset, WAVE_CONST WaveU8* data, size_t size)
+{
+    WaveChecksum* checksum = self->checksum;
+
+    wave_checksum_start(self);
+    if (checksum->resync || offset != checksum->frontier) {
+        checksum->resync = WAVE_TRUE;
+        checksum->frontier = MIN(checksum->frontier, offset);
+        return;
+    }
+
+    while (size > 0) {
+        size_t index = (size_t)(checksum->frontier / checksum->block_size);
+        size_t used = (size_t)(checksum->frontier % checksum->block_size);
+        size_t n = MIN(size, checksum->block_size - used);
+
+        if (!wave_checksum_reserve(checksum, index + 1)) {
+            return;
+        }
+        if (used == 0) {
+            checksum->crcs[index] = 0;
+        }
+        checksum->crcs[index] = wave_crc32c(checksum->crcs[index], data, n);
+        checksum->num_crcs = index + 1;
+        checksum->frontier += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void wave_checksum_verify(WaveFile* self, WaveU64 first, WaveU64 end, WAVE_CONST WaveU8* data)
+{
+    WaveChecksum* checksum = self->checksum;
+    size_t        index;
+
+    end = MIN(end, checksum->data_size);
+    for (index = (size_t)(first / checksum->block_size); (WaveU64)index * checksum->block_size < end; ++index) {
+        WaveU64 start = (WaveU64)index * checksum->block_size;
+        size_t  n = (size_t)MIN(checksum->block_size, checksum->data_size - start);
+        WaveU32 crc;
+
+        if (checksum->verified[index]) {
+            continue;
+        }
+        if (data != NULL && start >= first && start + n <= end) {
+            crc = wave_crc32c(0, data + (start - first), n);
+        } else {
+            WaveU8* block = wave_checksum_block(checksum);
+            if (block == NULL) {
+                return;
+            }
+            if (wave_read_at(self, block, n, self->data_chunk.offset + start) != n) {
+                if (g_err.code == WAVE_OK) {
+                    wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+                }
+                return;
+            }
+            crc = wave_crc32c(0, block, n);
+        }
+        if (crc != checksum->crcs[index]) {
+            wave_err_set(WAVE_ERR_CHECKSUM, "Checksum mismatch in frames %zu to %zu of %s", wave_checksum_frame(self, start),
+                         wave_checksum_frame(self, start + n), self->filename);
+            return;
+        }
+        checksum->verified[index] = 1;
+    }
+}
+
+/* Compute the blocks from the one that holds the frontier to the end of the data chunk from the file */
+static void wave_checksum_resync(WaveFile* self)
+{
+    WaveChecksum* checksum = self->checksum;
+    WaveU64       data_size = self->data_chunk.header.size;
+    WaveU64       start = checksum->frontier - checksum->frontier % checksum->block_size;
+    WaveU8*       block = wave_checksum_block(checksum);
+
+    if (block == NULL || !wave_checksum_reserve(checksum, (size_t)((data_size + checksum->block_size - 1) / checksum->block_size))) {
+        return;
+    }
+    for (; start < data_size; start += checksum->block_size) {
+        size_t n = (size_t)MIN(checksum->block_size, data_size - start);
+        if (wave_read_at(self, block, n, self->data_chunk.offset + start) != n) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+            }
+            return;
+        }
+        checksum->crcs[start / checksum->block_size] = wave_crc32c(0, block, n);
+    }
+    checksum->frontier = data_size;
+    checksum->resync = WAVE_FALSE;
+}
+
+void wave_checksum_commit(WaveFile* self)
+{
+    WaveChecksum*       checksum = self->checksum;
+    WaveU64             data_size = self->data_chunk.header.size;
+    WaveU64             offset = self->data_chunk.offset + data_size;
+    WaveChunkHeader     header;
+    WaveChecksumHeader  body;
+    WaveU32             riff_size;
+    long                save_pos;
+
+    if (!(self->mode & (WAVE_OPEN_WRITE | WAVE_OPEN_APPEND))) {
+        return;
+    }
+
+    wave_checksum_start(self);
+    if (checksum->resync || checksum->frontier != data_size) {
+        wave_checksum_resync(self);
+        if (g_err.code != WAVE_OK) {
+            return;
+        }
+    }
+    checksum->num_crcs = (size_t)((data_size + checksum->block_size - 1) / checksum->block_size);
+
+    header.id = WAVE_CRC_CHUNK_ID;
+    header.size = (WaveU32)(sizeof(body) + sizeof(WaveU32) * checksum->num_crcs);
+    body.block_size = checksum->block_size;
+    body.data_size = data_size;
+    riff_size = (WaveU32)(offset + (data_size & 1) + sizeof(header) + header.size - 8);
+
+    save_pos = ftell(self->fp);
+    if (save_pos == -1L) {
+        wave_err_set(WAVE_ERR_OS, "ftell() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fseek(self->fp, (long)offset, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (((data_size & 1) && fputc(0, self->fp) == EOF) ||
+        fwrite(&header, sizeof(header), 1, self->fp) != 1 ||
+        fwrite(&body, sizeof(body), 1, self->fp) != 1 ||
+        (checksum->num_crcs > 0 && fwrite(checksum->crcs, sizeof(WaveU32) * checksum->num_crcs, 1, self->fp) != 1))
+    {
+        wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        return;
+    }
+    if (fseek(self->fp, (long)(sizeof(WaveChunkHeader) - 4), SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fwrite(&riff_size, 4, 1, self->fp) != 1) {
+        wave_err_set(WAVE_ERR_OS, "fwrite() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if (fseek(self->fp, save_pos, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+}
+
+typedef struct {
+    WaveFile*       file;
+    WaveChecksum*   checksum;
+    WaveU64         end;                /* bytes of the data chunk that have checksums */
+    size_t          blocks_per_task;
+    WaveU8*         corrupt;            /* one flag per block */
+} WaveChecksumScan;
+
+static void wave_checksum_scan_task(void *context, size_t index)
+{
+    WaveChecksumScan *scan = context;
+    WaveU64           block_size = scan->checksum->block_size;
+    size_t            first_block = index * scan->blocks_per_task;
+    size_t            end_block = MIN(first_block + scan->blocks_per_task, scan->checksum->num_crcs);
+    WaveU64           first = first_block * block_size;
+    size_t            size = (size_t)(MIN(end_block * block_size, scan->end) - first);
+    WaveU8           *buffer = wave_malloc(MAX(size, 1));
+    size_t            got, b;
+
+    if (buffer == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the verification buffer");
+        return;
+    }
+    got = wave_read_at(scan->file, buffer, size, scan->file->data_chunk.offset + first);
+    if (g_err.code == WAVE_OK) {
+        /* blocks cut short by the end of the file are corrupt too */
+        for (b = first_block; b < end_block; ++b) {
+            size_t offset = (size_t)((b - first_block) * block_size);
+            size_t n = (size_t)MIN(block_size, scan->end - b * block_size);
+            scan->corrupt[b] = offset + n > got || wave_crc32c(0, buffer + offset, n) != scan->checksum->crcs[b];
+        }
+    }
+    wave_free(buffer);
+}
+
+/* Append frames [first, end) to {regions}, merged with the last one if they touch */
+static WaveBool wave_checksum_add_region(WaveRegion** regions, size_t* num_regions, size_t* capacity, size_t first, size_t end)
+{
+    if (*num_regions > 0 && (*regions)[*num_regions - 1].first_frame + (*regions)[*num_regions - 1].num_frames == first) {
+        (*regions)[*num_regions - 1].num_frames = end - (*regions)[*num_regions - 1].first_frame;
+        return WAVE_TRUE;
+    }
+    if (*num_regions == *capacity) {
+        WaveRegion *p = wave_realloc(*regions, sizeof(WaveRegion) * (*capacity > 0 ? *capacity * 2 : 16));
+        if (p == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the regions");
+            return WAVE_FALSE;
+        }
+        *regions = p;
+        *capacity = *capacity > 0 ? *capacity * 2 : 16;
+    }
+    (*regions)[*num_regions].first_frame = first;
+    (*regions)[*num_regions].num_frames = end - first;
+    ++*num_regions;
+    return WAVE_TRUE;
+}
+
+size_t wave_verify(WAVE_CONST char* filename, size_t num_threads, WaveRegion** corrupt_out)
+{
+    WaveChecksumScan  scan;
+    WaveFile         *file;
+    WavePool         *pool;
+    WaveRegion       *regions = NULL;
+    size_t            num_regions = 0;
+    size_t            capacity = 0;
+    size_t            num_tasks, b;
+    WaveU64           data_size;
+
+    *corrupt_out = NULL;
+
+    file = wave_open(filename, WAVE_OPEN_READ);
+    if (file == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+        return 0;
+    }
+    if (g_err.code != WAVE_OK) {
+        wave_close(file);
+        return 0;
+    }
+
+    memset(&scan, 0, sizeof(scan));
+    scan.file = file;
+    scan.checksum = wave_checksum_load(file);
+    if (scan.checksum == NULL) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "No block checksums in %s", filename);
+        }
+        wave_close(file);
+        return 0;
+    }
+    data_size = file->data_chunk.header.size;
+    scan.end = scan.checksum->data_size;
+    scan.blocks_per_task = MAX(WAVE_CHECKSUM_TASK_SIZE / scan.checksum->block_size, 1);
+    scan.corrupt = wave_malloc(MAX(scan.checksum->num_crcs, 1));
+    if (scan.corrupt == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the verification flags");
+        wave_checksum_destroy(scan.checksum);
+        wave_close(file);
+        return 0;
+    }
+
+    num_tasks = (scan.checksum->num_crcs + scan.blocks_per_task - 1) / scan.blocks_per_task;
+    pool = wave_pool_create(MIN(num_tasks, num_threads != 0 ? num_threads : wave_cpu_count()));
+    wave_pool_run(pool, num_tasks, wave_checksum_scan_task, &scan);
+    wave_pool_destroy(pool);
+
+    for (b = 0; b < scan.checksum->num_crcs && g_err.code == WAVE_OK; ++b) {
+        WaveU64 start = (WaveU64)b * scan.checksum->block_size;
+        if (scan.corrupt[b]) {
+            wave_checksum_add_region(&regions, &num_regions, &capacity, wave_checksum_frame(file, start),
+                                     wave_checksum_frame(file, MIN(start + scan.checksum->block_size, scan.end)));
+        }
+    }
+    /* frames written after the checksums cannot be trusted either */
+    if (g_err.code == WAVE_OK && data_size > scan.end) {
+        wave_checksum_add_region(&regions, &num_regions, &capacity, wave_checksum_frame(file, scan.end),
+                                 wave_checksum_frame(file, data_size));
+    }
+
+    wave_free(scan.corrupt);
+    wave_checksum_destroy(scan.checksum);
+    wave_close(file);
+    if (g_err.code != WAVE_OK) {
+        wave_free(regions);
+        return 0;
+    }
+
+    *corrupt_out = regions;
+    return num_regions;
+}
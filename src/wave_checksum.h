@@ -0,0 +1,26 @@
+#ifndef __WAVE_CHECKSUM_H__
+#define __WAVE_CHECKSUM_H__
+
+#include "wave_internal.h"
+
+typedef struct _WaveChecksum WaveChecksum;
+
+void wave_checksum_destroy(WaveChecksum* checksum);
+
+/** Attach the checksums to a file opened with {WAVE_OPEN_CHECKSUM}. Readers need the "crcc" chunk of the file, writers
+ *  continue it, or compute it from the samples already in the file when it is missing or out of date. Files opened with
+ *  {WAVE_OPEN_APPEND} alone continue the chunk if they have one. */
+void wave_checksum_open(WaveFile* self);
+
+/** Add {size} bytes that are written at {offset} in the data chunk. Writes that do not continue the previous one leave
+ *  the blocks from there on to {wave_checksum_commit}, which reads them back from the file. */
+void wave_checksum_update(WaveFile* self, WaveU64 offset, WAVE_CONST WaveU8* data, size_t size);
+
+/** Check the blocks that overlap bytes [{first}, {end}) of the data chunk that have not been checked yet. {data} holds
+ *  those bytes if they have just been read and may be NULL, blocks not entirely in it are read from the file. */
+void wave_checksum_verify(WaveFile* self, WaveU64 first, WaveU64 end, WAVE_CONST WaveU8* data);
+
+/** Write the "crcc" chunk after the samples of a file opened for writing and include it in the RIFF size */
+void wave_checksum_commit(WaveFile* self);
+
+#endif /* __WAVE_CHECKSUM_H__ */
@@ -0,0 +1,311 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+
+#define WAVE_COPY_BUFFER_SIZE   ((size_t)1 << 20)
+
+static WaveBool wave_is_writable(WAVE_CONST WaveFile* self)
+{
+    return (self->mode & WAVE_OPEN_WRITE) || (self->mode & WAVE_OPEN_APPEND);
+}
+
+/* ADPCM frames are not whole bytes of the data chunk, and the last block is only known through the fact chunk */
+static WaveBool wave_check_not_adpcm(WAVE_CONST WaveFile* self)
+{
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+        wave_err_set(WAVE_ERR_FORMAT, "ADPCM frames of %s cannot be copied", self->filename);
+        return WAVE_FALSE;
+    }
+    return WAVE_TRUE;
+}
+
+static WaveBool wave_is_compatible(WAVE_CONST WaveFile* a, WAVE_CONST WaveFile* b)
+{
+    WAVE_CONST WaveFormatChunk *fa = &a->format_chunk;
+    WAVE_CONST WaveFormatChunk *fb = &b->format_chunk;
+
+    if (fa->body.format_tag != fb->body.format_tag ||
+        fa->body.num_channels != fb->body.num_channels ||
+        fa->body.sample_rate != fb->body.sample_rate ||
+        fa->body.block_align != fb->body.block_align ||
+        fa->body.bits_per_sample != fb->body.bits_per_sample)
+    {
+        return WAVE_FALSE;
+    }
+
+    if (fa->body.format_tag == WAVE_FORMAT_EXTENSIBLE) {
+        return fa->body.valid_bits_per_sample == fb->body.valid_bits_per_sample &&
+               fa->body.channel_mask == fb->body.channel_mask &&
+               memcmp(fa->body.sub_format, fb->body.sub_format, 16) == 0;
+    }
+
+    return WAVE_TRUE;
+}
+
+/* Make an empty {dst} use exactly the format of {src}, or check that a non-empty {dst} already does. */
+static void wave_match_format(WaveFile* dst, WAVE_CONST WaveFile* src)
+{
+    if (wave_is_compatible(dst, src)) {
+        return;
+    }
+
+    if (dst->data_chunk.header.size != 0 || (!(dst->mode & WAVE_OPEN_WRITE) && !dst->is_a_new_file)) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Incompatible wave formats");
+        return;
+    }
+
+    dst->format_chunk.header = src->format_chunk.header;
+    dst->format_chunk.header.size = (WaveU32)MIN(src->format_chunk.header.size, sizeof(dst->format_chunk.body));
+    dst->format_chunk.body = src->format_chunk.body;
+    dst->data_chunk.offset = dst->format_chunk.offset + dst->format_chunk.header.size + sizeof(WaveChunkHeader);
+
+    wave_write_header(dst);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static void wave_copy_bytes(WaveFile* src, WaveU64 src_offset, WaveFile* dst, WaveU64 dst_offset, WaveU64 size)
+{
+    long   save_pos = ftell(src->fp);
+    void  *buffer = wave_malloc(WAVE_COPY_BUFFER_SIZE);
+
+    if (buffer == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the copy buffer");
+        return;
+    }
+
+    while (size > 0) {
+        size_t n = (size_t)MIN(size, WAVE_COPY_BUFFER_SIZE);
+
+        if (fseek(src->fp, (long)src_offset, SEEK_SET) != 0 || fread(buffer, n, 1, src->fp) != 1) {
+            wave_err_set(WAVE_ERR_OS, "Error when reading %s [errno %d: %s]", src->filename, errno, strerror(errno));
+            break;
+        }
+        if (fseek(dst->fp, (long)dst_offset, SEEK_SET) != 0 || fwrite(buffer, n, 1, dst->fp) != 1) {
+            wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", dst->filename, errno, strerror(errno));
+            break;
+        }
+
+        src_offset += n;
+        dst_offset += n;
+        size -= n;
+    }
+
+    wave_free(buffer);
+    fseek(src->fp, save_pos, SEEK_SET);
+}
+
+#else
+
+/* Move {size} bytes between the files without touching the stdio positions. On Linux the kernel copies the data (and
+ * shares extents on file systems with reflink support); otherwise, or if the kernel refuses, fall back to pread/pwrite. */
+static void wave_copy_bytes(WaveFile* src, WaveU64 src_offset, WaveFile* dst, WaveU64 dst_offset, WaveU64 size)
+{
+    int    in_fd = fileno(src->fp);
+    int    out_fd = fileno(dst->fp);
+    void  *buffer;
+
+#if defined(__linux__)
+    while (size > 0) {
+        loff_t  off_in = (loff_t)src_offset;
+        loff_t  off_out = (loff_t)dst_offset;
+        ssize_t n = copy_file_range(in_fd, &off_in, out_fd, &off_out, (size_t)size, 0);
+
+        if (n > 0) {
+            src_offset += (WaveU64)n;
+            dst_offset += (WaveU64)n;
+            size -= (WaveU64)n;
+        } else if (n == 0) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", src->filename);
+            return;
+        } else if (errno != EINTR) {
+            if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+                break;
+            }
+            wave_err_set(WAVE_ERR_OS, "copy_file_range() failed [errno %d: %s]", errno, strerror(errno));
+            return;
+        }
+    }
+
+    if (size == 0) {
+        return;
+    }
+#endif
+
+    buffer = wave_malloc(WAVE_COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the copy buffer");
+        return;
+    }
+
+    while (size > 0) {
+        ssize_t n = pread(in_fd, buffer, (size_t)MIN(size, WAVE_COPY_BUFFER_SIZE), (off_t)src_offset);
+        ssize_t written = 0;
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) {
+                wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", src->filename);
+            } else {
+                wave_err_set(WAVE_ERR_OS, "Error when reading %s [errno %d: %s]", src->filename, errno, strerror(errno));
+            }
+            break;
+        }
+
+        while (written < n) {
+            ssize_t w = pwrite(out_fd, (char*)buffer + written, (size_t)(n - written), (off_t)dst_offset + written);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w < 0) {
+                wave_err_set(WAVE_ERR_OS, "Error when writing to %s [errno %d: %s]", dst->filename, errno, strerror(errno));
+                wave_free(buffer);
+                return;
+            }
+            written += w;
+        }
+
+        src_offset += (WaveU64)n;
+        dst_offset += (WaveU64)n;
+        size -= (WaveU64)n;
+    }
+
+    wave_free(buffer);
+}
+
+#endif
+
+size_t wave_copy_range(WaveFile* src, size_t first_frame, size_t count, WaveFile* dst)
+{
+    size_t  length = wave_get_length(src);
+    WaveU64 size, dst_end;
+
+    if (!wave_is_writable(dst)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not writable");
+        return 0;
+    }
+    if (!wave_check_not_adpcm(src) || !wave_check_not_adpcm(dst)) {
+        return 0;
+    }
+
+    if (first_frame > length) {
+        wave_err_set(WAVE_ERR_PARAM, "Invalid first frame: %zu", first_frame);
+        return 0;
+    }
+
+    count = MIN(count, length - first_frame);
+
+    wave_match_format(dst, src);
+    if (g_err.code != WAVE_OK || count == 0) {
+        return 0;
+    }
+
+    /* the kernel copies below stdio, so nothing may be pending in either stream */
+    wave_drain_buffer(src);
+    if (g_err.code == WAVE_OK) {
+        wave_drain_buffer(dst);
+    }
+    if (g_err.code != WAVE_OK) {
+        return 0;
+    }
+    if (fflush(src->fp) != 0 || fflush(dst->fp) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+        return 0;
+    }
+
+    size = (WaveU64)count * src->format_chunk.body.block_align;
+    dst_end = dst->data_chunk.offset + dst->data_chunk.header.size;
+    wave_copy_bytes(src, src->data_chunk.offset + (WaveU64)first_frame * src->format_chunk.body.block_align, dst, dst_end, size);
+    if (g_err.code != WAVE_OK) {
+        return 0;
+    }
+
+    dst->riff_chunk.size += (WaveU32)size;
+    if (dst->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+        dst->fact_chunk.body.sample_length += (WaveU32)count;
+    }
+    dst->data_chunk.header.size += (WaveU32)size;
+
+    if (fseek(dst->fp, (long)(dst_end + size), SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        return 0;
+    }
+
+    if (dst->mode & WAVE_OPEN_DEFER_SIZES) {
+        dst->sizes_dirty = WAVE_TRUE;
+    } else {
+        wave_update_sizes(dst);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    return count;
+}
+
+size_t wave_split(WaveFile* src, WAVE_CONST size_t* split_frames, size_t num_splits, WAVE_CONST char* WAVE_CONST* filenames)
+{
+    size_t length = wave_get_length(src);
+    size_t first = 0;
+    size_t i;
+
+    if (!wave_check_not_adpcm(src)) {
+        return 0;
+    }
+    for (i = 0; i < num_splits; ++i) {
+        if (split_frames[i] < first || split_frames[i] > length) {
+            wave_err_set(WAVE_ERR_PARAM, "Invalid split frame: %zu", split_frames[i]);
+            return 0;
+        }
+        first = split_frames[i];
+    }
+
+    first = 0;
+    for (i = 0; i <= num_splits; ++i) {
+        size_t    last = i < num_splits ? split_frames[i] : length;
+        WaveFile *dst = wave_open(filenames[i], WAVE_OPEN_WRITE);
+
+        if (dst == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+            return i;
+        }
+
+        if (g_err.code == WAVE_OK) {
+            wave_copy_range(src, first, last - first, dst);
+        }
+        wave_close(dst);
+
+        if (g_err.code != WAVE_OK) {
+            return i;
+        }
+        first = last;
+    }
+
+    return num_splits + 1;
+}
+
+size_t wave_concat(WaveFile* WAVE_CONST* srcs, size_t n, WaveFile* dst)
+{
+    size_t total = 0;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        if (!wave_check_not_adpcm(srcs[i])) {
+            return 0;
+        }
+        if (!wave_is_compatible(srcs[0], srcs[i])) {
+            wave_err_set(WAVE_ERR_FORMAT, "Incompatible wave formats: %s and %s", srcs[0]->filename, srcs[i]->filename);
+            return 0;
+        }
+    }
+
+    for (i = 0; i < n; ++i) {
+        total += wave_copy_range(srcs[i], 0, wave_get_length(srcs[i]), dst);
+        if (g_err.code != WAVE_OK) {
+            break;
+        }
+    }
+
+    return total;
+}
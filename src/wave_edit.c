@@ -0,0 +1,564 @@
+#include "wave_edit.h"
+
+#include <sys/stat.h>
+
+/* header space left over when the samples have to move anyway, so that later edits fit in place */
+#define WAVE_EDIT_RESERVE       ((WaveU64)4096)
+/* bytes moved per step when the samples are shifted by copying */
+#define WAVE_EDIT_COPY_SIZE     ((size_t)1 << 20)
+
+typedef struct {
+    char    id[4];
+    char*   value;
+} WaveInfoTag;
+
+struct _WaveEdit {
+    WaveInfoTag*    tags;
+    size_t          num_tags;
+    WaveBool        loaded;
+    WaveBool        tags_dirty;
+};
+
+typedef struct {
+    WaveU32 id;
+    WaveU32 size;
+    WaveU64 offset;     /* of the chunk header */
+} WaveChunkRef;
+
+/* chunks that are laid out in memory before they are written */
+typedef struct {
+    WaveU8* data;
+    size_t  size;
+    size_t  capacity;
+} WaveBlob;
+
+static WaveU64 wave_chunk_end(WAVE_CONST WaveChunkRef* chunk)
+{
+    return chunk->offset + sizeof(WaveChunkHeader) + chunk->size + (chunk->size & 1);
+}
+
+static void wave_blob_append(WaveBlob* blob, WAVE_CONST void* data, size_t size)
+{
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+    if (blob->size + size > blob->capacity) {
+        size_t  capacity = MAX(blob->capacity * 2, blob->size + size);
+        WaveU8 *p = wave_realloc(blob->data, capacity);
+        if (p == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for the header");
+            return;
+        }
+        blob->data = p;
+        blob->capacity = capacity;
+    }
+    if (data != NULL) {
+        memcpy(blob->data + blob->size, data, size);
+    } else {
+        memset(blob->data + blob->size, 0, size);
+    }
+    blob->size += size;
+}
+
+static void wave_blob_append_chunk_header(WaveBlob* blob, WaveU32 id, WaveU32 size)
+{
+    WaveChunkHeader header;
+
+    header.id = id;
+    header.size = size;
+    wave_blob_append(blob, &header, sizeof(header));
+}
+
+/* Copy a whole chunk, including its pad byte, from the file */
+static void wave_blob_append_chunk(WaveBlob* blob, WaveFile* self, WAVE_CONST WaveChunkRef* chunk)
+{
+    size_t size = (size_t)(wave_chunk_end(chunk) - chunk->offset);
+    size_t start = blob->size;
+
+    wave_blob_append(blob, NULL, size);
+    if (g_err.code == WAVE_OK && wave_read_at(self, blob->data + start, size, chunk->offset) != size && g_err.code == WAVE_OK) {
+        wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+    }
+}
+
+static void wave_blob_append_tags(WaveBlob* blob, WAVE_CONST WaveEdit* edit)
+{
+    WaveU32 size = 4;
+    WaveU32 info_id = WAVE_INFO_ID;
+    size_t  i;
+
+    if (edit->num_tags == 0) {
+        return;
+    }
+    for (i = 0; i < edit->num_tags; ++i) {
+        size_t len = strlen(edit->tags[i].value) + 1;
+        size += (WaveU32)(sizeof(WaveChunkHeader) + len + (len & 1));
+    }
+
+    wave_blob_append_chunk_header(blob, WAVE_LIST_CHUNK_ID, size);
+    wave_blob_append(blob, &info_id, 4);
+    for (i = 0; i < edit->num_tags; ++i) {
+        size_t  len = strlen(edit->tags[i].value) + 1;
+        WaveU32 id;
+
+        memcpy(&id, edit->tags[i].id, 4);
+        wave_blob_append_chunk_header(blob, id, (WaveU32)len);
+        wave_blob_append(blob, edit->tags[i].value, len);
+        if (len & 1) {
+            wave_blob_append(blob, NULL, 1);
+        }
+    }
+}
+
+static WaveU64 wave_edit_file_size(WaveFile* self)
+{
+    long pos = ftell(self->fp);
+    long size;
+
+    if (pos < 0 || fseek(self->fp, 0, SEEK_END) != 0 || (size = ftell(self->fp)) < 0 || fseek(self->fp, pos, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "Failed to get the size of %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        return 0;
+    }
+    return (WaveU64)size;
+}
+
+/* List the chunks of the RIFF chunk, stopping at the first one that does not fit in the file */
+static size_t wave_edit_list_chunks(WaveFile* self, WaveChunkRef** chunks_out)
+{
+    WaveChunkRef *chunks = NULL;
+    size_t        num_chunks = 0, capacity = 0;
+    WaveU64       file_size = wave_edit_file_size(self);
+    WaveU64       end = MIN(file_size, (WaveU64)self->riff_chunk.size + sizeof(WaveChunkHeader));
+    WaveU64       offset = sizeof(WaveChunkHeader) + 4;
+
+    while (g_err.code == WAVE_OK && offset + sizeof(WaveChunkHeader) <= end) {
+        WaveChunkHeader header;
+
+        if (wave_read_at(self, &header, sizeof(header), offset) != sizeof(header)) {
+            break;
+        }
+        /* the data size in memory may have been repaired or grown past the one on disk */
+        if (offset + sizeof(WaveChunkHeader) == self->data_chunk.offset) {
+            header.size = self->data_chunk.header.size;
+        }
+        if (num_chunks == capacity) {
+            WaveChunkRef *p = wave_realloc(chunks, sizeof(WaveChunkRef) * (capacity = MAX(capacity * 2, 16)));
+            if (p == NULL) {
+                wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for the chunk list");
+                break;
+            }
+            chunks = p;
+        }
+        chunks[num_chunks].id = header.id;
+        chunks[num_chunks].size = header.size;
+        chunks[num_chunks].offset = offset;
+        offset = wave_chunk_end(&chunks[num_chunks++]);
+    }
+
+    *chunks_out = chunks;
+    return num_chunks;
+}
+
+static WaveBool wave_edit_is_info(WaveFile* self, WAVE_CONST WaveChunkRef* chunk)
+{
+    WaveU32 type = 0;
+
+    return chunk->id == WAVE_LIST_CHUNK_ID && chunk->size >= 4 &&
+           wave_read_at(self, &type, 4, chunk->offset + sizeof(WaveChunkHeader)) == 4 && type == WAVE_INFO_ID;
+}
+
+static WaveEdit* wave_edit_get(WaveFile* self)
+{
+    if (self->edit == NULL) {
+        self->edit = wave_malloc(sizeof(WaveEdit));
+        if (self->edit == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for the tags");
+            return NULL;
+        }
+        memset(self->edit, 0, sizeof(WaveEdit));
+    }
+    return self->edit;
+}
+
+static void wave_edit_put_tag(WaveEdit* edit, WAVE_CONST char* id, WAVE_CONST char* value, size_t len)
+{
+    WaveInfoTag *tags;
+    char        *copy;
+    size_t       i;
+
+    for (i = 0; i < edit->num_tags && memcmp(edit->tags[i].id, id, 4) != 0; ++i) {
+    }
+
+    if (len == 0) {
+        if (i < edit->num_tags) {
+            wave_free(edit->tags[i].value);
+            memmove(edit->tags + i, edit->tags + i + 1, sizeof(WaveInfoTag) * (edit->num_tags - i - 1));
+            --edit->num_tags;
+        }
+        return;
+    }
+
+    copy = wave_malloc(len + 1);
+    if (copy == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a tag");
+        return;
+    }
+    memcpy(copy, value, len);
+    copy[len] = '\0';
+
+    if (i == edit->num_tags) {
+        tags = wave_realloc(edit->tags, sizeof(WaveInfoTag) * (edit->num_tags + 1));
+        if (tags == NULL) {
+            wave_free(copy);
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a tag");
+            return;
+        }
+        edit->tags = tags;
+        memcpy(edit->tags[i].id, id, 4);
+        edit->tags[i].value = NULL;
+        ++edit->num_tags;
+    }
+    wave_free(edit->tags[i].value);
+    edit->tags[i].value = copy;
+}
+
+/* Read the tags of the first LIST/INFO chunk, wherever it is */
+static void wave_edit_load_tags(WaveFile* self, WaveEdit* edit)
+{
+    WaveChunkRef *chunks;
+    size_t        num_chunks = wave_edit_list_chunks(self, &chunks);
+    WaveU8       *list = NULL;
+    size_t        i, pos;
+
+    edit->loaded = WAVE_TRUE;
+    for (i = 0; i < num_chunks && g_err.code == WAVE_OK; ++i) {
+        if (!wave_edit_is_info(self, &chunks[i])) {
+            continue;
+        }
+        list = wave_malloc(chunks[i].size);
+        if (list == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for the tags");
+            break;
+        }
+        if (wave_read_at(self, list, chunks[i].size, chunks[i].offset + sizeof(WaveChunkHeader)) != chunks[i].size) {
+            break;
+        }
+        for (pos = 4; pos + sizeof(WaveChunkHeader) <= chunks[i].size; ) {
+            WaveChunkHeader header;
+            size_t          len;
+
+            memcpy(&header, list + pos, sizeof(header));
+            pos += sizeof(header);
+            if (header.size > chunks[i].size - pos) {
+                break;
+            }
+            /* values are NUL-terminated, but not always */
+            for (len = 0; len < header.size && list[pos + len] != '\0'; ++len) {
+            }
+            wave_edit_put_tag(edit, (WAVE_CONST char*)&header.id, (WAVE_CONST char*)list + pos, len);
+            pos += header.size + (header.size & 1);
+        }
+        break;
+    }
+
+    wave_free(list);
+    wave_free(chunks);
+}
+
+void wave_edit_destroy(WaveEdit* edit)
+{
+    size_t i;
+
+    if (edit == NULL) {
+        return;
+    }
+    for (i = 0; i < edit->num_tags; ++i) {
+        wave_free(edit->tags[i].value);
+    }
+    wave_free(edit->tags);
+    wave_free(edit);
+}
+
+WaveBool wave_edit_is_dirty(WAVE_CONST WaveFile* self)
+{
+    return (self->mode & WAVE_OPEN_EDIT) && (self->header_dirty || (self->edit != NULL && self->edit->tags_dirty));
+}
+
+static void wave_edit_write_at(WaveFile* self, WAVE_CONST void* data, size_t size, WaveU64 offset)
+{
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+    if (fseek(self->fp, (long)offset, SEEK_SET) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+    } else if (size > 0 && fwrite(data, size, 1, self->fp) != 1) {
+        wave_err_set(WAVE_ERR_OS, "Error while writing to %s [errno %d: %s]", self->filename, errno, strerror(errno));
+    }
+}
+
+static WaveU64 wave_edit_block_size(WaveFile* self)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void)self;
+    return 4096;
+#else
+    struct stat st;
+    return fstat(fileno(self->fp), &st) == 0 && st.st_blksize > 0 ? (WaveU64)st.st_blksize : 4096;
+#endif
+}
+
+/* Move the bytes in [from, end) by {by} bytes towards the end of the file. {by} is a multiple of the block size, so that
+ * file systems that can insert a range into a file do it without copying. The bytes before {from} in the same block move
+ * along, which the caller overwrites. */
+static void wave_edit_shift(WaveFile* self, WaveU64 from, WaveU64 end, WaveU64 by)
+{
+    WaveU8  *buffer;
+    WaveU64  pos;
+
+    if (fflush(self->fp) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fflush() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+
+#if defined(__linux__) && defined(FALLOC_FL_INSERT_RANGE)
+    {
+        WaveU64 start = from - from % wave_edit_block_size(self);
+        if (start < end && fallocate(fileno(self->fp), FALLOC_FL_INSERT_RANGE, (off_t)start, (off_t)by) == 0) {
+            return;
+        }
+        /* not every file system supports it, then the bytes are copied */
+    }
+#endif
+
+    buffer = wave_malloc(WAVE_EDIT_COPY_SIZE);
+    if (buffer == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the copy buffer");
+        return;
+    }
+    /* backwards, so that nothing is overwritten before it is copied */
+    for (pos = end; pos > from && g_err.code == WAVE_OK; ) {
+        size_t n = (size_t)MIN((WaveU64)WAVE_EDIT_COPY_SIZE, pos - from);
+        pos -= n;
+        if (wave_read_at(self, buffer, n, pos) != n) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", self->filename);
+            }
+            break;
+        }
+        wave_edit_write_at(self, buffer, n, pos + by);
+    }
+    wave_free(buffer);
+}
+
+/* Lay out the chunks that go before the data: the format and the fact chunk, then {extra}. The format chunk is padded by
+ * {fmt_pad} bytes to absorb a slack that is too small for a JUNK chunk. */
+static void wave_edit_build_head(WaveFile* self, WaveBlob* head, WAVE_CONST WaveBlob* extra, WaveU32 fmt_pad)
+{
+    WaveU32 fmt_size = self->format_chunk.header.size;
+
+    head->size = 0;
+    wave_blob_append_chunk_header(head, WAVE_FORMAT_CHUNK_ID, fmt_size + fmt_pad);
+    wave_blob_append(head, &self->format_chunk.body, MIN(fmt_size, sizeof(self->format_chunk.body)));
+    wave_blob_append(head, NULL, fmt_size - MIN(fmt_size, sizeof(self->format_chunk.body)) + fmt_pad + ((fmt_size + fmt_pad) & 1));
+    if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+        wave_blob_append(head, &self->fact_chunk.header, sizeof(WaveChunkHeader));
+        wave_blob_append(head, &self->fact_chunk.body, sizeof(self->fact_chunk.body));
+        wave_blob_append(head, NULL, self->fact_chunk.header.size - sizeof(self->fact_chunk.body));
+    }
+    if (extra != NULL) {
+        wave_blob_append(head, extra->data, extra->size);
+    }
+}
+
+/* Whether {size} bytes of chunks fill {space} exactly or leave room for a JUNK chunk */
+static WaveBool wave_edit_fits(WaveU64 size, WaveU64 space)
+{
+    return size == space || size + sizeof(WaveChunkHeader) <= space;
+}
+
+void wave_edit_commit(WaveFile* self)
+{
+    WaveEdit     *edit = self->edit;
+    WaveBool      tags_dirty = edit != NULL && edit->tags_dirty;
+    WaveBool      rewrite_tail = WAVE_FALSE;
+    WaveChunkRef *chunks = NULL;
+    WaveBlob      head, extra, tail;
+    WaveU64       space, data_header, data_end, file_end, shift = 0;
+    WaveU32       fmt_pad = 0;
+    size_t        num_chunks, data_index, i;
+    long          pos;
+
+    if (!wave_edit_is_dirty(self)) {
+        return;
+    }
+
+    memset(&head, 0, sizeof(head));
+    memset(&extra, 0, sizeof(extra));
+    memset(&tail, 0, sizeof(tail));
+
+    if (fflush(self->fp) != 0 || (pos = ftell(self->fp)) < 0) {
+        wave_err_set(WAVE_ERR_OS, "Failed to flush %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        return;
+    }
+
+    num_chunks = wave_edit_list_chunks(self, &chunks);
+    for (data_index = 0; data_index < num_chunks && chunks[data_index].id != WAVE_DATA_CHUNK_ID; ++data_index) {
+    }
+    if (g_err.code == WAVE_OK && data_index == num_chunks) {
+        wave_err_set(WAVE_ERR_FORMAT, "Missing data chunk in %s", self->filename);
+    }
+    if (g_err.code != WAVE_OK) {
+        wave_free(chunks);
+        return;
+    }
+    data_header = chunks[data_index].offset;
+    data_end = wave_chunk_end(&chunks[data_index]);
+    file_end = wave_chunk_end(&chunks[num_chunks - 1]);
+    space = data_header - (sizeof(WaveChunkHeader) + 4);
+
+    /* the other chunks in front of the data stay there, the old padding is dropped. The tags always go in front of the
+     * data as well, since appending frames overwrites whatever follows the data. */
+    for (i = 0; i < data_index; ++i) {
+        if (chunks[i].id == WAVE_FORMAT_CHUNK_ID || chunks[i].id == WAVE_FACT_CHUNK_ID || chunks[i].id == WAVE_JUNK_CHUNK_ID ||
+            (tags_dirty && wave_edit_is_info(self, &chunks[i])))
+        {
+            continue;
+        }
+        wave_blob_append_chunk(&extra, self, &chunks[i]);
+    }
+    if (tags_dirty) {
+        wave_blob_append_tags(&extra, edit);
+    }
+
+    wave_edit_build_head(self, &head, &extra, 0);
+    if (g_err.code == WAVE_OK && !wave_edit_fits(head.size, space)) {
+        if (head.size < space) {
+            fmt_pad = (WaveU32)(space - head.size);
+            wave_edit_build_head(self, &head, &extra, fmt_pad);
+        } else {
+            /* make room by moving the samples and everything after them, once, with room to spare for later edits */
+            WaveU64 block = wave_edit_block_size(self);
+            shift = (head.size + sizeof(WaveChunkHeader) + WAVE_EDIT_RESERVE - space + block - 1) / block * block;
+        }
+    }
+
+    /* tags that other writers put after the data are replaced by the ones in front of it */
+    for (i = data_index + 1; tags_dirty && i < num_chunks; ++i) {
+        if (wave_edit_is_info(self, &chunks[i])) {
+            rewrite_tail = WAVE_TRUE;
+        }
+    }
+    if (rewrite_tail) {
+        for (i = data_index + 1; i < num_chunks; ++i) {
+            if (chunks[i].id == WAVE_JUNK_CHUNK_ID || wave_edit_is_info(self, &chunks[i])) {
+                continue;
+            }
+            wave_blob_append_chunk(&tail, self, &chunks[i]);
+        }
+    }
+    wave_free(chunks);
+
+    if (g_err.code == WAVE_OK && shift > 0) {
+        wave_edit_shift(self, data_header, file_end, shift);
+        data_header += shift;
+        data_end += shift;
+        file_end += shift;
+        space += shift;
+    }
+
+    wave_edit_write_at(self, head.data, head.size, sizeof(WaveChunkHeader) + 4);
+    if (head.size < space) {
+        WaveChunkHeader junk;
+        junk.id = WAVE_JUNK_CHUNK_ID;
+        junk.size = (WaveU32)(space - head.size - sizeof(WaveChunkHeader));
+        wave_edit_write_at(self, &junk, sizeof(junk), sizeof(WaveChunkHeader) + 4 + head.size);
+    }
+
+    if (rewrite_tail) {
+        WaveU8 pad = 0;
+        if (self->data_chunk.header.size & 1) {
+            wave_edit_write_at(self, &pad, 1, data_end - 1);
+        }
+        wave_edit_write_at(self, tail.data, tail.size, data_end);
+        file_end = data_end + tail.size;
+        if (g_err.code == WAVE_OK && (fflush(self->fp) != 0 || wave_truncate(fileno(self->fp), file_end) != 0)) {
+            wave_err_set(WAVE_ERR_OS, "Error when truncating %s [errno %d: %s]", self->filename, errno, strerror(errno));
+        }
+    }
+
+    if (g_err.code == WAVE_OK) {
+        WaveU64 old_data_offset = self->data_chunk.offset;
+
+        self->riff_chunk.size = (WaveU32)(file_end - sizeof(WaveChunkHeader));
+        wave_edit_write_at(self, &self->riff_chunk, sizeof(WaveChunkHeader) + 4, 0);
+
+        self->format_chunk.offset = sizeof(WaveChunkHeader) * 2 + 4;
+        if (self->fact_chunk.header.id == WAVE_FACT_CHUNK_ID) {
+            WaveU32 fmt_size = self->format_chunk.header.size + fmt_pad;
+            self->fact_chunk.offset = self->format_chunk.offset + fmt_size + (fmt_size & 1) + sizeof(WaveChunkHeader);
+        }
+        self->data_chunk.offset = data_header + sizeof(WaveChunkHeader);
+        self->header_dirty = WAVE_FALSE;
+        if (edit != NULL) {
+            edit->tags_dirty = WAVE_FALSE;
+        }
+
+        /* the stream keeps its frame position */
+        if (fseek(self->fp, (WaveU64)pos >= old_data_offset ? pos + (long)shift : (long)self->data_chunk.offset, SEEK_SET) != 0) {
+            wave_err_set(WAVE_ERR_OS, "fseek() failed [errno %d: %s]", errno, strerror(errno));
+        }
+    }
+
+    wave_free(head.data);
+    wave_free(extra.data);
+    wave_free(tail.data);
+}
+
+void wave_set_info(WaveFile* self, WAVE_CONST char* id, WAVE_CONST char* value)
+{
+    WaveEdit *edit;
+    int       i;
+
+    if (!(self->mode & WAVE_OPEN_EDIT)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "Tags can only be set on a file opened with WAVE_OPEN_EDIT");
+        return;
+    }
+    for (i = 0; i < 4; ++i) {
+        if (id[i] < 0x20 || id[i] > 0x7e) {
+            wave_err_set_literal(WAVE_ERR_PARAM, "A tag ID is made of four printable characters");
+            return;
+        }
+    }
+
+    edit = wave_edit_get(self);
+    if (edit == NULL) {
+        return;
+    }
+    if (!edit->loaded) {
+        wave_edit_load_tags(self, edit);
+        if (g_err.code != WAVE_OK) {
+            return;
+        }
+    }
+    wave_edit_put_tag(edit, id, value, value != NULL ? strlen(value) : 0);
+    edit->tags_dirty = g_err.code == WAVE_OK;
+}
+
+WAVE_CONST char* wave_get_info(WaveFile* self, WAVE_CONST char* id)
+{
+    WaveEdit *edit = wave_edit_get(self);
+    size_t    i;
+
+    if (edit == NULL) {
+        return NULL;
+    }
+    if (!edit->loaded) {
+        wave_edit_load_tags(self, edit);
+    }
+    for (i = 0; i < edit->num_tags; ++i) {
+        if (memcmp(edit->tags[i].id, id, 4) == 0) {
+            return edit->tags[i].value;
+        }
+    }
+    return NULL;
+}
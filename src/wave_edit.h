@@ -0,0 +1,18 @@
+#ifndef __WAVE_EDIT_H__
+#define __WAVE_EDIT_H__
+
+#include "wave_internal.h"
+
+typedef struct _WaveEdit WaveEdit;
+
+void wave_edit_destroy(WaveEdit* edit);
+
+/** Whether {wave_edit_commit} has anything to write */
+WaveBool wave_edit_is_dirty(WAVE_CONST WaveFile* self);
+
+/** Write the changed header and LIST/INFO tags of a file opened with {WAVE_OPEN_EDIT}. The chunks before the data are
+ *  rewritten in place, with the slack turned into a JUNK chunk, and tags that do not fit go after the data. The samples
+ *  are only moved if the format chunk itself outgrows the space before them. */
+void wave_edit_commit(WaveFile* self);
+
+#endif /* __WAVE_EDIT_H__ */
@@ -0,0 +1,215 @@
+#include "wave_internal.h"
+#include "wave_kernels.h"
+
+#define WAVE_FANOUT_DEFAULT_BUFFER_SIZE ((size_t)256 << 10)
+
+struct _WaveFanOut {
+    WaveFile**  files;
+    WaveU8**    planes;
+    WaveU8**    cursors;
+    size_t      num_files;
+    size_t      num_channels;
+    size_t      sample_size;
+    size_t      capacity;
+    size_t      used;
+    WaveBool    failed;     /* a drain stopped part way, so the files no longer hold the same frames */
+};
+
+static void wave_fanout_alloc_planes(WaveFanOut* self, size_t capacity)
+{
+    size_t c;
+
+    for (c = 0; c < self->num_channels; ++c) {
+        WaveU8 *plane = wave_realloc(self->planes[c], capacity * self->sample_size);
+        if (plane == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the channel buffers");
+            return;
+        }
+        self->planes[c] = plane;
+    }
+    self->capacity = capacity;
+}
+
+/* Write the staged frames of every channel with one call per file. The sizes are written at close. */
+static void wave_fanout_drain(WaveFanOut* self)
+{
+    size_t c;
+
+    if (self->used == 0 || self->failed) {
+        return;
+    }
+
+    for (c = 0; c < self->num_files; ++c) {
+        if (wave_write(self->files[c], self->planes[c], self->used) != self->used) {
+            if (g_err.code == WAVE_OK) {
+                wave_err_set(WAVE_ERR_OS, "Short write to %s", self->files[c]->filename);
+            }
+            self->failed = WAVE_TRUE;
+            return;
+        }
+    }
+
+    self->used = 0;
+}
+
+WaveFanOut* wave_fanout_open(WAVE_CONST char* WAVE_CONST* filenames, WaveU16 num_channels, WaveU16 format, WaveU32 sample_rate, size_t sample_size)
+{
+    WaveFanOut *self;
+    size_t      c;
+
+    self = wave_malloc(sizeof(WaveFanOut));
+    if (self == NULL) {
+        return NULL;
+    }
+    memset(self, 0, sizeof(WaveFanOut));
+
+    if (num_channels < 1) {
+        wave_err_set(WAVE_ERR_PARAM, "Invalid number of channels: %u", num_channels);
+        return self;
+    }
+
+    self->files = wave_malloc(sizeof(WaveFile*) * num_channels);
+    self->planes = wave_malloc(sizeof(WaveU8*) * num_channels);
+    self->cursors = wave_malloc(sizeof(WaveU8*) * num_channels);
+    if (self->files == NULL || self->planes == NULL || self->cursors == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFanOut");
+        return self;
+    }
+    memset(self->planes, 0, sizeof(WaveU8*) * num_channels);
+    self->num_channels = num_channels;
+
+    for (c = 0; c < num_channels; ++c) {
+        WaveFile *file = wave_open(filenames[c], WAVE_OPEN_WRITE | WAVE_OPEN_DEFER_SIZES);
+        if (file == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+            return self;
+        }
+        self->files[self->num_files++] = file;
+
+        if (g_err.code == WAVE_OK) {
+            wave_set_format(file, format);
+        }
+        if (g_err.code == WAVE_OK) {
+            wave_set_num_channels(file, 1);
+        }
+        if (g_err.code == WAVE_OK) {
+            wave_set_sample_rate(file, sample_rate);
+        }
+        if (g_err.code == WAVE_OK && sample_size != 0) {
+            wave_set_sample_size(file, sample_size);
+        }
+        if (g_err.code != WAVE_OK) {
+            return self;
+        }
+    }
+
+    self->sample_size = wave_get_sample_size(self->files[0]);
+    wave_fanout_alloc_planes(self, WAVE_FANOUT_DEFAULT_BUFFER_SIZE / self->sample_size);
+
+    return self;
+}
+
+void wave_fanout_close(WaveFanOut* self)
+{
+    size_t c;
+
+    if (self->capacity > 0) {
+        wave_fanout_drain(self);
+    }
+
+    for (c = 0; c < self->num_files; ++c) {
+        wave_close(self->files[c]);
+    }
+    if (self->planes != NULL) {
+        for (c = 0; c < self->num_channels; ++c) {
+            wave_free(self->planes[c]);
+        }
+    }
+
+    wave_free(self->cursors);
+    wave_free(self->planes);
+    wave_free(self->files);
+    wave_free(self);
+}
+
+/* Refuse to write more once the files are out of step, since the staged frames already went to some of them */
+static WaveBool wave_fanout_check(WaveFanOut* self)
+{
+    if (self->failed) {
+        wave_err_set_literal(WAVE_ERR_MODE, "An earlier write of this WaveFanOut failed");
+        return WAVE_FALSE;
+    }
+    return WAVE_TRUE;
+}
+
+void wave_fanout_set_buffer_size(WaveFanOut* self, size_t size)
+{
+    size_t capacity;
+
+    if (!wave_fanout_check(self)) {
+        return;
+    }
+    wave_fanout_drain(self);
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
+    capacity = size / self->sample_size;
+    wave_fanout_alloc_planes(self, capacity > 0 ? capacity : 1);
+}
+
+size_t wave_fanout_write(WaveFanOut* self, WAVE_CONST void *buffer, size_t count)
+{
+    WAVE_CONST WaveU8 *src = buffer;
+    size_t frame_size = self->num_channels * self->sample_size;
+    size_t done = 0;
+    size_t c;
+
+    if (self->capacity == 0 || self->num_files != self->num_channels) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "Invalid WaveFanOut");
+        return 0;
+    }
+    if (!wave_fanout_check(self)) {
+        return 0;
+    }
+
+    while (done < count) {
+        size_t n = MIN(count - done, self->capacity - self->used);
+
+        for (c = 0; c < self->num_channels; ++c) {
+            self->cursors[c] = self->planes[c] + self->used * self->sample_size;
+        }
+        wave_deinterleave(self->cursors, src + done * frame_size, self->num_channels, self->sample_size, n);
+        self->used += n;
+
+        if (self->used == self->capacity) {
+            wave_fanout_drain(self);
+            if (g_err.code != WAVE_OK) {
+                break;
+            }
+        }
+        done += n;
+    }
+
+    return done;
+}
+
+int wave_fanout_flush(WaveFanOut* self)
+{
+    size_t c;
+
+    if (!wave_fanout_check(self)) {
+        return (int)g_err.code;
+    }
+    wave_fanout_drain(self);
+    for (c = 0; c < self->num_files && g_err.code == WAVE_OK; ++c) {
+        wave_flush(self->files[c]);
+    }
+
+    return (int)g_err.code;
+}
+
+WaveFile* wave_fanout_get_file(WAVE_CONST WaveFanOut* self, size_t channel)
+{
+    return channel < self->num_files ? self->files[channel] : NULL;
+}
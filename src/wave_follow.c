@@ -0,0 +1,219 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_follow.h"
+
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+/* how often files are checked for growth where there is no way to be notified of writes */
+#define WAVE_FOLLOW_POLL_MS 10
+
+struct _WaveFollow {
+    WaveU64 file_size;      /* the size at the last refresh */
+    int     notify_fd;      /* an inotify instance watching the file for writes, or -1 */
+};
+
+void wave_follow_open(WaveFile* self)
+{
+    WaveFollow* follow = wave_malloc(sizeof(WaveFollow));
+
+    if (follow == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the follow state");
+        return;
+    }
+    follow->file_size = 0;
+    follow->notify_fd = -1;
+#if defined(__linux__)
+    /* watched before the first refresh, so that no write after it goes unnoticed */
+    follow->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (follow->notify_fd >= 0 && inotify_add_watch(follow->notify_fd, self->filename, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        close(follow->notify_fd);
+        follow->notify_fd = -1;
+    }
+#endif
+    self->follow = follow;
+
+    wave_follow_refresh(self);
+}
+
+void wave_follow_destroy(WaveFollow* follow)
+{
+    if (follow == NULL) {
+        return;
+    }
+    if (follow->notify_fd >= 0) {
+        close(follow->notify_fd);
+    }
+    wave_free(follow);
+}
+
+static WaveBool wave_follow_has_chunk_at(WaveFile* self, WaveU64 offset, WaveU64 file_size)
+{
+    WaveChunkHeader header;
+    WaveU8*         id = (WaveU8*)&header.id;
+    int             i;
+
+    if (offset + sizeof(WaveChunkHeader) > file_size ||
+        wave_read_at(self, &header, sizeof(WaveChunkHeader), offset) != sizeof(WaveChunkHeader))
+    {
+        return WAVE_FALSE;
+    }
+    for (i = 0; i < 4; ++i) {
+        if (id[i] < 0x20 || id[i] > 0x7e) {
+            return WAVE_FALSE;
+        }
+    }
+    return offset + sizeof(WaveChunkHeader) + header.size <= file_size;
+}
+
+void wave_follow_refresh(WaveFile* self)
+{
+    WaveFollow* follow = self->follow;
+    WaveU16     block_align = self->format_chunk.body.block_align;
+    WaveU64     avail, size, frames;
+    WaveU32     header_size, fact_length;
+    WaveBool    trusted = WAVE_FALSE;
+    struct stat st;
+
+    if (fstat(fileno(self->fp), &st) != 0) {
+        wave_err_set(WAVE_ERR_OS, "fstat() failed [errno %d: %s]", errno, strerror(errno));
+        return;
+    }
+    if ((WaveU64)st.st_size == follow->file_size || block_align == 0) {
+        return;
+    }
+    follow->file_size = (WaveU64)st.st_size;
+
+    avail = follow->file_size > self->data_chunk.offset ? follow->file_size - self->data_chunk.offset : 0;
+    size = avail;
+    if (wave_read_at(self, &header_size, 4, self->data_chunk.offset - 4) == 4) {
+        if (header_size < avail &&
+            wave_follow_has_chunk_at(self, self->data_chunk.offset + header_size + (header_size & 1), follow->file_size))
+        {
+            size = header_size;
+            trusted = WAVE_TRUE;
+        } else if (header_size == avail) {
+            trusted = WAVE_TRUE;
+        }
+    }
+    if (g_err.code != WAVE_OK) {
+        return;
+    }
+
+    size = MIN(size, 0xffffffffUL - self->data_chunk.offset);
+    size -= size % block_align;
+
+    /* frames that have been seen never go away, the file only grows while it is being recorded */
+    if (size > self->data_chunk.header.size) {
+        self->data_chunk.header.size = (WaveU32)size;
+        self->riff_chunk.size = (WaveU32)(self->data_chunk.offset + size - sizeof(WaveChunkHeader));
+        if (self->fact_chunk.header.id != WAVE_FACT_CHUNK_ID) {
+            return;
+        }
+        if (!WAVE_IS_ADPCM(self->format_chunk.body.format_tag)) {
+            self->fact_chunk.body.sample_length = (WaveU32)(size / block_align);
+            return;
+        }
+
+        /* the fact chunk is the only place that tells how much of the last block is padding, and it is only as
+         * current as the data size in the header. Until the writer has written both, every block counts in full. */
+        frames = size / block_align * wave_adpcm_samples_per_block(self);
+        if (trusted && wave_read_at(self, &fact_length, 4, self->fact_chunk.offset) == 4 && fact_length <= frames &&
+            fact_length + wave_adpcm_samples_per_block(self) > frames)
+        {
+            frames = fact_length;
+        }
+        if (frames > self->fact_chunk.body.sample_length) {
+            self->fact_chunk.body.sample_length = (WaveU32)MIN(frames, 0xffffffffUL);
+        }
+    }
+}
+
+static WaveU64 wave_follow_now_ms(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return (WaveU64)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (WaveU64)ts.tv_sec * 1000 + (WaveU64)ts.tv_nsec / 1000000;
+#endif
+}
+
+/* Block until the file may have been written to, or for at most {timeout_ms} milliseconds if it is not negative */
+static void wave_follow_sleep(WaveFollow* follow, long timeout_ms)
+{
+#if defined(__linux__)
+    if (follow->notify_fd >= 0) {
+        struct pollfd pfd;
+        char          events[4096];
+
+        pfd.fd = follow->notify_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout_ms < 0 ? -1 : (int)MIN(timeout_ms, 0x7fffffffL)) > 0) {
+            /* the events only say that something changed, the refresh finds out what */
+            while (read(follow->notify_fd, events, sizeof(events)) > 0) {
+            }
+        }
+        return;
+    }
+#else
+    (void)follow;
+#endif
+    if (timeout_ms < 0 || timeout_ms > WAVE_FOLLOW_POLL_MS) {
+        timeout_ms = WAVE_FOLLOW_POLL_MS;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep((DWORD)timeout_ms);
+#else
+    {
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = timeout_ms * 1000000L;
+        nanosleep(&ts, NULL);
+    }
+#endif
+}
+
+size_t wave_wait(WaveFile* self, size_t min_frames, long timeout_ms)
+{
+    WaveU64 deadline = timeout_ms > 0 ? wave_follow_now_ms() + (WaveU64)timeout_ms : 0;
+
+    if (self->follow == NULL) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not opened with WAVE_OPEN_FOLLOW");
+        return 0;
+    }
+
+    min_frames = MAX(min_frames, 1);
+    for (;;) {
+        size_t length, pos;
+        long   remaining = -1;
+
+        wave_follow_refresh(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+        length = wave_get_length(self);
+        pos = (size_t)wave_tell(self);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+        if (length >= pos + min_frames || timeout_ms == 0) {
+            return length > pos ? length - pos : 0;
+        }
+        if (timeout_ms > 0) {
+            WaveU64 now = wave_follow_now_ms();
+            if (now >= deadline) {
+                return length > pos ? length - pos : 0;
+            }
+            remaining = (long)(deadline - now);
+        }
+        wave_follow_sleep(self->follow, remaining);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef __WAVE_FOLLOW_H__
+#define __WAVE_FOLLOW_H__
+
+#include "wave_internal.h"
+
+typedef struct _WaveFollow WaveFollow;
+
+/** Start following a file opened with {WAVE_OPEN_FOLLOW}: watch it for writes and take its length from the file */
+void wave_follow_open(WaveFile* self);
+void wave_follow_destroy(WaveFollow* follow);
+
+/** Extend the data chunk of {self} to the whole frames that are in the file now. Costs one {fstat} if the file did not
+ *  grow. The data size in the header is only trusted if another chunk follows it, since the writer may defer it. */
+void wave_follow_refresh(WaveFile* self);
+
+#endif /* __WAVE_FOLLOW_H__ */
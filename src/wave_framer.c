@@ -0,0 +1,283 @@
+#include <math.h>
+
+#include "wave_internal.h"
+#include "wave_kernels.h"
+
+/* frames decoded from the file by one {wave_read_float} */
+#define WAVE_FRAMER_READ_FRAMES 1024
+
+struct _WaveFramer {
+    WaveFile*           file;           /* NULL for frames passed to {wave_framer_push} */
+    WaveFramerOptions   options;
+    size_t              num_channels;   /* of the input frames */
+    size_t              num_planes;     /* of the analysis frames */
+
+    /* one plane of {capacity} samples per output channel. The next analysis frame starts at {start}, the samples are
+     * valid up to {end}, and {skip} more input samples are dropped when the hop is longer than the frame. */
+    float*              ring;
+    size_t              capacity;
+    size_t              start;
+    size_t              end;
+    size_t              skip;
+    WaveU8**            plane_ends;     /* where {wave_deinterleave} stores the next sample of every plane */
+
+    float*              staging;        /* interleaved frames from the file */
+    float*              window;         /* NULL for {WAVE_FRAMER_RECTANGULAR} */
+    float*              windowed;       /* the analysis frame times the window, one plane after the other */
+
+    WaveU64             position;       /* the stream index of the sample at {start} */
+    WaveU64             last;           /* the stream index of the first sample of the last analysis frame */
+    WaveU64             covered;        /* the stream index after the last sample of the last analysis frame */
+    WaveBool            ended;
+};
+
+static WaveFramer* wave_framer_init(WaveFile* file, size_t num_channels, WAVE_CONST WaveFramerOptions* options)
+{
+    WaveFramer* self = wave_malloc(sizeof(WaveFramer));
+    size_t      n = options->frame_size;
+    size_t      i;
+
+    if (self == NULL) {
+        return NULL;
+    }
+    memset(self, 0, sizeof(WaveFramer));
+    self->file = file;
+    self->options = *options;
+    if (self->options.hop_size == 0) {
+        self->options.hop_size = n;
+    }
+
+    if (n == 0 || num_channels == 0) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "The frame size and the number of channels must not be 0");
+        return self;
+    }
+    if (options->window != WAVE_FRAMER_RECTANGULAR && options->window != WAVE_FRAMER_HANN &&
+        options->window != WAVE_FRAMER_HAMMING)
+    {
+        wave_err_set(WAVE_ERR_PARAM, "Invalid window function: %d", (int)options->window);
+        return self;
+    }
+
+    self->num_channels = num_channels;
+    self->num_planes = options->downmix ? 1 : num_channels;
+    /* room for a frame, for the one after it and for a read that goes past that */
+    self->capacity = MAX(2 * n + self->options.hop_size, n + WAVE_FRAMER_READ_FRAMES);
+    self->ring = wave_malloc(self->capacity * self->num_planes * sizeof(float));
+    self->plane_ends = wave_malloc(self->num_planes * sizeof(WaveU8*));
+    if (self->ring == NULL || self->plane_ends == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the framing ring");
+        return self;
+    }
+    if (file != NULL) {
+        self->staging = wave_malloc(WAVE_FRAMER_READ_FRAMES * num_channels * sizeof(float));
+        if (self->staging == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the framing buffer");
+            return self;
+        }
+    }
+
+    if (options->window != WAVE_FRAMER_RECTANGULAR) {
+        double a = options->window == WAVE_FRAMER_HANN ? 0.5 : 0.54;
+
+        self->window = wave_malloc(n * sizeof(float));
+        self->windowed = wave_malloc(n * self->num_planes * sizeof(float));
+        if (self->window == NULL || self->windowed == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the window");
+            return self;
+        }
+        /* periodic, so that the windows of a hop of N/2 or N/4 add up to a constant */
+        for (i = 0; i < n; ++i) {
+            self->window[i] = (float)(a - (1.0 - a) * cos(2.0 * 3.14159265358979323846 * (double)i / (double)n));
+        }
+    }
+
+    return self;
+}
+
+WaveFramer* wave_framer_open(WaveFile* file, WAVE_CONST WaveFramerOptions* options)
+{
+    WaveFramer* self = wave_framer_init(file, wave_get_num_channels(file), options);
+
+    if (self != NULL && g_err.code == WAVE_OK && !(file->mode & WAVE_OPEN_READ)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFile is not readable");
+    }
+    return self;
+}
+
+WaveFramer* wave_framer_create(size_t num_channels, WAVE_CONST WaveFramerOptions* options)
+{
+    return wave_framer_init(NULL, num_channels, options);
+}
+
+void wave_framer_close(WaveFramer* self)
+{
+    if (self == NULL) {
+        return;
+    }
+    wave_free(self->ring);
+    wave_free(self->plane_ends);
+    wave_free(self->staging);
+    wave_free(self->window);
+    wave_free(self->windowed);
+    wave_free(self);
+}
+
+/* Move the samples from {start} on to the front of the ring */
+static void wave_framer_compact(WaveFramer* self)
+{
+    size_t p;
+
+    if (self->start == 0) {
+        return;
+    }
+    for (p = 0; p < self->num_planes; ++p) {
+        float* plane = self->ring + p * self->capacity;
+        memmove(plane, plane + self->start, (self->end - self->start) * sizeof(float));
+    }
+    self->end -= self->start;
+    self->start = 0;
+}
+
+/* Store as many of {count} interleaved frames as fit after {end}, returns the number of frames used up */
+static size_t wave_framer_absorb(WaveFramer* self, WAVE_CONST float* frames, size_t count)
+{
+    size_t skipped = MIN(self->skip, count);
+    size_t n, i, c, p;
+
+    self->skip -= skipped;
+    frames += skipped * self->num_channels;
+    n = MIN(count - skipped, self->capacity - self->end);
+    if (n == 0) {
+        return skipped;
+    }
+
+    if (self->options.downmix && self->num_channels > 1) {
+        float  scale = 1.0f / (float)self->num_channels;
+        float* dst = self->ring + self->end;
+
+        for (i = 0; i < n; ++i) {
+            float sum = 0.0f;
+            for (c = 0; c < self->num_channels; ++c) {
+                sum += frames[i * self->num_channels + c];
+            }
+            dst[i] = sum * scale;
+        }
+    } else if (self->num_channels == 1) {
+        memcpy(self->ring + self->end, frames, n * sizeof(float));
+    } else {
+        for (p = 0; p < self->num_planes; ++p) {
+            self->plane_ends[p] = (WaveU8*)(self->ring + p * self->capacity + self->end);
+        }
+        wave_deinterleave(self->plane_ends, (WAVE_CONST WaveU8*)frames, self->num_channels, sizeof(float), n);
+    }
+    self->end += n;
+
+    return skipped + n;
+}
+
+size_t wave_framer_push(WaveFramer* self, WAVE_CONST float* frames, size_t count)
+{
+    if (self->file != NULL) {
+        wave_err_set_literal(WAVE_ERR_MODE, "This WaveFramer reads its frames from a file");
+        return 0;
+    }
+    if (frames == NULL) {
+        self->ended = WAVE_TRUE;
+        return 0;
+    }
+    if (self->capacity - self->end < count) {
+        wave_framer_compact(self);
+    }
+    return wave_framer_absorb(self, frames, count);
+}
+
+/* Decode the next frames of the file into the ring, returns WAVE_FALSE if there are none yet */
+static WaveBool wave_framer_fill(WaveFramer* self)
+{
+    size_t n;
+
+    if (self->capacity - self->end < WAVE_FRAMER_READ_FRAMES) {
+        wave_framer_compact(self);
+    }
+
+    /* a single channel needs no splitting, so it is decoded in place */
+    if (self->num_channels == 1 && self->skip == 0) {
+        n = wave_read_float(self->file, self->ring + self->end, WAVE_FRAMER_READ_FRAMES);
+        self->end += n;
+    } else {
+        n = wave_read_float(self->file, self->staging, WAVE_FRAMER_READ_FRAMES);
+        wave_framer_absorb(self, self->staging, n);
+    }
+    if (g_err.code != WAVE_OK) {
+        return WAVE_FALSE;
+    }
+    if (n == 0 && !(self->file->mode & WAVE_OPEN_FOLLOW)) {
+        self->ended = WAVE_TRUE;
+    }
+    return n > 0;
+}
+
+WaveBool wave_framer_next(WaveFramer* self, WAVE_CONST float** planes)
+{
+    size_t n = self->options.frame_size;
+    size_t p;
+
+    if (self->ring == NULL) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "This WaveFramer failed to open");
+        return WAVE_FALSE;
+    }
+
+    while (self->end - self->start < n) {
+        if (self->ended) {
+            WaveU64 stream_end = self->position + (self->end - self->start);
+
+            /* one last frame for the samples that no frame has covered yet */
+            if (!self->options.pad_end || self->end == self->start || stream_end <= self->covered) {
+                return WAVE_FALSE;
+            }
+            wave_framer_compact(self);
+            for (p = 0; p < self->num_planes; ++p) {
+                memset(self->ring + p * self->capacity + self->end, 0, (n - self->end) * sizeof(float));
+            }
+            self->end = n;
+            break;
+        }
+        if (self->file == NULL || !wave_framer_fill(self)) {
+            if (self->ended) {
+                continue;
+            }
+            return WAVE_FALSE;
+        }
+    }
+
+    for (p = 0; p < self->num_planes; ++p) {
+        float* src = self->ring + p * self->capacity + self->start;
+        if (self->window != NULL) {
+            wave_multiply_f32(self->windowed + p * n, src, self->window, n);
+            planes[p] = self->windowed + p * n;
+        } else {
+            planes[p] = src;
+        }
+    }
+
+    self->last = self->position;
+    self->covered = self->position + n;
+    self->position += self->options.hop_size;
+    self->start += self->options.hop_size;
+    if (self->start > self->end) {
+        self->skip = self->start - self->end;
+        self->start = self->end;
+    }
+
+    return WAVE_TRUE;
+}
+
+size_t wave_framer_get_num_channels(WAVE_CONST WaveFramer* self)
+{
+    return self->num_planes;
+}
+
+WaveU64 wave_framer_tell(WAVE_CONST WaveFramer* self)
+{
+    return self->last;
+}
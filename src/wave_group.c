@@ -0,0 +1,261 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_pool.h"
+
+typedef struct {
+    WaveFile*   file;
+    size_t      first_channel;
+    WaveU8*     scratch;
+    size_t      scratch_size;
+} WaveGroupMember;
+
+struct _WaveGroup {
+    WaveGroupMember*    members;
+    size_t              num_files;
+    size_t              num_channels;
+    size_t              sample_size;
+    size_t              length;
+    size_t              pos;
+    WavePool*           pool;
+};
+
+typedef struct {
+    WaveGroup*  group;
+    WaveU8*     buffer;
+    size_t      count;
+    WaveLayout  layout;
+} WaveGroupRead;
+
+/* Copy {n} samples of {size} bytes between strided buffers, with a constant size for the common sample sizes */
+static void wave_copy_samples(WaveU8 *dst, size_t dst_stride, WAVE_CONST WaveU8 *src, size_t src_stride, size_t size, size_t n)
+{
+    size_t i;
+
+#define WAVE_COPY_SAMPLES(bytes) \
+    for (i = 0; i < n; ++i) { \
+        memcpy(dst + i * dst_stride, src + i * src_stride, bytes); \
+    }
+
+    switch (size) {
+        case 1: WAVE_COPY_SAMPLES(1); break;
+        case 2: WAVE_COPY_SAMPLES(2); break;
+        case 3: WAVE_COPY_SAMPLES(3); break;
+        case 4: WAVE_COPY_SAMPLES(4); break;
+        case 8: WAVE_COPY_SAMPLES(8); break;
+        default: WAVE_COPY_SAMPLES(size); break;
+    }
+
+#undef WAVE_COPY_SAMPLES
+}
+
+static void wave_group_read_member(void *context, size_t index)
+{
+    WaveGroupRead   *read = context;
+    WaveGroup       *group = read->group;
+    WaveGroupMember *member = &group->members[index];
+    WaveFile        *file = member->file;
+    size_t           block_align = file->format_chunk.body.block_align;
+    size_t           num_channels = file->format_chunk.body.num_channels;
+    size_t           ss = group->sample_size;
+    size_t           size = read->count * block_align;
+    size_t           c;
+
+    if (wave_read_at(file, member->scratch, size, file->data_chunk.offset + (WaveU64)group->pos * block_align) != size) {
+        if (g_err.code == WAVE_OK) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", file->filename);
+        }
+        return;
+    }
+
+    if (read->layout == WAVE_LAYOUT_INTERLEAVED) {
+        wave_copy_samples(read->buffer + member->first_channel * ss, group->num_channels * ss,
+                          member->scratch, block_align, block_align, read->count);
+    } else {
+        for (c = 0; c < num_channels; ++c) {
+            wave_copy_samples(read->buffer + (member->first_channel + c) * read->count * ss, ss,
+                              member->scratch + c * ss, block_align, ss, read->count);
+        }
+    }
+}
+
+WaveGroup* wave_group_open(WAVE_CONST char* WAVE_CONST* filenames, size_t num_files)
+{
+    WaveGroup *self;
+    size_t     i;
+
+    self = wave_malloc(sizeof(WaveGroup));
+    if (self == NULL) {
+        return NULL;
+    }
+    memset(self, 0, sizeof(WaveGroup));
+
+    if (num_files == 0) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "A WaveGroup needs at least one file");
+        return self;
+    }
+
+    self->members = wave_malloc(sizeof(WaveGroupMember) * num_files);
+    if (self->members == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveGroup");
+        return self;
+    }
+    memset(self->members, 0, sizeof(WaveGroupMember) * num_files);
+
+    for (i = 0; i < num_files; ++i) {
+        WaveFile *file = wave_open(filenames[i], WAVE_OPEN_READ);
+        if (file == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+            return self;
+        }
+
+        self->members[i].file = file;
+        self->members[i].first_channel = self->num_channels;
+        ++self->num_files;
+        if (g_err.code != WAVE_OK) {
+            return self;
+        }
+
+        /* the members are read as raw frames */
+        if (WAVE_IS_ADPCM(file->format_chunk.body.format_tag)) {
+            wave_err_set(WAVE_ERR_FORMAT, "ADPCM files cannot be grouped: %s", filenames[i]);
+            return self;
+        }
+
+        self->num_channels += wave_get_num_channels(file);
+
+        if (i == 0) {
+            self->sample_size = wave_get_sample_size(file);
+            self->length = wave_get_length(file);
+            continue;
+        }
+
+        /* plain and extensible files with the same samples can be mixed */
+        if (wave_get_sample_format(file) != wave_get_sample_format(self->members[0].file) ||
+            wave_get_sample_size(file) != self->sample_size ||
+            wave_get_valid_bits_per_sample(file) != wave_get_valid_bits_per_sample(self->members[0].file))
+        {
+            wave_err_set(WAVE_ERR_FORMAT, "Sample format of %s differs from %s", filenames[i], filenames[0]);
+            return self;
+        }
+        if (wave_get_sample_rate(file) != wave_get_sample_rate(self->members[0].file)) {
+            wave_err_set(WAVE_ERR_FORMAT, "Sample rate of %s differs from %s", filenames[i], filenames[0]);
+            return self;
+        }
+        if (wave_get_length(file) != self->length) {
+            wave_err_set(WAVE_ERR_FORMAT, "Length of %s differs from %s", filenames[i], filenames[0]);
+            return self;
+        }
+    }
+
+    self->pool = wave_pool_create(MIN(num_files, wave_cpu_count()));
+
+    return self;
+}
+
+void wave_group_close(WaveGroup* self)
+{
+    size_t i;
+
+    wave_pool_destroy(self->pool);
+    for (i = 0; i < self->num_files; ++i) {
+        wave_close(self->members[i].file);
+        wave_free(self->members[i].scratch);
+    }
+    wave_free(self->members);
+    wave_free(self);
+}
+
+void wave_group_set_num_threads(WaveGroup* self, size_t num_threads)
+{
+    wave_pool_destroy(self->pool);
+    self->pool = wave_pool_create(num_threads);
+}
+
+size_t wave_group_read(WaveGroup* self, void *buffer, size_t count, WaveLayout layout)
+{
+    WaveGroupRead read;
+    size_t        i;
+
+    if (self->members == NULL || self->num_files == 0) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "Invalid WaveGroup");
+        return 0;
+    }
+
+    count = MIN(count, self->length - MIN(self->pos, self->length));
+    if (count == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < self->num_files; ++i) {
+        WaveGroupMember *member = &self->members[i];
+        size_t size = count * member->file->format_chunk.body.block_align;
+        if (member->scratch_size < size) {
+            WaveU8 *scratch = wave_realloc(member->scratch, size);
+            if (scratch == NULL) {
+                wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the read buffer");
+                return 0;
+            }
+            member->scratch = scratch;
+            member->scratch_size = size;
+        }
+    }
+
+    read.group = self;
+    read.buffer = buffer;
+    read.count = count;
+    read.layout = layout;
+    wave_pool_run(self->pool, self->num_files, wave_group_read_member, &read);
+    if (g_err.code != WAVE_OK) {
+        return 0;
+    }
+
+    self->pos += count;
+    return count;
+}
+
+int wave_group_seek(WaveGroup* self, long int offset, int origin)
+{
+    if (origin == SEEK_CUR) {
+        offset += (long)self->pos;
+    } else if (origin == SEEK_END) {
+        offset += (long)self->length;
+    }
+
+    if (offset < 0) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "Invalid seek");
+        return (int)g_err.code;
+    }
+
+    self->pos = (size_t)offset;
+    return 0;
+}
+
+long int wave_group_tell(WAVE_CONST WaveGroup* self)
+{
+    return (long)self->pos;
+}
+
+size_t wave_group_get_num_files(WAVE_CONST WaveGroup* self)
+{
+    return self->num_files;
+}
+
+WaveFile* wave_group_get_file(WAVE_CONST WaveGroup* self, size_t index)
+{
+    return index < self->num_files ? self->members[index].file : NULL;
+}
+
+WaveU16 wave_group_get_num_channels(WAVE_CONST WaveGroup* self)
+{
+    return (WaveU16)self->num_channels;
+}
+
+size_t wave_group_get_sample_size(WAVE_CONST WaveGroup* self)
+{
+    return self->sample_size;
+}
+
+size_t wave_group_get_length(WAVE_CONST WaveGroup* self)
+{
+    return self->length;
+}
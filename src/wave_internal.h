@@ -0,0 +1,231 @@
+#ifndef __WAVE_INTERNAL_H__
+#define __WAVE_INTERNAL_H__
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#define fileno _fileno
+#define wave_truncate(fd, size) _chsize_s((fd), (__int64)(size))
+#else
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define wave_truncate(fd, size) ftruncate((fd), (off_t)(size))
+#endif
+
+#include "wave.h"
+
+#define WAVE_ENDIAN_ORDER_LITTLE    0x41424344UL
+#define WAVE_ENDIAN_ORDER_BIG       0x44434241UL
+#define WAVE_ENDIAN_ORDER_PDP       0x42414443UL
+#define WAVE_ENDIAN_ORDER           'ABCD'
+
+#if WAVE_ENDIAN_ORDER == WAVE_ENDIAN_ORDER_LITTLE
+#define WAVE_ENDIAN_LITTLE 1
+#define WAVE_ENDIAN_BIG 0
+#elif WAVE_ENDIAN_ORDER == WAVE_ENDIAN_ORDER_BIG
+#define WAVE_ENDIAN_LITTLE 0
+#define WAVE_ENDIAN_BIG 1
+#else
+#error "unsupported endianess"
+#endif
+
+#if WAVE_ENDIAN_LITTLE
+#define WAVE_RIFF_CHUNK_ID       ((WaveU32)'FFIR')
+#define WAVE_FORMAT_CHUNK_ID     ((WaveU32)' tmf')
+#define WAVE_FACT_CHUNK_ID       ((WaveU32)'tcaf')
+#define WAVE_DATA_CHUNK_ID       ((WaveU32)'atad')
+#define WAVE_WAVE_ID             ((WaveU32)'EVAW')
+#define WAVE_LIST_CHUNK_ID       ((WaveU32)'TSIL')
+#define WAVE_INFO_ID             ((WaveU32)'OFNI')
+#define WAVE_JUNK_CHUNK_ID       ((WaveU32)'KNUJ')
+#define WAVE_CRC_CHUNK_ID        ((WaveU32)'ccrc')
+#endif
+
+#if WAVE_ENDIAN_BIG
+#define WAVE_RIFF_CHUNK_ID       ((WaveU32)'RIFF')
+#define WAVE_FORMAT_CHUNK_ID     ((WaveU32)'fmt ')
+#define WAVE_FACT_CHUNK_ID       ((WaveU32)'fact')
+#define WAVE_DATA_CHUNK_ID       ((WaveU32)'data')
+#define WAVE_WAVE_ID             ((WaveU32)'WAVE')
+#define WAVE_LIST_CHUNK_ID       ((WaveU32)'LIST')
+#define WAVE_INFO_ID             ((WaveU32)'INFO')
+#define WAVE_JUNK_CHUNK_ID       ((WaveU32)'JUNK')
+#define WAVE_CRC_CHUNK_ID        ((WaveU32)'crcc')
+#endif
+
+extern WAVE_THREAD_LOCAL WaveErr g_err;
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/* bytes converted per pass by {wave_read_float} and {wave_write_float} */
+#define WAVE_SCRATCH_SIZE   ((size_t)64 << 10)
+
+WAVE_INLINE void wave_err_set(WaveErrCode code, WAVE_CONST char *format, ...)
+{
+    assert(g_err.code == WAVE_OK);
+    va_list args;
+    va_start(args, format);
+    g_err.code = code;
+    wave_vasprintf(&g_err.message, format, args);
+    g_err._is_literal = 0;
+    va_end(args);
+}
+
+WAVE_INLINE void wave_err_set_literal(WaveErrCode code, WAVE_CONST char *message)
+{
+    assert(g_err.code == WAVE_OK);
+    g_err.code = code;
+    g_err.message = (char *)message;
+    g_err._is_literal = 1;
+}
+
+#pragma pack(push, 1)
+
+typedef struct {
+    WaveU32 id;
+    WaveU32 size;
+} WaveChunkHeader;
+
+typedef struct {
+    WaveChunkHeader header;
+
+    WaveU64 offset;
+
+    struct {
+        WaveU16 format_tag;
+        WaveU16 num_channels;
+        WaveU32 sample_rate;
+        WaveU32 avg_bytes_per_sec;
+        WaveU16 block_align;
+        WaveU16 bits_per_sample;
+
+        WaveU16 ext_size;
+        WaveU16 valid_bits_per_sample;
+        WaveU32 channel_mask;
+
+        WaveU8 sub_format[16];
+
+        /* the rest of the coefficient table of Microsoft ADPCM, which reuses the extensible fields */
+        WaveU8 ext_tail[10];
+    } body;
+} WaveFormatChunk;
+
+typedef struct {
+    WaveChunkHeader header;
+
+    WaveU64 offset;
+
+    struct {
+        WaveU32 sample_length;
+    } body;
+} WaveFactChunk;
+
+typedef struct {
+    WaveChunkHeader header;
+    WaveU64 offset;
+} WaveDataChunk;
+
+typedef struct {
+    WaveU32 id;
+    WaveU32 size;
+    WaveU32 wave_id;
+    WaveU64 offset;
+} WaveMasterChunk;
+
+#pragma pack(pop)
+
+/* what makes blocks of two handles interchangeable */
+typedef struct {
+    WaveU64 device;
+    WaveU64 inode;
+    WaveU64 size;
+    WaveU64 mtime;
+} WaveFileId;
+
+#define WAVE_CHUNK_MASTER    ((WaveU32)1)
+#define WAVE_CHUNK_FORMAT    ((WaveU32)2)
+#define WAVE_CHUNK_FACT      ((WaveU32)4)
+#define WAVE_CHUNK_DATA      ((WaveU32)8)
+
+struct _WaveFile {
+    FILE*               fp;
+    char*               filename;
+    WaveU32              mode;
+    WaveBool             is_a_new_file;
+    WaveBool             sizes_dirty;
+
+    /* frames written but not yet passed to stdio, starting at file offset {buffer_offset} */
+    WaveU8*              buffer;
+    size_t               buffer_size;
+    size_t               buffer_used;
+    WaveU64              buffer_offset;
+
+    /* encoded samples on their way to or from {wave_read_float} and {wave_write_float} */
+    WaveU8*              scratch;
+    size_t               scratch_size;
+
+    /* read-only handles with a cache keep their own position, the stream is only used on misses */
+    WaveCache*           cache;
+    WaveFileId           cache_id;
+    WaveU64              cache_pos;
+
+    /* analysis of every frame that passes through {wave_read} or {wave_write}, see {wave_attach_meter} */
+    struct _WaveMeter*   meter;
+
+    /* block codec of IMA and Microsoft ADPCM files, which owns the frame position */
+    struct _WaveAdpcm*   adpcm;
+
+    /* LIST/INFO tags, and whether the header of a file opened with {WAVE_OPEN_EDIT} has changed, see {wave_edit_commit} */
+    struct _WaveEdit*    edit;
+    WaveBool             header_dirty;
+
+    /* CRC32C of every block of the data chunk, kept up to date by writes or checked by reads, see {WAVE_OPEN_CHECKSUM} */
+    struct _WaveChecksum* checksum;
+
+    /* the length seen by a reader of a file that is still being written, see {WAVE_OPEN_FOLLOW} */
+    struct _WaveFollow*  follow;
+
+    WaveMasterChunk      riff_chunk;
+    WaveFormatChunk      format_chunk;
+    WaveFactChunk        fact_chunk;
+    WaveDataChunk        data_chunk;
+};
+
+/* The format code of the samples, which is the sub format for {WAVE_FORMAT_EXTENSIBLE} */
+WAVE_INLINE WaveU16 wave_get_sample_format(WAVE_CONST WaveFile* self)
+{
+    if (self->format_chunk.body.format_tag == WAVE_FORMAT_EXTENSIBLE) {
+        return (WaveU16)(self->format_chunk.body.sub_format[0] | (self->format_chunk.body.sub_format[1] << 8));
+    }
+    return self->format_chunk.body.format_tag;
+}
+
+void wave_parse_header(WaveFile* self);
+void wave_write_header(WaveFile* self);
+void wave_update_sizes(WaveFile* self);
+void wave_drain_buffer(WaveFile* self);
+
+/* Write {count} units of {block_align} bytes as they are, i.e. frames or ADPCM blocks */
+size_t wave_write_raw(WaveFile* self, WAVE_CONST void *buffer, size_t count);
+
+/* Read {size} bytes at file offset {offset} without moving the stream position, returns the number of bytes read */
+size_t wave_read_at(WaveFile* self, void *buffer, size_t size, WaveU64 offset);
+/* Read frames through the attached cache, see {wave_set_cache} */
+size_t wave_cache_read(WaveFile* self, void *buffer, size_t count);
+
+void wave_init(WaveFile* self, WAVE_CONST char* filename, WaveU32 mode);
+void wave_finalize(WaveFile* self);
+
+#endif /* __WAVE_INTERNAL_H__ */
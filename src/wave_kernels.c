@@ -0,0 +1,574 @@
+#include "wave_internal.h"
+#include "wave_adpcm.h"
+#include "wave_kernels_isa.h"
+#include "wave_thread.h"
+
+/* frames per tile of the scalar transpose, so that the source rows of a tile stay in the cache */
+#define WAVE_TRANSPOSE_TILE 64
+
+void wave_deinterleave_scalar(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size,
+                              size_t first_frame, size_t first_channel, size_t end_frame)
+{
+    size_t frame_size = num_channels * sample_size;
+    size_t f0, f, c;
+
+#define WAVE_DEINTERLEAVE(bytes) \
+    for (f0 = first_frame; f0 < end_frame; f0 += WAVE_TRANSPOSE_TILE) { \
+        size_t f1 = MIN(f0 + WAVE_TRANSPOSE_TILE, end_frame); \
+        for (c = first_channel; c < num_channels; ++c) { \
+            for (f = f0; f < f1; ++f) { \
+                memcpy(dst[c] + f * (bytes), src + f * frame_size + c * (bytes), (bytes)); \
+            } \
+        } \
+    }
+
+    switch (sample_size) {
+        case 1: WAVE_DEINTERLEAVE(1); break;
+        case 2: WAVE_DEINTERLEAVE(2); break;
+        case 3: WAVE_DEINTERLEAVE(3); break;
+        case 4: WAVE_DEINTERLEAVE(4); break;
+        case 8: WAVE_DEINTERLEAVE(8); break;
+        default: WAVE_DEINTERLEAVE(sample_size); break;
+    }
+
+#undef WAVE_DEINTERLEAVE
+}
+
+static void wave_deinterleave_portable(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size, size_t count)
+{
+    wave_deinterleave_scalar(dst, src, num_channels, sample_size, 0, 0, count);
+}
+
+WaveEncoding wave_get_encoding(WAVE_CONST WaveFile* self)
+{
+    size_t sample_size = wave_get_sample_size(self);
+
+    switch (wave_get_sample_format(self)) {
+        case WAVE_FORMAT_PCM:
+            return sample_size == 1 ? WAVE_ENCODING_U8 :
+                   sample_size == 2 ? WAVE_ENCODING_S16 :
+                   sample_size == 3 ? WAVE_ENCODING_S24 :
+                   sample_size == 4 ? WAVE_ENCODING_S32 : WAVE_ENCODING_UNSUPPORTED;
+        case WAVE_FORMAT_IEEE_FLOAT:
+            return sample_size == 4 ? WAVE_ENCODING_F32 :
+                   sample_size == 8 ? WAVE_ENCODING_F64 : WAVE_ENCODING_UNSUPPORTED;
+        case WAVE_FORMAT_ALAW:
+            return sample_size == 1 ? WAVE_ENCODING_ALAW : WAVE_ENCODING_UNSUPPORTED;
+        case WAVE_FORMAT_MULAW:
+            return sample_size == 1 ? WAVE_ENCODING_MULAW : WAVE_ENCODING_UNSUPPORTED;
+        default:
+            return WAVE_ENCODING_UNSUPPORTED;
+    }
+}
+
+WaveEncoding wave_get_frame_encoding(WAVE_CONST WaveFile* self)
+{
+    return WAVE_IS_ADPCM(self->format_chunk.body.format_tag) ? WAVE_ENCODING_S16 : wave_get_encoding(self);
+}
+
+unsigned wave_get_padding_bits(WAVE_CONST WaveFile* self)
+{
+    unsigned container = (unsigned)(8 * wave_get_sample_size(self));
+    unsigned valid = wave_get_valid_bits_per_sample(self);
+
+    if (WAVE_IS_ADPCM(self->format_chunk.body.format_tag) || wave_get_sample_format(self) != WAVE_FORMAT_PCM) {
+        return 0;
+    }
+    return valid > 0 && valid < container ? container - valid : 0;
+}
+
+void wave_clear_padding_bits(WaveU8* samples, size_t sample_size, size_t n, unsigned bits)
+{
+    size_t  full = bits / 8;
+    WaveU8  mask = (WaveU8)(0xff << (bits % 8));
+    size_t  i;
+
+    /* little-endian samples are left-justified, so the padding is in the leading bytes */
+    for (i = 0; i < n; ++i, samples += sample_size) {
+        memset(samples, 0, full);
+        samples[full] &= mask;
+    }
+}
+
+void wave_round_padding_bits(WaveU8* samples, size_t sample_size, size_t n, unsigned bits)
+{
+    WaveI64 half = (WaveI64)1 << (bits - 1);
+    WaveI64 max = ((WaveI64)1 << (8 * sample_size - 1)) - ((WaveI64)1 << bits);
+    size_t  i, b;
+
+    for (i = 0; i < n; ++i, samples += sample_size) {
+        WaveI64 x = 0;
+
+        for (b = 0; b < sample_size; ++b) {
+            x |= (WaveI64)samples[b] << (8 * b);
+        }
+        /* 8-bit samples are unsigned, all others are two's complement */
+        x = sample_size == 1 ? x - 128 : x - ((x >> (8 * sample_size - 1)) << (8 * sample_size));
+        x = MIN(x + half, max) & ~((WaveI64)2 * half - 1);
+        x = sample_size == 1 ? x + 128 : x;
+        for (b = 0; b < sample_size; ++b) {
+            samples[b] = (WaveU8)(x >> (8 * b));
+        }
+    }
+}
+
+/* G.711 expansion to 16-bit linear PCM */
+static WAVE_CONST WaveI16 wave_alaw_table[256] = {
+     -5504,  -5248,  -6016,  -5760,  -4480,  -4224,  -4992,  -4736,
+     -7552,  -7296,  -8064,  -7808,  -6528,  -6272,  -7040,  -6784,
+     -2752,  -2624,  -3008,  -2880,  -2240,  -2112,  -2496,  -2368,
+     -3776,  -3648,  -4032,  -3904,  -3264,  -3136,  -3520,  -3392,
+    -22016, -20992, -24064, -23040, -17920, -16896, -19968, -18944,
+    -30208, -29184, -32256, -31232, -26112, -25088, -28160, -27136,
+    -11008, -10496, -12032, -11520,  -8960,  -8448,  -9984,  -9472,
+    -15104, -14592, -16128, -15616, -13056, -12544, -14080, -13568,
+      -344,   -328,   -376,   -360,   -280,   -264,   -312,   -296,
+      -472,   -456,   -504,   -488,   -408,   -392,   -440,   -424,
+       -88,    -72,   -120,   -104,    -24,     -8,    -56,    -40,
+      -216,   -200,   -248,   -232,   -152,   -136,   -184,   -168,
+     -1376,  -1312,  -1504,  -1440,  -1120,  -1056,  -1248,  -1184,
+     -1888,  -1824,  -2016,  -1952,  -1632,  -1568,  -1760,  -1696,
+      -688,   -656,   -752,   -720,   -560,   -528,   -624,   -592,
+      -944,   -912,  -1008,   -976,   -816,   -784,   -880,   -848,
+      5504,   5248,   6016,   5760,   4480,   4224,   4992,   4736,
+      7552,   7296,   8064,   7808,   6528,   6272,   7040,   6784,
+      2752,   2624,   3008,   2880,   2240,   2112,   2496,   2368,
+      3776,   3648,   4032,   3904,   3264,   3136,   3520,   3392,
+     22016,  20992,  24064,  23040,  17920,  16896,  19968,  18944,
+     30208,  29184,  32256,  31232,  26112,  25088,  28160,  27136,
+     11008,  10496,  12032,  11520,   8960,   8448,   9984,   9472,
+     15104,  14592,  16128,  15616,  13056,  12544,  14080,  13568,
+       344,    328,    376,    360,    280,    264,    312,    296,
+       472,    456,    504,    488,    408,    392,    440,    424,
+        88,     72,    120,    104,     24,      8,     56,     40,
+       216,    200,    248,    232,    152,    136,    184,    168,
+      1376,   1312,   1504,   1440,   1120,   1056,   1248,   1184,
+      1888,   1824,   2016,   1952,   1632,   1568,   1760,   1696,
+       688,    656,    752,    720,    560,    528,    624,    592,
+       944,    912,   1008,    976,    816,    784,    880,    848,
+};
+
+static WAVE_CONST WaveI16 wave_mulaw_table[256] = {
+    -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956,
+    -23932, -22908, -21884, -20860, -19836, -18812, -17788, -16764,
+    -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
+    -11900, -11388, -10876, -10364,  -9852,  -9340,  -8828,  -8316,
+     -7932,  -7676,  -7420,  -7164,  -6908,  -6652,  -6396,  -6140,
+     -5884,  -5628,  -5372,  -5116,  -4860,  -4604,  -4348,  -4092,
+     -3900,  -3772,  -3644,  -3516,  -3388,  -3260,  -3132,  -3004,
+     -2876,  -2748,  -2620,  -2492,  -2364,  -2236,  -2108,  -1980,
+     -1884,  -1820,  -1756,  -1692,  -1628,  -1564,  -1500,  -1436,
+     -1372,  -1308,  -1244,  -1180,  -1116,  -1052,   -988,   -924,
+      -876,   -844,   -812,   -780,   -748,   -716,   -684,   -652,
+      -620,   -588,   -556,   -524,   -492,   -460,   -428,   -396,
+      -372,   -356,   -340,   -324,   -308,   -292,   -276,   -260,
+      -244,   -228,   -212,   -196,   -180,   -164,   -148,   -132,
+      -120,   -112,   -104,    -96,    -88,    -80,    -72,    -64,
+       -56,    -48,    -40,    -32,    -24,    -16,     -8,      0,
+     32124,  31100,  30076,  29052,  28028,  27004,  25980,  24956,
+     23932,  22908,  21884,  20860,  19836,  18812,  17788,  16764,
+     15996,  15484,  14972,  14460,  13948,  13436,  12924,  12412,
+     11900,  11388,  10876,  10364,   9852,   9340,   8828,   8316,
+      7932,   7676,   7420,   7164,   6908,   6652,   6396,   6140,
+      5884,   5628,   5372,   5116,   4860,   4604,   4348,   4092,
+      3900,   3772,   3644,   3516,   3388,   3260,   3132,   3004,
+      2876,   2748,   2620,   2492,   2364,   2236,   2108,   1980,
+      1884,   1820,   1756,   1692,   1628,   1564,   1500,   1436,
+      1372,   1308,   1244,   1180,   1116,   1052,    988,    924,
+       876,    844,    812,    780,    748,    716,    684,    652,
+       620,    588,    556,    524,    492,    460,    428,    396,
+       372,    356,    340,    324,    308,    292,    276,    260,
+       244,    228,    212,    196,    180,    164,    148,    132,
+       120,    112,    104,     96,     88,     80,     72,     64,
+        56,     48,     40,     32,     24,     16,      8,      0,
+};
+
+static WaveU8 wave_s16_to_alaw(int sample)
+{
+    int pcm = sample >> 3;
+    int mask = 0xd5;
+    int segment = 0;
+
+    if (pcm < 0) {
+        pcm = -pcm - 1;
+        mask = 0x55;
+    }
+    while (segment < 8 && pcm > (0x20 << segment) - 1) {
+        ++segment;
+    }
+    if (segment >= 8) {
+        return (WaveU8)(0x7f ^ mask);
+    }
+
+    return (WaveU8)(((segment << 4) | (segment < 2 ? (pcm >> 1) & 0x0f : (pcm >> segment) & 0x0f)) ^ mask);
+}
+
+static WaveU8 wave_s16_to_mulaw(int sample)
+{
+    int pcm = sample;
+    int sign = 0;
+    int exponent = 7;
+    int mask;
+
+    if (pcm < 0) {
+        pcm = -pcm;
+        sign = 0x80;
+    }
+    pcm = (pcm > 32635 ? 32635 : pcm) + 0x84;
+    for (mask = 0x4000; (pcm & mask) == 0 && exponent > 0; mask >>= 1) {
+        --exponent;
+    }
+
+    return (WaveU8)~(sign | (exponent << 4) | ((pcm >> (exponent + 3)) & 0x0f));
+}
+
+/* Scale, round half away from zero and clip to [lo, hi] without calling into libm */
+#define WAVE_QUANTIZE(x, scale, lo, hi) \
+    ((x) >= (float)(hi) / (scale) ? (hi) : (x) <= (float)(lo) / (scale) ? (lo) : \
+     (WaveI32)((x) * (scale) + ((x) >= 0.0f ? 0.5f : -0.5f)))
+
+void wave_decode_f32_scalar(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    size_t i;
+
+    switch (encoding) {
+        case WAVE_ENCODING_U8:
+            for (i = 0; i < n; ++i) {
+                dst[i] = (float)((int)src[i] - 128) * (1.0f / 128.0f);
+            }
+            break;
+        case WAVE_ENCODING_S16:
+            for (i = 0; i < n; ++i) {
+                WaveI16 s;
+                memcpy(&s, src + i * 2, 2);
+                dst[i] = (float)s * (1.0f / 32768.0f);
+            }
+            break;
+        case WAVE_ENCODING_S24:
+            for (i = 0; i < n; ++i) {
+                WAVE_CONST WaveU8 *p = src + i * 3;
+                WaveI32 s = (WaveI32)((WaveU32)p[0] << 8 | (WaveU32)p[1] << 16 | (WaveU32)p[2] << 24) >> 8;
+                dst[i] = (float)s * (1.0f / 8388608.0f);
+            }
+            break;
+        case WAVE_ENCODING_S32:
+            for (i = 0; i < n; ++i) {
+                WaveI32 s;
+                memcpy(&s, src + i * 4, 4);
+                dst[i] = (float)((double)s * (1.0 / 2147483648.0));
+            }
+            break;
+        case WAVE_ENCODING_F32:
+            memmove(dst, src, n * sizeof(float));
+            break;
+        case WAVE_ENCODING_F64:
+            for (i = 0; i < n; ++i) {
+                double s;
+                memcpy(&s, src + i * 8, 8);
+                dst[i] = (float)s;
+            }
+            break;
+        case WAVE_ENCODING_ALAW:
+            for (i = 0; i < n; ++i) {
+                dst[i] = (float)wave_alaw_table[src[i]] * (1.0f / 32768.0f);
+            }
+            break;
+        case WAVE_ENCODING_MULAW:
+            for (i = 0; i < n; ++i) {
+                dst[i] = (float)wave_mulaw_table[src[i]] * (1.0f / 32768.0f);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void wave_encode_f32_scalar(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    size_t i;
+
+    switch (encoding) {
+        case WAVE_ENCODING_U8:
+            for (i = 0; i < n; ++i) {
+                dst[i] = (WaveU8)(WAVE_QUANTIZE(src[i], 128.0f, -128, 127) + 128);
+            }
+            break;
+        case WAVE_ENCODING_S16:
+            for (i = 0; i < n; ++i) {
+                WaveI16 s = (WaveI16)WAVE_QUANTIZE(src[i], 32768.0f, -32768, 32767);
+                memcpy(dst + i * 2, &s, 2);
+            }
+            break;
+        case WAVE_ENCODING_S24:
+            for (i = 0; i < n; ++i) {
+                WaveI32 s = WAVE_QUANTIZE(src[i], 8388608.0f, -8388608, 8388607);
+                dst[i * 3 + 0] = (WaveU8)s;
+                dst[i * 3 + 1] = (WaveU8)(s >> 8);
+                dst[i * 3 + 2] = (WaveU8)(s >> 16);
+            }
+            break;
+        case WAVE_ENCODING_S32:
+            for (i = 0; i < n; ++i) {
+                double  x = src[i];
+                WaveI32 s = x >= 1.0 ? 2147483647 : x < -1.0 ? (-2147483647 - 1) : (WaveI32)(x * 2147483648.0 + (x >= 0.0 ? 0.5 : -0.5));
+                memcpy(dst + i * 4, &s, 4);
+            }
+            break;
+        case WAVE_ENCODING_F32:
+            memmove(dst, src, n * sizeof(float));
+            break;
+        case WAVE_ENCODING_F64:
+            for (i = 0; i < n; ++i) {
+                double s = src[i];
+                memcpy(dst + i * 8, &s, 8);
+            }
+            break;
+        case WAVE_ENCODING_ALAW:
+            for (i = 0; i < n; ++i) {
+                dst[i] = wave_s16_to_alaw(WAVE_QUANTIZE(src[i], 32768.0f, -32768, 32767));
+            }
+            break;
+        case WAVE_ENCODING_MULAW:
+            for (i = 0; i < n; ++i) {
+                dst[i] = wave_s16_to_mulaw(WAVE_QUANTIZE(src[i], 32768.0f, -32768, 32767));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+void wave_analyze_f32_scalar(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    float  peak = stats->peak;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        float x = src[i];
+        float a = x < 0.0f ? -x : x;
+        peak = a > peak ? a : peak;
+        stats->sum += x;
+        stats->sum_sq += (double)x * x;
+        stats->clips += a >= clip_level;
+    }
+    stats->peak = peak;
+}
+
+double wave_sum_squares_f32_scalar(WAVE_CONST float* src, size_t n)
+{
+    double total = 0.0;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        total += (double)src[i] * src[i];
+    }
+
+    return total;
+}
+
+void wave_multiply_f32_scalar(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        dst[i] = a[i] * b[i];
+    }
+}
+
+/* slice-by-8 tables of the reflected Castagnoli polynomial, filled in when the kernels are selected */
+static WaveU32 g_crc32c_table[8][256];
+
+static void wave_crc32c_init_table(void)
+{
+    WaveU32 i, k;
+
+    for (i = 0; i < 256; ++i) {
+        WaveU32 crc = i;
+        for (k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+        }
+        g_crc32c_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; ++i) {
+        for (k = 1; k < 8; ++k) {
+            g_crc32c_table[k][i] = (g_crc32c_table[k - 1][i] >> 8) ^ g_crc32c_table[0][g_crc32c_table[k - 1][i] & 0xff];
+        }
+    }
+}
+
+WaveU32 wave_crc32c_scalar(WaveU32 crc, WAVE_CONST WaveU8* data, size_t size)
+{
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        WaveU32 lo = crc ^ ((WaveU32)data[0] | (WaveU32)data[1] << 8 | (WaveU32)data[2] << 16 | (WaveU32)data[3] << 24);
+        WaveU32 hi = (WaveU32)data[4] | (WaveU32)data[5] << 8 | (WaveU32)data[6] << 16 | (WaveU32)data[7] << 24;
+        crc = g_crc32c_table[7][lo & 0xff] ^ g_crc32c_table[6][(lo >> 8) & 0xff] ^
+              g_crc32c_table[5][(lo >> 16) & 0xff] ^ g_crc32c_table[4][lo >> 24] ^
+              g_crc32c_table[3][hi & 0xff] ^ g_crc32c_table[2][(hi >> 8) & 0xff] ^
+              g_crc32c_table[1][(hi >> 16) & 0xff] ^ g_crc32c_table[0][hi >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        crc = g_crc32c_table[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* Runtime selection of the kernels. Every target is compiled in its own translation unit with the flags that enable it,
+ * and only the ones that the CPU and the OS support are installed, in ascending order. */
+
+static WaveKernels g_kernels;
+static WaveOnce    g_kernels_once = WAVE_ONCE_INIT;
+
+#if defined(WAVE_KERNELS_SSE2) || defined(WAVE_KERNELS_AVX2) || defined(WAVE_KERNELS_AVX512)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+static WaveBool wave_cpu_has(WAVE_CONST char* target)
+{
+    int         regs[4];
+    int         max_leaf;
+    WaveBool    sse2, avx_os, avx512_os;
+
+    __cpuid(regs, 0);
+    max_leaf = regs[0];
+    __cpuid(regs, 1);
+    sse2 = (regs[3] & (1 << 26)) != 0;
+    if (strcmp(target, "sse2") == 0) {
+        return sse2;
+    }
+    /* OSXSAVE, then whether the OS saves the YMM and ZMM registers */
+    if (max_leaf < 7 || !(regs[2] & (1 << 27))) {
+        return WAVE_FALSE;
+    }
+    avx_os = (_xgetbv(0) & 0x06) == 0x06;
+    avx512_os = (_xgetbv(0) & 0xe6) == 0xe6;
+    __cpuidex(regs, 7, 0);
+    if (strcmp(target, "avx2") == 0) {
+        return avx_os && (regs[1] & (1 << 5)) != 0;
+    }
+    return avx512_os && (regs[1] & (1 << 16)) != 0;
+}
+
+#else
+
+/* the compiler runtime also checks that the OS saves the wider registers */
+static WaveBool wave_cpu_has(WAVE_CONST char* target)
+{
+    __builtin_cpu_init();
+    if (strcmp(target, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2") != 0;
+    } else if (strcmp(target, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2") != 0;
+    }
+    return __builtin_cpu_supports("avx512f") != 0;
+}
+
+#endif
+
+#endif
+
+/* The override names the best target to use, so that the lower ones can be tested on the same machine */
+static WaveBool wave_kernels_stop_after(WAVE_CONST char* target)
+{
+    WAVE_CONST char *limit = getenv("WAVE_KERNELS");
+    return limit != NULL && strcmp(limit, target) == 0;
+}
+
+static void wave_kernels_select(void)
+{
+    g_kernels.name = "scalar";
+    g_kernels.deinterleave = wave_deinterleave_portable;
+    g_kernels.decode_f32 = wave_decode_f32_scalar;
+    g_kernels.encode_f32 = wave_encode_f32_scalar;
+    g_kernels.analyze_f32 = wave_analyze_f32_scalar;
+    g_kernels.sum_squares_f32 = wave_sum_squares_f32_scalar;
+    g_kernels.multiply_f32 = wave_multiply_f32_scalar;
+    g_kernels.crc32c = wave_crc32c_scalar;
+    wave_crc32c_init_table();
+    if (wave_kernels_stop_after("scalar")) {
+        return;
+    }
+
+#ifdef WAVE_KERNELS_SSE2
+    if (wave_cpu_has("sse2")) {
+        wave_kernels_use_sse2(&g_kernels);
+    }
+    if (wave_kernels_stop_after("sse2")) {
+        return;
+    }
+#endif
+#ifdef WAVE_KERNELS_AVX2
+    if (wave_cpu_has("avx2")) {
+        wave_kernels_use_avx2(&g_kernels);
+    }
+    if (wave_kernels_stop_after("avx2")) {
+        return;
+    }
+#endif
+#ifdef WAVE_KERNELS_AVX512
+    if (wave_cpu_has("avx512")) {
+        wave_kernels_use_avx512(&g_kernels);
+    }
+    if (wave_kernels_stop_after("avx512")) {
+        return;
+    }
+#endif
+#ifdef WAVE_KERNELS_NEON
+    wave_kernels_use_neon(&g_kernels);
+#endif
+}
+
+void wave_kernels_init(void)
+{
+    wave_once(&g_kernels_once, wave_kernels_select);
+}
+
+WAVE_CONST char* wave_get_kernels_target(void)
+{
+    wave_kernels_init();
+    return g_kernels.name;
+}
+
+void wave_deinterleave(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size, size_t count)
+{
+    wave_kernels_init();
+    g_kernels.deinterleave(dst, src, num_channels, sample_size, count);
+}
+
+void wave_decode_f32(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    wave_kernels_init();
+    g_kernels.decode_f32(dst, src, encoding, n);
+}
+
+void wave_encode_f32(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    wave_kernels_init();
+    g_kernels.encode_f32(dst, src, encoding, n);
+}
+
+void wave_analyze_f32(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    wave_kernels_init();
+    g_kernels.analyze_f32(stats, src, n, clip_level);
+}
+
+double wave_sum_squares_f32(WAVE_CONST float* src, size_t n)
+{
+    wave_kernels_init();
+    return g_kernels.sum_squares_f32(src, n);
+}
+
+void wave_multiply_f32(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    wave_kernels_init();
+    g_kernels.multiply_f32(dst, a, b, n);
+}
+
+WaveU32 wave_crc32c(WaveU32 crc, WAVE_CONST void* data, size_t size)
+{
+    wave_kernels_init();
+    return g_kernels.crc32c(crc, data, size);
+}
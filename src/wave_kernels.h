@@ -0,0 +1,71 @@
+#ifndef __WAVE_KERNELS_H__
+#define __WAVE_KERNELS_H__
+
+#include "wave.h"
+
+/* sample encodings that the conversion kernels understand */
+typedef enum {
+    WAVE_ENCODING_UNSUPPORTED,
+    WAVE_ENCODING_U8,
+    WAVE_ENCODING_S16,
+    WAVE_ENCODING_S24,
+    WAVE_ENCODING_S32,
+    WAVE_ENCODING_F32,
+    WAVE_ENCODING_F64,
+    WAVE_ENCODING_ALAW,
+    WAVE_ENCODING_MULAW
+} WaveEncoding;
+
+/** Pick the kernels of the best target that the CPU supports, unless the {WAVE_KERNELS} environment variable names a lower
+ *  one. This is done once per process, the first time a file is opened or a kernel is called. */
+void wave_kernels_init(void);
+
+/** Split {count} interleaved frames of {num_channels} samples of {sample_size} bytes into one plane per channel
+ *
+ *  @param dst      {num_channels} pointers to where frame 0 of each channel is stored
+ */
+void wave_deinterleave(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size, size_t count);
+
+/** The encoding of the samples in the data chunk of {self}, or {WAVE_ENCODING_UNSUPPORTED} if they cannot be converted */
+WaveEncoding wave_get_encoding(WAVE_CONST WaveFile* self);
+
+/** The encoding of the frames passed to {wave_read} and {wave_write}, which is 16-bit PCM for the block codecs */
+WaveEncoding wave_get_frame_encoding(WAVE_CONST WaveFile* self);
+
+/** The number of low bits of every integer sample of {self} that are padding, i.e. the container bits minus the valid bits */
+unsigned wave_get_padding_bits(WAVE_CONST WaveFile* self);
+
+/** Zero the {bits} padding bits of {n} samples of {sample_size} bytes, which readers must ignore */
+void wave_clear_padding_bits(WaveU8* samples, size_t sample_size, size_t n, unsigned bits);
+
+/** Round {n} integer samples of {sample_size} bytes to the nearest value with {bits} zero padding bits */
+void wave_round_padding_bits(WaveU8* samples, size_t sample_size, size_t n, unsigned bits);
+
+/** Convert {n} samples of {encoding} to float in [-1.0, 1.0) */
+void wave_decode_f32(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n);
+
+/** Convert {n} float samples to {encoding}, clipping to the range of the integer encodings */
+void wave_encode_f32(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n);
+
+/* running per-channel sample statistics */
+typedef struct {
+    float   peak;
+    double  sum;
+    double  sum_sq;
+    WaveU64 clips;
+} WaveSampleStats;
+
+/** Accumulate the peak magnitude, the sum, the sum of squares and the samples with a magnitude of at least
+ *  {clip_level} of {n} float samples into {stats} */
+void wave_analyze_f32(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level);
+
+/** The sum of the squares of {n} float samples */
+double wave_sum_squares_f32(WAVE_CONST float* src, size_t n);
+
+/** Multiply {n} float samples element by element, e.g. with the coefficients of a window function */
+void wave_multiply_f32(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n);
+
+/** Continue the CRC32C (Castagnoli) {crc} of the bytes before {data} over {size} more bytes. The CRC of no bytes is 0. */
+WaveU32 wave_crc32c(WaveU32 crc, WAVE_CONST void* data, size_t size);
+
+#endif /* __WAVE_KERNELS_H__ */
@@ -0,0 +1,165 @@
+#include <immintrin.h>
+
+#include "wave_internal.h"
+#include "wave_kernels_isa.h"
+
+static void wave_decode_f32_avx2(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((WAVE_CONST __m128i*)(src + i * 2)));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 2, encoding, n - i);
+    } else if (encoding == WAVE_ENCODING_S32) {
+        WAVE_CONST __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m256i s = _mm256_loadu_si256((WAVE_CONST __m256i*)(src + i * 4));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 4, encoding, n - i);
+    } else {
+        wave_decode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_encode_f32_avx2(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m256 scale = _mm256_set1_ps(32768.0f);
+        WAVE_CONST __m256 lo = _mm256_set1_ps(-32768.0f);
+        WAVE_CONST __m256 hi = _mm256_set1_ps(32767.0f);
+        WAVE_CONST __m256 half = _mm256_set1_ps(0.5f);
+        WAVE_CONST __m256 sign = _mm256_set1_ps(-0.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m256  x = _mm256_loadu_ps(src + i);
+            __m256  y = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, scale), lo), hi);
+            __m256i s = _mm256_cvttps_epi32(_mm256_add_ps(y, _mm256_or_ps(_mm256_and_ps(x, sign), half)));
+            _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_packs_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1)));
+        }
+        wave_encode_f32_scalar(dst + i * 2, src + i, encoding, n - i);
+    } else {
+        wave_encode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static float wave_hsum256_ps(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static void wave_analyze_f32_avx2(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    WAVE_CONST __m256 sign = _mm256_set1_ps(-0.0f);
+    WAVE_CONST __m256 level = _mm256_set1_ps(clip_level);
+    __m256  peak = _mm256_set1_ps(stats->peak);
+    size_t  vec_n = n - n % 8;
+    size_t  i = 0;
+    float   lanes[8];
+    WaveI32 counts[8];
+    size_t  k;
+
+    while (i < vec_n) {
+        size_t  end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m256  sum = _mm256_setzero_ps();
+        __m256  sum_sq = _mm256_setzero_ps();
+        __m256i clips = _mm256_setzero_si256();
+
+        for (; i < end; i += 8) {
+            __m256 x = _mm256_loadu_ps(src + i);
+            __m256 a = _mm256_andnot_ps(sign, x);
+            peak = _mm256_max_ps(peak, a);
+            sum = _mm256_add_ps(sum, x);
+            sum_sq = _mm256_add_ps(sum_sq, _mm256_mul_ps(x, x));
+            clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(a, level, _CMP_GE_OQ)));
+        }
+
+        stats->sum += wave_hsum256_ps(sum);
+        stats->sum_sq += wave_hsum256_ps(sum_sq);
+        _mm256_storeu_si256((__m256i*)counts, clips);
+        for (k = 0; k < 8; ++k) {
+            stats->clips += (WaveU64)counts[k];
+        }
+    }
+
+    _mm256_storeu_ps(lanes, peak);
+    for (k = 0; k < 8; ++k) {
+        stats->peak = MAX(stats->peak, lanes[k]);
+    }
+    wave_analyze_f32_scalar(stats, src + vec_n, n - vec_n, clip_level);
+}
+
+static double wave_sum_squares_f32_avx2(WAVE_CONST float* src, size_t n)
+{
+    size_t vec_n = n - n % 8;
+    double total = 0.0;
+    size_t i = 0;
+
+    while (i < vec_n) {
+        size_t end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m256 sum_sq = _mm256_setzero_ps();
+
+        for (; i < end; i += 8) {
+            __m256 x = _mm256_loadu_ps(src + i);
+            sum_sq = _mm256_add_ps(sum_sq, _mm256_mul_ps(x, x));
+        }
+        total += wave_hsum256_ps(sum_sq);
+    }
+
+    return total + wave_sum_squares_f32_scalar(src + vec_n, n - vec_n);
+}
+
+static void wave_multiply_f32_avx2(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    size_t vec_n = n - n % 8;
+    size_t i;
+
+    for (i = 0; i < vec_n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    wave_multiply_f32_scalar(dst + vec_n, a + vec_n, b + vec_n, n - vec_n);
+}
+
+/* SSE4.2 is part of every CPU with AVX2, and the flags of this file enable it */
+static WaveU32 wave_crc32c_avx2(WaveU32 crc, WAVE_CONST WaveU8* data, size_t size)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    WaveU64 crc64 = ~crc & 0xffffffffu;
+    for (; size >= 8; size -= 8, data += 8) {
+        WaveU64 word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (WaveU32)crc64;
+#else
+    crc = ~crc;
+    for (; size >= 4; size -= 4, data += 4) {
+        WaveU32 word;
+        memcpy(&word, data, 4);
+        crc = _mm_crc32_u32(crc, word);
+    }
+#endif
+    for (; size > 0; --size, ++data) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return ~crc;
+}
+
+void wave_kernels_use_avx2(WaveKernels* kernels)
+{
+    kernels->name = "avx2";
+    kernels->decode_f32 = wave_decode_f32_avx2;
+    kernels->encode_f32 = wave_encode_f32_avx2;
+    kernels->analyze_f32 = wave_analyze_f32_avx2;
+    kernels->sum_squares_f32 = wave_sum_squares_f32_avx2;
+    kernels->multiply_f32 = wave_multiply_f32_avx2;
+    kernels->crc32c = wave_crc32c_avx2;
+}
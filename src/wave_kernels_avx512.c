@@ -0,0 +1,123 @@
+#include <immintrin.h>
+
+#include "wave_internal.h"
+#include "wave_kernels_isa.h"
+
+static void wave_decode_f32_avx512(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m512 scale = _mm512_set1_ps(1.0f / 32768.0f);
+        for (; i + 16 <= n; i += 16) {
+            __m512i s = _mm512_cvtepi16_epi32(_mm256_loadu_si256((WAVE_CONST __m256i*)(src + i * 2)));
+            _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(s), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 2, encoding, n - i);
+    } else if (encoding == WAVE_ENCODING_S32) {
+        WAVE_CONST __m512 scale = _mm512_set1_ps(1.0f / 2147483648.0f);
+        for (; i + 16 <= n; i += 16) {
+            __m512i s = _mm512_loadu_si512((WAVE_CONST void*)(src + i * 4));
+            _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(s), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 4, encoding, n - i);
+    } else {
+        wave_decode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_encode_f32_avx512(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m512  scale = _mm512_set1_ps(32768.0f);
+        WAVE_CONST __m512  lo = _mm512_set1_ps(-32768.0f);
+        WAVE_CONST __m512  hi = _mm512_set1_ps(32767.0f);
+        WAVE_CONST __m512i half = _mm512_castps_si512(_mm512_set1_ps(0.5f));
+        WAVE_CONST __m512i sign = _mm512_castps_si512(_mm512_set1_ps(-0.0f));
+        for (; i + 16 <= n; i += 16) {
+            __m512  x = _mm512_loadu_ps(src + i);
+            __m512  y = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(x, scale), lo), hi);
+            __m512  h = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(_mm512_castps_si512(x), sign), half));
+            _mm256_storeu_si256((__m256i*)(dst + i * 2), _mm512_cvtsepi32_epi16(_mm512_cvttps_epi32(_mm512_add_ps(y, h))));
+        }
+        wave_encode_f32_scalar(dst + i * 2, src + i, encoding, n - i);
+    } else {
+        wave_encode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_analyze_f32_avx512(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    WAVE_CONST __m512i abs_mask = _mm512_set1_epi32(0x7fffffff);
+    WAVE_CONST __m512i one = _mm512_set1_epi32(1);
+    WAVE_CONST __m512  level = _mm512_set1_ps(clip_level);
+    __m512  peak = _mm512_set1_ps(stats->peak);
+    size_t  vec_n = n - n % 16;
+    size_t  i = 0;
+
+    while (i < vec_n) {
+        size_t  end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m512  sum = _mm512_setzero_ps();
+        __m512  sum_sq = _mm512_setzero_ps();
+        __m512i clips = _mm512_setzero_si512();
+
+        for (; i < end; i += 16) {
+            __m512 x = _mm512_loadu_ps(src + i);
+            __m512 a = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), abs_mask));
+            peak = _mm512_max_ps(peak, a);
+            sum = _mm512_add_ps(sum, x);
+            sum_sq = _mm512_add_ps(sum_sq, _mm512_mul_ps(x, x));
+            clips = _mm512_mask_add_epi32(clips, _mm512_cmp_ps_mask(a, level, _CMP_GE_OQ), clips, one);
+        }
+
+        stats->sum += _mm512_reduce_add_ps(sum);
+        stats->sum_sq += _mm512_reduce_add_ps(sum_sq);
+        stats->clips += (WaveU64)_mm512_reduce_add_epi32(clips);
+    }
+
+    stats->peak = _mm512_reduce_max_ps(peak);
+    wave_analyze_f32_scalar(stats, src + vec_n, n - vec_n, clip_level);
+}
+
+static double wave_sum_squares_f32_avx512(WAVE_CONST float* src, size_t n)
+{
+    size_t vec_n = n - n % 16;
+    double total = 0.0;
+    size_t i = 0;
+
+    while (i < vec_n) {
+        size_t end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m512 sum_sq = _mm512_setzero_ps();
+
+        for (; i < end; i += 16) {
+            __m512 x = _mm512_loadu_ps(src + i);
+            sum_sq = _mm512_add_ps(sum_sq, _mm512_mul_ps(x, x));
+        }
+        total += _mm512_reduce_add_ps(sum_sq);
+    }
+
+    return total + wave_sum_squares_f32_scalar(src + vec_n, n - vec_n);
+}
+
+static void wave_multiply_f32_avx512(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    size_t vec_n = n - n % 16;
+    size_t i;
+
+    for (i = 0; i < vec_n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    wave_multiply_f32_scalar(dst + vec_n, a + vec_n, b + vec_n, n - vec_n);
+}
+
+void wave_kernels_use_avx512(WaveKernels* kernels)
+{
+    kernels->name = "avx512";
+    kernels->decode_f32 = wave_decode_f32_avx512;
+    kernels->encode_f32 = wave_encode_f32_avx512;
+    kernels->analyze_f32 = wave_analyze_f32_avx512;
+    kernels->sum_squares_f32 = wave_sum_squares_f32_avx512;
+    kernels->multiply_f32 = wave_multiply_f32_avx512;
+}
@@ -0,0 +1,37 @@
+#ifndef __WAVE_KERNELS_ISA_H__
+#define __WAVE_KERNELS_ISA_H__
+
+#include "wave_kernels.h"
+
+/* the kernels of one target, each target overrides the entries that it accelerates */
+typedef struct {
+    WAVE_CONST char*    name;
+    void                (*deinterleave)(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size, size_t count);
+    void                (*decode_f32)(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n);
+    void                (*encode_f32)(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n);
+    void                (*analyze_f32)(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level);
+    double              (*sum_squares_f32)(WAVE_CONST float* src, size_t n);
+    void                (*multiply_f32)(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n);
+    WaveU32             (*crc32c)(WaveU32 crc, WAVE_CONST WaveU8* data, size_t size);
+} WaveKernels;
+
+/* samples summed in float before the partial sums are added to the double totals */
+#define WAVE_ANALYZE_BLOCK 1024
+
+/* The portable kernels, which the targets fall back to for the encodings and the tails they do not handle */
+void   wave_deinterleave_scalar(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size,
+                                size_t first_frame, size_t first_channel, size_t end_frame);
+void   wave_decode_f32_scalar(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n);
+void   wave_encode_f32_scalar(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n);
+void   wave_analyze_f32_scalar(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level);
+double wave_sum_squares_f32_scalar(WAVE_CONST float* src, size_t n);
+void   wave_multiply_f32_scalar(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n);
+WaveU32 wave_crc32c_scalar(WaveU32 crc, WAVE_CONST WaveU8* data, size_t size);
+
+/* Install the kernels of one target over {kernels}, each is only built when the compiler can target it */
+void wave_kernels_use_sse2(WaveKernels* kernels);
+void wave_kernels_use_avx2(WaveKernels* kernels);
+void wave_kernels_use_avx512(WaveKernels* kernels);
+void wave_kernels_use_neon(WaveKernels* kernels);
+
+#endif /* __WAVE_KERNELS_ISA_H__ */
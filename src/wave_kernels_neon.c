@@ -0,0 +1,143 @@
+#include <arm_neon.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "wave_internal.h"
+#include "wave_kernels_isa.h"
+
+static void wave_decode_f32_neon(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        for (; i + 8 <= n; i += 8) {
+            int16x8_t s = vld1q_s16((WAVE_CONST int16_t*)(WAVE_CONST void*)(src + i * 2));
+            vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), 1.0f / 32768.0f));
+            vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), 1.0f / 32768.0f));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 2, encoding, n - i);
+    } else if (encoding == WAVE_ENCODING_S32) {
+        for (; i + 4 <= n; i += 4) {
+            int32x4_t s = vld1q_s32((WAVE_CONST int32_t*)(WAVE_CONST void*)(src + i * 4));
+            vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(s), 1.0f / 2147483648.0f));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 4, encoding, n - i);
+    } else {
+        wave_decode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_encode_f32_neon(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST float32x4_t lo = vdupq_n_f32(-32768.0f);
+        WAVE_CONST float32x4_t hi = vdupq_n_f32(32767.0f);
+        WAVE_CONST uint32x4_t  sign = vdupq_n_u32(0x80000000u);
+        WAVE_CONST uint32x4_t  half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t x = vld1q_f32(src + i);
+            float32x4_t y = vminq_f32(vmaxq_f32(vmulq_n_f32(x, 32768.0f), lo), hi);
+            float32x4_t h = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(x), sign), half));
+            /* the conversion truncates, which rounds half away from zero after adding the signed half */
+            vst1_s16((int16_t*)(void*)(dst + i * 2), vqmovn_s32(vcvtq_s32_f32(vaddq_f32(y, h))));
+        }
+        wave_encode_f32_scalar(dst + i * 2, src + i, encoding, n - i);
+    } else {
+        wave_encode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_analyze_f32_neon(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    WAVE_CONST float32x4_t level = vdupq_n_f32(clip_level);
+    float32x4_t peak = vdupq_n_f32(stats->peak);
+    size_t      vec_n = n - n % 4;
+    size_t      i = 0;
+
+    while (i < vec_n) {
+        size_t      end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        float32x4_t sum_sq = vdupq_n_f32(0.0f);
+        uint32x4_t  clips = vdupq_n_u32(0);
+
+        for (; i < end; i += 4) {
+            float32x4_t x = vld1q_f32(src + i);
+            float32x4_t a = vabsq_f32(x);
+            peak = vmaxq_f32(peak, a);
+            sum = vaddq_f32(sum, x);
+            sum_sq = vaddq_f32(sum_sq, vmulq_f32(x, x));
+            clips = vsubq_u32(clips, vcgeq_f32(a, level));
+        }
+
+        stats->sum += vaddvq_f32(sum);
+        stats->sum_sq += vaddvq_f32(sum_sq);
+        stats->clips += vaddvq_u32(clips);
+    }
+
+    stats->peak = vmaxvq_f32(peak);
+    wave_analyze_f32_scalar(stats, src + vec_n, n - vec_n, clip_level);
+}
+
+static double wave_sum_squares_f32_neon(WAVE_CONST float* src, size_t n)
+{
+    size_t vec_n = n - n % 4;
+    double total = 0.0;
+    size_t i = 0;
+
+    while (i < vec_n) {
+        size_t      end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        float32x4_t sum_sq = vdupq_n_f32(0.0f);
+
+        for (; i < end; i += 4) {
+            float32x4_t x = vld1q_f32(src + i);
+            sum_sq = vaddq_f32(sum_sq, vmulq_f32(x, x));
+        }
+        total += vaddvq_f32(sum_sq);
+    }
+
+    return total + wave_sum_squares_f32_scalar(src + vec_n, n - vec_n);
+}
+
+static void wave_multiply_f32_neon(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    size_t vec_n = n - n % 4;
+    size_t i;
+
+    for (i = 0; i < vec_n; i += 4) {
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    wave_multiply_f32_scalar(dst + vec_n, a + vec_n, b + vec_n, n - vec_n);
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+/* the CRC instructions are optional before ARMv8.1, so they are only used when the build targets them */
+static WaveU32 wave_crc32c_neon(WaveU32 crc, WAVE_CONST WaveU8* data, size_t size)
+{
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; --size, ++data) {
+        crc = __crc32cb(crc, *data);
+    }
+    return ~crc;
+}
+#endif
+
+void wave_kernels_use_neon(WaveKernels* kernels)
+{
+    kernels->name = "neon";
+    kernels->decode_f32 = wave_decode_f32_neon;
+    kernels->encode_f32 = wave_encode_f32_neon;
+    kernels->analyze_f32 = wave_analyze_f32_neon;
+    kernels->sum_squares_f32 = wave_sum_squares_f32_neon;
+    kernels->multiply_f32 = wave_multiply_f32_neon;
+#if defined(__ARM_FEATURE_CRC32)
+    kernels->crc32c = wave_crc32c_neon;
+#endif
+}
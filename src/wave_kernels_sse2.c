@@ -0,0 +1,234 @@
+#include <emmintrin.h>
+
+#include "wave_internal.h"
+#include "wave_kernels_isa.h"
+
+/* 8 frames x 8 channels of 16-bit samples */
+static void wave_transpose_8x8_16(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t frame_size, size_t dst_offset)
+{
+    __m128i r0 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 0 * frame_size));
+    __m128i r1 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 1 * frame_size));
+    __m128i r2 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 2 * frame_size));
+    __m128i r3 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 3 * frame_size));
+    __m128i r4 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 4 * frame_size));
+    __m128i r5 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 5 * frame_size));
+    __m128i r6 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 6 * frame_size));
+    __m128i r7 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 7 * frame_size));
+
+    __m128i a0 = _mm_unpacklo_epi16(r0, r1);
+    __m128i a1 = _mm_unpackhi_epi16(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi16(r2, r3);
+    __m128i a3 = _mm_unpackhi_epi16(r2, r3);
+    __m128i a4 = _mm_unpacklo_epi16(r4, r5);
+    __m128i a5 = _mm_unpackhi_epi16(r4, r5);
+    __m128i a6 = _mm_unpacklo_epi16(r6, r7);
+    __m128i a7 = _mm_unpackhi_epi16(r6, r7);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    _mm_storeu_si128((__m128i*)(dst[0] + dst_offset), _mm_unpacklo_epi64(b0, b4));
+    _mm_storeu_si128((__m128i*)(dst[1] + dst_offset), _mm_unpackhi_epi64(b0, b4));
+    _mm_storeu_si128((__m128i*)(dst[2] + dst_offset), _mm_unpacklo_epi64(b1, b5));
+    _mm_storeu_si128((__m128i*)(dst[3] + dst_offset), _mm_unpackhi_epi64(b1, b5));
+    _mm_storeu_si128((__m128i*)(dst[4] + dst_offset), _mm_unpacklo_epi64(b2, b6));
+    _mm_storeu_si128((__m128i*)(dst[5] + dst_offset), _mm_unpackhi_epi64(b2, b6));
+    _mm_storeu_si128((__m128i*)(dst[6] + dst_offset), _mm_unpacklo_epi64(b3, b7));
+    _mm_storeu_si128((__m128i*)(dst[7] + dst_offset), _mm_unpackhi_epi64(b3, b7));
+}
+
+/* 4 frames x 4 channels of 32-bit samples */
+static void wave_transpose_4x4_32(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t frame_size, size_t dst_offset)
+{
+    __m128i r0 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 0 * frame_size));
+    __m128i r1 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 1 * frame_size));
+    __m128i r2 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 2 * frame_size));
+    __m128i r3 = _mm_loadu_si128((WAVE_CONST __m128i*)(src + 3 * frame_size));
+
+    __m128i a0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i a1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi32(r2, r3);
+    __m128i a3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128((__m128i*)(dst[0] + dst_offset), _mm_unpacklo_epi64(a0, a2));
+    _mm_storeu_si128((__m128i*)(dst[1] + dst_offset), _mm_unpackhi_epi64(a0, a2));
+    _mm_storeu_si128((__m128i*)(dst[2] + dst_offset), _mm_unpacklo_epi64(a1, a3));
+    _mm_storeu_si128((__m128i*)(dst[3] + dst_offset), _mm_unpackhi_epi64(a1, a3));
+}
+
+static void wave_deinterleave_sse2(WaveU8* WAVE_CONST* dst, WAVE_CONST WaveU8* src, size_t num_channels, size_t sample_size, size_t count)
+{
+    size_t frame_size = num_channels * sample_size;
+    size_t lanes = sample_size == 2 ? 8 : sample_size == 4 ? 4 : 0;
+    size_t tiled_channels = lanes != 0 ? num_channels - num_channels % lanes : 0;
+    size_t tiled_frames = lanes != 0 ? count - count % lanes : 0;
+    size_t f, c;
+
+    if (tiled_channels > 0) {
+        for (f = 0; f < tiled_frames; f += lanes) {
+            for (c = 0; c < tiled_channels; c += lanes) {
+                if (lanes == 8) {
+                    wave_transpose_8x8_16(dst + c, src + f * frame_size + c * 2, frame_size, f * 2);
+                } else {
+                    wave_transpose_4x4_32(dst + c, src + f * frame_size + c * 4, frame_size, f * 4);
+                }
+            }
+        }
+        if (tiled_channels < num_channels) {
+            wave_deinterleave_scalar(dst, src, num_channels, sample_size, 0, tiled_channels, tiled_frames);
+        }
+        wave_deinterleave_scalar(dst, src, num_channels, sample_size, tiled_frames, 0, count);
+        return;
+    }
+
+    wave_deinterleave_scalar(dst, src, num_channels, sample_size, 0, 0, count);
+}
+
+static void wave_decode_f32_sse2(float* dst, WAVE_CONST WaveU8* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m128i s = _mm_loadu_si128((WAVE_CONST __m128i*)(src + i * 2));
+            /* sign-extend by moving every sample to the top half of a 32-bit lane */
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 2, encoding, n - i);
+    } else if (encoding == WAVE_ENCODING_S32) {
+        WAVE_CONST __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+        for (; i + 4 <= n; i += 4) {
+            __m128i s = _mm_loadu_si128((WAVE_CONST __m128i*)(src + i * 4));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+        }
+        wave_decode_f32_scalar(dst + i, src + i * 4, encoding, n - i);
+    } else {
+        wave_decode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static void wave_encode_f32_sse2(WaveU8* dst, WAVE_CONST float* src, WaveEncoding encoding, size_t n)
+{
+    size_t i = 0;
+
+    if (encoding == WAVE_ENCODING_S16) {
+        WAVE_CONST __m128 scale = _mm_set1_ps(32768.0f);
+        WAVE_CONST __m128 lo = _mm_set1_ps(-32768.0f);
+        WAVE_CONST __m128 hi = _mm_set1_ps(32767.0f);
+        WAVE_CONST __m128 half = _mm_set1_ps(0.5f);
+        WAVE_CONST __m128 sign = _mm_set1_ps(-0.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m128 x0 = _mm_loadu_ps(src + i);
+            __m128 x1 = _mm_loadu_ps(src + i + 4);
+            /* clip first, then round half away from zero by truncating */
+            __m128 y0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x0, scale), lo), hi);
+            __m128 y1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x1, scale), lo), hi);
+            y0 = _mm_add_ps(y0, _mm_or_ps(_mm_and_ps(x0, sign), half));
+            y1 = _mm_add_ps(y1, _mm_or_ps(_mm_and_ps(x1, sign), half));
+            _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_packs_epi32(_mm_cvttps_epi32(y0), _mm_cvttps_epi32(y1)));
+        }
+        wave_encode_f32_scalar(dst + i * 2, src + i, encoding, n - i);
+    } else {
+        wave_encode_f32_scalar(dst, src, encoding, n);
+    }
+}
+
+static float wave_hsum_ps(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+static void wave_analyze_f32_sse2(WaveSampleStats* stats, WAVE_CONST float* src, size_t n, float clip_level)
+{
+    WAVE_CONST __m128 sign = _mm_set1_ps(-0.0f);
+    WAVE_CONST __m128 level = _mm_set1_ps(clip_level);
+    __m128  peak = _mm_set1_ps(stats->peak);
+    size_t  vec_n = n - n % 4;
+    size_t  i = 0;
+    float   lanes[4];
+    WaveI32 counts[4];
+
+    while (i < vec_n) {
+        size_t  end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m128  sum = _mm_setzero_ps();
+        __m128  sum_sq = _mm_setzero_ps();
+        __m128i clips = _mm_setzero_si128();
+
+        for (; i < end; i += 4) {
+            __m128 x = _mm_loadu_ps(src + i);
+            __m128 a = _mm_andnot_ps(sign, x);
+            peak = _mm_max_ps(peak, a);
+            sum = _mm_add_ps(sum, x);
+            sum_sq = _mm_add_ps(sum_sq, _mm_mul_ps(x, x));
+            /* the comparison yields -1 per clipped lane */
+            clips = _mm_sub_epi32(clips, _mm_castps_si128(_mm_cmpge_ps(a, level)));
+        }
+
+        stats->sum += wave_hsum_ps(sum);
+        stats->sum_sq += wave_hsum_ps(sum_sq);
+        _mm_storeu_si128((__m128i*)counts, clips);
+        stats->clips += (WaveU64)counts[0] + (WaveU64)counts[1] + (WaveU64)counts[2] + (WaveU64)counts[3];
+    }
+
+    _mm_storeu_ps(lanes, peak);
+    stats->peak = MAX(MAX(lanes[0], lanes[1]), MAX(lanes[2], lanes[3]));
+    wave_analyze_f32_scalar(stats, src + vec_n, n - vec_n, clip_level);
+}
+
+static double wave_sum_squares_f32_sse2(WAVE_CONST float* src, size_t n)
+{
+    double total = 0.0;
+    size_t i = 0;
+    size_t vec_n = n - n % 4;
+
+    while (i < vec_n) {
+        size_t end = MIN(i + WAVE_ANALYZE_BLOCK, vec_n);
+        __m128 sum_sq = _mm_setzero_ps();
+
+        for (; i < end; i += 4) {
+            __m128 x = _mm_loadu_ps(src + i);
+            sum_sq = _mm_add_ps(sum_sq, _mm_mul_ps(x, x));
+        }
+        total += wave_hsum_ps(sum_sq);
+    }
+
+    for (; i < n; ++i) {
+        total += (double)src[i] * src[i];
+    }
+
+    return total;
+}
+
+static void wave_multiply_f32_sse2(float* dst, WAVE_CONST float* a, WAVE_CONST float* b, size_t n)
+{
+    size_t vec_n = n - n % 4;
+    size_t i;
+
+    for (i = 0; i < vec_n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    wave_multiply_f32_scalar(dst + vec_n, a + vec_n, b + vec_n, n - vec_n);
+}
+
+void wave_kernels_use_sse2(WaveKernels* kernels)
+{
+    kernels->name = "sse2";
+    kernels->deinterleave = wave_deinterleave_sse2;
+    kernels->decode_f32 = wave_decode_f32_sse2;
+    kernels->encode_f32 = wave_encode_f32_sse2;
+    kernels->analyze_f32 = wave_analyze_f32_sse2;
+    kernels->sum_squares_f32 = wave_sum_squares_f32_sse2;
+    kernels->multiply_f32 = wave_multiply_f32_sse2;
+}
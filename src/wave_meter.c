@@ -0,0 +1,456 @@
+#include <math.h>
+
+#include "wave_internal.h"
+#include "wave_kernels.h"
+#include "wave_meter.h"
+
+#define WAVE_METER_CHUNK        1024    /* frames analyzed per pass */
+#define WAVE_METER_TAPS         12      /* taps per phase of the true-peak interpolator */
+#define WAVE_METER_PHASES       4
+#define WAVE_METER_SEGMENTS     30      /* 100 ms segments in the 3 s short-term window */
+#define WAVE_METER_BLOCK        4       /* 100 ms segments in a 400 ms gating block */
+#define WAVE_METER_BINS         1000    /* 0.1 LU bins of block loudness from -70 to +30 LUFS */
+#define WAVE_METER_PI           3.14159265358979323846
+
+/* 4x oversampling interpolator of ITU-R BS.1770-4 Annex 2 */
+static WAVE_CONST float wave_true_peak_fir[WAVE_METER_PHASES][WAVE_METER_TAPS] = {
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f, -0.0594482421875f,  0.1373291015625f,
+      0.9721679687500f, -0.1022949218750f,  0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f, -0.1665039062500f,  0.4650878906250f,
+      0.7797851562500f, -0.2003173828125f,  0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    {-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f, -0.2003173828125f,  0.7797851562500f,
+      0.4650878906250f, -0.1665039062500f,  0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    {-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f, -0.1022949218750f,  0.9721679687500f,
+      0.1373291015625f, -0.0594482421875f,  0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f },
+};
+
+typedef struct {
+    WaveSampleStats stats;
+    float           true_peak;
+    double          weight;
+    double          z[4];       /* states of the two K-weighting biquads */
+} WaveMeterChannel;
+
+struct _WaveMeter {
+    WaveU32             flags;
+    WaveU16             format_tag;
+    WaveU16             num_channels;
+    WaveU16             frame_size;
+    WaveU32             sample_rate;
+    WaveEncoding        encoding;
+    float               clip_level;
+    WaveU64             num_frames;
+
+    float*              interleaved;
+    float*              planes;         /* per channel: the last {WAVE_METER_TAPS} - 1 samples, then the current chunk */
+    WaveU8**            plane_ptrs;
+    WaveMeterChannel*   channels;
+
+    /* K-weighting: a high shelf followed by a high pass */
+    double              shelf_b[3], shelf_a[3];
+    double              hp_b[3], hp_a[3];
+
+    size_t              segment_frames;
+    size_t              segment_pos;
+    double              segment_energy;
+    double              segments[WAVE_METER_SEGMENTS];
+    WaveU64             num_segments;
+    WaveU64             bin_count[WAVE_METER_BINS];
+    double              bin_energy[WAVE_METER_BINS];
+};
+
+#define WAVE_METER_PLANE_SIZE   (WAVE_METER_TAPS - 1 + WAVE_METER_CHUNK)
+
+static float* wave_meter_plane(WaveMeter* meter, size_t channel)
+{
+    return meter->planes + channel * WAVE_METER_PLANE_SIZE + (WAVE_METER_TAPS - 1);
+}
+
+/* The largest magnitude that a sample of {encoding} can represent, anything at or above it has clipped */
+static float wave_meter_clip_level(WaveEncoding encoding)
+{
+    switch (encoding) {
+        case WAVE_ENCODING_U8: return 127.0f / 128.0f;
+        case WAVE_ENCODING_S16: return 32767.0f / 32768.0f;
+        case WAVE_ENCODING_S24: return 8388607.0f / 8388608.0f;
+        case WAVE_ENCODING_ALAW: return 32256.0f / 32768.0f;
+        case WAVE_ENCODING_MULAW: return 32124.0f / 32768.0f;
+        default: return 1.0f;
+    }
+}
+
+static void wave_meter_init_filters(WaveMeter* meter)
+{
+    double rate = (double)meter->sample_rate;
+    double f0 = 1681.974450955533;
+    double q = 0.7071752369554196;
+    double k = tan(WAVE_METER_PI * f0 / rate);
+    double vh = pow(10.0, 3.999843853973347 / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    meter->shelf_b[0] = (vh + vb * k / q + k * k) / a0;
+    meter->shelf_b[1] = 2.0 * (k * k - vh) / a0;
+    meter->shelf_b[2] = (vh - vb * k / q + k * k) / a0;
+    meter->shelf_a[0] = 1.0;
+    meter->shelf_a[1] = 2.0 * (k * k - 1.0) / a0;
+    meter->shelf_a[2] = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(WAVE_METER_PI * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+
+    meter->hp_b[0] = 1.0;
+    meter->hp_b[1] = -2.0;
+    meter->hp_b[2] = 1.0;
+    meter->hp_a[0] = 1.0;
+    meter->hp_a[1] = 2.0 * (k * k - 1.0) / a0;
+    meter->hp_a[2] = (1.0 - k / q + k * k) / a0;
+}
+
+/* The BS.1770 weight of {channel}: the LFE is excluded and the surrounds count +1.5 dB. Without a channel mask the
+ * channels of 6-channel files are taken to be in the 5.1 order of WAVE_FORMAT_EXTENSIBLE. */
+static double wave_meter_channel_weight(WAVE_CONST WaveFile* file, size_t channel)
+{
+    WaveU32 mask = file->format_chunk.body.format_tag == WAVE_FORMAT_EXTENSIBLE ? file->format_chunk.body.channel_mask : 0;
+    WaveU32 speaker;
+
+    if (mask == 0) {
+        return wave_get_num_channels(file) == 6 ? (channel == 3 ? 0.0 : channel >= 4 ? 1.41 : 1.0) : 1.0;
+    }
+
+    /* channels take the set bits of the mask in ascending order */
+    for (speaker = 1; speaker != 0; speaker <<= 1) {
+        if ((mask & speaker) && channel-- == 0) {
+            break;
+        }
+    }
+
+    switch (speaker) {
+        case WAVE_SPEAKER_LOW_FREQUENCY:
+            return 0.0;
+        case WAVE_SPEAKER_BACK_LEFT:
+        case WAVE_SPEAKER_BACK_RIGHT:
+        case WAVE_SPEAKER_SIDE_LEFT:
+        case WAVE_SPEAKER_SIDE_RIGHT:
+            return 1.41;
+        default:
+            return 1.0;
+    }
+}
+
+/* (Re)start the analysis for the current format of {file} */
+static void wave_meter_configure(WaveMeter* meter, WaveFile* file)
+{
+    size_t num_channels = wave_get_num_channels(file);
+    size_t c;
+
+    wave_free(meter->interleaved);
+    wave_free(meter->planes);
+    wave_free(meter->plane_ptrs);
+    wave_free(meter->channels);
+    memset((WaveU8*)meter + sizeof(WaveU32), 0, sizeof(WaveMeter) - sizeof(WaveU32));
+
+    meter->format_tag = file->format_chunk.body.format_tag;
+    meter->num_channels = (WaveU16)num_channels;
+    meter->frame_size = (WaveU16)(num_channels * wave_get_sample_size(file));
+    meter->sample_rate = file->format_chunk.body.sample_rate;
+    meter->encoding = wave_get_frame_encoding(file);
+    meter->clip_level = wave_meter_clip_level(meter->encoding);
+
+    if (meter->encoding == WAVE_ENCODING_UNSUPPORTED) {
+        wave_err_set_literal(WAVE_ERR_FORMAT, "Sample format cannot be metered");
+        return;
+    }
+    if ((meter->flags & WAVE_METER_LOUDNESS) && meter->sample_rate < 10) {
+        wave_err_set(WAVE_ERR_FORMAT, "Invalid sample rate for loudness: %u", meter->sample_rate);
+        return;
+    }
+
+    meter->interleaved = wave_malloc(sizeof(float) * WAVE_METER_CHUNK * num_channels);
+    meter->planes = wave_malloc(sizeof(float) * WAVE_METER_PLANE_SIZE * num_channels);
+    meter->plane_ptrs = wave_malloc(sizeof(WaveU8*) * num_channels);
+    meter->channels = wave_malloc(sizeof(WaveMeterChannel) * num_channels);
+    if (meter->interleaved == NULL || meter->planes == NULL || meter->plane_ptrs == NULL || meter->channels == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the meter");
+        return;
+    }
+    memset(meter->planes, 0, sizeof(float) * WAVE_METER_PLANE_SIZE * num_channels);
+    memset(meter->channels, 0, sizeof(WaveMeterChannel) * num_channels);
+
+    for (c = 0; c < num_channels; ++c) {
+        meter->plane_ptrs[c] = (WaveU8*)wave_meter_plane(meter, c);
+        meter->channels[c].weight = wave_meter_channel_weight(file, c);
+    }
+
+    meter->segment_frames = MAX((meter->sample_rate + 5) / 10, 1);
+    wave_meter_init_filters(meter);
+}
+
+WaveMeter* wave_meter_create(WaveFile* file, WaveU32 flags)
+{
+    WaveMeter *meter = wave_malloc(sizeof(WaveMeter));
+
+    if (meter == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the meter");
+        return NULL;
+    }
+    memset(meter, 0, sizeof(WaveMeter));
+    meter->flags = flags;
+
+    wave_meter_configure(meter, file);
+    if (g_err.code != WAVE_OK) {
+        wave_meter_destroy(meter);
+        return NULL;
+    }
+
+    return meter;
+}
+
+void wave_meter_destroy(WaveMeter* meter)
+{
+    if (meter == NULL) {
+        return;
+    }
+    wave_free(meter->interleaved);
+    wave_free(meter->planes);
+    wave_free(meter->plane_ptrs);
+    wave_free(meter->channels);
+    wave_free(meter);
+}
+
+static void wave_meter_true_peak(WaveMeterChannel* channel, float* plane, size_t n)
+{
+    float *history = plane - (WAVE_METER_TAPS - 1);
+    float  peak = channel->true_peak;
+    size_t i, p, k;
+
+    for (i = 0; i < n; ++i) {
+        WAVE_CONST float *x = history + i;
+        float a = plane[i] < 0.0f ? -plane[i] : plane[i];
+
+        peak = a > peak ? a : peak;
+        for (p = 0; p < WAVE_METER_PHASES; ++p) {
+            float y = 0.0f;
+            for (k = 0; k < WAVE_METER_TAPS; ++k) {
+                y += wave_true_peak_fir[p][k] * x[WAVE_METER_TAPS - 1 - k];
+            }
+            y = y < 0.0f ? -y : y;
+            peak = y > peak ? y : peak;
+        }
+    }
+
+    channel->true_peak = peak;
+    memmove(history, history + n, sizeof(float) * (WAVE_METER_TAPS - 1));
+}
+
+static void wave_meter_push_segment(WaveMeter* meter)
+{
+    double energy = 0.0;
+    size_t i;
+
+    meter->segments[meter->num_segments % WAVE_METER_SEGMENTS] = meter->segment_energy / (double)meter->segment_frames;
+    ++meter->num_segments;
+    meter->segment_energy = 0.0;
+    meter->segment_pos = 0;
+
+    if (meter->num_segments < WAVE_METER_BLOCK) {
+        return;
+    }
+
+    /* gating blocks of 400 ms overlap by 75 %, so one completes with every segment */
+    for (i = 0; i < WAVE_METER_BLOCK; ++i) {
+        energy += meter->segments[(meter->num_segments - 1 - i) % WAVE_METER_SEGMENTS];
+    }
+    energy /= WAVE_METER_BLOCK;
+
+    if (energy > 0.0) {
+        double loudness = -0.691 + 10.0 * log10(energy);
+        if (loudness >= -70.0) {
+            size_t bin = (size_t)((loudness + 70.0) * 10.0);
+            bin = MIN(bin, WAVE_METER_BINS - 1);
+            ++meter->bin_count[bin];
+            meter->bin_energy[bin] += energy;
+        }
+    }
+}
+
+static void wave_meter_loudness(WaveMeter* meter, size_t n)
+{
+    size_t done = 0;
+    size_t c, i;
+
+    while (done < n) {
+        size_t m = MIN(n - done, meter->segment_frames - meter->segment_pos);
+
+        for (c = 0; c < meter->num_channels; ++c) {
+            WaveMeterChannel  *channel = &meter->channels[c];
+            WAVE_CONST float  *x = wave_meter_plane(meter, c) + done;
+            double             z0 = channel->z[0], z1 = channel->z[1], z2 = channel->z[2], z3 = channel->z[3];
+            double             energy = 0.0;
+
+            if (channel->weight == 0.0) {
+                continue;
+            }
+
+            for (i = 0; i < m; ++i) {
+                double in = x[i];
+                double y1 = meter->shelf_b[0] * in + z0;
+                double y2;
+
+                z0 = meter->shelf_b[1] * in - meter->shelf_a[1] * y1 + z1;
+                z1 = meter->shelf_b[2] * in - meter->shelf_a[2] * y1;
+                y2 = meter->hp_b[0] * y1 + z2;
+                z2 = meter->hp_b[1] * y1 - meter->hp_a[1] * y2 + z3;
+                z3 = meter->hp_b[2] * y1 - meter->hp_a[2] * y2;
+                energy += y2 * y2;
+            }
+
+            channel->z[0] = z0;
+            channel->z[1] = z1;
+            channel->z[2] = z2;
+            channel->z[3] = z3;
+            meter->segment_energy += channel->weight * energy;
+        }
+
+        meter->segment_pos += m;
+        done += m;
+        if (meter->segment_pos == meter->segment_frames) {
+            wave_meter_push_segment(meter);
+        }
+    }
+}
+
+void wave_meter_update(WaveFile* file, WAVE_CONST void* buffer, size_t count)
+{
+    WaveMeter         *meter = file->meter;
+    WAVE_CONST WaveU8 *src = buffer;
+    size_t             c;
+
+    /* the format of a new file may still change before the first frame */
+    if (meter->format_tag != file->format_chunk.body.format_tag || meter->frame_size != wave_get_num_channels(file) * wave_get_sample_size(file) ||
+        meter->num_channels != file->format_chunk.body.num_channels || meter->sample_rate != file->format_chunk.body.sample_rate)
+    {
+        wave_meter_configure(meter, file);
+    }
+    if (meter->channels == NULL || meter->encoding == WAVE_ENCODING_UNSUPPORTED) {
+        return;
+    }
+
+    while (count > 0) {
+        size_t n = MIN(count, WAVE_METER_CHUNK);
+
+        wave_decode_f32(meter->interleaved, src, meter->encoding, n * meter->num_channels);
+        wave_deinterleave(meter->plane_ptrs, (WAVE_CONST WaveU8*)meter->interleaved, meter->num_channels, sizeof(float), n);
+
+        for (c = 0; c < meter->num_channels; ++c) {
+            float *plane = wave_meter_plane(meter, c);
+
+            if (meter->flags & (WAVE_METER_PEAK | WAVE_METER_RMS | WAVE_METER_DC | WAVE_METER_CLIPS)) {
+                wave_analyze_f32(&meter->channels[c].stats, plane, n, meter->clip_level);
+            }
+            if (meter->flags & WAVE_METER_TRUE_PEAK) {
+                wave_meter_true_peak(&meter->channels[c], plane, n);
+            }
+        }
+        if (meter->flags & WAVE_METER_LOUDNESS) {
+            wave_meter_loudness(meter, n);
+        }
+
+        meter->num_frames += n;
+        src += n * meter->frame_size;
+        count -= n;
+    }
+}
+
+void wave_attach_meter(WaveFile* self, WaveU32 flags)
+{
+    wave_meter_destroy(self->meter);
+    self->meter = NULL;
+
+    if (flags != 0) {
+        self->meter = wave_meter_create(self, flags);
+    }
+}
+
+void wave_get_channel_stats(WAVE_CONST WaveFile* self, size_t channel, WaveChannelStats* stats)
+{
+    WAVE_CONST WaveMeter        *meter = self->meter;
+    WAVE_CONST WaveMeterChannel *ch;
+
+    memset(stats, 0, sizeof(WaveChannelStats));
+    if (meter == NULL || meter->channels == NULL) {
+        wave_err_set_literal(WAVE_ERR_MODE, "No meter is attached");
+        return;
+    }
+    if (channel >= meter->num_channels) {
+        wave_err_set(WAVE_ERR_PARAM, "Invalid channel: %zu", channel);
+        return;
+    }
+
+    ch = &meter->channels[channel];
+    stats->peak = ch->stats.peak;
+    stats->true_peak = MAX(ch->true_peak, ch->stats.peak);
+    stats->clips = ch->stats.clips;
+    if (meter->num_frames > 0) {
+        stats->rms = sqrt(ch->stats.sum_sq / (double)meter->num_frames);
+        stats->dc = ch->stats.sum / (double)meter->num_frames;
+    }
+}
+
+/* Loudness of the mean of the last {n} segments, none until there are that many */
+static double wave_meter_window_loudness(WAVE_CONST WaveMeter* meter, size_t n)
+{
+    double energy = 0.0;
+    size_t i;
+
+    if (meter->num_segments < n) {
+        return -HUGE_VAL;
+    }
+    for (i = 0; i < n; ++i) {
+        energy += meter->segments[(meter->num_segments - 1 - i) % WAVE_METER_SEGMENTS];
+    }
+
+    return n > 0 && energy > 0.0 ? -0.691 + 10.0 * log10(energy / (double)n) : -HUGE_VAL;
+}
+
+void wave_get_loudness(WAVE_CONST WaveFile* self, WaveLoudness* loudness)
+{
+    WAVE_CONST WaveMeter *meter = self->meter;
+    double                energy = 0.0;
+    WaveU64               count = 0;
+    size_t                bin, first_bin;
+
+    loudness->integrated = -HUGE_VAL;
+    loudness->short_term = -HUGE_VAL;
+    loudness->momentary = -HUGE_VAL;
+
+    if (meter == NULL || meter->channels == NULL || !(meter->flags & WAVE_METER_LOUDNESS)) {
+        wave_err_set_literal(WAVE_ERR_MODE, "No loudness meter is attached");
+        return;
+    }
+
+    loudness->short_term = wave_meter_window_loudness(meter, WAVE_METER_SEGMENTS);
+    loudness->momentary = wave_meter_window_loudness(meter, WAVE_METER_BLOCK);
+
+    /* the histogram only holds blocks above the absolute gate of -70 LUFS; the relative gate is 10 LU below their mean */
+    for (bin = 0; bin < WAVE_METER_BINS; ++bin) {
+        energy += meter->bin_energy[bin];
+        count += meter->bin_count[bin];
+    }
+    if (count == 0) {
+        return;
+    }
+
+    first_bin = (size_t)MAX((-0.691 + 10.0 * log10(energy / (double)count) - 10.0 + 70.0) * 10.0, 0.0);
+    energy = 0.0;
+    count = 0;
+    for (bin = first_bin; bin < WAVE_METER_BINS; ++bin) {
+        energy += meter->bin_energy[bin];
+        count += meter->bin_count[bin];
+    }
+    if (count > 0) {
+        loudness->integrated = -0.691 + 10.0 * log10(energy / (double)count);
+    }
+}
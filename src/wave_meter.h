@@ -0,0 +1,15 @@
+#ifndef __WAVE_METER_H__
+#define __WAVE_METER_H__
+
+#include "wave.h"
+
+/* Analysis state attached to a WaveFile by {wave_attach_meter} */
+typedef struct _WaveMeter WaveMeter;
+
+WaveMeter* wave_meter_create(WaveFile* file, WaveU32 flags);
+void       wave_meter_destroy(WaveMeter* meter);
+
+/** Feed {count} frames in the sample format of {file}, which passed through {wave_read} or {wave_write} */
+void       wave_meter_update(WaveFile* file, WAVE_CONST void* buffer, size_t count);
+
+#endif /* __WAVE_METER_H__ */
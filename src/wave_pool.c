@@ -0,0 +1,185 @@
+#include "wave_internal.h"
+#include "wave_pool.h"
+#include "wave_thread.h"
+
+struct _WavePool {
+    WaveMutex       mutex;
+    WaveCond        work_cond;
+    WaveCond        done_cond;
+    WaveThread*     threads;
+    size_t          num_threads;
+    WaveBool        stop;
+
+    unsigned long   generation;
+    WavePoolFunc    func;
+    void*           context;
+    size_t          num_tasks;
+    size_t          next_task;
+    size_t          done_tasks;
+
+    WaveErrCode     err_code;
+    char*           err_message;
+};
+
+/* Called with the mutex held, returns with the mutex held */
+static void wave_pool_work(WavePool *pool)
+{
+    while (pool->next_task < pool->num_tasks) {
+        size_t index = pool->next_task++;
+
+        wave_mutex_unlock(&pool->mutex);
+        pool->func(pool->context, index);
+        wave_mutex_lock(&pool->mutex);
+
+        if (g_err.code != WAVE_OK) {
+            if (pool->err_code == WAVE_OK) {
+                pool->err_code = g_err.code;
+                pool->err_message = wave_strdup(g_err.message);
+            }
+            wave_err_clear();
+        }
+
+        if (++pool->done_tasks == pool->num_tasks) {
+            wave_cond_broadcast(&pool->done_cond);
+        }
+    }
+}
+
+static void wave_pool_worker(void *arg)
+{
+    WavePool      *pool = arg;
+    unsigned long  generation = 0;
+
+    wave_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && pool->generation == generation) {
+            wave_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        if (pool->stop) {
+            break;
+        }
+        generation = pool->generation;
+        wave_pool_work(pool);
+    }
+    wave_mutex_unlock(&pool->mutex);
+}
+
+WavePool* wave_pool_create(size_t num_threads)
+{
+    WavePool *pool;
+    size_t    i;
+
+    if (num_threads <= 1) {
+        return NULL;
+    }
+
+    pool = wave_malloc(sizeof(WavePool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(WavePool));
+
+    pool->threads = wave_malloc(sizeof(WaveThread) * (num_threads - 1));
+    if (pool->threads == NULL) {
+        wave_free(pool);
+        return NULL;
+    }
+
+    wave_mutex_init(&pool->mutex);
+    wave_cond_init(&pool->work_cond);
+    wave_cond_init(&pool->done_cond);
+
+    for (i = 0; i < num_threads - 1; ++i) {
+        if (wave_thread_create(&pool->threads[i], wave_pool_worker, pool) != 0) {
+            break;
+        }
+        ++pool->num_threads;
+    }
+
+    return pool;
+}
+
+void wave_pool_destroy(WavePool *pool)
+{
+    size_t i;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    wave_mutex_lock(&pool->mutex);
+    pool->stop = WAVE_TRUE;
+    wave_cond_broadcast(&pool->work_cond);
+    wave_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->num_threads; ++i) {
+        wave_thread_join(pool->threads[i]);
+    }
+
+    wave_cond_destroy(&pool->done_cond);
+    wave_cond_destroy(&pool->work_cond);
+    wave_mutex_destroy(&pool->mutex);
+    wave_free(pool->threads);
+    wave_free(pool);
+}
+
+void wave_pool_run(WavePool *pool, size_t num_tasks, WavePoolFunc func, void *context)
+{
+    size_t i;
+
+    if (pool == NULL || pool->num_threads == 0 || num_tasks <= 1) {
+        WaveErrCode  err_code = WAVE_OK;
+        char        *err_message = NULL;
+
+        /* same semantics as the threads: every task runs and the first error wins */
+        for (i = 0; i < num_tasks; ++i) {
+            func(context, i);
+            if (g_err.code != WAVE_OK) {
+                if (err_code == WAVE_OK) {
+                    err_code = g_err.code;
+                    err_message = wave_strdup(g_err.message);
+                }
+                wave_err_clear();
+            }
+        }
+        if (err_code != WAVE_OK) {
+            wave_err_set(err_code, "%s", err_message);
+            wave_free(err_message);
+        }
+        return;
+    }
+
+    wave_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->context = context;
+    pool->num_tasks = num_tasks;
+    pool->next_task = 0;
+    pool->done_tasks = 0;
+    ++pool->generation;
+    wave_cond_broadcast(&pool->work_cond);
+
+    wave_pool_work(pool);
+    while (pool->done_tasks < pool->num_tasks) {
+        wave_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+
+    if (pool->err_code != WAVE_OK) {
+        wave_err_set(pool->err_code, "%s", pool->err_message);
+        wave_free(pool->err_message);
+        pool->err_code = WAVE_OK;
+        pool->err_message = NULL;
+    }
+    wave_mutex_unlock(&pool->mutex);
+}
+
+size_t wave_cpu_count(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#endif
+}
@@ -0,0 +1,21 @@
+#ifndef __WAVE_POOL_H__
+#define __WAVE_POOL_H__
+
+#include "wave.h"
+
+/* A fixed set of worker threads that run the tasks of one batch in parallel with the calling thread.
+ * Errors raised by tasks on any thread are re-raised on the calling thread when the batch ends. */
+typedef struct _WavePool WavePool;
+
+typedef void (*WavePoolFunc)(void *context, size_t index);
+
+/** Create a pool of {num_threads} threads including the calling thread. Returns NULL for a single thread. */
+WavePool* wave_pool_create(size_t num_threads);
+void      wave_pool_destroy(WavePool *pool);
+
+/** Run {func}({context}, i) for i in [0, {num_tasks}) and wait for all of them. {pool} may be NULL. */
+void      wave_pool_run(WavePool *pool, size_t num_tasks, WavePoolFunc func, void *context);
+
+size_t    wave_cpu_count(void);
+
+#endif /* __WAVE_POOL_H__ */
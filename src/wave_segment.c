@@ -0,0 +1,361 @@
+#include "wave_internal.h"
+#include "wave_thread.h"
+
+typedef struct _WaveSegmentDone {
+    struct _WaveSegmentDone*    next;
+    WaveFile*                   file;
+    size_t                      num_frames;
+} WaveSegmentDone;
+
+struct _WaveSegmentWriter {
+    char*               pattern;
+    WaveSegmentOptions  options;
+    size_t              frames_per_segment;
+    size_t              block_align;
+
+    WaveFile*           current;
+    size_t              current_frames;
+    WaveU32             index;
+
+    /* shared with the background thread, protected by {mutex} */
+    WaveMutex           mutex;
+    WaveCond            cond;
+    WaveThread          thread;
+    WaveBool            has_thread;
+    WaveBool            stop;
+    WaveBool            want_next;
+    WaveU32             next_index;
+    WaveFile*           next;
+    WaveSegmentDone*    done_head;
+    WaveSegmentDone*    done_tail;
+
+    /* error raised on the background thread, re-raised on the writer's thread */
+    WaveErrCode         err_code;
+    char*               err_message;
+};
+
+static WaveFile* wave_segment_create(WaveSegmentWriter *self, WaveU32 index)
+{
+    char     *filename;
+    WaveFile *file;
+
+    if (wave_asprintf(&filename, self->pattern, index) < 0) {
+        wave_err_set_literal(WAVE_ERR_PARAM, "Invalid segment file name pattern");
+        return NULL;
+    }
+
+    file = wave_open(filename, WAVE_OPEN_WRITE);
+    wave_free(filename);
+    if (file == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a segment");
+        return NULL;
+    }
+
+    if (g_err.code == WAVE_OK && self->options.format != 0) {
+        wave_set_format(file, self->options.format);
+    }
+    if (g_err.code == WAVE_OK && self->options.num_channels != 0) {
+        wave_set_num_channels(file, self->options.num_channels);
+    }
+    if (g_err.code == WAVE_OK && self->options.sample_rate != 0) {
+        wave_set_sample_rate(file, self->options.sample_rate);
+    }
+    if (g_err.code == WAVE_OK && self->options.sample_size != 0) {
+        wave_set_sample_size(file, self->options.sample_size);
+    }
+
+    if (g_err.code != WAVE_OK) {
+        wave_close(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+static void wave_segment_discard(WaveFile *file)
+{
+    char *filename = wave_strdup(file->filename);
+    wave_close(file);
+    remove(filename);
+    wave_free(filename);
+}
+
+static void wave_segment_finish(WaveSegmentWriter *self, WaveSegmentDone *done)
+{
+    char *filename = wave_strdup(done->file->filename);
+
+    /* a segment whose close failed is not reported as written */
+    wave_close(done->file);
+    if (self->options.on_segment != NULL && g_err.code == WAVE_OK) {
+        self->options.on_segment(self->options.context, filename, done->num_frames);
+    }
+
+    wave_free(filename);
+    wave_free(done);
+}
+
+/* Move the error of the background thread into {self}, where the first one is kept for the writer's thread. Called with
+ * {mutex} held, or on the writer's thread when there is no background thread. */
+static void wave_segment_keep_error(WaveSegmentWriter *self)
+{
+    if (g_err.code == WAVE_OK) {
+        return;
+    }
+    if (self->err_code == WAVE_OK) {
+        self->err_code = g_err.code;
+        self->err_message = wave_strdup(g_err.message);
+    }
+    wave_err_clear();
+}
+
+/* Re-raise the error kept by {wave_segment_keep_error} on the writer's thread, under the same conditions */
+static void wave_segment_raise_error(WaveSegmentWriter *self)
+{
+    if (self->err_code == WAVE_OK) {
+        return;
+    }
+    if (g_err.code == WAVE_OK) {
+        wave_err_set(self->err_code, "%s", self->err_message);
+    }
+    wave_free(self->err_message);
+    self->err_message = NULL;
+    self->err_code = WAVE_OK;
+}
+
+static void wave_segment_worker(void *arg)
+{
+    WaveSegmentWriter *self = arg;
+
+    wave_mutex_lock(&self->mutex);
+    for (;;) {
+        if (self->done_head != NULL) {
+            WaveSegmentDone *done = self->done_head;
+            self->done_head = done->next;
+            if (self->done_head == NULL) {
+                self->done_tail = NULL;
+            }
+            wave_mutex_unlock(&self->mutex);
+            wave_segment_finish(self, done);
+            wave_mutex_lock(&self->mutex);
+            wave_segment_keep_error(self);
+        } else if (self->want_next && !self->stop) {
+            WaveU32   index = self->next_index;
+            WaveFile *next;
+
+            wave_mutex_unlock(&self->mutex);
+            next = wave_segment_create(self, index);
+            wave_mutex_lock(&self->mutex);
+
+            wave_segment_keep_error(self);
+            self->next = next;
+            self->want_next = WAVE_FALSE;
+            wave_cond_broadcast(&self->cond);
+        } else if (self->stop) {
+            break;
+        } else {
+            wave_cond_wait(&self->cond, &self->mutex);
+        }
+    }
+    wave_mutex_unlock(&self->mutex);
+}
+
+static void wave_segment_switch(WaveSegmentWriter *self)
+{
+    WaveSegmentDone *done;
+    WaveFile        *next;
+
+    done = wave_malloc(sizeof(WaveSegmentDone));
+    if (done == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a segment");
+        return;
+    }
+    done->next = NULL;
+    done->file = self->current;
+    done->num_frames = self->current_frames;
+    self->current = NULL;
+    self->current_frames = 0;
+
+    if (!self->has_thread) {
+        /* the next segment is opened even if the last one failed to close */
+        wave_segment_finish(self, done);
+        wave_segment_keep_error(self);
+        next = wave_segment_create(self, self->index + 1);
+        wave_segment_keep_error(self);
+        if (next != NULL) {
+            self->current = next;
+            ++self->index;
+        }
+        wave_segment_raise_error(self);
+        return;
+    }
+
+    wave_mutex_lock(&self->mutex);
+    while (self->want_next) {
+        wave_cond_wait(&self->cond, &self->mutex);
+    }
+    next = self->next;
+    self->next = NULL;
+
+    if (self->done_tail != NULL) {
+        self->done_tail->next = done;
+    } else {
+        self->done_head = done;
+    }
+    self->done_tail = done;
+
+    if (next != NULL) {
+        ++self->index;
+        self->next_index = self->index + 1;
+        self->want_next = WAVE_TRUE;
+    }
+    wave_segment_raise_error(self);
+    wave_cond_broadcast(&self->cond);
+    wave_mutex_unlock(&self->mutex);
+
+    self->current = next;
+}
+
+WaveSegmentWriter* wave_segment_open(WAVE_CONST char *pattern, WAVE_CONST WaveSegmentOptions *options)
+{
+    WaveSegmentWriter *self = wave_malloc(sizeof(WaveSegmentWriter));
+    if (self == NULL) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(WaveSegmentWriter));
+    self->pattern = wave_strdup(pattern);
+    self->options = *options;
+    wave_mutex_init(&self->mutex);
+    wave_cond_init(&self->cond);
+
+    self->current = wave_segment_create(self, 0);
+    if (self->current == NULL) {
+        return self;
+    }
+
+    self->block_align = self->current->format_chunk.body.block_align;
+    self->frames_per_segment = options->max_frames;
+    if (options->max_bytes != 0) {
+        size_t max_frames = options->max_bytes / self->block_align;
+        if (max_frames == 0) {
+            wave_err_set(WAVE_ERR_PARAM, "Segment size limit is smaller than one frame: %zu", options->max_bytes);
+            return self;
+        }
+        if (self->frames_per_segment == 0 || max_frames < self->frames_per_segment) {
+            self->frames_per_segment = max_frames;
+        }
+    }
+
+    /* without a background thread, segments are still written, just switched synchronously */
+    if (wave_thread_create(&self->thread, wave_segment_worker, self) == 0) {
+        self->has_thread = WAVE_TRUE;
+        wave_mutex_lock(&self->mutex);
+        self->next_index = 1;
+        self->want_next = WAVE_TRUE;
+        wave_cond_broadcast(&self->cond);
+        wave_mutex_unlock(&self->mutex);
+    }
+
+    return self;
+}
+
+void wave_segment_close(WaveSegmentWriter *self)
+{
+    WaveSegmentDone *done = NULL;
+
+    if (self->current != NULL && self->current_frames > 0) {
+        done = wave_malloc(sizeof(WaveSegmentDone));
+    }
+
+    if (done != NULL) {
+        done->next = NULL;
+        done->file = self->current;
+        done->num_frames = self->current_frames;
+    } else if (self->current != NULL && self->current_frames > 0) {
+        wave_close(self->current);
+    } else if (self->current != NULL) {
+        wave_segment_discard(self->current);
+    }
+    self->current = NULL;
+
+    if (self->has_thread) {
+        /* hand the last segment to the background thread so that callbacks stay in order */
+        wave_mutex_lock(&self->mutex);
+        if (done != NULL) {
+            if (self->done_tail != NULL) {
+                self->done_tail->next = done;
+            } else {
+                self->done_head = done;
+            }
+            self->done_tail = done;
+        }
+        self->stop = WAVE_TRUE;
+        wave_cond_broadcast(&self->cond);
+        wave_mutex_unlock(&self->mutex);
+        wave_thread_join(self->thread);
+    } else if (done != NULL) {
+        wave_segment_finish(self, done);
+    }
+    wave_segment_keep_error(self);
+    wave_segment_raise_error(self);
+
+    if (self->next != NULL) {
+        wave_segment_discard(self->next);
+    }
+
+    wave_cond_destroy(&self->cond);
+    wave_mutex_destroy(&self->mutex);
+    wave_free(self->err_message);
+    wave_free(self->pattern);
+    wave_free(self);
+}
+
+size_t wave_segment_write(WaveSegmentWriter *self, WAVE_CONST void *buffer, size_t count)
+{
+    WAVE_CONST WaveU8 *p = buffer;
+    size_t written = 0;
+
+    while (written < count) {
+        size_t n = count - written;
+        size_t write_count;
+
+        if (self->current == NULL) {
+            wave_err_set_literal(WAVE_ERR_MODE, "No segment is open");
+            break;
+        }
+
+        if (self->frames_per_segment != 0) {
+            n = MIN(n, self->frames_per_segment - self->current_frames);
+        }
+
+        write_count = wave_write(self->current, p + written * self->block_align, n);
+        written += write_count;
+        self->current_frames += write_count;
+        if (write_count < n) {
+            break;
+        }
+
+        if (self->frames_per_segment != 0 && self->current_frames == self->frames_per_segment) {
+            wave_segment_switch(self);
+            if (g_err.code != WAVE_OK) {
+                break;
+            }
+        }
+    }
+
+    return written;
+}
+
+void wave_segment_split(WaveSegmentWriter *self)
+{
+    if (self->current == NULL || self->current_frames == 0) {
+        return;
+    }
+
+    wave_segment_switch(self);
+}
+
+WaveU32 wave_segment_get_index(WAVE_CONST WaveSegmentWriter *self)
+{
+    return self->index;
+}
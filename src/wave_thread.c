@@ -0,0 +1,111 @@
+#include "wave_internal.h"
+#include "wave_thread.h"
+
+typedef struct {
+    WaveThreadFunc  func;
+    void*           arg;
+} WaveThreadStart;
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static DWORD WINAPI wave_thread_entry(LPVOID p)
+{
+    WaveThreadStart start = *(WaveThreadStart*)p;
+    wave_free(p);
+    start.func(start.arg);
+    return 0;
+}
+
+int wave_thread_create(WaveThread *thread, WaveThreadFunc func, void *arg)
+{
+    WaveThreadStart *start = wave_malloc(sizeof(WaveThreadStart));
+    if (start == NULL) {
+        return -1;
+    }
+    start->func = func;
+    start->arg = arg;
+    *thread = CreateThread(NULL, 0, wave_thread_entry, start, 0, NULL);
+    if (*thread == NULL) {
+        wave_free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void wave_thread_join(WaveThread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+void wave_mutex_init(WaveMutex *mutex)    { InitializeSRWLock(mutex); }
+void wave_mutex_destroy(WaveMutex *mutex) { (void)mutex; }
+void wave_mutex_lock(WaveMutex *mutex)    { AcquireSRWLockExclusive(mutex); }
+void wave_mutex_unlock(WaveMutex *mutex)  { ReleaseSRWLockExclusive(mutex); }
+
+void wave_cond_init(WaveCond *cond)                       { InitializeConditionVariable(cond); }
+void wave_cond_destroy(WaveCond *cond)                    { (void)cond; }
+void wave_cond_wait(WaveCond *cond, WaveMutex *mutex)     { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+void wave_cond_signal(WaveCond *cond)                     { WakeConditionVariable(cond); }
+void wave_cond_broadcast(WaveCond *cond)                  { WakeAllConditionVariable(cond); }
+
+static BOOL CALLBACK wave_once_entry(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void)once;
+    (void)context;
+    (*(WaveOnceFunc*)param)();
+    return TRUE;
+}
+
+void wave_once(WaveOnce *once, WaveOnceFunc func)
+{
+    InitOnceExecuteOnce(once, wave_once_entry, &func, NULL);
+}
+
+#else
+
+static void* wave_thread_entry(void *p)
+{
+    WaveThreadStart start = *(WaveThreadStart*)p;
+    wave_free(p);
+    start.func(start.arg);
+    return NULL;
+}
+
+int wave_thread_create(WaveThread *thread, WaveThreadFunc func, void *arg)
+{
+    WaveThreadStart *start = wave_malloc(sizeof(WaveThreadStart));
+    if (start == NULL) {
+        return -1;
+    }
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, wave_thread_entry, start) != 0) {
+        wave_free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void wave_thread_join(WaveThread thread)
+{
+    pthread_join(thread, NULL);
+}
+
+void wave_mutex_init(WaveMutex *mutex)    { pthread_mutex_init(mutex, NULL); }
+void wave_mutex_destroy(WaveMutex *mutex) { pthread_mutex_destroy(mutex); }
+void wave_mutex_lock(WaveMutex *mutex)    { pthread_mutex_lock(mutex); }
+void wave_mutex_unlock(WaveMutex *mutex)  { pthread_mutex_unlock(mutex); }
+
+void wave_cond_init(WaveCond *cond)                       { pthread_cond_init(cond, NULL); }
+void wave_cond_destroy(WaveCond *cond)                    { pthread_cond_destroy(cond); }
+void wave_cond_wait(WaveCond *cond, WaveMutex *mutex)     { pthread_cond_wait(cond, mutex); }
+void wave_cond_signal(WaveCond *cond)                     { pthread_cond_signal(cond); }
+void wave_cond_broadcast(WaveCond *cond)                  { pthread_cond_broadcast(cond); }
+
+void wave_once(WaveOnce *once, WaveOnceFunc func)
+{
+    pthread_once(once, func);
+}
+
+#endif
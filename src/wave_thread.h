@@ -0,0 +1,43 @@
+#ifndef __WAVE_THREAD_H__
+#define __WAVE_THREAD_H__
+
+#include "wave.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+typedef HANDLE              WaveThread;
+typedef SRWLOCK             WaveMutex;
+typedef CONDITION_VARIABLE  WaveCond;
+typedef INIT_ONCE           WaveOnce;
+#define WAVE_ONCE_INIT      INIT_ONCE_STATIC_INIT
+#else
+#include <pthread.h>
+typedef pthread_t           WaveThread;
+typedef pthread_mutex_t     WaveMutex;
+typedef pthread_cond_t      WaveCond;
+typedef pthread_once_t      WaveOnce;
+#define WAVE_ONCE_INIT      PTHREAD_ONCE_INIT
+#endif
+
+typedef void (*WaveThreadFunc)(void *arg);
+typedef void (*WaveOnceFunc)(void);
+
+/** Start a thread running {func}. Returns 0 on success. */
+int  wave_thread_create(WaveThread *thread, WaveThreadFunc func, void *arg);
+void wave_thread_join(WaveThread thread);
+
+void wave_mutex_init(WaveMutex *mutex);
+void wave_mutex_destroy(WaveMutex *mutex);
+void wave_mutex_lock(WaveMutex *mutex);
+void wave_mutex_unlock(WaveMutex *mutex);
+
+void wave_cond_init(WaveCond *cond);
+void wave_cond_destroy(WaveCond *cond);
+void wave_cond_wait(WaveCond *cond, WaveMutex *mutex);
+void wave_cond_signal(WaveCond *cond);
+void wave_cond_broadcast(WaveCond *cond);
+
+/** Run {func} exactly once for {once}, however many threads get here at the same time */
+void wave_once(WaveOnce *once, WaveOnceFunc func);
+
+#endif /* __WAVE_THREAD_H__ */
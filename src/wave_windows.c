@@ -0,0 +1,236 @@
+#include "wave_internal.h"
+#include "wave_kernels.h"
+#include "wave_pool.h"
+
+/* never merge windows into a single read larger than this */
+#define WAVE_WINDOWS_MAX_RUN    ((size_t)16 << 20)
+
+typedef struct {
+    WAVE_CONST WaveWindow*  window;
+    size_t                  index;
+} WaveWindowRef;
+
+typedef struct {
+    WAVE_CONST WaveWindowOptions*   options;
+    WaveWindowRef*                  refs;
+    size_t*                         groups;     /* first ref of every file, plus the end */
+    float*                          out;
+    size_t                          num_channels;
+    size_t                          window_frames;
+    WaveBool*                       done;
+} WaveWindowBatch;
+
+static int wave_window_ref_cmp(WAVE_CONST void *a, WAVE_CONST void *b)
+{
+    WAVE_CONST WaveWindowRef *ra = a;
+    WAVE_CONST WaveWindowRef *rb = b;
+    int c = strcmp(ra->window->filename, rb->window->filename);
+
+    if (c != 0) {
+        return c;
+    }
+    if (ra->window->first_frame != rb->window->first_frame) {
+        return ra->window->first_frame < rb->window->first_frame ? -1 : 1;
+    }
+    return ra->index < rb->index ? -1 : ra->index > rb->index ? 1 : 0;
+}
+
+/* Read frames [first, first + count) of {file} as raw bytes */
+static size_t wave_windows_read_run(WaveFile* file, WaveU8* buffer, size_t first, size_t count)
+{
+    size_t block_align = file->format_chunk.body.block_align;
+
+    if (file->cache != NULL) {
+        wave_seek(file, (long)first, SEEK_SET);
+        return g_err.code == WAVE_OK ? wave_read(file, buffer, count) : 0;
+    }
+
+    return wave_read_at(file, buffer, count * block_align, file->data_chunk.offset + (WaveU64)first * block_align) / block_align;
+}
+
+/* Serve all windows of one file, merging the ones that are close enough into one read */
+static void wave_windows_read_file(void *context, size_t index)
+{
+    WaveWindowBatch               *batch = context;
+    WAVE_CONST WaveWindowOptions  *options = batch->options;
+    WaveWindowRef                 *refs = batch->refs + batch->groups[index];
+    size_t                         num_refs = batch->groups[index + 1] - batch->groups[index];
+    WAVE_CONST char               *filename = refs[0].window->filename;
+    WaveFile                      *file;
+    WaveEncoding                   encoding;
+    unsigned                       padding_bits;
+    WaveU8                        *buffer = NULL;
+    size_t                         buffer_size = 0;
+    size_t                         block_align, length, i, j;
+
+    file = options->cache != NULL ? wave_open_cached(filename, options->cache) : wave_open(filename, WAVE_OPEN_READ);
+    if (file == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+        return;
+    }
+    if (g_err.code != WAVE_OK) {
+        wave_close(file);
+        return;
+    }
+
+    encoding = wave_get_encoding(file);
+    padding_bits = wave_get_padding_bits(file);
+    block_align = file->format_chunk.body.block_align;
+    length = wave_get_length(file);
+    if (encoding == WAVE_ENCODING_UNSUPPORTED) {
+        wave_err_set(WAVE_ERR_FORMAT, "Sample format of %s cannot be converted to float", filename);
+    } else if (wave_get_num_channels(file) != batch->num_channels) {
+        wave_err_set(WAVE_ERR_FORMAT, "%s has %u channels instead of %zu", filename, wave_get_num_channels(file), batch->num_channels);
+    }
+
+    for (i = 0; i < num_refs && g_err.code == WAVE_OK; i = j) {
+        size_t first = MIN(refs[i].window->first_frame, length);
+        size_t end = MIN(first + refs[i].window->num_frames, length);
+        size_t max_frames = MAX(WAVE_WINDOWS_MAX_RUN / block_align, 1);
+        size_t got;
+
+        /* extend the run while the next window starts within the gap and the run stays bounded */
+        for (j = i + 1; j < num_refs; ++j) {
+            size_t next_first = MIN(refs[j].window->first_frame, length);
+            size_t next_end = MIN(next_first + refs[j].window->num_frames, length);
+            if (next_first > end + options->merge_gap || MAX(end, next_end) - first > max_frames) {
+                break;
+            }
+            end = MAX(end, next_end);
+        }
+
+        if (buffer_size < (end - first) * block_align) {
+            WaveU8 *p = wave_realloc(buffer, (end - first) * block_align);
+            if (p == NULL) {
+                wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate the window buffer");
+                break;
+            }
+            buffer = p;
+            buffer_size = (end - first) * block_align;
+        }
+
+        got = end > first ? wave_windows_read_run(file, buffer, first, end - first) : 0;
+        if (padding_bits > 0) {
+            wave_clear_padding_bits(buffer, block_align / batch->num_channels, got * batch->num_channels, padding_bits);
+        }
+        if (g_err.code == WAVE_OK && got < end - first) {
+            wave_err_set(WAVE_ERR_FORMAT, "Unexpected EOF in %s", filename);
+        }
+        if (g_err.code != WAVE_OK) {
+            break;
+        }
+
+        for (; i < j; ++i) {
+            WAVE_CONST WaveWindow *window = refs[i].window;
+            float  *dst = batch->out + refs[i].index * batch->window_frames * batch->num_channels;
+            size_t  want = MIN(window->num_frames, batch->window_frames);
+            size_t  avail = window->first_frame < length ? MIN(want, length - window->first_frame) : 0;
+
+            if (avail < want && !options->pad_past_end) {
+                wave_err_set(WAVE_ERR_PARAM, "Window at frame %zu exceeds the length of %s", window->first_frame, filename);
+                break;
+            }
+
+            if (avail > 0) {
+                wave_decode_f32(dst, buffer + (window->first_frame - first) * block_align, encoding, avail * batch->num_channels);
+            }
+            memset(dst + avail * batch->num_channels, 0, (batch->window_frames - avail) * batch->num_channels * sizeof(float));
+            if (options->frames_read != NULL) {
+                options->frames_read[refs[i].index] = avail;
+            }
+            batch->done[refs[i].index] = WAVE_TRUE;
+        }
+    }
+
+    wave_free(buffer);
+    wave_close(file);
+}
+
+size_t wave_read_windows(WAVE_CONST WaveWindow* requests, size_t n, float* out, WAVE_CONST WaveWindowOptions* options)
+{
+    WaveWindowOptions  defaults;
+    WaveWindowBatch    batch;
+    WavePool          *pool;
+    size_t             num_groups = 0;
+    size_t             num_done = 0;
+    size_t             i;
+
+    if (n == 0) {
+        return 0;
+    }
+    if (options == NULL) {
+        memset(&defaults, 0, sizeof(defaults));
+        options = &defaults;
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    batch.options = options;
+    batch.out = out;
+    batch.num_channels = options->num_channels;
+    batch.window_frames = options->window_frames;
+    if (batch.window_frames == 0) {
+        for (i = 0; i < n; ++i) {
+            batch.window_frames = MAX(batch.window_frames, requests[i].num_frames);
+        }
+    }
+
+    if (batch.num_channels == 0) {
+        WaveFile *file = wave_open(requests[0].filename, WAVE_OPEN_READ);
+        if (file == NULL) {
+            wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for a WaveFile");
+            return 0;
+        }
+        batch.num_channels = wave_get_num_channels(file);
+        wave_close(file);
+        if (g_err.code != WAVE_OK) {
+            return 0;
+        }
+    }
+
+    batch.refs = wave_malloc(sizeof(WaveWindowRef) * n);
+    batch.groups = wave_malloc(sizeof(size_t) * (n + 1));
+    batch.done = wave_malloc(sizeof(WaveBool) * n);
+    if (batch.refs == NULL || batch.groups == NULL || batch.done == NULL) {
+        wave_err_set_literal(WAVE_ERR_OS, "Failed to allocate memory for the windows");
+        wave_free(batch.done);
+        wave_free(batch.groups);
+        wave_free(batch.refs);
+        return 0;
+    }
+
+    for (i = 0; i < n; ++i) {
+        batch.refs[i].window = &requests[i];
+        batch.refs[i].index = i;
+        batch.done[i] = WAVE_FALSE;
+    }
+    qsort(batch.refs, n, sizeof(WaveWindowRef), wave_window_ref_cmp);
+
+    for (i = 0; i < n; ++i) {
+        if (i == 0 || strcmp(batch.refs[i].window->filename, batch.refs[i - 1].window->filename) != 0) {
+            batch.groups[num_groups++] = i;
+        }
+    }
+    batch.groups[num_groups] = n;
+
+    pool = wave_pool_create(MIN(num_groups, options->num_threads != 0 ? options->num_threads : wave_cpu_count()));
+    wave_pool_run(pool, num_groups, wave_windows_read_file, &batch);
+    wave_pool_destroy(pool);
+
+    /* windows that failed are zeros, never left-over data */
+    for (i = 0; i < n; ++i) {
+        if (batch.done[i]) {
+            ++num_done;
+        } else {
+            memset(out + i * batch.window_frames * batch.num_channels, 0, batch.window_frames * batch.num_channels * sizeof(float));
+            if (options->frames_read != NULL) {
+                options->frames_read[i] = 0;
+            }
+        }
+    }
+
+    wave_free(batch.done);
+    wave_free(batch.groups);
+    wave_free(batch.refs);
+
+    return num_done;
+}
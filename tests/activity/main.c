@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define SAMPLE_RATE     48000
+#define NUM_FRAMES      (SAMPLE_RATE * 10)
+
+static short pcm[NUM_FRAMES * 2];
+static short regions_pcm[NUM_FRAMES * 2];
+
+/* frames that carry a tone, the 50 ms gap between the first two is shorter than the minimum silence */
+static const size_t bursts[][2] = {{48000, 96000}, {98400, 144000}, {288000, 312000}};
+static const size_t expected[][2] = {{48000, 96000}, {288000, 24000}};
+
+static int check(WaveFile *fp, size_t num_threads)
+{
+    WaveRegion *regions;
+    size_t num_regions, i, total = 0;
+
+    num_regions = wave_scan_activity(fp, 0.01f, 0.2, &regions, num_threads);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "%s\n", wave_err()->message);
+        return 1;
+    }
+    if (num_regions != 2) {
+        fprintf(stderr, "%zu regions with %zu threads\n", num_regions, num_threads);
+        return 1;
+    }
+    for (i = 0; i < num_regions; ++i) {
+        if (regions[i].first_frame != expected[i][0] || regions[i].num_frames != expected[i][1]) {
+            fprintf(stderr, "region %zu: %zu+%zu\n", i, regions[i].first_frame, regions[i].num_frames);
+            return 1;
+        }
+        total += regions[i].num_frames;
+    }
+
+    if (wave_read_regions(fp, regions, num_regions, regions_pcm) != total) {
+        fprintf(stderr, "short read of the regions\n");
+        return 1;
+    }
+    if (memcmp(regions_pcm, pcm + expected[0][0] * 2, expected[0][1] * 4) != 0 ||
+        memcmp(regions_pcm + expected[0][1] * 2, pcm + expected[1][0] * 2, expected[1][1] * 4) != 0)
+    {
+        fprintf(stderr, "wrong frames in the regions\n");
+        return 1;
+    }
+
+    wave_free_regions(regions);
+    return 0;
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    size_t i, b;
+
+    srand(1);
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        pcm[i] = (short)(rand() % 21 - 10);
+    }
+    for (b = 0; b < sizeof(bursts) / sizeof(bursts[0]); ++b) {
+        for (i = bursts[b][0]; i < bursts[b][1]; ++i) {
+            pcm[i * 2] = (short)((i / 24) % 2 ? 8000 : -8000);
+            pcm[i * 2 + 1] = pcm[i * 2];
+        }
+    }
+
+    fp = wave_open("activity.wav", WAVE_OPEN_WRITE);
+    wave_set_sample_rate(fp, SAMPLE_RATE);
+    wave_write(fp, pcm, NUM_FRAMES);
+    wave_close(fp);
+
+    fp = wave_open("activity.wav", WAVE_OPEN_READ);
+    if (check(fp, 1) != 0 || check(fp, 4) != 0) {
+        return 1;
+    }
+    wave_close(fp);
+
+    return wave_err()->code != WAVE_OK;
+}
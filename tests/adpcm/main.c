@@ -0,0 +1,200 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES  300001
+
+static short original[NUM_FRAMES * 2];
+static short decoded[NUM_FRAMES * 2];
+static short chunked[NUM_FRAMES * 2];
+static float floats[NUM_FRAMES * 2];
+
+static int check_format(WaveU16 format, WaveU16 num_channels, WaveU32 sample_rate)
+{
+    WaveFile *fp;
+    double signal = 0.0, noise = 0.0;
+    size_t i, n, done;
+
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        double t = (double)i / sample_rate;
+        original[i * num_channels] = (short)(12000.0 * sin(2.0 * 3.14159265358979323846 * 440.0 * t));
+        if (num_channels == 2) {
+            original[i * 2 + 1] = (short)(8000.0 * sin(2.0 * 3.14159265358979323846 * (200.0 + 50.0 * t) * t));
+        }
+    }
+
+    fp = wave_open("adpcm.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, num_channels);
+    wave_set_sample_rate(fp, sample_rate);
+    wave_set_format(fp, format);
+    for (done = 0; done < NUM_FRAMES; done += n) {
+        n = NUM_FRAMES - done < 5000 ? NUM_FRAMES - done : 5000;
+        if (wave_write(fp, original + done * num_channels, n) != n) {
+            fprintf(stderr, "write: %s\n", wave_err()->message);
+            return 1;
+        }
+    }
+    wave_close(fp);
+
+    /* one read of whole blocks */
+    fp = wave_open("adpcm.wav", WAVE_OPEN_READ);
+    if (wave_err()->code != WAVE_OK || wave_get_format(fp) != format || wave_get_length(fp) != NUM_FRAMES) {
+        fprintf(stderr, "format %#x: %s, length %zu\n", format, wave_err()->message, wave_get_length(fp));
+        return 1;
+    }
+    if (wave_read(fp, decoded, NUM_FRAMES + 10) != NUM_FRAMES || !wave_eof(fp)) {
+        fprintf(stderr, "format %#x: short read\n", format);
+        return 1;
+    }
+    for (i = 0; i < NUM_FRAMES * num_channels; ++i) {
+        double e = (double)decoded[i] - original[i];
+        signal += (double)original[i] * original[i];
+        noise += e * e;
+    }
+    if (10.0 * log10(signal / noise) < 20.0) {
+        fprintf(stderr, "format %#x, %u channels: SNR %f dB\n", format, num_channels, 10.0 * log10(signal / noise));
+        return 1;
+    }
+
+    /* reads that start and end within blocks give the same frames */
+    wave_rewind(fp);
+    for (done = 0; done < NUM_FRAMES; done += n) {
+        n = wave_read(fp, chunked + done * num_channels, 777);
+        if (n == 0) {
+            break;
+        }
+    }
+    if (done != NUM_FRAMES || memcmp(chunked, decoded, NUM_FRAMES * num_channels * sizeof(short)) != 0) {
+        fprintf(stderr, "format %#x: chunked read differs\n", format);
+        return 1;
+    }
+
+    srand(format);
+    for (i = 0; i < 100; ++i) {
+        size_t frame = (size_t)rand() % NUM_FRAMES;
+        wave_seek(fp, (long)frame, SEEK_SET);
+        n = wave_read(fp, chunked, 50);
+        if (wave_tell(fp) != (long)(frame + n) || memcmp(chunked, decoded + frame * num_channels, n * num_channels * sizeof(short)) != 0) {
+            fprintf(stderr, "format %#x: read at %zu differs\n", format, frame);
+            return 1;
+        }
+    }
+
+    wave_rewind(fp);
+    if (wave_read_float(fp, floats, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "format %#x: short float read\n", format);
+        return 1;
+    }
+    for (i = 0; i < NUM_FRAMES * num_channels; ++i) {
+        if (floats[i] != (float)decoded[i] / 32768.0f) {
+            fprintf(stderr, "format %#x: float sample %zu differs\n", format, i);
+            return 1;
+        }
+    }
+    wave_close(fp);
+
+    return wave_err()->code != WAVE_OK;
+}
+
+static unsigned char* put16(unsigned char* p, int x)
+{
+    p[0] = (unsigned char)(x & 0xff);
+    p[1] = (unsigned char)((x >> 8) & 0xff);
+    return p + 2;
+}
+
+static unsigned char* put32(unsigned char* p, unsigned long x)
+{
+    return put16(put16(p, (int)(x & 0xffff)), (int)(x >> 16));
+}
+
+/* Write a Microsoft ADPCM file of two mono blocks of 11 bytes, with the 7 standard coefficient pairs and {extra} pairs of
+ * (128, 64) after them. Block 0 uses {predictor}, block 1 the first standard pair. */
+static void write_ms_file(const char* filename, int extra, int predictor)
+{
+    static const int coefs[7][2] = {{256, 0}, {512, -256}, {0, 0}, {192, 64}, {240, 0}, {460, -208}, {392, -232}};
+    static const unsigned char nibbles[2][4] = {{0x12, 0x34, 0x07, 0x8f}, {0x77, 0x77, 0x99, 0x00}};
+    unsigned char buffer[256], *p = buffer;
+    int i, num_coefs = 7 + extra;
+    FILE *out;
+
+    memcpy(p, "RIFF", 4);
+    p = put32(p + 4, (unsigned long)(4 + 8 + 22 + 4 * num_coefs + 12 + 8 + 22));
+    memcpy(p, "WAVEfmt ", 8);
+    p = put32(p + 8, (unsigned long)(22 + 4 * num_coefs));
+    p = put16(put16(p, 2), 1);
+    p = put32(put32(p, 8000), 8800);
+    p = put16(put16(p, 11), 4);
+    p = put16(put16(put16(p, 4 + 4 * num_coefs), 10), num_coefs);
+    for (i = 0; i < num_coefs; ++i) {
+        p = put16(put16(p, i < 7 ? coefs[i][0] : 128), i < 7 ? coefs[i][1] : 64);
+    }
+    memcpy(p, "fact", 4);
+    p = put32(put32(p + 4, 4), 20);
+    memcpy(p, "data", 4);
+    p = put32(p + 4, 22);
+
+    /* predictor, delta, the second and the first sample, then the nibbles */
+    *p++ = (unsigned char)predictor;
+    p = put16(put16(put16(p, 32), 1000), 2000);
+    memcpy(p, nibbles[0], 4);
+    p += 4;
+    *p++ = 0;
+    p = put16(put16(put16(p, 16), -500), -400);
+    memcpy(p, nibbles[1], 4);
+    p += 4;
+
+    out = fopen(filename, "wb");
+    fwrite(buffer, 1, (size_t)(p - buffer), out);
+    fclose(out);
+}
+
+/* Decode blocks that were worked out by hand from the Microsoft ADPCM algorithm, one of them with a predictor from an
+ * extended coefficient table */
+static int check_ms_blocks(void)
+{
+    static const short expected[20] = {
+        2000, 1000, 1032, 822, 744, 665, 518, 586, -18, -28,
+        -400, -500, -388, -122, 515, 2041, -1613, -10370, -10370, -10370
+    };
+    short frames[20];
+    WaveFile *fp;
+
+    write_ms_file("adpcm-ms.wav", 1, 7);
+    fp = wave_open("adpcm-ms.wav", WAVE_OPEN_READ);
+    if (wave_get_length(fp) != 20 || wave_read(fp, frames, 20) != 20 || memcmp(frames, expected, sizeof(expected)) != 0 ||
+        wave_err()->code != WAVE_OK)
+    {
+        fprintf(stderr, "hand-made blocks: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    /* a predictor past the end of the table */
+    write_ms_file("adpcm-ms.wav", 0, 7);
+    fp = wave_open("adpcm-ms.wav", WAVE_OPEN_READ);
+    if (wave_read(fp, frames, 20) != 0 || wave_err()->code != WAVE_ERR_FORMAT) {
+        fprintf(stderr, "predictor 7 of 7 coefficients: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+
+    return 0;
+}
+
+int main(void)
+{
+    if (check_ms_blocks() != 0) {
+        return 1;
+    }
+    if (check_format(WAVE_FORMAT_IMA_ADPCM, 1, 22050) != 0 || check_format(WAVE_FORMAT_IMA_ADPCM, 2, 44100) != 0 ||
+        check_format(WAVE_FORMAT_ADPCM, 1, 8000) != 0 || check_format(WAVE_FORMAT_ADPCM, 2, 44100) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
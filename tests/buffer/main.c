@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_CHANNELS    2
+#define NUM_FRAMES      7000
+#define STEP_FRAMES     7
+#define DATA_SIZE_AT    40
+
+static short samples[NUM_FRAMES * NUM_CHANNELS];
+static short decoded[NUM_FRAMES * NUM_CHANNELS];
+
+/* The data size that another handle sees in the header on disk */
+static unsigned long data_size_on_disk(const char* filename)
+{
+    unsigned char size[4] = {0};
+    FILE *in = fopen(filename, "rb");
+
+    fseek(in, DATA_SIZE_AT, SEEK_SET);
+    if (fread(size, 4, 1, in) != 1) {
+        size[0] = size[1] = size[2] = size[3] = 0xff;
+    }
+    fclose(in);
+    return size[0] | (size[1] << 8) | ((unsigned long)size[2] << 16) | ((unsigned long)size[3] << 24);
+}
+
+static int write_steps(WaveFile* fp, size_t first, size_t last)
+{
+    size_t pos;
+
+    for (pos = first; pos < last; pos += STEP_FRAMES) {
+        if (wave_write(fp, samples + pos * NUM_CHANNELS, STEP_FRAMES) != STEP_FRAMES) {
+            fprintf(stderr, "write at %zu: %s\n", pos, wave_err()->message);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(i * 7919);
+    }
+
+    fp = wave_open("buffer.wav", WAVE_OPEN_WRITE | WAVE_OPEN_READ);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    /* rounded down to 250 frames */
+    wave_set_buffer_size(fp, 1001);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "set buffer size: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* small writes stay in the buffer, with the header on disk behind them */
+    if (write_steps(fp, 0, 35 * STEP_FRAMES) != 0) {
+        return 1;
+    }
+    if (wave_tell(fp) != 35 * STEP_FRAMES || wave_get_length(fp) != 35 * STEP_FRAMES ||
+        data_size_on_disk("buffer.wav") != 0)
+    {
+        fprintf(stderr, "before a drain: tell %ld, on disk %lu\n", wave_tell(fp), data_size_on_disk("buffer.wav"));
+        return 1;
+    }
+
+    /* the next write does not fit, so the buffer is written out first */
+    if (write_steps(fp, 35 * STEP_FRAMES, 36 * STEP_FRAMES) != 0) {
+        return 1;
+    }
+    if (data_size_on_disk("buffer.wav") != 35 * STEP_FRAMES * NUM_CHANNELS * 2) {
+        fprintf(stderr, "after a drain: on disk %lu\n", data_size_on_disk("buffer.wav"));
+        return 1;
+    }
+
+    /* a seek writes out the buffer, then the frames read back */
+    if (wave_seek(fp, 100, SEEK_SET) != 0 || wave_tell(fp) != 100 ||
+        data_size_on_disk("buffer.wav") != 36 * STEP_FRAMES * NUM_CHANNELS * 2)
+    {
+        fprintf(stderr, "seek: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (wave_read(fp, decoded, 100) != 100 || wave_tell(fp) != 200 ||
+        memcmp(decoded, samples + 100 * NUM_CHANNELS, 100 * NUM_CHANNELS * sizeof(short)) != 0)
+    {
+        fprintf(stderr, "read after seek: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* back to the end for more small writes, which close writes out */
+    if (wave_seek(fp, 0, SEEK_END) != 0 || wave_tell(fp) != 36 * STEP_FRAMES) {
+        fprintf(stderr, "seek to the end: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (write_steps(fp, 36 * STEP_FRAMES, NUM_FRAMES) != 0) {
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("buffer.wav", WAVE_OPEN_READ);
+    if (wave_get_length(fp) != NUM_FRAMES || wave_read(fp, decoded, NUM_FRAMES) != NUM_FRAMES ||
+        memcmp(decoded, samples, sizeof(samples)) != 0)
+    {
+        fprintf(stderr, "after close: length %zu %s\n", wave_get_length(fp), wave_err()->message);
+        return 1;
+    }
+    wave_set_buffer_size(fp, 4096);
+    if (wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "buffer on a read-only file\n");
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+
+    /* without the buffer, every write reaches the header */
+    fp = wave_open("buffer.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    wave_set_buffer_size(fp, 4096);
+    if (write_steps(fp, 0, 10 * STEP_FRAMES) != 0) {
+        return 1;
+    }
+    wave_set_buffer_size(fp, 0);
+    if (data_size_on_disk("buffer.wav") != 10 * STEP_FRAMES * NUM_CHANNELS * 2 ||
+        write_steps(fp, 10 * STEP_FRAMES, 11 * STEP_FRAMES) != 0 ||
+        data_size_on_disk("buffer.wav") != 11 * STEP_FRAMES * NUM_CHANNELS * 2)
+    {
+        fprintf(stderr, "unbuffered: on disk %lu\n", data_size_on_disk("buffer.wav"));
+        return 1;
+    }
+    wave_close(fp);
+
+    return 0;
+}
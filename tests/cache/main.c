@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      50000
+#define NUM_WINDOWS     2000
+#define WINDOW_FRAMES   700
+
+static short samples[NUM_FRAMES * 2];
+
+static int check(const char *what)
+{
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "%s: %s\n", what, wave_err()->message);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static short window[WINDOW_FRAMES * 2];
+    WaveCacheStats stats;
+    WaveCache *cache;
+    WaveFile *fp;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        samples[i] = (short)(i * 7919);
+    }
+    fp = wave_open("cache.wav", WAVE_OPEN_WRITE);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+    if (check("write")) {
+        return 1;
+    }
+
+    /* small blocks and a capacity below the file size, so that blocks are evicted and read again */
+    cache = wave_cache_create(128 << 10, 4096);
+
+    srand(1);
+    for (i = 0; i < NUM_WINDOWS; ++i) {
+        size_t start = (size_t)rand() % NUM_FRAMES;
+        size_t expected = NUM_FRAMES - start < WINDOW_FRAMES ? NUM_FRAMES - start : WINDOW_FRAMES;
+
+        fp = wave_open_cached("cache.wav", cache);
+        wave_seek(fp, (long)start, SEEK_SET);
+        if (wave_read(fp, window, WINDOW_FRAMES) != expected || check("read")) {
+            fprintf(stderr, "short read at %zu\n", start);
+            return 1;
+        }
+        if (memcmp(window, samples + start * 2, expected * 4) != 0) {
+            fprintf(stderr, "wrong data at %zu\n", start);
+            return 1;
+        }
+        if ((size_t)wave_tell(fp) != start + expected || !wave_eof(fp) != (start + expected < NUM_FRAMES)) {
+            fprintf(stderr, "wrong position after reading at %zu\n", start);
+            return 1;
+        }
+        wave_close(fp);
+    }
+
+    wave_cache_get_stats(cache, &stats);
+    if (stats.header_misses != 1 || stats.header_hits != NUM_WINDOWS - 1) {
+        fprintf(stderr, "header was not cached: %lu hits, %lu misses\n", (unsigned long)stats.header_hits, (unsigned long)stats.header_misses);
+        return 1;
+    }
+    if (stats.hits == 0 || stats.misses == 0 || stats.evictions == 0 || stats.size > (128 << 10)) {
+        fprintf(stderr, "unexpected stats: %lu hits, %lu misses, %lu evictions, %zu bytes\n",
+                (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.evictions, stats.size);
+        return 1;
+    }
+
+    /* attaching to an open handle keeps its position, detaching gives it back to the stream */
+    fp = wave_open("cache.wav", WAVE_OPEN_READ);
+    wave_seek(fp, 100, SEEK_SET);
+    wave_set_cache(fp, cache);
+    wave_read(fp, window, 10);
+    wave_set_cache(fp, NULL);
+    wave_read(fp, window + 20, 10);
+    if (check("attach") || memcmp(window, samples + 200, 80) != 0 || wave_tell(fp) != 120) {
+        fprintf(stderr, "attach/detach lost the position\n");
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("cache.wav", WAVE_OPEN_WRITE);
+    wave_set_cache(fp, cache);
+    if (wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "a writable file was attached\n");
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+
+    wave_cache_destroy(cache);
+    return 0;
+}
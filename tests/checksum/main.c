@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      300001
+#define NUM_CHANNELS    2
+#define CORRUPT_FRAME   123456
+
+#define MAX_FRAMES      (NUM_FRAMES * 2 + 1000)
+
+static short samples[MAX_FRAMES * NUM_CHANNELS];
+static short decoded[MAX_FRAMES * NUM_CHANNELS];
+static unsigned char file_data[MAX_FRAMES * NUM_CHANNELS * 2 + 65536];
+
+static unsigned get_u32(const unsigned char* p)
+{
+    return (unsigned)p[0] | (unsigned)p[1] << 8 | (unsigned)p[2] << 16 | (unsigned)p[3] << 24;
+}
+
+/* bitwise CRC32C, independent of the table and hardware versions of the library */
+static unsigned crc32c(const unsigned char* data, size_t size)
+{
+    unsigned crc = 0xffffffffu;
+    size_t i;
+    int k;
+
+    for (i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* Check the "crcc" chunk of a file against {num_frames} frames of {samples} */
+static int check_chunk(const char* filename, size_t num_frames)
+{
+    FILE* fp = fopen(filename, "rb");
+    size_t size = fread(file_data, 1, sizeof(file_data), fp);
+    size_t data_size = num_frames * NUM_CHANNELS * 2;
+    size_t offset = 44 + data_size + (data_size & 1);
+    size_t block_size, i;
+
+    fclose(fp);
+    if (get_u32(file_data + 4) != size - 8 || get_u32(file_data + 40) != data_size ||
+        memcmp(file_data + 44, samples, data_size) != 0 || memcmp(file_data + offset, "crcc", 4) != 0)
+    {
+        fprintf(stderr, "%s: unexpected layout\n", filename);
+        return 0;
+    }
+    block_size = get_u32(file_data + offset + 8);
+    if (block_size == 0 || get_u32(file_data + offset + 12) != data_size || get_u32(file_data + offset + 16) != 0 ||
+        offset + 20 + 4 * ((data_size + block_size - 1) / block_size) != size)
+    {
+        fprintf(stderr, "%s: invalid checksum chunk\n", filename);
+        return 0;
+    }
+    for (i = 0; i * block_size < data_size; ++i) {
+        size_t n = data_size - i * block_size < block_size ? data_size - i * block_size : block_size;
+        if (get_u32(file_data + offset + 20 + 4 * i) != crc32c(file_data + 44 + i * block_size, n)) {
+            fprintf(stderr, "%s: checksum of block %zu\n", filename, i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void flip_byte(const char* filename, long offset)
+{
+    FILE* fp = fopen(filename, "rb+");
+    int c;
+    fseek(fp, offset, SEEK_SET);
+    c = fgetc(fp);
+    fseek(fp, offset, SEEK_SET);
+    fputc(c ^ 0x5a, fp);
+    fclose(fp);
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    WaveRegion *corrupt;
+    size_t done, n, i;
+
+    for (i = 0; i < MAX_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(i * 7919 + (i >> 7));
+    }
+
+    /* checksums are maintained across writes of any size */
+    fp = wave_open("checksum.wav", WAVE_OPEN_WRITE | WAVE_OPEN_CHECKSUM);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    for (done = 0, n = 1; done < NUM_FRAMES; done += n, n = n * 3 + 1) {
+        n = n < NUM_FRAMES - done ? n : NUM_FRAMES - done;
+        if (wave_write(fp, samples + done * NUM_CHANNELS, n) != n) {
+            fprintf(stderr, "write: %s\n", wave_err()->message);
+            return 1;
+        }
+    }
+    wave_close(fp);
+    if (!check_chunk("checksum.wav", NUM_FRAMES)) {
+        return 1;
+    }
+    if (wave_verify("checksum.wav", 4, &corrupt) != 0 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "verify: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* one bad byte is localised to its block */
+    flip_byte("checksum.wav", 44 + CORRUPT_FRAME * NUM_CHANNELS * 2 + 1);
+    if (wave_verify("checksum.wav", 0, &corrupt) != 1 || corrupt[0].first_frame > CORRUPT_FRAME ||
+        corrupt[0].first_frame + corrupt[0].num_frames <= CORRUPT_FRAME || corrupt[0].num_frames > 65536 / 4)
+    {
+        fprintf(stderr, "corruption was not found\n");
+        return 1;
+    }
+    wave_free_regions(corrupt);
+
+    /* readers that opt in fail on the corrupt block, and only there */
+    fp = wave_open("checksum.wav", WAVE_OPEN_READ | WAVE_OPEN_CHECKSUM);
+    for (done = 0; done < NUM_FRAMES; done += n) {
+        n = wave_read(fp, decoded + done * NUM_CHANNELS, 1000);
+        if (n != 1000) {
+            break;
+        }
+    }
+    if (wave_err()->code != WAVE_ERR_CHECKSUM || done > CORRUPT_FRAME || done + 1000 + 65536 / 4 <= CORRUPT_FRAME) {
+        fprintf(stderr, "read stopped at %zu: %s\n", done, wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+    flip_byte("checksum.wav", 44 + CORRUPT_FRAME * NUM_CHANNELS * 2 + 1);
+
+    /* appending continues the checksums of the file */
+    fp = wave_open("checksum.wav", WAVE_OPEN_APPEND | WAVE_OPEN_CHECKSUM);
+    if (wave_write(fp, samples + NUM_FRAMES * NUM_CHANNELS, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "append: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    if (!check_chunk("checksum.wav", NUM_FRAMES * 2)) {
+        return 1;
+    }
+
+    fp = wave_open("checksum.wav", WAVE_OPEN_READ | WAVE_OPEN_CHECKSUM);
+    if (wave_read(fp, decoded, NUM_FRAMES * 2) != NUM_FRAMES * 2 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "read: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    /* appending without the flag keeps the checksums */
+    fp = wave_open("checksum.wav", WAVE_OPEN_APPEND);
+    wave_write(fp, samples + NUM_FRAMES * 2 * NUM_CHANNELS, 1000);
+    wave_close(fp);
+    if (!check_chunk("checksum.wav", MAX_FRAMES)) {
+        return 1;
+    }
+
+    /* checksums are added to a file that has none when frames are appended */
+    fp = wave_open("checksum.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+    fp = wave_open("checksum.wav", WAVE_OPEN_APPEND | WAVE_OPEN_CHECKSUM);
+    wave_write(fp, samples + NUM_FRAMES * NUM_CHANNELS, 1);
+    wave_close(fp);
+    if (wave_err()->code != WAVE_OK || !check_chunk("checksum.wav", NUM_FRAMES + 1)) {
+        fprintf(stderr, "append: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* files without checksums cannot be verified */
+    fp = wave_open("plain.wav", WAVE_OPEN_WRITE);
+    wave_write(fp, samples, 100);
+    wave_close(fp);
+    if (wave_verify("plain.wav", 0, &corrupt) != 0 || wave_err()->code != WAVE_ERR_FORMAT) {
+        fprintf(stderr, "plain file was verified\n");
+        return 1;
+    }
+    wave_err_clear();
+
+    return 0;
+}
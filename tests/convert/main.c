@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES  100000
+
+static short samples[NUM_FRAMES];
+static float converted[NUM_FRAMES];
+static char  buffer[NUM_FRAMES * 2 + 1024];
+
+/* Run wave-convert on {input} into the directory "out", returns its exit status */
+static int convert(const char* tool, const char* format, const char* input)
+{
+    char command[4096];
+
+    snprintf(command, sizeof(command), "\"%s\" -q -j 2 -S 10000 -f %s -o out %s", tool, format, input);
+    return system(command);
+}
+
+/* Check the format and the length of a converted file */
+static int check_output(const char* filename, WaveU16 format, WaveU16 sub_format)
+{
+    WaveFile *fp = wave_open(filename, WAVE_OPEN_READ);
+
+    if (fp == NULL || wave_err()->code != WAVE_OK || wave_get_format(fp) != format ||
+        (sub_format != 0 && wave_get_sub_format(fp) != sub_format) || wave_get_length(fp) != NUM_FRAMES)
+    {
+        fprintf(stderr, "%s: %s\n", filename, wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    WaveFile *fp;
+    FILE *in, *out;
+    size_t i, size;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: convert <wave-convert>\n");
+        return 1;
+    }
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        samples[i] = (short)(i * 7919);
+    }
+
+    fp = wave_open("convert.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, 1);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+
+    if (convert(argv[1], "float", "convert.wav") != 0) {
+        fprintf(stderr, "converting a whole file failed\n");
+        return 1;
+    }
+    fp = wave_open("out/convert.wav", WAVE_OPEN_READ);
+    if (fp == NULL || wave_read_float(fp, converted, NUM_FRAMES) != NUM_FRAMES || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "read the output: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        if (converted[i] != (float)samples[i] / 32768.0f) {
+            fprintf(stderr, "sample %zu: %f\n", i, converted[i]);
+            return 1;
+        }
+    }
+
+    /* the header promises all the samples, but the file ends half way, so the reads come up short without an error */
+    in = fopen("convert.wav", "rb");
+    size = fread(buffer, 1, sizeof(buffer), in);
+    fclose(in);
+    out = fopen("truncated.wav", "wb");
+    fwrite(buffer, 1, size / 2, out);
+    fclose(out);
+
+    if (convert(argv[1], "float", "truncated.wav") == 0) {
+        fprintf(stderr, "converting a truncated file succeeded\n");
+        return 1;
+    }
+
+    /* extensible inputs are converted by their sub format, and can be written as extensible files */
+    fp = wave_open("extensible.wav", WAVE_OPEN_WRITE);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_set_num_channels(fp, 1);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+
+    if (convert(argv[1], "ext-float", "extensible.wav") != 0 ||
+        check_output("out/extensible.wav", WAVE_FORMAT_EXTENSIBLE, WAVE_FORMAT_IEEE_FLOAT) != 0)
+    {
+        fprintf(stderr, "converting an extensible file failed\n");
+        return 1;
+    }
+    fp = wave_open("out/extensible.wav", WAVE_OPEN_READ);
+    if (wave_read_float(fp, converted, NUM_FRAMES) != NUM_FRAMES || converted[1] != (float)samples[1] / 32768.0f) {
+        fprintf(stderr, "read the extensible output: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    /* ADPCM is written in one part even when it is longer than the split size, and can be read back */
+    rename("out/convert.wav", "adpcm.wav");
+    if (convert(argv[1], "ima", "adpcm.wav") != 0 || check_output("out/adpcm.wav", WAVE_FORMAT_IMA_ADPCM, 0) != 0) {
+        fprintf(stderr, "converting to ADPCM failed\n");
+        return 1;
+    }
+    rename("out/adpcm.wav", "decoded.wav");
+    if (convert(argv[1], "pcm", "decoded.wav") != 0 || check_output("out/decoded.wav", WAVE_FORMAT_PCM, 0) != 0) {
+        fprintf(stderr, "converting from ADPCM failed\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/stat.h>
+#endif
+
+#define NUM_CHANNELS    2
+#define NUM_FRAMES      100003
+
+static short samples[NUM_FRAMES * NUM_CHANNELS];
+static short copied[NUM_FRAMES * NUM_CHANNELS];
+
+static void write_source(const char* filename)
+{
+    WaveFile *fp = wave_open(filename, WAVE_OPEN_WRITE);
+
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_rate(fp, 22050);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+}
+
+/* Check that {filename} has {length} frames in the format of the source and starts with the {count} frames of the
+ * source from {first} on */
+static int check_file(const char* filename, size_t length, size_t first, size_t count)
+{
+    WaveFile *fp = wave_open(filename, WAVE_OPEN_READ);
+    size_t n;
+
+    if (fp == NULL || wave_err()->code != WAVE_OK || wave_get_num_channels(fp) != NUM_CHANNELS ||
+        wave_get_sample_rate(fp) != 22050 || wave_get_sample_size(fp) != 2 || wave_get_length(fp) != length)
+    {
+        fprintf(stderr, "%s: %s, length %zu\n", filename, wave_err()->message, fp != NULL ? wave_get_length(fp) : 0);
+        return 1;
+    }
+    n = wave_read(fp, copied, count);
+    wave_close(fp);
+    if (n != count || memcmp(copied, samples + first * NUM_CHANNELS, count * NUM_CHANNELS * sizeof(short)) != 0) {
+        fprintf(stderr, "%s: samples differ\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+/* Copy two ranges of {src_name} into a new file that starts without a format */
+static int copy_ranges(const char* src_name, const char* dst_name)
+{
+    WaveFile *src = wave_open(src_name, WAVE_OPEN_READ);
+    WaveFile *dst = wave_open(dst_name, WAVE_OPEN_WRITE);
+    size_t i;
+
+    if (wave_copy_range(src, 1000, 30000, dst) != 30000 || wave_copy_range(src, 31000, 20000, dst) != 20000 ||
+        wave_get_num_channels(dst) != NUM_CHANNELS || wave_get_sample_rate(dst) != 22050)
+    {
+        fprintf(stderr, "copy from %s: %s\n", src_name, wave_err()->message);
+        return 1;
+    }
+    /* a range that runs past the end of the source stops there */
+    if (wave_copy_range(src, NUM_FRAMES - 10, 100, dst) != 10 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "copy past the end: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(dst);
+    wave_close(src);
+
+    if (check_file(dst_name, 50010, 1000, 50000)) {
+        return 1;
+    }
+    dst = wave_open(dst_name, WAVE_OPEN_READ);
+    wave_seek(dst, 50000, SEEK_SET);
+    i = wave_read(dst, copied, 10);
+    wave_close(dst);
+    if (i != 10 || memcmp(copied, samples + (NUM_FRAMES - 10) * NUM_CHANNELS, sizeof(short) * 10 * NUM_CHANNELS) != 0) {
+        fprintf(stderr, "the last frames differ\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static const char *parts[3] = {"copy-part0.wav", "copy-part1.wav", "copy-part2.wav"};
+    static const size_t splits[2] = {25000, 70001};
+    static const size_t descending[2] = {70001, 25000};
+    WaveFile *src, *dst, *srcs[4];
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(i * 7919);
+    }
+    write_source("copy-src.wav");
+
+    /* within one file system, where Linux copies with copy_file_range */
+    if (copy_ranges("copy-src.wav", "copy-dst.wav")) {
+        return 1;
+    }
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    /* from tmpfs, where copy_file_range fails with EXDEV and the data goes through pread and pwrite */
+    {
+        struct stat st;
+        if (stat("/dev/shm", &st) == 0 && S_ISDIR(st.st_mode)) {
+            write_source("/dev/shm/libwave-copy-src.wav");
+            i = (size_t)copy_ranges("/dev/shm/libwave-copy-src.wav", "copy-shm.wav");
+            remove("/dev/shm/libwave-copy-src.wav");
+            if (i) {
+                return 1;
+            }
+        }
+    }
+#endif
+
+    /* a destination with samples of another format is not changed */
+    src = wave_open("copy-src.wav", WAVE_OPEN_READ);
+    dst = wave_open("copy-mono.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(dst, 1);
+    wave_write(dst, samples, 10);
+    if (wave_copy_range(src, 0, 100, dst) != 0 || wave_err()->code != WAVE_ERR_FORMAT || wave_get_length(dst) != 10) {
+        fprintf(stderr, "copy to another format: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(dst);
+
+    /* split and join again */
+    if (wave_split(src, splits, 2, parts) != 3 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "split: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (check_file(parts[0], 25000, 0, 25000) || check_file(parts[1], 45001, 25000, 45001) ||
+        check_file(parts[2], NUM_FRAMES - 70001, 70001, NUM_FRAMES - 70001))
+    {
+        return 1;
+    }
+    for (i = 0; i < 3; ++i) {
+        srcs[i] = wave_open(parts[i], WAVE_OPEN_READ);
+    }
+    dst = wave_open("copy-joined.wav", WAVE_OPEN_WRITE);
+    if (wave_concat(srcs, 3, dst) != NUM_FRAMES || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "concat: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(dst);
+    if (check_file("copy-joined.wav", NUM_FRAMES, 0, NUM_FRAMES)) {
+        return 1;
+    }
+
+    /* files of different formats are not joined */
+    srcs[3] = wave_open("copy-mono.wav", WAVE_OPEN_READ);
+    dst = wave_open("copy-mixed.wav", WAVE_OPEN_WRITE);
+    if (wave_concat(srcs, 4, dst) != 0 || wave_err()->code != WAVE_ERR_FORMAT) {
+        fprintf(stderr, "concat of different formats: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(dst);
+    for (i = 0; i < 4; ++i) {
+        wave_close(srcs[i]);
+    }
+    if (wave_split(src, descending, 2, parts) != 0 || wave_err()->code != WAVE_ERR_PARAM) {
+        fprintf(stderr, "split at descending frames\n");
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(src);
+
+    /* ADPCM frames are not whole bytes, nothing is copied */
+    src = wave_open("copy-adpcm.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(src, NUM_CHANNELS);
+    wave_set_format(src, WAVE_FORMAT_IMA_ADPCM);
+    wave_write(src, samples, 5000);
+    wave_close(src);
+    src = wave_open("copy-adpcm.wav", WAVE_OPEN_READ);
+    dst = wave_open("copy-from-adpcm.wav", WAVE_OPEN_WRITE);
+    if (wave_copy_range(src, 0, 5000, dst) != 0 || wave_err()->code != WAVE_ERR_FORMAT || wave_get_length(dst) != 0) {
+        fprintf(stderr, "copy from ADPCM: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(dst);
+    if (wave_split(src, splits, 2, parts) != 0 || wave_err()->code != WAVE_ERR_FORMAT) {
+        fprintf(stderr, "split of ADPCM: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(src);
+
+    return 0;
+}
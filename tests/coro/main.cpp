@@ -0,0 +1,177 @@
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "wave.hpp"
+
+namespace {
+
+const std::size_t num_streams = 8;
+const std::size_t num_channels = 2;
+
+/* A coroutine that starts at once and is not waited for */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct Stream {
+    std::string               filename;
+    std::vector<std::int16_t> samples;
+    std::size_t               frames_read = 0;
+    bool                      ok = false;
+};
+
+std::mutex              done_mutex;
+std::condition_variable done_cond;
+std::size_t             num_done = 0;
+
+void finish(Stream& stream, bool ok)
+{
+    std::lock_guard<std::mutex> lock(done_mutex);
+    stream.ok = ok;
+    ++num_done;
+    done_cond.notify_one();
+}
+
+bool check_block(Stream& stream, const wave::Block<std::int16_t>& block)
+{
+    if (block.channels != num_channels ||
+        std::memcmp(block.data, stream.samples.data() + stream.frames_read * num_channels, block.size() * 2) != 0) {
+        std::fprintf(stderr, "%s: mismatch at frame %zu\n", stream.filename.c_str(), stream.frames_read);
+        return false;
+    }
+    stream.frames_read += block.frames;
+    return true;
+}
+
+/* Ask for fewer frames than a buffer holds, so that buffers are handed out in parts */
+Detached read_blocks(wave::IoContext& io, Stream& stream)
+{
+    auto reader = wave::AsyncReader<std::int16_t>::open(io, stream.filename.c_str(), 1024, 3);
+    if (!reader) {
+        finish(stream, false);
+        co_return;
+    }
+    for (;;) {
+        auto block = co_await reader->next_block(700);
+        if (!block || block->frames > 700) {
+            finish(stream, false);
+            co_return;
+        }
+        if (block->frames == 0) {
+            break;
+        }
+        if (!check_block(stream, *block)) {
+            finish(stream, false);
+            co_return;
+        }
+    }
+    auto end = co_await reader->next_block(700);
+    finish(stream, end && end->frames == 0 && stream.frames_read * num_channels == stream.samples.size());
+}
+
+Detached read_generator(wave::IoContext& io, Stream& stream)
+{
+    auto reader = wave::AsyncReader<std::int16_t>::open(io, stream.filename.c_str(), 512);
+    if (!reader) {
+        finish(stream, false);
+        co_return;
+    }
+    auto blocks = reader->blocks(512);
+    while (const auto* block = co_await blocks.next()) {
+        if (!check_block(stream, *block)) {
+            finish(stream, false);
+            co_return;
+        }
+    }
+    finish(stream, reader->error().code == WAVE_OK && stream.frames_read * num_channels == stream.samples.size());
+}
+
+/* Drop the reader after one block, on the only I/O thread, with the next read already posted */
+Detached read_one_block(wave::IoContext& io, Stream& stream)
+{
+    bool ok;
+    {
+        auto reader = wave::AsyncReader<std::int16_t>::open(io, stream.filename.c_str(), 256, 4);
+        if (!reader) {
+            finish(stream, false);
+            co_return;
+        }
+        auto block = co_await reader->next_block(256);
+        ok = block && block->frames == 256;
+    }
+    finish(stream, ok);
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<Stream> streams(num_streams);
+    for (std::size_t s = 0; s < num_streams; ++s) {
+        Stream& stream = streams[s];
+        stream.filename = "coro" + std::to_string(s) + ".wav";
+        stream.samples.resize((20000 + 1234 * s) * num_channels);
+        for (std::size_t i = 0; i < stream.samples.size(); ++i) {
+            stream.samples[i] = static_cast<std::int16_t>(i * 7919 + s);
+        }
+
+        wave::Spec spec;
+        spec.num_channels = num_channels;
+        spec.sample_size = 2;
+        auto writer = wave::Writer<std::int16_t>::create(stream.filename.c_str(), spec);
+        if (!writer || !writer->write(stream.samples.data(), stream.samples.size() / num_channels)) {
+            std::fprintf(stderr, "write failed\n");
+            return 1;
+        }
+    }
+
+    {
+        /* all streams share two I/O threads */
+        wave::IoContext io(2);
+        for (std::size_t s = 0; s < num_streams; ++s) {
+            if (s % 2 == 0) {
+                read_blocks(io, streams[s]);
+            } else {
+                read_generator(io, streams[s]);
+            }
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cond.wait(lock, [] { return num_done == num_streams; });
+    }
+
+    for (const auto& stream : streams) {
+        if (!stream.ok) {
+            std::fprintf(stderr, "%s: failed after %zu frames\n", stream.filename.c_str(), stream.frames_read);
+            return 1;
+        }
+    }
+
+    {
+        wave::IoContext io(1);
+        num_done = 0;
+        read_one_block(io, streams[0]);
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cond.wait(lock, [] { return num_done == 1; });
+    }
+    if (!streams[0].ok) {
+        std::fprintf(stderr, "%s: dropping the reader early failed\n", streams[0].filename.c_str());
+        return 1;
+    }
+
+    wave::IoContext io(1);
+    auto missing = wave::AsyncReader<float>::open(io, "does-not-exist.wav", 256);
+    if (missing || missing.error().code != WAVE_ERR_OS) {
+        std::fprintf(stderr, "opening a missing file did not fail\n");
+        return 1;
+    }
+
+    return 0;
+}
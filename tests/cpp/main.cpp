@@ -0,0 +1,62 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "wave.hpp"
+
+int main()
+{
+    const std::size_t num_frames = 10000;
+    std::vector<float> planar(2 * num_frames);
+    for (std::size_t i = 0; i < num_frames; ++i) {
+        planar[i] = 0.5f * std::sin(0.01f * static_cast<float>(i));
+        planar[num_frames + i] = -planar[i];
+    }
+
+    for (WaveU16 format : {WAVE_FORMAT_PCM, WAVE_FORMAT_IEEE_FLOAT, WAVE_FORMAT_ALAW, WAVE_FORMAT_MULAW}) {
+        wave::Spec spec;
+        spec.format = format;
+        spec.num_channels = 2;
+        spec.sample_rate = 16000;
+        spec.sample_size = format == WAVE_FORMAT_PCM ? 3 : 0;
+
+        {
+            auto writer = wave::Writer<float, wave::Layout::Planar>::create("cpp.wav", spec);
+            if (!writer || !writer->write(planar.data(), num_frames)) {
+                std::fprintf(stderr, "write failed\n");
+                return 1;
+            }
+        }
+
+        auto reader = wave::Reader<std::int16_t>::open("cpp.wav");
+        if (!reader) {
+            std::fprintf(stderr, "open: %s\n", reader.error().message.c_str());
+            return 1;
+        }
+
+        const double tolerance = format == WAVE_FORMAT_ALAW || format == WAVE_FORMAT_MULAW ? 0.02 : 1e-4;
+        std::size_t frame = 0;
+        auto blocks = reader->blocks(333);
+        for (const auto& block : blocks) {
+            for (std::size_t i = 0; i < block.frames; ++i, ++frame) {
+                double left = block.data[2 * i] / 32768.0;
+                double right = block.data[2 * i + 1] / 32768.0;
+                if (std::fabs(left - planar[frame]) > tolerance || std::fabs(right + planar[frame]) > tolerance) {
+                    std::fprintf(stderr, "format %#x: mismatch at frame %zu\n", format, frame);
+                    return 1;
+                }
+            }
+        }
+        if (frame != num_frames || blocks.error().code != WAVE_OK) {
+            std::fprintf(stderr, "format %#x: read %zu frames\n", format, frame);
+            return 1;
+        }
+    }
+
+    auto missing = wave::File::open("does-not-exist.wav", WAVE_OPEN_READ);
+    if (missing || missing.error().code != WAVE_ERR_OS) {
+        std::fprintf(stderr, "opening a missing file did not fail\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      100000
+#define NUM_CHANNELS    2
+
+static short samples[NUM_FRAMES * NUM_CHANNELS];
+static short decoded[NUM_FRAMES * NUM_CHANNELS];
+
+static long file_size(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+    long size;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+static int check_samples(const char* filename, WaveU32 sample_rate, WaveU16 format)
+{
+    WaveFile* fp = wave_open(filename, WAVE_OPEN_READ);
+    size_t i;
+
+    if (wave_err()->code != WAVE_OK || wave_get_sample_rate(fp) != sample_rate || wave_get_format(fp) != format ||
+        wave_get_length(fp) != NUM_FRAMES)
+    {
+        fprintf(stderr, "header: %s\n", wave_err()->message);
+        return 0;
+    }
+    memset(decoded, 0, sizeof(decoded));
+    if (wave_read(fp, decoded, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read: %s\n", wave_err()->message);
+        return 0;
+    }
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        if (decoded[i] != samples[i]) {
+            fprintf(stderr, "sample %zu: %d != %d\n", i, decoded[i], samples[i]);
+            return 0;
+        }
+    }
+    wave_close(fp);
+    return 1;
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    long size;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(i * 7919);
+    }
+
+    fp = wave_open("edit.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_rate(fp, 44100);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+
+    /* the layout of the samples cannot change */
+    fp = wave_open("edit.wav", WAVE_OPEN_EDIT);
+    wave_set_num_channels(fp, 1);
+    if (wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "set_num_channels was accepted\n");
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+
+    /* the bigger format chunk and the tags do not fit in a canonical 44-byte header */
+    fp = wave_open("edit.wav", WAVE_OPEN_EDIT);
+    wave_set_sample_rate(fp, 48000);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_set_channel_mask(fp, WAVE_SPEAKER_FRONT_LEFT | WAVE_SPEAKER_FRONT_RIGHT);
+    wave_set_info(fp, "INAM", "Test tone");
+    wave_set_info(fp, "IART", "libwave");
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "edit: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    if (!check_samples("edit.wav", 48000, WAVE_FORMAT_EXTENSIBLE)) {
+        return 1;
+    }
+
+    fp = wave_open("edit.wav", WAVE_OPEN_READ);
+    if (wave_get_info(fp, "INAM") == NULL || strcmp(wave_get_info(fp, "INAM"), "Test tone") != 0 ||
+        wave_get_info(fp, "IART") == NULL || strcmp(wave_get_info(fp, "IART"), "libwave") != 0 ||
+        wave_get_channel_mask(fp) != (WAVE_SPEAKER_FRONT_LEFT | WAVE_SPEAKER_FRONT_RIGHT))
+    {
+        fprintf(stderr, "tags were not written\n");
+        return 1;
+    }
+    wave_close(fp);
+
+    /* further edits reuse the reserved space and never move the samples again */
+    size = file_size("edit.wav");
+    fp = wave_open("edit.wav", WAVE_OPEN_EDIT);
+    wave_set_format(fp, WAVE_FORMAT_PCM);
+    wave_set_sample_rate(fp, 22050);
+    wave_set_info(fp, "INAM", "A much longer title that still fits in the reserved space");
+    wave_set_info(fp, "IART", "");
+    wave_set_info(fp, "ICMT", "comment");
+    wave_close(fp);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "second edit: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (file_size("edit.wav") > size + 256) {
+        fprintf(stderr, "file grew from %ld to %ld\n", size, file_size("edit.wav"));
+        return 1;
+    }
+    if (!check_samples("edit.wav", 22050, WAVE_FORMAT_PCM)) {
+        return 1;
+    }
+
+    fp = wave_open("edit.wav", WAVE_OPEN_READ);
+    if (wave_get_info(fp, "IART") != NULL || wave_get_info(fp, "ICMT") == NULL ||
+        strcmp(wave_get_info(fp, "INAM"), "A much longer title that still fits in the reserved space") != 0)
+    {
+        fprintf(stderr, "tags were not updated\n");
+        return 1;
+    }
+    wave_close(fp);
+
+    /* tags added to a canonical header stay when frames are appended later */
+    fp = wave_open("edit-append.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, 1000);
+    wave_close(fp);
+    fp = wave_open("edit-append.wav", WAVE_OPEN_EDIT);
+    wave_set_info(fp, "INAM", "Appended");
+    wave_close(fp);
+    fp = wave_open("edit-append.wav", WAVE_OPEN_APPEND);
+    wave_write(fp, samples + 1000 * NUM_CHANNELS, 1000);
+    wave_close(fp);
+    fp = wave_open("edit-append.wav", WAVE_OPEN_READ);
+    if (wave_err()->code != WAVE_OK || wave_get_length(fp) != 2000 || wave_get_info(fp, "INAM") == NULL ||
+        strcmp(wave_get_info(fp, "INAM"), "Appended") != 0 || wave_read(fp, decoded, 2000) != 2000 ||
+        memcmp(decoded, samples, 2000 * NUM_CHANNELS * 2) != 0)
+    {
+        fprintf(stderr, "append after edit: %zu frames %s\n", wave_get_length(fp), wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    {
+        FILE* raw = fopen("edit-append.wav", "rb");
+        unsigned int riff_size = 0;
+        fseek(raw, 4, SEEK_SET);
+        if (fread(&riff_size, 4, 1, raw) != 1 || (long)riff_size + 8 != file_size("edit-append.wav")) {
+            fprintf(stderr, "RIFF size %u of a %ld-byte file\n", riff_size, file_size("edit-append.wav"));
+            return 1;
+        }
+        fclose(raw);
+    }
+
+    /* the blocks and the frame count of an ADPCM file stay as they are */
+    fp = wave_open("edit-adpcm.wav", WAVE_OPEN_WRITE);
+    wave_set_format(fp, WAVE_FORMAT_IMA_ADPCM);
+    wave_set_num_channels(fp, 1);
+    wave_set_sample_rate(fp, 8000);
+    wave_write(fp, samples, 8000);
+    wave_close(fp);
+    fp = wave_open("edit-adpcm.wav", WAVE_OPEN_EDIT);
+    wave_set_sample_rate(fp, 44100);
+    wave_close(fp);
+    fp = wave_open("edit-adpcm.wav", WAVE_OPEN_READ);
+    if (wave_err()->code != WAVE_OK || wave_get_sample_rate(fp) != 44100 || wave_get_length(fp) != 8000 ||
+        wave_read(fp, decoded, 8000) != 8000)
+    {
+        fprintf(stderr, "ADPCM rate edit: %zu frames %s\n", wave_get_length(fp), wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      48000
+#define NUM_CHANNELS    6
+
+static int samples[NUM_FRAMES * NUM_CHANNELS];
+static float floats[NUM_FRAMES * NUM_CHANNELS];
+static float decoded[NUM_FRAMES * NUM_CHANNELS];
+
+int main(void)
+{
+    WaveFile *fp;
+    WaveU32 mask = WAVE_SPEAKER_FRONT_LEFT | WAVE_SPEAKER_FRONT_RIGHT | WAVE_SPEAKER_FRONT_CENTER |
+                   WAVE_SPEAKER_LOW_FREQUENCY | WAVE_SPEAKER_SIDE_LEFT | WAVE_SPEAKER_SIDE_RIGHT;
+    size_t i;
+
+    /* 24 valid bits in 32-bit containers, with garbage in the padding */
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        int x = (int)(8000000.0 * sin(0.001 * (double)i));
+        samples[i] = (int)((unsigned)x << 8) | (int)(i & 0xff);
+    }
+
+    fp = wave_open("extensible.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_rate(fp, 48000);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_set_sample_size(fp, 4);
+    wave_set_valid_bits_per_sample(fp, 24);
+    wave_set_channel_mask(fp, mask);
+    if (wave_write(fp, samples, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "write: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("extensible.wav", WAVE_OPEN_READ);
+    if (wave_err()->code != WAVE_OK || wave_get_format(fp) != WAVE_FORMAT_EXTENSIBLE ||
+        wave_get_sub_format(fp) != WAVE_FORMAT_PCM || wave_get_valid_bits_per_sample(fp) != 24 ||
+        wave_get_channel_mask(fp) != mask || wave_get_length(fp) != NUM_FRAMES)
+    {
+        fprintf(stderr, "header: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (wave_read_float(fp, floats, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        /* the padding bits must not leak into the converted value */
+        if (floats[i] != (float)((double)(samples[i] & ~0xff) / 2147483648.0)) {
+            fprintf(stderr, "sample %zu: %f\n", i, floats[i]);
+            return 1;
+        }
+    }
+    wave_close(fp);
+
+    /* float writes are rounded to the valid bits */
+    fp = wave_open("extensible.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_set_sample_size(fp, 4);
+    wave_set_valid_bits_per_sample(fp, 24);
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        floats[i] = (float)(0.9 * sin(0.0123 * (double)i));
+    }
+    floats[0] = 1.0f;
+    if (wave_write_float(fp, floats, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "write_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("extensible.wav", WAVE_OPEN_READ);
+    if (wave_read(fp, samples, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read: %s\n", wave_err()->message);
+        return 1;
+    }
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        double expected = (double)floats[i] * 8388608.0;
+        if ((samples[i] & 0xff) != 0 || fabs((double)(samples[i] >> 8) - expected) > 1.0) {
+            fprintf(stderr, "rounded sample %zu: %#x, expected %f\n", i, (unsigned)samples[i], expected);
+            return 1;
+        }
+    }
+    wave_close(fp);
+
+    /* a float sub format goes through the float path */
+    fp = wave_open("extensible.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_format(fp, WAVE_FORMAT_IEEE_FLOAT);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_write_float(fp, floats, NUM_FRAMES);
+    wave_close(fp);
+
+    fp = wave_open("extensible.wav", WAVE_OPEN_READ);
+    if (wave_err()->code != WAVE_OK || wave_get_sub_format(fp) != WAVE_FORMAT_IEEE_FLOAT || wave_get_sample_size(fp) != 4) {
+        fprintf(stderr, "float header: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (wave_read_float(fp, decoded, NUM_FRAMES) != NUM_FRAMES || memcmp(decoded, floats, sizeof(floats)) != 0) {
+        fprintf(stderr, "float read: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    remove("extensible.wav");
+    return 0;
+}
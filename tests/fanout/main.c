@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NUM_CHANNELS    67
+#define NUM_FRAMES      5003
+
+/* Split an interleaved stream into mono files and read it back as a group */
+static int round_trip(WaveU16 format, size_t sample_size)
+{
+    static char names[NUM_CHANNELS][32];
+    const char *filenames[NUM_CHANNELS];
+    size_t frame_size = NUM_CHANNELS * sample_size;
+    unsigned char *in = malloc(NUM_FRAMES * frame_size);
+    unsigned char *out = malloc(NUM_FRAMES * frame_size);
+    WaveFanOut *fanout;
+    WaveGroup *group;
+    size_t i, pos = 0, n;
+
+    for (i = 0; i < NUM_FRAMES * frame_size; ++i) {
+        in[i] = (unsigned char)(rand() & 0xff);
+    }
+    for (i = 0; i < NUM_CHANNELS; ++i) {
+        sprintf(names[i], "fanout-%zu.wav", i);
+        filenames[i] = names[i];
+    }
+
+    fanout = wave_fanout_open(filenames, NUM_CHANNELS, format, 48000, sample_size);
+    wave_fanout_set_buffer_size(fanout, 1000 * sample_size);
+    while (pos < NUM_FRAMES && wave_err()->code == WAVE_OK) {
+        n = NUM_FRAMES - pos < 77 ? NUM_FRAMES - pos : 77;
+        pos += wave_fanout_write(fanout, in + pos * frame_size, n);
+    }
+    wave_fanout_close(fanout);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "fanout: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    group = wave_group_open(filenames, NUM_CHANNELS);
+    n = wave_group_read(group, out, NUM_FRAMES + 1, WAVE_LAYOUT_INTERLEAVED);
+    wave_group_close(group);
+    if (wave_err()->code != WAVE_OK || n != NUM_FRAMES) {
+        fprintf(stderr, "group: read %zu frames %s\n", n, wave_err()->message);
+        return 1;
+    }
+
+    if (memcmp(in, out, NUM_FRAMES * frame_size) != 0) {
+        fprintf(stderr, "format %#x, sample size %zu: data mismatch\n", format, sample_size);
+        return 1;
+    }
+
+    free(in);
+    free(out);
+    return 0;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/* Make the descriptor that holds {filename} write to /dev/full instead, returns 0 if it was found */
+static int redirect_to_full(const char* filename)
+{
+    struct stat target, st;
+    int fd, full;
+
+    if (stat(filename, &target) != 0 || (full = open("/dev/full", O_WRONLY)) < 0) {
+        return 1;
+    }
+    for (fd = 3; fd < 1024; ++fd) {
+        if (fd != full && fstat(fd, &st) == 0 && st.st_dev == target.st_dev && st.st_ino == target.st_ino) {
+            dup2(full, fd);
+            close(full);
+            return 0;
+        }
+    }
+    close(full);
+    return 1;
+}
+
+/* more than a stdio buffer, so that a drain reaches the device */
+#define STAGED_FRAMES   5000
+
+/* One file fails part way through a drain. The other file already has the staged frames and must not get them again. */
+static int short_write(void)
+{
+    static const char *filenames[2] = {"fanout-ok.wav", "fanout-full.wav"};
+    static short in[STAGED_FRAMES * 2];
+    WaveFanOut *fanout;
+    WaveFile *fp;
+    size_t n;
+
+    fanout = wave_fanout_open(filenames, 2, WAVE_FORMAT_PCM, 48000, 2);
+    wave_fanout_set_buffer_size(fanout, STAGED_FRAMES * 2);
+    if (wave_fanout_write(fanout, in, 2000) != 2000 || redirect_to_full("fanout-full.wav") != 0) {
+        fprintf(stderr, "short write setup: %s\n", wave_err()->message);
+        return 1;
+    }
+    n = wave_fanout_write(fanout, in + 2000 * 2, STAGED_FRAMES - 2000);
+    if (n != 0 || wave_err()->code == WAVE_OK) {
+        fprintf(stderr, "write to a full device: %zu frames\n", n);
+        return 1;
+    }
+    wave_err_clear();
+    if (wave_fanout_write(fanout, in + 2000 * 2, 100) != 0 || wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "write after a failed drain: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_fanout_close(fanout);
+    wave_err_clear();
+
+    fp = wave_open("fanout-ok.wav", WAVE_OPEN_READ);
+    n = wave_get_length(fp);
+    wave_close(fp);
+    if (n != STAGED_FRAMES) {
+        fprintf(stderr, "the file that did not fail has %zu frames\n", n);
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+int main(void)
+{
+    if (round_trip(WAVE_FORMAT_PCM, 2) ||
+        round_trip(WAVE_FORMAT_PCM, 3) ||
+        round_trip(WAVE_FORMAT_IEEE_FLOAT, 4) ||
+        round_trip(WAVE_FORMAT_MULAW, 1))
+    {
+        return 1;
+    }
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (short_write() != 0) {
+        return 1;
+    }
+#endif
+    return 0;
+}
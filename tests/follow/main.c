@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define NUM_FRAMES      40000
+#define STEP_FRAMES     4000
+#define BURST_FRAMES    1000
+#define DATA_SIZE_AT    40
+
+static short samples[NUM_FRAMES];
+static short decoded[NUM_FRAMES];
+
+/* Append {size} bytes of the samples from byte {offset} on, the way a recorder that leaves the header alone does */
+static void append_bytes(FILE* out, size_t offset, size_t size)
+{
+    fwrite((unsigned char*)samples + offset, 1, size, out);
+    fflush(out);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static void* writer_main(void* arg)
+{
+    FILE* out = (FILE*)arg;
+    struct timespec ts = {0, 2000000};
+    size_t pos;
+
+    for (pos = NUM_FRAMES / 2; pos < NUM_FRAMES; pos += BURST_FRAMES) {
+        nanosleep(&ts, NULL);
+        append_bytes(out, pos * 2, BURST_FRAMES * 2);
+    }
+    return NULL;
+}
+#endif
+
+/* Read what {wave_wait} reports, returns the new position */
+static size_t read_available(WaveFile* fp, size_t pos, size_t avail)
+{
+    size_t n = wave_read(fp, decoded + pos, avail);
+    if (n != avail || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "read at %zu: %zu of %zu %s\n", pos, n, avail, wave_err()->message);
+        exit(1);
+    }
+    return pos + n;
+}
+
+/* An ADPCM recording grows a block at a time, and its last block only ends where the fact chunk says */
+static int follow_adpcm(void)
+{
+    WaveFile *writer, *fp;
+    size_t pos = 0, avail, first;
+    short fresh[NUM_FRAMES / 4];
+
+    writer = wave_open("follow-adpcm.wav", WAVE_OPEN_WRITE | WAVE_OPEN_DEFER_SIZES);
+    wave_set_num_channels(writer, 1);
+    wave_set_sample_rate(writer, 8000);
+    wave_set_format(writer, WAVE_FORMAT_IMA_ADPCM);
+    if (wave_write(writer, samples, STEP_FRAMES) != STEP_FRAMES || wave_flush(writer) != 0) {
+        fprintf(stderr, "adpcm write: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* the frames still waiting in the encoder are counted by the fact chunk, but not written yet */
+    fp = wave_open("follow-adpcm.wav", WAVE_OPEN_READ | WAVE_OPEN_FOLLOW);
+    first = wave_wait(fp, 1, 0);
+    if (fp == NULL || first == 0 || first >= STEP_FRAMES || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "adpcm wait: %zu %s\n", first, wave_err()->message);
+        return 1;
+    }
+    pos = read_available(fp, pos, first);
+
+    if (wave_write(writer, samples + STEP_FRAMES, STEP_FRAMES + 10) != STEP_FRAMES + 10) {
+        fprintf(stderr, "adpcm write: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(writer);
+    while ((avail = wave_wait(fp, 1, 0)) > 0) {
+        pos = read_available(fp, pos, avail);
+    }
+    if (pos != 2 * STEP_FRAMES + 10 || wave_get_length(fp) != pos || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "adpcm length: %zu %zu %s\n", pos, wave_get_length(fp), wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("follow-adpcm.wav", WAVE_OPEN_READ);
+    if (wave_read(fp, fresh, NUM_FRAMES / 4) != pos || memcmp(fresh, decoded, pos * sizeof(short)) != 0) {
+        fprintf(stderr, "adpcm samples differ\n");
+        return 1;
+    }
+    wave_close(fp);
+
+    return 0;
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    FILE *out;
+    size_t pos, avail, written, bytes = 0;
+    unsigned int data_size = NUM_FRAMES * 2;
+
+    for (pos = 0; pos < NUM_FRAMES; ++pos) {
+        samples[pos] = (short)(pos * 7919);
+    }
+    pos = 0;
+
+    /* the header of a recording that has just started, with an empty data chunk */
+    fp = wave_open("follow.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, 1);
+    wave_set_sample_size(fp, 2);
+    wave_close(fp);
+    out = fopen("follow.wav", "rb+");
+    fseek(out, 0, SEEK_END);
+
+    fp = wave_open("follow.wav", WAVE_OPEN_READ | WAVE_OPEN_FOLLOW);
+    if (fp == NULL || wave_get_length(fp) != 0 || wave_wait(fp, 1, 0) != 0 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "open: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (wave_wait(fp, 1, 20) != 0 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "timeout: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* writes that end in the middle of a frame, only whole frames show up */
+    for (written = STEP_FRAMES; written <= NUM_FRAMES / 2; written += STEP_FRAMES) {
+        size_t end = written * 2 + (written < NUM_FRAMES / 2);
+        append_bytes(out, bytes, end - bytes);
+        bytes = end;
+        avail = wave_wait(fp, 1, 0);
+        if (avail != written - pos) {
+            fprintf(stderr, "wait after %zu frames: %zu\n", written, avail);
+            return 1;
+        }
+        pos = read_available(fp, pos, avail);
+        if (wave_read(fp, decoded + pos, 1) != 0 || wave_err()->code != WAVE_OK) {
+            fprintf(stderr, "read past the end at %zu\n", pos);
+            return 1;
+        }
+    }
+
+    /* the second half comes from another thread while the reader sleeps in wave_wait */
+#if !defined(_WIN32) && !defined(_WIN64)
+    {
+        pthread_t writer;
+        pthread_create(&writer, NULL, writer_main, out);
+        while (pos < NUM_FRAMES) {
+            avail = wave_wait(fp, 1, 5000);
+            if (avail == 0 || wave_err()->code != WAVE_OK) {
+                fprintf(stderr, "wait at %zu: %s\n", pos, wave_err()->message);
+                return 1;
+            }
+            pos = read_available(fp, pos, avail);
+        }
+        pthread_join(writer, NULL);
+    }
+#else
+    append_bytes(out, NUM_FRAMES, NUM_FRAMES);
+    pos = read_available(fp, pos, wave_wait(fp, NUM_FRAMES - pos, 5000));
+#endif
+    if (memcmp(decoded, samples, sizeof(samples)) != 0) {
+        fprintf(stderr, "samples differ\n");
+        return 1;
+    }
+
+    /* a chunk after the samples, with the data size written by then, is not taken for frames */
+    fwrite("JUNK\4\0\0\0\0\0\0\0", 1, 12, out);
+    fflush(out);
+    fseek(out, DATA_SIZE_AT, SEEK_SET);
+    fwrite(&data_size, 4, 1, out);
+    fclose(out);
+    if (wave_wait(fp, 1, 0) != 0 || wave_get_length(fp) != NUM_FRAMES || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "length after the junk chunk: %zu %s\n", wave_get_length(fp), wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("follow.wav", WAVE_OPEN_READ);
+    if (wave_wait(fp, 1, 0) != 0 || wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "wait without WAVE_OPEN_FOLLOW\n");
+        return 1;
+    }
+    wave_err_clear();
+    wave_close(fp);
+
+    return follow_adpcm();
+}
@@ -0,0 +1,154 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      10007
+#define NUM_CHANNELS    2
+#define PUSH_FRAMES     333
+
+static short samples[NUM_FRAMES * NUM_CHANNELS];
+static float reference[NUM_FRAMES * NUM_CHANNELS];
+
+/* The expected sample {i} of analysis frame at {first}, zero past the end */
+static float expected(WAVE_CONST WaveFramerOptions* options, size_t first, size_t i, size_t plane)
+{
+    double a = options->window == WAVE_FRAMER_HANN ? 0.5 : options->window == WAVE_FRAMER_HAMMING ? 0.54 : 1.0;
+    double w = a - (1.0 - a) * cos(2.0 * 3.14159265358979323846 * (double)i / (double)options->frame_size);
+    double x = 0.0;
+    size_t c;
+
+    if (first + i >= NUM_FRAMES) {
+        return 0.0f;
+    }
+    if (options->downmix) {
+        for (c = 0; c < NUM_CHANNELS; ++c) {
+            x += reference[(first + i) * NUM_CHANNELS + c];
+        }
+        x /= NUM_CHANNELS;
+    } else {
+        x = reference[(first + i) * NUM_CHANNELS + plane];
+    }
+    return (float)(x * w);
+}
+
+/* Compare every analysis frame that {framer} has ready, returns the number of frames or -1 on a mismatch */
+static long check_frames(WaveFramer* framer, WAVE_CONST WaveFramerOptions* options, size_t* count)
+{
+    WAVE_CONST float* planes[NUM_CHANNELS];
+    size_t hop = options->hop_size != 0 ? options->hop_size : options->frame_size;
+    size_t num_planes = wave_framer_get_num_channels(framer);
+    size_t i, p;
+
+    while (wave_framer_next(framer, planes)) {
+        size_t first = *count * hop;
+        if (wave_framer_tell(framer) != first) {
+            fprintf(stderr, "frame %zu starts at %lu\n", *count, (unsigned long)wave_framer_tell(framer));
+            return -1;
+        }
+        for (p = 0; p < num_planes; ++p) {
+            for (i = 0; i < options->frame_size; ++i) {
+                if (fabsf(planes[p][i] - expected(options, first, i, p)) > 1e-6f) {
+                    fprintf(stderr, "frame %zu plane %zu sample %zu: %f, expected %f\n", *count, p, i, planes[p][i],
+                            expected(options, first, i, p));
+                    return -1;
+                }
+            }
+        }
+        ++*count;
+    }
+    return wave_err()->code == WAVE_OK ? (long)*count : -1;
+}
+
+static size_t expected_count(WAVE_CONST WaveFramerOptions* options)
+{
+    size_t n = options->frame_size;
+    size_t hop = options->hop_size != 0 ? options->hop_size : n;
+    size_t count = NUM_FRAMES >= n ? (NUM_FRAMES - n) / hop + 1 : 0;
+
+    if (options->pad_end && (count == 0 ? NUM_FRAMES > 0 : (count - 1) * hop + n < NUM_FRAMES) &&
+        count * hop < NUM_FRAMES) {
+        ++count;
+    }
+    return count;
+}
+
+static int check_file(WAVE_CONST WaveFramerOptions* options)
+{
+    WaveFile* fp = wave_open("framer.wav", WAVE_OPEN_READ);
+    WaveFramer* framer = wave_framer_open(fp, options);
+    size_t count = 0;
+
+    if (framer == NULL || wave_err()->code != WAVE_OK || check_frames(framer, options, &count) < 0) {
+        fprintf(stderr, "file, frame size %zu: %s\n", options->frame_size, wave_err()->message);
+        return 1;
+    }
+    if (count != expected_count(options)) {
+        fprintf(stderr, "file, frame size %zu: %zu frames, expected %zu\n", options->frame_size, count, expected_count(options));
+        return 1;
+    }
+    wave_framer_close(framer);
+    wave_close(fp);
+    return 0;
+}
+
+static int check_push(WAVE_CONST WaveFramerOptions* options)
+{
+    WaveFramer* framer = wave_framer_create(NUM_CHANNELS, options);
+    size_t pos = 0, count = 0;
+
+    while (pos < NUM_FRAMES) {
+        size_t n = NUM_FRAMES - pos < PUSH_FRAMES ? NUM_FRAMES - pos : PUSH_FRAMES;
+        pos += wave_framer_push(framer, reference + pos * NUM_CHANNELS, n);
+        if (check_frames(framer, options, &count) < 0) {
+            fprintf(stderr, "push, frame size %zu: %s\n", options->frame_size, wave_err()->message);
+            return 1;
+        }
+    }
+    wave_framer_push(framer, NULL, 0);
+    if (check_frames(framer, options, &count) < 0 || count != expected_count(options)) {
+        fprintf(stderr, "push, frame size %zu: %zu frames, expected %zu\n", options->frame_size, count, expected_count(options));
+        return 1;
+    }
+    wave_framer_close(framer);
+    return 0;
+}
+
+int main(void)
+{
+    WaveFramerOptions options[] = {
+        {400, 160, WAVE_FRAMER_HANN, WAVE_TRUE, WAVE_FALSE},
+        {512, 128, WAVE_FRAMER_HAMMING, WAVE_FALSE, WAVE_TRUE},
+        {2048, 512, WAVE_FRAMER_RECTANGULAR, WAVE_FALSE, WAVE_TRUE},
+        {100, 250, WAVE_FRAMER_HANN, WAVE_FALSE, WAVE_TRUE},
+        {1000, 0, WAVE_FRAMER_RECTANGULAR, WAVE_TRUE, WAVE_FALSE},
+    };
+    WaveFile* fp;
+    size_t i;
+
+    srand(1);
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(rand() % 65536 - 32768);
+    }
+    fp = wave_open("framer.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+
+    fp = wave_open("framer.wav", WAVE_OPEN_READ);
+    if (wave_read_float(fp, reference, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    for (i = 0; i < sizeof(options) / sizeof(options[0]); ++i) {
+        if (check_file(&options[i]) != 0 || check_push(&options[i]) != 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
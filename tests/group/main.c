@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      1000
+#define NUM_CHANNELS    6
+
+static const WaveU16 channels[3] = {2, 1, 3};
+static short frames[NUM_FRAMES * NUM_CHANNELS];
+
+/* sample {c} of the group at frame {i} */
+static short expected(size_t i, size_t c)
+{
+    return (short)(i * NUM_CHANNELS + c);
+}
+
+/* Write the channels of the group from {first_channel} on to {filename}, with {length} frames in the header but only
+ * {stored} of them in the data chunk */
+static void write_member(const char* filename, size_t first_channel, WaveU16 num_channels, WaveU32 sample_rate,
+                         size_t sample_size, size_t length, size_t stored)
+{
+    /* room for {sample_size} bytes per sample; the samples are only meaningful for 2 bytes */
+    short *samples = calloc(length * num_channels, sample_size > sizeof(short) ? sample_size : sizeof(short));
+    WaveFile *fp;
+    size_t i, c;
+
+    for (i = 0; i < length && sample_size == sizeof(short); ++i) {
+        for (c = 0; c < num_channels; ++c) {
+            samples[i * num_channels + c] = expected(i, first_channel + c);
+        }
+    }
+    fp = wave_open(filename, WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, num_channels);
+    wave_set_sample_rate(fp, sample_rate);
+    wave_set_sample_size(fp, sample_size);
+    wave_write(fp, samples, length);
+    wave_close(fp);
+    free(samples);
+
+    if (stored < length) {
+        /* cut the file short, behind the back of the header */
+        FILE *in = fopen(filename, "rb");
+        size_t size = 44 + stored * num_channels * sample_size;
+        unsigned char *bytes = malloc(size);
+
+        size = fread(bytes, 1, size, in);
+        fclose(in);
+        in = fopen(filename, "wb");
+        fwrite(bytes, 1, size, in);
+        fclose(in);
+        free(bytes);
+    }
+}
+
+/* Write channel 2 of the group to {filename} as a mono WAVE_FORMAT_EXTENSIBLE file */
+static void write_extensible(const char* filename, WaveU16 sub_format, size_t sample_size)
+{
+    /* room for {sample_size} bytes per sample; the samples are only meaningful for 2-byte PCM */
+    short *samples = calloc(NUM_FRAMES, sample_size > sizeof(short) ? sample_size : sizeof(short));
+    WaveFile *fp;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES && sample_size == sizeof(short); ++i) {
+        samples[i] = expected(i, 2);
+    }
+    fp = wave_open(filename, WAVE_OPEN_WRITE);
+    wave_set_format(fp, WAVE_FORMAT_EXTENSIBLE);
+    wave_set_sub_format(fp, sub_format);
+    wave_set_num_channels(fp, 1);
+    wave_set_sample_rate(fp, 48000);
+    wave_set_sample_size(fp, sample_size);
+    wave_write(fp, samples, NUM_FRAMES);
+    wave_close(fp);
+    free(samples);
+}
+
+static int check_mismatch(const char* filename, const char* what)
+{
+    const char *filenames[2] = {"group-0.wav", NULL};
+    WaveGroup *group;
+
+    filenames[1] = filename;
+    group = wave_group_open(filenames, 2);
+    if (group == NULL || wave_err()->code != WAVE_ERR_FORMAT) {
+        fprintf(stderr, "a group with another %s: %s\n", what, wave_err()->message);
+        return 1;
+    }
+    wave_err_clear();
+    wave_group_close(group);
+    return 0;
+}
+
+int main(void)
+{
+    const char *filenames[3] = {"group-0.wav", "group-1.wav", "group-2.wav"};
+    WaveGroup *group;
+    size_t i, c, n, threads;
+
+    write_member("group-0.wav", 0, channels[0], 48000, 2, NUM_FRAMES, NUM_FRAMES);
+    write_member("group-1.wav", 2, channels[1], 48000, 2, NUM_FRAMES, NUM_FRAMES);
+    write_member("group-2.wav", 3, channels[2], 48000, 2, NUM_FRAMES, NUM_FRAMES);
+
+    /* with the default threads, with fewer threads than files, and on the calling thread alone */
+    for (threads = 0; threads < 3; ++threads) {
+        group = wave_group_open(filenames, 3);
+        if (threads > 0) {
+            wave_group_set_num_threads(group, threads);
+        }
+        if (wave_err()->code != WAVE_OK || wave_group_get_num_files(group) != 3 ||
+            wave_group_get_num_channels(group) != NUM_CHANNELS || wave_group_get_sample_size(group) != 2 ||
+            wave_group_get_length(group) != NUM_FRAMES)
+        {
+            fprintf(stderr, "open: %s\n", wave_err()->message);
+            return 1;
+        }
+
+        n = wave_group_read(group, frames, 300, WAVE_LAYOUT_INTERLEAVED);
+        for (i = 0; i < n * NUM_CHANNELS; ++i) {
+            if (frames[i] != expected(i / NUM_CHANNELS, i % NUM_CHANNELS)) {
+                fprintf(stderr, "interleaved sample %zu: %d\n", i, frames[i]);
+                return 1;
+            }
+        }
+        if (n != 300 || wave_group_tell(group) != 300) {
+            fprintf(stderr, "interleaved read: %zu %s\n", n, wave_err()->message);
+            return 1;
+        }
+
+        n = wave_group_read(group, frames, 400, WAVE_LAYOUT_PLANAR);
+        for (c = 0; c < NUM_CHANNELS; ++c) {
+            for (i = 0; i < n; ++i) {
+                if (frames[c * 400 + i] != expected(300 + i, c)) {
+                    fprintf(stderr, "planar sample %zu of channel %zu: %d\n", i, c, frames[c * 400 + i]);
+                    return 1;
+                }
+            }
+        }
+        if (n != 400 || wave_group_tell(group) != 700) {
+            fprintf(stderr, "planar read: %zu %s\n", n, wave_err()->message);
+            return 1;
+        }
+
+        /* a read that runs past the end stops there */
+        if (wave_group_seek(group, -50, SEEK_END) != 0 || wave_group_read(group, frames, 100, WAVE_LAYOUT_INTERLEAVED) != 50 ||
+            frames[0] != expected(NUM_FRAMES - 50, 0) || wave_group_read(group, frames, 100, WAVE_LAYOUT_INTERLEAVED) != 0 ||
+            wave_err()->code != WAVE_OK)
+        {
+            fprintf(stderr, "read at the end: %s\n", wave_err()->message);
+            return 1;
+        }
+        wave_group_close(group);
+    }
+
+    /* files that do not line up */
+    write_member("group-short.wav", 2, 1, 48000, 2, NUM_FRAMES - 1, NUM_FRAMES - 1);
+    write_member("group-rate.wav", 2, 1, 44100, 2, NUM_FRAMES, NUM_FRAMES);
+    write_member("group-size.wav", 2, 1, 48000, 3, NUM_FRAMES, NUM_FRAMES);
+    if (check_mismatch("group-short.wav", "length") || check_mismatch("group-rate.wav", "sample rate") ||
+        check_mismatch("group-size.wav", "sample size"))
+    {
+        return 1;
+    }
+
+    /* ADPCM frames cannot be read as raw samples */
+    {
+        WaveFile *fp = wave_open("group-adpcm.wav", WAVE_OPEN_WRITE);
+        wave_set_format(fp, WAVE_FORMAT_IMA_ADPCM);
+        wave_set_sample_rate(fp, 48000);
+        wave_write(fp, frames, NUM_FRAMES);
+        wave_close(fp);
+    }
+    {
+        const char *adpcm[2] = {"group-adpcm.wav", "group-adpcm.wav"};
+        group = wave_group_open(adpcm, 2);
+        if (group == NULL || wave_err()->code != WAVE_ERR_FORMAT) {
+            fprintf(stderr, "a group of ADPCM files: %s\n", wave_err()->message);
+            return 1;
+        }
+        wave_err_clear();
+        wave_group_close(group);
+    }
+
+    /* plain and extensible files with the same samples make a group, other encodings of the same size do not */
+    write_extensible("group-ext.wav", WAVE_FORMAT_PCM, 2);
+    {
+        const char *mixed[3] = {"group-0.wav", "group-ext.wav", "group-2.wav"};
+        group = wave_group_open(mixed, 3);
+        if (wave_err()->code != WAVE_OK || wave_group_read(group, frames, NUM_FRAMES, WAVE_LAYOUT_INTERLEAVED) != NUM_FRAMES) {
+            fprintf(stderr, "a group with an extensible file: %s\n", wave_err()->message);
+            return 1;
+        }
+        for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+            if (frames[i] != expected(i / NUM_CHANNELS, i % NUM_CHANNELS)) {
+                fprintf(stderr, "sample %zu with an extensible file: %d\n", i, frames[i]);
+                return 1;
+            }
+        }
+        wave_group_close(group);
+    }
+    write_extensible("group-ext-pcm.wav", WAVE_FORMAT_PCM, 4);
+    write_extensible("group-ext-float.wav", WAVE_FORMAT_IEEE_FLOAT, 4);
+    {
+        const char *encodings[2] = {"group-ext-pcm.wav", "group-ext-float.wav"};
+        group = wave_group_open(encodings, 2);
+        if (group == NULL || wave_err()->code != WAVE_ERR_FORMAT) {
+            fprintf(stderr, "a group of PCM and float: %s\n", wave_err()->message);
+            return 1;
+        }
+        wave_err_clear();
+        wave_group_close(group);
+    }
+
+    /* a file that ends before its header says, so that the read of one worker fails */
+    write_member("group-1.wav", 2, channels[1], 48000, 2, NUM_FRAMES, NUM_FRAMES / 2);
+    for (threads = 1; threads <= 3; threads += 2) {
+        group = wave_group_open(filenames, 3);
+        wave_group_set_num_threads(group, threads);
+        if (wave_err()->code != WAVE_OK || wave_group_read(group, frames, 400, WAVE_LAYOUT_INTERLEAVED) != 400) {
+            fprintf(stderr, "read before the cut: %s\n", wave_err()->message);
+            return 1;
+        }
+        if (wave_group_read(group, frames, 400, WAVE_LAYOUT_PLANAR) != 0 || wave_err()->code != WAVE_ERR_FORMAT ||
+            strstr(wave_err()->message, "group-1.wav") == NULL || wave_group_tell(group) != 400)
+        {
+            fprintf(stderr, "read across the cut with %zu threads: %s\n", threads, wave_err()->message);
+            return 1;
+        }
+        wave_err_clear();
+        wave_group_close(group);
+    }
+
+    return 0;
+}
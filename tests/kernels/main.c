@@ -0,0 +1,186 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+/* odd, so that every target also runs its scalar tail */
+#define NUM_FRAMES  100003
+
+static float original[NUM_FRAMES * 2];
+static float decoded[NUM_FRAMES * 2];
+static short s16[NUM_FRAMES * 2];
+static int s32[NUM_FRAMES * 2];
+
+/* the conversions of the portable kernels, which every target must reproduce exactly */
+static short expected_s16(float x)
+{
+    if (x >= 32767.0f / 32768.0f) {
+        return 32767;
+    } else if (x <= -1.0f) {
+        return -32768;
+    }
+    return (short)(x * 32768.0f + (x >= 0.0f ? 0.5f : -0.5f));
+}
+
+static int check_s16(void)
+{
+    WaveFile *fp;
+    size_t i;
+
+    fp = wave_open("kernels.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, 2);
+    if (wave_write_float(fp, original, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "write_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("kernels.wav", WAVE_OPEN_READ);
+    if (wave_read(fp, s16, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_rewind(fp);
+    if (wave_read_float(fp, decoded, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        if (s16[i] != expected_s16(original[i])) {
+            fprintf(stderr, "s16 encode %zu: %d instead of %d for %.9g\n", i, s16[i], expected_s16(original[i]), original[i]);
+            return 1;
+        }
+        if (decoded[i] != (float)s16[i] / 32768.0f) {
+            fprintf(stderr, "s16 decode %zu: %.9g\n", i, decoded[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_s32(void)
+{
+    WaveFile *fp;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        s32[i] = (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+    }
+
+    fp = wave_open("kernels.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, 2);
+    wave_set_sample_size(fp, 4);
+    wave_write(fp, s32, NUM_FRAMES);
+    wave_close(fp);
+
+    fp = wave_open("kernels.wav", WAVE_OPEN_READ);
+    if (wave_read_float(fp, decoded, NUM_FRAMES) != NUM_FRAMES) {
+        fprintf(stderr, "read_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        if (decoded[i] != (float)((double)s32[i] / 2147483648.0)) {
+            fprintf(stderr, "s32 decode %zu: %.9g for %d\n", i, decoded[i], s32[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_meter(void)
+{
+    WaveFile *fp;
+    WaveChannelStats stats;
+    double peak = 0.0, sum = 0.0, sum_sq = 0.0;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        double x = original[i * 2];
+        peak = fabs(x) > peak ? fabs(x) : peak;
+        sum += x;
+        sum_sq += x * x;
+    }
+
+    fp = wave_open("kernels.wav", WAVE_OPEN_WRITE);
+    wave_set_format(fp, WAVE_FORMAT_IEEE_FLOAT);
+    wave_set_num_channels(fp, 2);
+    wave_attach_meter(fp, WAVE_METER_PEAK | WAVE_METER_RMS | WAVE_METER_DC);
+    wave_write_float(fp, original, NUM_FRAMES);
+    wave_get_channel_stats(fp, 0, &stats);
+    wave_close(fp);
+
+    /* the targets sum in float blocks of different widths */
+    if (stats.peak != (float)peak || fabs(stats.rms / sqrt(sum_sq / NUM_FRAMES) - 1.0) > 1e-6 || fabs(stats.dc / (sum / NUM_FRAMES) - 1.0) > 1e-5) {
+        fprintf(stderr, "meter: peak %f rms %f dc %f, expected %f %f %f\n",
+                stats.peak, stats.rms, stats.dc, peak, sqrt(sum_sq / NUM_FRAMES), sum / NUM_FRAMES);
+        return 1;
+    }
+    return 0;
+}
+
+/* 1 if the CPU and the OS run the kernels of {target}, 0 if they do not, -1 if this test cannot tell */
+static int cpu_supports(WAVE_CONST char* target)
+{
+    if (strcmp(target, "scalar") == 0) {
+        return 1;
+    }
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (strcmp(target, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2") != 0;
+    } else if (strcmp(target, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2") != 0;
+    } else if (strcmp(target, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f") != 0;
+    }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    if (strcmp(target, "neon") == 0) {
+        return 1;
+    }
+#endif
+    return -1;
+}
+
+int main(void)
+{
+    WAVE_CONST char *limit = getenv("WAVE_KERNELS");
+    WAVE_CONST char *target;
+    size_t i;
+
+    for (i = 0; i < NUM_FRAMES * 2; ++i) {
+        original[i] = (float)(1.2 * sin(0.00731 * (double)i) * cos(0.0001 * (double)i));
+    }
+    /* exact halves and the clipping edges */
+    original[0] = 0.5f / 32768.0f;
+    original[1] = -0.5f / 32768.0f;
+    original[2] = 1.5f / 32768.0f;
+    original[3] = -2.5f / 32768.0f;
+    original[4] = 32767.0f / 32768.0f;
+    original[5] = -1.0f;
+    original[6] = 1e9f;
+    original[7] = -1e9f;
+
+    if (check_s16() != 0 || check_s32() != 0 || check_meter() != 0) {
+        return 1;
+    }
+
+    target = wave_get_kernels_target();
+    printf("kernels: %s\n", target);
+    /* the kernels-<target> tests only name targets that are built, so the CPU is all that can stand in the way */
+    if (limit != NULL && cpu_supports(limit) == 1 && strcmp(target, limit) != 0) {
+        fprintf(stderr, "WAVE_KERNELS=%s ignored, got %s\n", limit, target);
+        return 1;
+    }
+    if (limit != NULL && cpu_supports(limit) == 0 && strcmp(target, limit) == 0) {
+        fprintf(stderr, "WAVE_KERNELS=%s picked on a CPU without it\n", limit);
+        return 1;
+    }
+
+    remove("kernels.wav");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define SAMPLE_RATE     48000
+#define NUM_FRAMES      (SAMPLE_RATE * 10)
+#define NUM_CLIPS       5
+#define CHUNK_FRAMES    4000
+
+static float frames[NUM_FRAMES * 2];
+
+static int check_stats(WaveFile* fp, double amplitude)
+{
+    WaveChannelStats stats;
+    WaveLoudness loudness;
+    size_t c;
+
+    for (c = 0; c < 2; ++c) {
+        wave_get_channel_stats(fp, c, &stats);
+        if (wave_err()->code != WAVE_OK) {
+            fprintf(stderr, "%s\n", wave_err()->message);
+            return 1;
+        }
+        double peak = c == 0 ? 1.0 : amplitude;
+        if (fabs(stats.peak - peak) > 1e-3 || stats.true_peak < stats.peak || (c == 1 && stats.true_peak > amplitude * 1.01)) {
+            fprintf(stderr, "channel %zu: peak %f, true peak %f\n", c, stats.peak, stats.true_peak);
+            return 1;
+        }
+        if (fabs(stats.rms - amplitude / sqrt(2.0)) > 1e-3 || fabs(stats.dc) > 1e-4) {
+            fprintf(stderr, "channel %zu: rms %f, dc %f\n", c, stats.rms, stats.dc);
+            return 1;
+        }
+        if (stats.clips != (c == 0 ? NUM_CLIPS : 0)) {
+            fprintf(stderr, "channel %zu: %llu clips\n", c, (unsigned long long)stats.clips);
+            return 1;
+        }
+    }
+
+    wave_get_loudness(fp, &loudness);
+    if (fabs(loudness.integrated + 23.0) > 0.1 || fabs(loudness.short_term + 23.0) > 0.1 || fabs(loudness.momentary + 23.0) > 0.1) {
+        fprintf(stderr, "loudness: integrated %f, short-term %f, momentary %f\n", loudness.integrated, loudness.short_term, loudness.momentary);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    double amplitude = pow(10.0, -23.0 / 20.0);
+    WaveLoudness loudness;
+    WaveFile *fp;
+    size_t i, done;
+
+    /* a 1 kHz sine in both channels at -23 dBFS is -23 LUFS, with a few full-scale clicks in the left channel that are
+     * too short to change the loudness */
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        float x = (float)(amplitude * sin(2.0 * 3.14159265358979323846 * 1000.0 * (double)i / SAMPLE_RATE));
+        frames[i * 2] = x;
+        frames[i * 2 + 1] = x;
+    }
+    for (i = 0; i < NUM_CLIPS; ++i) {
+        frames[(i + 1) * 12347 * 2] = (i % 2) ? -1.0f : 1.0f;
+    }
+
+    fp = wave_open("meter.wav", WAVE_OPEN_WRITE);
+    wave_set_sample_rate(fp, SAMPLE_RATE);
+    wave_attach_meter(fp, WAVE_METER_ALL);
+    for (done = 0; done < NUM_FRAMES; done += CHUNK_FRAMES) {
+        wave_write_float(fp, frames + done * 2, CHUNK_FRAMES);
+
+        /* the windows only give a loudness once they are full */
+        wave_get_loudness(fp, &loudness);
+        if ((loudness.momentary == -HUGE_VAL) != (done + CHUNK_FRAMES < SAMPLE_RATE * 4 / 10) ||
+            (loudness.short_term == -HUGE_VAL) != (done + CHUNK_FRAMES < SAMPLE_RATE * 3))
+        {
+            fprintf(stderr, "loudness after %zu frames: short-term %f, momentary %f\n", done + CHUNK_FRAMES,
+                    loudness.short_term, loudness.momentary);
+            return 1;
+        }
+    }
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "%s\n", wave_err()->message);
+        return 1;
+    }
+    if (check_stats(fp, amplitude) != 0) {
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("meter.wav", WAVE_OPEN_READ);
+    wave_attach_meter(fp, WAVE_METER_ALL);
+    while (wave_read_float(fp, frames, 3000) > 0) {
+    }
+    if (check_stats(fp, amplitude) != 0) {
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("meter.wav", WAVE_OPEN_READ);
+    wave_get_loudness(fp, &loudness);
+    if (wave_err()->code != WAVE_ERR_MODE) {
+        fprintf(stderr, "loudness without a meter\n");
+        return 1;
+    }
+    wave_close(fp);
+
+    return 0;
+}
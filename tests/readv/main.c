@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES      48000
+#define NUM_CHANNELS    2
+#define RING_FRAMES     1000
+#define BLOCK_FRAMES    384
+
+static short samples[NUM_FRAMES * NUM_CHANNELS];
+static short decoded[NUM_FRAMES * NUM_CHANNELS];
+static short ring[RING_FRAMES * NUM_CHANNELS];
+static float floats[NUM_FRAMES * NUM_CHANNELS];
+static float floats_decoded[NUM_FRAMES * NUM_CHANNELS];
+
+/* The one or two parts of the ring buffer that hold {count} frames from frame {pos} on */
+static size_t ring_segments(WaveIoVec* segments, size_t pos, size_t count)
+{
+    size_t first = pos % RING_FRAMES;
+    size_t n = count < RING_FRAMES - first ? count : RING_FRAMES - first;
+
+    segments[0].buffer = ring + first * NUM_CHANNELS;
+    segments[0].count = n;
+    segments[1].buffer = ring;
+    segments[1].count = count - n;
+    return count > n ? 2 : 1;
+}
+
+int main(void)
+{
+    WaveFile *fp;
+    WaveIoVec segments[100];
+    WaveRegion *corrupt;
+    size_t pos, n, i;
+
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        samples[i] = (short)(i * 7919);
+        floats[i] = (float)((double)samples[i] / 32768.0);
+    }
+
+    /* write through a ring buffer, with the checksums kept up to date by the vectored writes */
+    fp = wave_open("readv.wav", WAVE_OPEN_WRITE | WAVE_OPEN_CHECKSUM);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    for (pos = 0; pos < NUM_FRAMES; pos += n) {
+        size_t num_segments;
+        n = NUM_FRAMES - pos < BLOCK_FRAMES ? NUM_FRAMES - pos : BLOCK_FRAMES;
+        num_segments = ring_segments(segments, pos, n);
+        for (i = 0; i < n; ++i) {
+            memcpy(ring + (pos + i) % RING_FRAMES * NUM_CHANNELS, samples + (pos + i) * NUM_CHANNELS, NUM_CHANNELS * 2);
+        }
+        if (wave_writev(fp, segments, num_segments) != n) {
+            fprintf(stderr, "writev: %s\n", wave_err()->message);
+            return 1;
+        }
+    }
+    wave_close(fp);
+    if (wave_verify("readv.wav", 0, &corrupt) != 0 || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "verify: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* read through the ring buffer, the last read stops at the end of the file */
+    fp = wave_open("readv.wav", WAVE_OPEN_READ | WAVE_OPEN_CHECKSUM);
+    if (wave_get_length(fp) != NUM_FRAMES) {
+        fprintf(stderr, "length: %zu\n", wave_get_length(fp));
+        return 1;
+    }
+    for (pos = 0; pos < NUM_FRAMES; pos += n) {
+        size_t num_segments = ring_segments(segments, pos, BLOCK_FRAMES);
+        n = wave_readv(fp, segments, num_segments);
+        if (n != (NUM_FRAMES - pos < BLOCK_FRAMES ? NUM_FRAMES - pos : BLOCK_FRAMES) || wave_err()->code != WAVE_OK) {
+            fprintf(stderr, "readv at %zu: %zu %s\n", pos, n, wave_err()->message);
+            return 1;
+        }
+        for (i = 0; i < n; ++i) {
+            memcpy(decoded + (pos + i) * NUM_CHANNELS, ring + (pos + i) % RING_FRAMES * NUM_CHANNELS, NUM_CHANNELS * 2);
+        }
+        if (wave_tell(fp) != (long)(pos + n)) {
+            fprintf(stderr, "tell: %ld\n", wave_tell(fp));
+            return 1;
+        }
+    }
+    if (memcmp(decoded, samples, sizeof(samples)) != 0) {
+        fprintf(stderr, "ring read mismatch\n");
+        return 1;
+    }
+
+    /* more segments than one system call takes, mixed with plain reads */
+    wave_seek(fp, 5, SEEK_SET);
+    memset(decoded, 0, sizeof(decoded));
+    for (i = 0; i < 100; ++i) {
+        segments[i].buffer = decoded + (5 + i * 10) * NUM_CHANNELS;
+        segments[i].count = i % 7 == 3 ? 0 : 10;
+    }
+    if (wave_readv(fp, segments, 100) != 860 || wave_read(fp, ring, 1) != 1 ||
+        memcmp(ring, samples + (5 + 860) * NUM_CHANNELS, NUM_CHANNELS * 2) != 0)
+    {
+        fprintf(stderr, "batched readv: %s\n", wave_err()->message);
+        return 1;
+    }
+    for (i = 0, pos = 5; i < 100; pos += segments[i].count, ++i) {
+        if (memcmp(segments[i].buffer, samples + pos * NUM_CHANNELS, segments[i].count * NUM_CHANNELS * 2) != 0) {
+            fprintf(stderr, "batched readv mismatch in segment %zu\n", i);
+            return 1;
+        }
+    }
+    wave_close(fp);
+
+    /* the converting variants, and a write buffer that takes the frames of all segments */
+    fp = wave_open("readv.wav", WAVE_OPEN_WRITE);
+    wave_set_num_channels(fp, NUM_CHANNELS);
+    wave_set_sample_size(fp, 2);
+    wave_set_buffer_size(fp, 4096);
+    segments[0].buffer = floats;
+    segments[0].count = 1000;
+    segments[1].buffer = floats + 1000 * NUM_CHANNELS;
+    segments[1].count = NUM_FRAMES - 1000;
+    if (wave_writev_float(fp, segments, 2) != NUM_FRAMES) {
+        fprintf(stderr, "writev_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+
+    fp = wave_open("readv.wav", WAVE_OPEN_READ);
+    segments[0].buffer = floats_decoded + 20000 * NUM_CHANNELS;
+    segments[0].count = NUM_FRAMES - 20000;
+    segments[1].buffer = floats_decoded;
+    segments[1].count = 20000;
+    if (wave_readv_float(fp, segments, 2) != NUM_FRAMES) {
+        fprintf(stderr, "readv_float: %s\n", wave_err()->message);
+        return 1;
+    }
+    wave_close(fp);
+    for (i = 0; i < NUM_FRAMES * NUM_CHANNELS; ++i) {
+        float expected = floats[(i + (NUM_FRAMES - 20000) * NUM_CHANNELS) % (NUM_FRAMES * NUM_CHANNELS)];
+        if (floats_decoded[i] != expected) {
+            fprintf(stderr, "float sample %zu: %f != %f\n", i, floats_decoded[i], expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
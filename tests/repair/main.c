@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include "wave.h"
+
+#define NUM_FRAMES 1000
+
+static size_t get_length(const char *filename, WaveU32 mode)
+{
+    WaveFile *fp;
+    size_t length;
+
+    wave_err_clear();
+    fp = wave_open(filename, mode);
+    length = wave_get_length(fp);
+    wave_close(fp);
+    return wave_err()->code == WAVE_OK ? length : 0;
+}
+
+int main(void)
+{
+    static short buf[NUM_FRAMES * 2];
+    const WaveU32 zero = 0;
+    WaveFile *fp;
+    FILE *raw;
+    long size;
+
+    /* sizes are only committed on flush */
+    fp = wave_open("repair.wav", WAVE_OPEN_WRITE | WAVE_OPEN_DEFER_SIZES);
+    wave_preallocate(fp, NUM_FRAMES);
+    wave_write(fp, buf, NUM_FRAMES);
+    wave_flush(fp);
+    if (get_length("repair.wav", WAVE_OPEN_READ) != NUM_FRAMES) {
+        fprintf(stderr, "sizes were not written on flush\n");
+        return 1;
+    }
+    wave_close(fp);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "%s\n", wave_err()->message);
+        return 1;
+    }
+
+    /* simulate a crash: stale data size and a partial frame at the end */
+    raw = fopen("repair.wav", "rb+");
+    fseek(raw, 40, SEEK_SET);
+    fwrite(&zero, 4, 1, raw);
+    fseek(raw, 0, SEEK_END);
+    fwrite(buf, 3, 1, raw);
+    fclose(raw);
+
+    if (get_length("repair.wav", WAVE_OPEN_READ) != 0) {
+        fprintf(stderr, "header was not corrupted\n");
+        return 1;
+    }
+    if (get_length("repair.wav", WAVE_OPEN_READ | WAVE_OPEN_REPAIR) != NUM_FRAMES) {
+        fprintf(stderr, "sizes were not recovered on open\n");
+        return 1;
+    }
+
+    if (wave_repair("repair.wav") != WAVE_OK) {
+        fprintf(stderr, "repair: %s\n", wave_err()->message);
+        return 1;
+    }
+    if (get_length("repair.wav", WAVE_OPEN_READ) != NUM_FRAMES) {
+        fprintf(stderr, "sizes were not repaired\n");
+        return 1;
+    }
+
+    raw = fopen("repair.wav", "rb");
+    fseek(raw, 0, SEEK_END);
+    size = ftell(raw);
+    fclose(raw);
+    if (size != 44 + NUM_FRAMES * 4) {
+        fprintf(stderr, "partial frame was not truncated: %ld bytes\n", size);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FRAMES 10000
+
+static size_t g_num_segments = 0;
+static size_t g_segment_frames[8];
+
+static void on_segment(void *context, const char *filename, size_t num_frames)
+{
+    (void)context;
+    (void)filename;
+    if (g_num_segments < 8) {
+        g_segment_frames[g_num_segments] = num_frames;
+    }
+    ++g_num_segments;
+}
+
+int main(void)
+{
+    static short buf[NUM_FRAMES];
+    static const size_t expected_frames[] = {3000, 3000, 1000, 3000};
+    WaveSegmentOptions options;
+    WaveSegmentWriter *writer;
+    size_t i, pos = 0;
+    short expected = 0;
+
+    for (i = 0; i < NUM_FRAMES; ++i) {
+        buf[i] = (short)i;
+    }
+
+    memset(&options, 0, sizeof(options));
+    options.format = WAVE_FORMAT_PCM;
+    options.num_channels = 1;
+    options.sample_rate = 16000;
+    options.sample_size = 2;
+    options.max_frames = 3000;
+    options.on_segment = on_segment;
+
+    writer = wave_segment_open("segment-%u.wav", &options);
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "open: %s\n", wave_err()->message);
+        return 1;
+    }
+
+    while (pos < 7000) {
+        size_t n = 7000 - pos < 77 ? 7000 - pos : 77;
+        pos += wave_segment_write(writer, buf + pos, n);
+        if (wave_err()->code != WAVE_OK) {
+            fprintf(stderr, "write: %s\n", wave_err()->message);
+            return 1;
+        }
+    }
+    wave_segment_split(writer);
+    pos += wave_segment_write(writer, buf + pos, NUM_FRAMES - pos);
+    wave_segment_close(writer);
+
+    if (pos != NUM_FRAMES || g_num_segments != 4) {
+        fprintf(stderr, "wrote %zu frames in %zu segments\n", pos, g_num_segments);
+        return 1;
+    }
+
+    for (i = 0; i < 4; ++i) {
+        char filename[32];
+        short samples[3000];
+        size_t j, n;
+        WaveFile *fp;
+
+        if (g_segment_frames[i] != expected_frames[i]) {
+            fprintf(stderr, "segment %zu has %zu frames\n", i, g_segment_frames[i]);
+            return 1;
+        }
+
+        sprintf(filename, "segment-%zu.wav", i);
+        fp = wave_open(filename, WAVE_OPEN_READ);
+        n = wave_read(fp, samples, 3000);
+        wave_close(fp);
+        if (wave_err()->code != WAVE_OK || n != expected_frames[i]) {
+            fprintf(stderr, "%s: read %zu frames\n", filename, n);
+            return 1;
+        }
+        for (j = 0; j < n; ++j) {
+            if (samples[j] != expected++) {
+                fprintf(stderr, "%s: mismatch at frame %zu\n", filename, j);
+                return 1;
+            }
+        }
+    }
+
+    if (fopen("segment-4.wav", "rb") != NULL) {
+        fprintf(stderr, "unused segment was not removed\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+#define NUM_FILES       3
+#define NUM_WINDOWS     500
+#define WINDOW_FRAMES   256
+
+static const char *filenames[NUM_FILES] = {"windows0.wav", "windows1.wav", "windows2.wav"};
+static const size_t lengths[NUM_FILES] = {20000, 5000, 12000};
+
+static short sample_of(size_t file, size_t frame, size_t channel)
+{
+    return (short)((file * 1000003 + frame * 7919 + channel * 104729) & 0x7fff) - 0x4000;
+}
+
+static int write_files(void)
+{
+    static short pcm[20000 * 2];
+    static float flt[20000 * 2];
+    size_t f, i;
+
+    for (f = 0; f < NUM_FILES; ++f) {
+        WaveFile *fp = wave_open(filenames[f], WAVE_OPEN_WRITE);
+        for (i = 0; i < lengths[f] * 2; ++i) {
+            pcm[i] = sample_of(f, i / 2, i % 2);
+            flt[i] = (float)pcm[i] / 32768.0f;
+        }
+        if (f == 2) {
+            wave_set_format(fp, WAVE_FORMAT_IEEE_FLOAT);
+            wave_write(fp, flt, lengths[f]);
+        } else {
+            wave_write(fp, pcm, lengths[f]);
+        }
+        wave_close(fp);
+    }
+
+    return wave_err()->code != WAVE_OK;
+}
+
+static int check_batch(const WaveWindow *windows, const float *out, const size_t *frames_read)
+{
+    size_t w, i;
+
+    for (w = 0; w < NUM_WINDOWS; ++w) {
+        size_t file = (size_t)(windows[w].filename[7] - '0');
+        size_t avail = windows[w].first_frame < lengths[file] ? lengths[file] - windows[w].first_frame : 0;
+
+        if (avail > windows[w].num_frames) {
+            avail = windows[w].num_frames;
+        }
+        if (frames_read[w] != avail) {
+            fprintf(stderr, "window %zu: %zu frames instead of %zu\n", w, frames_read[w], avail);
+            return 1;
+        }
+        for (i = 0; i < WINDOW_FRAMES * 2; ++i) {
+            float expected = i / 2 < avail ? (float)sample_of(file, windows[w].first_frame + i / 2, i % 2) / 32768.0f : 0.0f;
+            if (fabsf(out[w * WINDOW_FRAMES * 2 + i] - expected) > 1e-6f) {
+                fprintf(stderr, "window %zu: wrong sample %zu\n", w, i);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    static WaveWindow windows[NUM_WINDOWS];
+    static float out[NUM_WINDOWS * WINDOW_FRAMES * 2];
+    static size_t frames_read[NUM_WINDOWS];
+    WaveWindowOptions options;
+    size_t i, n;
+
+    if (write_files()) {
+        fprintf(stderr, "%s\n", wave_err()->message);
+        return 1;
+    }
+
+    srand(7);
+    for (i = 0; i < NUM_WINDOWS; ++i) {
+        size_t file = (size_t)rand() % NUM_FILES;
+        windows[i].filename = filenames[file];
+        windows[i].first_frame = (size_t)rand() % (lengths[file] + 100);
+        windows[i].num_frames = 1 + (size_t)rand() % WINDOW_FRAMES;
+    }
+
+    memset(&options, 0, sizeof(options));
+    options.window_frames = WINDOW_FRAMES;
+    options.merge_gap = 64;
+    options.pad_past_end = WAVE_TRUE;
+    options.frames_read = frames_read;
+    options.cache = wave_cache_create(1 << 20, 0);
+
+    n = wave_read_windows(windows, NUM_WINDOWS, out, &options);
+    if (n != NUM_WINDOWS || wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "read %zu windows: %s\n", n, wave_err()->message);
+        return 1;
+    }
+    if (check_batch(windows, out, frames_read)) {
+        return 1;
+    }
+
+    /* the same batch without a cache and on a single thread */
+    wave_cache_destroy(options.cache);
+    options.cache = NULL;
+    options.num_threads = 1;
+    memset(out, 0xff, sizeof(out));
+    n = wave_read_windows(windows, NUM_WINDOWS, out, &options);
+    if (n != NUM_WINDOWS || wave_err()->code != WAVE_OK || check_batch(windows, out, frames_read)) {
+        fprintf(stderr, "uncached batch failed\n");
+        return 1;
+    }
+
+    /* without padding, windows past the end fail and the others are still read */
+    options.pad_past_end = WAVE_FALSE;
+    options.num_threads = 0;
+    n = wave_read_windows(windows, NUM_WINDOWS, out, &options);
+    if (n == NUM_WINDOWS || n == 0 || wave_err()->code != WAVE_ERR_PARAM) {
+        fprintf(stderr, "windows past the end were not reported\n");
+        return 1;
+    }
+    wave_err_clear();
+
+    return 0;
+}
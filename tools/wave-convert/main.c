@@ -0,0 +1,1007 @@
+/** wave-convert: convert wav files in parallel
+ *
+ * Every input file is planned as one or more tasks, each converting a range of output frames. Files longer than the
+ * split size are written as several parts that are joined with {wave_concat} once the last part is done. The tasks are
+ * dealt to per-thread queues, largest first, and idle threads steal from the back of the other queues.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wave.h"
+
+#define CHUNK_FRAMES            ((size_t)1 << 16)
+#define OUTPUT_BUFFER_SIZE      ((size_t)1 << 20)
+#define DEFAULT_SPLIT_FRAMES    ((size_t)1 << 22)
+
+typedef struct {
+    WaveU16         format;         /* 0 to keep the input format */
+    WaveU16         sample_format;  /* the encoding of the samples, the sub format of WAVE_FORMAT_EXTENSIBLE */
+    size_t          sample_size;    /* 0 for the default of the format */
+    WaveU16         num_channels;   /* 0 to keep the input channels */
+    WaveU32         sample_rate;    /* 0 to keep the input rate */
+    size_t          num_threads;
+    size_t          split_frames;
+    int             dry_run;
+    int             quiet;
+    const char*     output_dir;
+} Options;
+
+typedef struct {
+    char*           input;
+    char*           output;
+
+    WaveU16         in_format;
+    WaveU16         in_sample_format;
+    WaveU16         in_channels;
+    WaveU32         in_rate;
+    size_t          in_frame_bits;
+    size_t          in_length;
+
+    WaveU16         out_format;
+    WaveU16         out_sample_format;
+    size_t          out_sample_size;
+    WaveU16         out_valid_bits;     /* 0 for the whole sample */
+    WaveU32         out_channel_mask;   /* 0 for none */
+    WaveU16         out_channels;
+    WaveU32         out_rate;
+    size_t          out_frame_bits;
+    size_t          out_length;
+
+    size_t          num_parts;
+
+    /* protected by the lock of the converter */
+    size_t          parts_left;
+    char*           error;
+} Job;
+
+typedef struct {
+    Job*            job;
+    size_t          part;
+    size_t          first;
+    size_t          count;
+} Task;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Task**          tasks;
+    size_t          head;
+    size_t          tail;
+} Queue;
+
+typedef struct {
+    Options         options;
+    Job*            jobs;
+    size_t          num_jobs;
+    Task*           tasks;
+    size_t          num_tasks;
+    Queue*          queues;
+    size_t          num_queues;     /* the queues with an initialized lock */
+
+    pthread_mutex_t lock;
+    pthread_cond_t  idle;
+    size_t          jobs_done;
+    size_t          jobs_failed;
+    size_t          workers_running;
+    WaveU64         bytes_read;
+    WaveU64         bytes_written;
+} Converter;
+
+typedef struct {
+    Converter*      converter;
+    size_t          index;
+} Worker;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double mib(WaveU64 bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+static char* path_join(const char* dir, const char* name)
+{
+    size_t len = strlen(dir);
+    char  *path = malloc(len + strlen(name) + 2);
+
+    if (path != NULL) {
+        sprintf(path, "%s%s%s", dir, len > 0 && dir[len - 1] == '/' ? "" : "/", name);
+    }
+    return path;
+}
+
+static int has_wav_suffix(const char* name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".wav") == 0;
+}
+
+/* Create the parent directories of {path} */
+static int make_parents(char* path)
+{
+    char *p;
+
+    for (p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+            fprintf(stderr, "wave-convert: cannot create %s: %s\n", path, strerror(errno));
+            *p = '/';
+            return -1;
+        }
+        *p = '/';
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------------------ */
+/* planning */
+
+static int is_adpcm(WaveU16 format)
+{
+    return format == WAVE_FORMAT_IMA_ADPCM || format == WAVE_FORMAT_ADPCM;
+}
+
+/* Parse an output format into its format code and the encoding of its samples, returns 0 for an unknown name */
+static int parse_format(const char* name, WaveU16* format, WaveU16* sample_format)
+{
+    int extensible = strncmp(name, "ext-", 4) == 0;
+
+    if (extensible) {
+        name += 4;
+    }
+
+    if (strcmp(name, "pcm") == 0) {
+        *sample_format = WAVE_FORMAT_PCM;
+    } else if (strcmp(name, "float") == 0) {
+        *sample_format = WAVE_FORMAT_IEEE_FLOAT;
+    } else if (strcmp(name, "alaw") == 0) {
+        *sample_format = WAVE_FORMAT_ALAW;
+    } else if (strcmp(name, "mulaw") == 0 || strcmp(name, "ulaw") == 0) {
+        *sample_format = WAVE_FORMAT_MULAW;
+    } else if (strcmp(name, "ima") == 0 && !extensible) {
+        *sample_format = WAVE_FORMAT_IMA_ADPCM;
+    } else if (strcmp(name, "msadpcm") == 0 && !extensible) {
+        *sample_format = WAVE_FORMAT_ADPCM;
+    } else {
+        return 0;
+    }
+
+    *format = extensible ? WAVE_FORMAT_EXTENSIBLE : *sample_format;
+    return 1;
+}
+
+/* The encoding of the samples of {file}, which is the sub format of an extensible file */
+static WaveU16 get_sample_format(WaveFile* file)
+{
+    return wave_get_format(file) == WAVE_FORMAT_EXTENSIBLE ? wave_get_sub_format(file) : wave_get_format(file);
+}
+
+static size_t default_sample_size(WaveU16 sample_format)
+{
+    switch (sample_format) {
+        case WAVE_FORMAT_IEEE_FLOAT: return 4;
+        case WAVE_FORMAT_ALAW:
+        case WAVE_FORMAT_MULAW: return 1;
+        default: return 2;
+    }
+}
+
+/* ADPCM is read and written as 16-bit frames */
+static int is_valid_sample_size(WaveU16 sample_format, size_t sample_size)
+{
+    switch (sample_format) {
+        case WAVE_FORMAT_PCM: return sample_size >= 1 && sample_size <= 4;
+        case WAVE_FORMAT_IEEE_FLOAT: return sample_size == 4 || sample_size == 8;
+        case WAVE_FORMAT_ALAW:
+        case WAVE_FORMAT_MULAW: return sample_size == 1;
+        case WAVE_FORMAT_IMA_ADPCM:
+        case WAVE_FORMAT_ADPCM: return sample_size == 2;
+        default: return 0;
+    }
+}
+
+/* The bits a frame takes in the file, for the I/O statistics; ADPCM stores about 4 bits per sample */
+static size_t frame_bits(WaveU16 sample_format, size_t sample_size, size_t num_channels)
+{
+    return (is_adpcm(sample_format) ? 4 : 8 * sample_size) * num_channels;
+}
+
+static int add_job(Converter* self, const char* input, const char* relative)
+{
+    const Options *options = &self->options;
+    WaveFile      *file;
+    Job           *jobs, *job;
+    struct stat    in_stat, out_stat;
+    size_t         in_sample_size;
+    WaveU16        in_valid_bits;
+    WaveU32        in_channel_mask;
+
+    jobs = realloc(self->jobs, sizeof(Job) * (self->num_jobs + 1));
+    if (jobs == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        return -1;
+    }
+    self->jobs = jobs;
+    job = &jobs[self->num_jobs];
+    memset(job, 0, sizeof(Job));
+
+    file = wave_open(input, WAVE_OPEN_READ);
+    if (file == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        return -1;
+    }
+    if (wave_err()->code != WAVE_OK) {
+        fprintf(stderr, "wave-convert: skipping %s: %s\n", input, wave_err()->message);
+        wave_err_clear();
+        wave_close(file);
+        return 0;
+    }
+
+    in_sample_size = wave_get_sample_size(file);
+    in_valid_bits = wave_get_valid_bits_per_sample(file);
+    in_channel_mask = wave_get_channel_mask(file);
+    job->in_format = wave_get_format(file);
+    job->in_sample_format = get_sample_format(file);
+    job->in_channels = wave_get_num_channels(file);
+    job->in_rate = wave_get_sample_rate(file);
+    job->in_frame_bits = frame_bits(job->in_sample_format, in_sample_size, job->in_channels);
+    job->in_length = wave_get_length(file);
+
+    if (!is_valid_sample_size(job->in_sample_format, in_sample_size)) {
+        fprintf(stderr, "wave-convert: skipping %s: unsupported sample format 0x%04x/%zu bytes\n", input, job->in_sample_format, in_sample_size);
+        wave_close(file);
+        return 0;
+    }
+    wave_close(file);
+
+    job->out_format = options->format != 0 ? options->format : job->in_format;
+    job->out_sample_format = options->format != 0 ? options->sample_format : job->in_sample_format;
+    if (options->sample_size != 0) {
+        job->out_sample_size = options->sample_size;
+    } else if (job->out_sample_format == job->in_sample_format) {
+        job->out_sample_size = in_sample_size;
+    } else {
+        job->out_sample_size = default_sample_size(job->out_sample_format);
+    }
+    if (!is_valid_sample_size(job->out_sample_format, job->out_sample_size)) {
+        fprintf(stderr, "wave-convert: invalid sample size %zu for format 0x%04x\n", job->out_sample_size, job->out_sample_format);
+        return -1;
+    }
+    job->out_channels = options->num_channels != 0 ? options->num_channels : job->in_channels;
+    job->out_rate = options->sample_rate != 0 ? options->sample_rate : job->in_rate;
+    job->out_frame_bits = frame_bits(job->out_sample_format, job->out_sample_size, job->out_channels);
+
+    /* an extensible output keeps the valid bits and the speaker positions of an extensible input where they still fit */
+    if (job->out_format == WAVE_FORMAT_EXTENSIBLE && job->in_format == WAVE_FORMAT_EXTENSIBLE) {
+        if (job->out_sample_format == job->in_sample_format && job->out_sample_size == in_sample_size) {
+            job->out_valid_bits = in_valid_bits;
+        }
+        if (job->out_channels == job->in_channels) {
+            job->out_channel_mask = in_channel_mask;
+        }
+    }
+
+    if (job->out_rate == job->in_rate || job->in_length == 0) {
+        job->out_length = job->in_length;
+    } else {
+        job->out_length = (size_t)((WaveU64)(job->in_length - 1) * job->out_rate / job->in_rate) + 1;
+    }
+
+    /* ADPCM is encoded in one pass from the first frame, and {wave_concat} cannot join ADPCM parts */
+    job->num_parts = 1;
+    if (options->num_threads > 1 && options->split_frames > 0 && job->out_length > options->split_frames &&
+        !is_adpcm(job->out_format))
+    {
+        job->num_parts = (job->out_length + options->split_frames - 1) / options->split_frames;
+    }
+    job->parts_left = job->num_parts;
+
+    job->input = strdup(input);
+    job->output = path_join(options->output_dir, relative);
+    if (job->input == NULL || job->output == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        free(job->input);
+        free(job->output);
+        return -1;
+    }
+
+    if (stat(job->output, &out_stat) == 0 && stat(input, &in_stat) == 0 &&
+        out_stat.st_dev == in_stat.st_dev && out_stat.st_ino == in_stat.st_ino)
+    {
+        fprintf(stderr, "wave-convert: refusing to overwrite the input %s\n", input);
+        free(job->input);
+        free(job->output);
+        return -1;
+    }
+
+    ++self->num_jobs;
+    return 0;
+}
+
+static int add_directory(Converter* self, const char* dir, const char* relative)
+{
+    DIR           *d = opendir(dir);
+    struct dirent *entry;
+    int            ret = 0;
+
+    if (d == NULL) {
+        fprintf(stderr, "wave-convert: cannot open %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    while (ret == 0 && (entry = readdir(d)) != NULL) {
+        struct stat st;
+        char       *path, *rel;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        path = path_join(dir, entry->d_name);
+        rel = relative[0] != '\0' ? path_join(relative, entry->d_name) : strdup(entry->d_name);
+        if (path == NULL || rel == NULL) {
+            fprintf(stderr, "wave-convert: out of memory\n");
+            ret = -1;
+        } else if (stat(path, &st) != 0) {
+            fprintf(stderr, "wave-convert: cannot stat %s: %s\n", path, strerror(errno));
+        } else if (S_ISDIR(st.st_mode)) {
+            ret = add_directory(self, path, rel);
+        } else if (S_ISREG(st.st_mode) && has_wav_suffix(entry->d_name)) {
+            ret = add_job(self, path, rel);
+        }
+
+        free(path);
+        free(rel);
+    }
+
+    closedir(d);
+    return ret;
+}
+
+static int compare_tasks(const void* a, const void* b)
+{
+    const Task *ta = *(Task* const*)a;
+    const Task *tb = *(Task* const*)b;
+    return ta->count < tb->count ? 1 : ta->count > tb->count ? -1 : 0;
+}
+
+/* Cut every job into tasks and deal them to the per-thread queues, largest first */
+static int plan_tasks(Converter* self)
+{
+    size_t  num_threads = self->options.num_threads;
+    Task  **sorted;
+    size_t  i, j, t = 0;
+
+    for (i = 0; i < self->num_jobs; ++i) {
+        self->num_tasks += self->jobs[i].num_parts;
+    }
+
+    self->tasks = calloc(self->num_tasks, sizeof(Task));
+    sorted = calloc(self->num_tasks, sizeof(Task*));
+    self->queues = calloc(num_threads, sizeof(Queue));
+    if ((self->num_tasks > 0 && (self->tasks == NULL || sorted == NULL)) || self->queues == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        free(sorted);
+        return -1;
+    }
+
+    for (i = 0; i < self->num_jobs; ++i) {
+        Job   *job = &self->jobs[i];
+        size_t part_frames = (job->out_length + job->num_parts - 1) / job->num_parts;
+
+        for (j = 0; j < job->num_parts; ++j) {
+            Task *task = &self->tasks[t];
+            task->job = job;
+            task->part = j;
+            task->first = j * part_frames;
+            task->count = j + 1 < job->num_parts ? part_frames : job->out_length - task->first;
+            sorted[t++] = task;
+        }
+    }
+    qsort(sorted, self->num_tasks, sizeof(Task*), compare_tasks);
+
+    for (i = 0; i < num_threads; ++i) {
+        Queue *queue = &self->queues[i];
+        pthread_mutex_init(&queue->lock, NULL);
+        ++self->num_queues;
+        queue->tasks = calloc(self->num_tasks / num_threads + 1, sizeof(Task*));
+        if (queue->tasks == NULL) {
+            fprintf(stderr, "wave-convert: out of memory\n");
+            free(sorted);
+            return -1;
+        }
+    }
+    for (t = 0; t < self->num_tasks; ++t) {
+        Queue *queue = &self->queues[t % num_threads];
+        queue->tasks[queue->tail++] = sorted[t];
+    }
+
+    free(sorted);
+    return 0;
+}
+
+/* Release the jobs, the tasks and the queues, once the workers have stopped */
+static void free_converter(Converter* self)
+{
+    size_t i;
+
+    for (i = 0; i < self->num_queues; ++i) {
+        pthread_mutex_destroy(&self->queues[i].lock);
+        free(self->queues[i].tasks);
+    }
+    free(self->queues);
+    free(self->tasks);
+
+    for (i = 0; i < self->num_jobs; ++i) {
+        free(self->jobs[i].input);
+        free(self->jobs[i].output);
+        free(self->jobs[i].error);
+    }
+    free(self->jobs);
+}
+
+/* ------------------------------------------------------------------------------------------------------------------ */
+/* conversion */
+
+/* Mix {n} frames: fewer output channels average the inputs that fold onto them, more output channels repeat the inputs */
+static void remix(float* dst, size_t dst_channels, const float* src, size_t src_channels, size_t n)
+{
+    size_t f, c;
+
+    if (dst_channels >= src_channels) {
+        for (f = 0; f < n; ++f) {
+            for (c = 0; c < dst_channels; ++c) {
+                dst[f * dst_channels + c] = src[f * src_channels + c % src_channels];
+            }
+        }
+        return;
+    }
+
+    for (f = 0; f < n; ++f) {
+        for (c = 0; c < dst_channels; ++c) {
+            float  sum = 0.0f;
+            size_t k, num = 0;
+            for (k = c; k < src_channels; k += dst_channels) {
+                sum += src[f * src_channels + k];
+                ++num;
+            }
+            dst[f * dst_channels + c] = sum / (float)num;
+        }
+    }
+}
+
+/* Linear interpolation of output frames [first, first + n) from input frames starting at {src_first} */
+static void resample(float* dst, const float* src, size_t src_first, size_t src_count, size_t num_channels,
+                     WaveU32 in_rate, WaveU32 out_rate, size_t first, size_t n)
+{
+    size_t k, c;
+
+    for (k = 0; k < n; ++k) {
+        WaveU64 pos = (WaveU64)(first + k) * in_rate;
+        size_t  i0 = (size_t)(pos / out_rate) - src_first;
+        size_t  i1 = i0 + 1 < src_count ? i0 + 1 : i0;
+        float   frac = (float)(pos % out_rate) / (float)out_rate;
+
+        for (c = 0; c < num_channels; ++c) {
+            float a = src[i0 * num_channels + c];
+            float b = src[i1 * num_channels + c];
+            dst[k * num_channels + c] = a + (b - a) * frac;
+        }
+    }
+}
+
+static char* part_name(const Job* job, size_t part)
+{
+    char *name;
+
+    if (job->num_parts == 1) {
+        return strdup(job->output);
+    }
+
+    name = malloc(strlen(job->output) + 32);
+    if (name != NULL) {
+        sprintf(name, "%s.part%zu", job->output, part);
+    }
+    return name;
+}
+
+static WaveFile* create_output(const Job* job, const char* filename)
+{
+    WaveFile *file = wave_open(filename, WAVE_OPEN_WRITE | WAVE_OPEN_DEFER_SIZES);
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (wave_err()->code == WAVE_OK) {
+        wave_set_format(file, job->out_format);
+    }
+    if (wave_err()->code == WAVE_OK && job->out_format == WAVE_FORMAT_EXTENSIBLE) {
+        wave_set_sub_format(file, job->out_sample_format);
+    }
+    if (wave_err()->code == WAVE_OK) {
+        wave_set_num_channels(file, job->out_channels);
+    }
+    if (wave_err()->code == WAVE_OK) {
+        wave_set_sample_rate(file, job->out_rate);
+    }
+    if (wave_err()->code == WAVE_OK && !is_adpcm(job->out_format)) {
+        wave_set_sample_size(file, job->out_sample_size);
+    }
+    if (wave_err()->code == WAVE_OK && job->out_valid_bits != 0) {
+        wave_set_valid_bits_per_sample(file, job->out_valid_bits);
+    }
+    if (wave_err()->code == WAVE_OK && job->out_channel_mask != 0) {
+        wave_set_channel_mask(file, job->out_channel_mask);
+    }
+    if (wave_err()->code == WAVE_OK) {
+        wave_set_buffer_size(file, OUTPUT_BUFFER_SIZE);
+    }
+    return file;
+}
+
+static void convert_task(Converter* self, const Task* task)
+{
+    const Job *job = task->job;
+    int        resampling = job->out_rate != job->in_rate;
+    size_t     in_chunk = resampling ? (size_t)((WaveU64)CHUNK_FRAMES * job->in_rate / job->out_rate) + 2 : CHUNK_FRAMES;
+    size_t     mix_channels = job->in_channels > job->out_channels ? job->in_channels : job->out_channels;
+    float     *in_buf = malloc(in_chunk * mix_channels * sizeof(float));
+    float     *mix_buf = malloc(in_chunk * job->out_channels * sizeof(float));
+    float     *out_buf = malloc(CHUNK_FRAMES * job->out_channels * sizeof(float));
+    char      *filename = part_name(job, task->part);
+    WaveFile  *in = NULL, *out = NULL;
+    const char *short_io = NULL;
+    size_t     j, end = task->first + task->count;
+
+    if (in_buf == NULL || mix_buf == NULL || out_buf == NULL || filename == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    in = wave_open(job->input, WAVE_OPEN_READ);
+    if (in != NULL && wave_err()->code == WAVE_OK) {
+        out = create_output(job, filename);
+    }
+
+    for (j = task->first; j < end && in != NULL && out != NULL && wave_err()->code == WAVE_OK; j += CHUNK_FRAMES) {
+        size_t n = end - j < CHUNK_FRAMES ? end - j : CHUNK_FRAMES;
+        size_t in_first = j, in_count = n;
+        float *mixed, *converted;
+
+        if (resampling) {
+            size_t in_last = (size_t)((WaveU64)(j + n - 1) * job->in_rate / job->out_rate) + 1;
+            in_first = (size_t)((WaveU64)j * job->in_rate / job->out_rate);
+            in_last = in_last < job->in_length ? in_last : job->in_length - 1;
+            in_count = in_last - in_first + 1;
+        }
+
+        if (wave_seek(in, (long)in_first, SEEK_SET) != 0 || wave_read_float(in, in_buf, in_count) != in_count) {
+            short_io = "short read";
+            break;
+        }
+
+        mixed = in_buf;
+        if (job->out_channels != job->in_channels) {
+            remix(mix_buf, job->out_channels, in_buf, job->in_channels, in_count);
+            mixed = mix_buf;
+        }
+
+        converted = mixed;
+        if (resampling) {
+            resample(out_buf, mixed, in_first, in_count, job->out_channels, job->in_rate, job->out_rate, j, n);
+            converted = out_buf;
+        }
+
+        if (wave_write_float(out, converted, n) != n) {
+            short_io = "short write";
+            break;
+        }
+
+        pthread_mutex_lock(&self->lock);
+        self->bytes_read += (WaveU64)in_count * job->in_frame_bits / 8;
+        self->bytes_written += (WaveU64)n * job->out_frame_bits / 8;
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    if (out != NULL) {
+        wave_close(out);
+    }
+    if (in != NULL) {
+        wave_close(in);
+    }
+
+    pthread_mutex_lock(&self->lock);
+    if (wave_err()->code != WAVE_OK && task->job->error == NULL) {
+        task->job->error = strdup(wave_err()->message);
+    } else if ((in == NULL || out == NULL) && task->job->error == NULL) {
+        task->job->error = strdup("out of memory");
+    } else if (short_io != NULL && task->job->error == NULL) {
+        task->job->error = strdup(short_io);
+    }
+    pthread_mutex_unlock(&self->lock);
+    wave_err_clear();
+
+    free(filename);
+    free(out_buf);
+    free(mix_buf);
+    free(in_buf);
+}
+
+/* Join the parts of a split job into the final output and remove them */
+static void join_parts(Job* job)
+{
+    WaveFile **parts = calloc(job->num_parts, sizeof(WaveFile*));
+    WaveFile  *out;
+    size_t     i;
+
+    if (parts == NULL) {
+        job->error = strdup("out of memory");
+        return;
+    }
+
+    out = wave_open(job->output, WAVE_OPEN_WRITE);
+    for (i = 0; i < job->num_parts && out != NULL && wave_err()->code == WAVE_OK; ++i) {
+        char *name = part_name(job, i);
+        parts[i] = name != NULL ? wave_open(name, WAVE_OPEN_READ) : NULL;
+        free(name);
+        if (parts[i] == NULL) {
+            break;
+        }
+    }
+    if (out != NULL && i == job->num_parts && wave_err()->code == WAVE_OK) {
+        wave_concat(parts, job->num_parts, out);
+    }
+
+    if (wave_err()->code != WAVE_OK) {
+        job->error = strdup(wave_err()->message);
+        wave_err_clear();
+    } else if (out == NULL || i < job->num_parts) {
+        job->error = strdup("out of memory");
+    }
+
+    for (i = 0; i < job->num_parts; ++i) {
+        char *name = part_name(job, i);
+        if (parts[i] != NULL) {
+            wave_close(parts[i]);
+        }
+        if (name != NULL) {
+            remove(name);
+        }
+        free(name);
+    }
+    if (out != NULL) {
+        wave_close(out);
+    }
+    wave_err_clear();
+    free(parts);
+}
+
+static void finish_task(Converter* self, const Task* task)
+{
+    Job *job = task->job;
+    int  last;
+
+    pthread_mutex_lock(&self->lock);
+    last = --job->parts_left == 0;
+    pthread_mutex_unlock(&self->lock);
+
+    if (!last) {
+        return;
+    }
+
+    if (job->num_parts > 1 && job->error == NULL) {
+        join_parts(job);
+    } else if (job->num_parts > 1) {
+        size_t i;
+        for (i = 0; i < job->num_parts; ++i) {
+            char *name = part_name(job, i);
+            if (name != NULL) {
+                remove(name);
+            }
+            free(name);
+        }
+    }
+    if (job->error != NULL) {
+        remove(job->output);
+    }
+
+    pthread_mutex_lock(&self->lock);
+    ++self->jobs_done;
+    if (job->error != NULL) {
+        ++self->jobs_failed;
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+static Task* pop_task(Converter* self, size_t index)
+{
+    Queue *queue = &self->queues[index];
+    Task  *task = NULL;
+    size_t k;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        task = queue->tasks[queue->head++];
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    /* steal the smallest task of another queue, leaving its owner the large ones */
+    for (k = 1; task == NULL && k < self->options.num_threads; ++k) {
+        Queue *victim = &self->queues[(index + k) % self->options.num_threads];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            task = victim->tasks[--victim->tail];
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    return task;
+}
+
+static void* worker_main(void* arg)
+{
+    Worker    *worker = arg;
+    Converter *self = worker->converter;
+    Task      *task;
+
+    while ((task = pop_task(self, worker->index)) != NULL) {
+        convert_task(self, task);
+        finish_task(self, task);
+    }
+
+    pthread_mutex_lock(&self->lock);
+    if (--self->workers_running == 0) {
+        pthread_cond_signal(&self->idle);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------------------------------------------------ */
+
+static void print_progress(Converter* self, double elapsed, int final)
+{
+    WaveU64 read, written;
+    size_t  done, failed;
+
+    pthread_mutex_lock(&self->lock);
+    read = self->bytes_read;
+    written = self->bytes_written;
+    done = self->jobs_done;
+    failed = self->jobs_failed;
+    pthread_mutex_unlock(&self->lock);
+
+    fprintf(stderr, "%s[%zu/%zu files, %zu failed] read %.1f MiB, wrote %.1f MiB, %.1f MiB/s",
+            final ? "" : "\r", done, self->num_jobs, failed, mib(read), mib(written),
+            elapsed > 0.0 ? mib(read + written) / elapsed : 0.0);
+    if (final) {
+        fprintf(stderr, " in %.2f s\n", elapsed);
+    }
+    fflush(stderr);
+}
+
+static void dry_run(const Converter* self)
+{
+    WaveU64 total_read = 0, total_written = 0, total_joined = 0;
+    size_t  i;
+
+    for (i = 0; i < self->num_jobs; ++i) {
+        const Job *job = &self->jobs[i];
+        WaveU64    read = (WaveU64)job->in_length * job->in_frame_bits / 8;
+        WaveU64    written = (WaveU64)job->out_length * job->out_frame_bits / 8;
+
+        printf("%s -> %s: %zu -> %zu frames, read %.1f MiB, write %.1f MiB", job->input, job->output,
+               job->in_length, job->out_length, mib(read), mib(written));
+        if (job->num_parts > 1) {
+            printf(", %zu parts", job->num_parts);
+            total_joined += written;
+        }
+        printf("\n");
+
+        total_read += read;
+        total_written += written;
+    }
+
+    printf("estimated I/O for %zu files: read %.1f MiB, write %.1f MiB", self->num_jobs, mib(total_read), mib(total_written));
+    if (total_joined > 0) {
+        printf(", up to %.1f MiB more to join split files", mib(total_joined));
+    }
+    printf("\n");
+}
+
+static void usage(FILE* out)
+{
+    fprintf(out,
+            "usage: wave-convert [options] <file.wav | directory>...\n"
+            "\n"
+            "  -o DIR     output directory, directory inputs keep their relative paths\n"
+            "  -f FORMAT  output format: pcm, float, alaw, mulaw, ima or msadpcm (default: the input format);\n"
+            "             ext-pcm, ext-float, ext-alaw and ext-mulaw write WAVE_FORMAT_EXTENSIBLE\n"
+            "  -b BYTES   output bytes per sample (default: the input size, or the default of the format);\n"
+            "             ADPCM is always read and written as 2-byte samples\n"
+            "  -c N       output channels; fewer channels are averaged, more channels repeat the inputs\n"
+            "  -r RATE    output sample rate, resampled by linear interpolation without an anti-aliasing filter\n"
+            "  -j N       number of threads (default: number of CPUs)\n"
+            "  -S FRAMES  split files longer than FRAMES output frames across threads (default: %zu, 0 disables)\n"
+            "             ADPCM output is never split\n"
+            "  -n         dry run: list the conversions and the estimated I/O volume\n"
+            "  -q         do not print progress\n"
+            "  -h         show this help\n",
+            DEFAULT_SPLIT_FRAMES);
+}
+
+/* Run the workers until every task is done, returns the exit status */
+static int run_workers(Converter* self)
+{
+    Worker    *workers = calloc(self->options.num_threads, sizeof(Worker));
+    pthread_t *threads = calloc(self->options.num_threads, sizeof(pthread_t));
+    double     start = now();
+    size_t     t, num_started;
+
+    if (workers == NULL || threads == NULL) {
+        fprintf(stderr, "wave-convert: out of memory\n");
+        free(threads);
+        free(workers);
+        return EXIT_FAILURE;
+    }
+
+    /* the workers that did start steal the tasks of the ones that did not */
+    pthread_mutex_lock(&self->lock);
+    for (num_started = 0; num_started < self->options.num_threads; ++num_started) {
+        workers[num_started].converter = self;
+        workers[num_started].index = num_started;
+        if (pthread_create(&threads[num_started], NULL, worker_main, &workers[num_started]) != 0) {
+            fprintf(stderr, "wave-convert: cannot start a thread\n");
+            break;
+        }
+        ++self->workers_running;
+    }
+
+    while (self->workers_running > 0) {
+        struct timespec deadline;
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 250000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        pthread_cond_timedwait(&self->idle, &self->lock, &deadline);
+
+        if (self->workers_running > 0 && !self->options.quiet && isatty(STDERR_FILENO)) {
+            pthread_mutex_unlock(&self->lock);
+            print_progress(self, now() - start, 0);
+            pthread_mutex_lock(&self->lock);
+        }
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    for (t = 0; t < num_started; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    free(workers);
+
+    if (num_started == 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (!self->options.quiet) {
+        if (isatty(STDERR_FILENO)) {
+            fprintf(stderr, "\n");
+        }
+        print_progress(self, now() - start, 1);
+    }
+
+    for (t = 0; t < self->num_jobs; ++t) {
+        if (self->jobs[t].error != NULL) {
+            fprintf(stderr, "wave-convert: %s: %s\n", self->jobs[t].input, self->jobs[t].error);
+        }
+    }
+
+    return self->jobs_failed > 0 || num_started < self->options.num_threads ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Plan the inputs from {argv} and convert them, returns the exit status */
+static int run(Converter* self, int argc, char* argv[])
+{
+    int    i;
+    size_t t;
+
+    for (i = optind; i < argc; ++i) {
+        struct stat st;
+        const char *base;
+        int         ret;
+
+        if (stat(argv[i], &st) != 0) {
+            fprintf(stderr, "wave-convert: cannot stat %s: %s\n", argv[i], strerror(errno));
+            return EXIT_FAILURE;
+        }
+        base = strrchr(argv[i], '/');
+        ret = S_ISDIR(st.st_mode) ? add_directory(self, argv[i], "") : add_job(self, argv[i], base != NULL ? base + 1 : argv[i]);
+        if (ret != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (self->options.dry_run) {
+        dry_run(self);
+        return EXIT_SUCCESS;
+    }
+
+    for (t = 0; t < self->num_jobs; ++t) {
+        if (make_parents(self->jobs[t].output) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    if (plan_tasks(self) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    return run_workers(self);
+}
+
+int main(int argc, char* argv[])
+{
+    Converter  self;
+    long       ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int        opt, status;
+
+    memset(&self, 0, sizeof(self));
+    self.options.num_threads = ncpu > 0 ? (size_t)ncpu : 1;
+    self.options.split_frames = DEFAULT_SPLIT_FRAMES;
+
+    while ((opt = getopt(argc, argv, "o:f:b:c:r:j:S:nqh")) != -1) {
+        switch (opt) {
+            case 'o': self.options.output_dir = optarg; break;
+            case 'f':
+                if (!parse_format(optarg, &self.options.format, &self.options.sample_format)) {
+                    fprintf(stderr, "wave-convert: unknown format: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b': self.options.sample_size = strtoul(optarg, NULL, 10); break;
+            case 'c': self.options.num_channels = (WaveU16)strtoul(optarg, NULL, 10); break;
+            case 'r': self.options.sample_rate = (WaveU32)strtoul(optarg, NULL, 10); break;
+            case 'j': self.options.num_threads = strtoul(optarg, NULL, 10); break;
+            case 'S': self.options.split_frames = strtoul(optarg, NULL, 10); break;
+            case 'n': self.options.dry_run = 1; break;
+            case 'q': self.options.quiet = 1; break;
+            case 'h': usage(stdout); return EXIT_SUCCESS;
+            default: usage(stderr); return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc || self.options.output_dir == NULL) {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    if (self.options.num_threads == 0) {
+        self.options.num_threads = 1;
+    }
+
+    pthread_mutex_init(&self.lock, NULL);
+    pthread_cond_init(&self.idle, NULL);
+
+    status = run(&self, argc, argv);
+
+    free_converter(&self);
+    pthread_cond_destroy(&self.idle);
+    pthread_mutex_destroy(&self.lock);
+    return status;
+}